@@ -0,0 +1,141 @@
+//----------------------------------------------------------------------------
+// Copyright Persistant Studios, SARL.
+// https://popcornfx.com/popcornfx-community-license/
+//----------------------------------------------------------------------------
+#pragma once
+
+#ifndef	__FX_AEGP_FRAMECACHE_H__
+#define	__FX_AEGP_FRAMECACHE_H__
+
+#include "AEGP_Define.h"
+
+#include <pk_kernel/include/kr_threads_basics.h>
+#include <pk_kernel/include/kr_refcounted_buffer.h>
+
+__AEGP_PK_BEGIN
+
+//----------------------------------------------------------------------------
+
+struct	SFrameCacheKey
+{
+	u64		m_Hash[2];
+
+	SFrameCacheKey() { m_Hash[0] = 0; m_Hash[1] = 0; }
+
+	bool	operator == (const SFrameCacheKey &other) const { return m_Hash[0] == other.m_Hash[0] && m_Hash[1] == other.m_Hash[1]; }
+	bool	operator != (const SFrameCacheKey &other) const { return !(*this == other); }
+};
+
+//----------------------------------------------------------------------------
+
+// 128 bits hash of the inputs of a frame, processed 8 bytes at a time: fast enough to hash the input layer pixels.
+// Structures must be appended field by field, their padding is not initialized.
+class	CFrameCacheKeyBuilder
+{
+public:
+	CFrameCacheKeyBuilder();
+
+	void			Append(const void *data, u64 sizeInBytes);
+	template<typename _Type>
+	void			AppendValue(const _Type &value) { Append(&value, sizeof(value)); }
+	void			AppendString(const char *str);
+
+	SFrameCacheKey	Finish() const;
+
+private:
+	void			_MixWord(u64 word);
+
+	u64				m_Lanes[2];
+	u64				m_Length;
+};
+
+//----------------------------------------------------------------------------
+
+struct	SFrameCacheStats
+{
+	u64		m_Hits = 0;
+	u64		m_Misses = 0;
+	u64		m_RAMBytes = 0;
+	u64		m_DiskBytes = 0;
+	u32		m_EntryCount = 0;
+};
+
+//----------------------------------------------------------------------------
+
+// Rendered frames by key, run-length encoded per pixel. Least recently used frames above the RAM limit are spilled
+// to the disk directory when set, and deleted above the disk limit. The spilled files only live for the session.
+// Does not depend on the AE SDK: usable from any thread, and outside of AE.
+class	CFrameResultCache
+{
+public:
+	enum
+	{
+		kDefaultRAMLimitInMB = 1024,
+		kDefaultDiskLimitInMB = 0,
+	};
+
+	CFrameResultCache();
+	~CFrameResultCache();
+
+	// 0 RAM limit disables the cache, empty 'spillDirectory' or 0 disk limit disables the spill.
+	// 'spillDirectory' is a physical path owned by this cache, not shared with other processes: its previous frames are deleted.
+	void				SetLimits(u64 RAMLimitInBytes, u64 diskLimitInBytes, const CString &spillDirectory);
+	bool				Enabled() const { return m_RAMLimitInBytes != 0; }
+
+	// 'rows' are 'height' rows of 'width' pixels of 'pixelSizeInBytes' bytes, 'rowPitch' bytes apart
+	bool				Store(const SFrameCacheKey &key, const u8 *rows, u32 rowPitch, u32 width, u32 height, u32 pixelSizeInBytes);
+	// Fails when the frame is missing, or stored with other dimensions
+	bool				Fetch(const SFrameCacheKey &key, u8 *rows, u32 rowPitch, u32 width, u32 height, u32 pixelSizeInBytes);
+
+	void				Clear();
+	SFrameCacheStats	Stats();
+
+	// Spilled frames of a cache that was not cleared (crashed session)
+	static void			DeleteSpilledFrames(const CString &spillDirectory);
+
+private:
+	struct	SEntry
+	{
+		SFrameCacheKey				m_Key;
+		u32							m_Width;
+		u32							m_Height;
+		u32							m_PixelSizeInBytes;
+		PRefCountedMemoryBuffer		m_Data;				// null when only on disk, or while spilled
+		u32							m_DataSizeInBytes;
+		u64							m_LastUsedTick;
+		bool						m_OnDisk;
+	};
+
+	struct	SSpill
+	{
+		SEntry						m_Entry;			// Copy: the entry can be evicted during the write
+		CString						m_Path;
+	};
+
+	CGuid				_FindEntry(const SFrameCacheKey &key) const;
+	CString				_EntryPath(const SFrameCacheKey &key) const;
+	void				_RemoveEntry(u32 entryIdx, TArray<CString> &filesToDelete);
+	// Takes the data of the least recently used entries until the RAM limit is met: the ones to write are returned
+	void				_EvictRAM(TArray<SSpill> &spills, TArray<CString> &filesToDelete);
+	void				_EvictDisk(TArray<CString> &filesToDelete);
+	// Without 'm_Lock'
+	void				_WriteSpills(TArray<SSpill> &spills, TArray<CString> &filesToDelete);
+	void				_DeleteFiles(const TArray<CString> &filesToDelete);
+
+	Threads::CCriticalSection	m_Lock;
+	TArray<SEntry>				m_Entries;
+	u64							m_RAMLimitInBytes;
+	u64							m_DiskLimitInBytes;
+	CString						m_SpillDirectory;
+	u64							m_RAMBytes;
+	u64							m_DiskBytes;
+	u64							m_Tick;
+	u64							m_Hits;
+	u64							m_Misses;
+};
+
+//----------------------------------------------------------------------------
+
+__AEGP_PK_END
+
+#endif
@@ -133,6 +133,7 @@ struct SLayerHolder
 
 	float											m_ScaleFactor = 1;
 	bool											m_ForceRender = false;
+	TAtomic<u32>									m_RenderGeneration = 0;	// Part of the frame cache keys: bumped when the effect is rebaked or its render invalidated
 	bool											m_Deleted = false;
 
 	Threads::CCriticalSection						m_LayerLock;
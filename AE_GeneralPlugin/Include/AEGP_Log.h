@@ -28,13 +28,17 @@ namespace AAePk
 
 __AEGP_PK_BEGIN
 
+// Can be called from any thread, render threads included: only the out data of the current AE call is written
+// synchronously. The messages are queued and forwarded to the AE UI and debug log by FlushPendingMessages(),
+// from the idle hook, or at the end of each render when the idle hook never runs (command line renders).
+// Repeated messages are reported once every few seconds.
 class CAELog
 {
 	static bool					s_PKState;
-	static SAAEIOData			*s_IOData;
 public:
 	static bool		LogErrorWindows(SAAEIOData *AAEData, const CString errorStr);
 
+	// IO data of the AE call running on the calling thread
 	static bool		SetIOData(SAAEIOData *AAEData);
 	static void		ClearIOData();
 	static bool		TryLogErrorWindows(const CString errorStr);
@@ -42,6 +46,11 @@ public:
 
 
 	static bool		TryLogInfoWindows(const CString infoStr);
+
+	// AE UI thread only
+	static void		FlushPendingMessages();
+	// End of a render: flushes only if the idle hook never ran
+	static void		FlushPendingMessagesWithoutIdleHook();
 };
 
 //----------------------------------------------------------------------------
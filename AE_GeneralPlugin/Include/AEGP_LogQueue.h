@@ -0,0 +1,95 @@
+//----------------------------------------------------------------------------
+// Copyright Persistant Studios, SARL.
+// https://popcornfx.com/popcornfx-community-license/
+//----------------------------------------------------------------------------
+#pragma once
+
+#ifndef	__FX_AEGP_LOGQUEUE_H__
+#define	__FX_AEGP_LOGQUEUE_H__
+
+#include "AEGP_Define.h"
+
+#include <pk_kernel/include/kr_threads_basics.h>
+#include <pk_kernel/include/kr_delegates.h>
+
+#include <atomic>
+
+__AEGP_PK_BEGIN
+
+//----------------------------------------------------------------------------
+
+// Messages logged from any thread, forwarded by Flush() in the logging order of each thread.
+// Bounded: above the pending limit, messages are dropped and their count reported by the next flush.
+// Repeated messages are reported once every 'repeatDelay' seconds, with their repeat count.
+// Does not depend on the AE SDK: CAELog forwards the flushed messages to AE.
+class	CLogMessageQueue
+{
+public:
+	enum	ELevel
+	{
+		Level_Info,
+		Level_Error,
+	};
+
+	enum
+	{
+		kDefaultMaxPendingMessages = 512,
+		kDefaultMaxReportedMessages = 64,
+	};
+
+	typedef FastDelegate<void(ELevel level, const CString &text)>	CbReport;
+
+	CLogMessageQueue(u32 maxPendingMessages = kDefaultMaxPendingMessages, u32 maxReportedMessages = kDefaultMaxReportedMessages, double repeatDelay = 5.0);
+	~CLogMessageQueue();
+
+	// Any thread, lock-free
+	void		Push(ELevel level, const CString &text);
+
+	// Something to report: pending messages, dropped messages or repeats. Lock-free.
+	bool		HasWork() const;
+	u32			PendingCount() const { return m_PendingCount.load(); }
+
+	// Any thread, flushes are serialized. 'now' in seconds, monotonic.
+	// 'flushRepeats': reports the pending repeat counts without waiting for the repeat delay.
+	void		Flush(const CbReport &report, double now, bool flushRepeats);
+	// Forgets the reported messages, and their repeats not reported yet
+	void		ClearHistory();
+
+private:
+	struct	SMessage
+	{
+		SMessage	*m_Next = null;
+		ELevel		m_Level = Level_Info;
+		CString		m_Text;
+	};
+
+	// Last report of a message, and how many times it was logged since
+	struct	SReportedMessage
+	{
+		ELevel		m_Level;
+		CString		m_Text;
+		double		m_LastReportTime;
+		u32			m_SuppressedCount;
+	};
+
+	bool		_ShouldReport(ELevel level, const CString &text, double now, u32 &outRepeatCount);
+
+	const u32					m_MaxPendingMessages;
+	const u32					m_MaxReportedMessages;
+	const double				m_RepeatDelay;
+
+	// Multiple producers: the messages are pushed on a lock-free stack, taken whole by the flush
+	std::atomic<SMessage*>		m_PendingHead;
+	std::atomic<u32>			m_PendingCount;
+	std::atomic<u32>			m_DroppedCount;
+	std::atomic<u32>			m_SuppressedCount;	// Sum of the SReportedMessage::m_SuppressedCount, read without the flush lock
+
+	Threads::CCriticalSection	m_FlushLock;
+	TArray<SReportedMessage>	m_ReportedMessages;
+};
+
+//----------------------------------------------------------------------------
+
+__AEGP_PK_END
+
+#endif
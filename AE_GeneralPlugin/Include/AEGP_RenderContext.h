@@ -72,6 +72,25 @@ public:
 private:
 	bool		CreateInternalWindowIFN(const CString& className);
 
+	// AE alternates between a few frame sizes (full/half resolution, regions of interest, other comps): the scene renderers
+	// of the recently used sizes are kept, with their render targets, so switching back to one of them does not resize anything.
+	struct	SSceneRenderer
+	{
+		PKSample::CRHIParticleSceneRenderHelper	*m_Renderer = null;
+		RHI::EPixelFormat						m_Format = RHI::FormatUnknown;
+		CUint2									m_Size = CUint2(0);
+		u32										m_RenderPasses = 0;	// Planned from the post-FX options
+		TArray<RHI::PRenderTarget>				m_RenderTargets;	// Render targets it was last resized with
+		u32										m_LastUsedFrame = 0;
+	};
+
+	static const u32	kMaxSceneRenderers = 3;
+	static const u32	kSceneRendererMaxAge = 64;	// Unused frames before releasing a kept scene renderer
+
+	bool		_SetupSceneRenderer(SSceneRenderer &sceneRenderer, bool newRenderer);
+	void		_ReleaseSceneRenderer(u32 index);
+	void		_ReleaseAgedSceneRenderers();
+
 	void									*m_WindowHandle;
 	void									*m_DeviceContext;
 
@@ -92,7 +111,9 @@ private:
 	bool									m_IsOverride = false;
 	float									m_AlphaValue = 1.0f;
 
-	PKSample::CRHIParticleSceneRenderHelper	*m_RHIRendering;
+	PKSample::CRHIParticleSceneRenderHelper	*m_RHIRendering;	// Renderer of the current size, owned by m_SceneRenderers
+	TArray<SSceneRenderer>					m_SceneRenderers;
+	u32										m_FrameIndex = 0;
 
 	//Shared between rendercontexts
 	PKSample::CShaderLoader					*m_ShaderLoader;
@@ -23,6 +23,7 @@
 
 #include "AEGP_Attribute.h"
 #include "AEGP_ParticleScene.h"
+#include "AEGP_SceneMemory.h"
 
 #include <PopcornFX_Define.h>
 
@@ -93,7 +94,7 @@ PK_FORWARD_DECLARE(AAEScene);
 
 //----------------------------------------------------------------------------
 
-class	CAAEScene : public CRefCountedObject
+class	CAAEScene : public CRefCountedObject, public ISceneMemoryClient
 {
 public:
 
@@ -131,6 +132,8 @@ public:
 	void									UpdateBackdropTransform(SEmitterDesc *desc);
 	bool									UpdateBackdrop(SLayerHolder *layer, SEmitterDesc *desc);
 	bool									Render(SAAEIOData &AAEData);
+	// The last Render() wrote the output world: not aborted, and no error
+	bool									LastRenderCompleted() const { return m_LastRenderCompleted; }
 
 	bool									ResetEffect(bool unload);
 
@@ -138,6 +141,16 @@ public:
 	HBO::CContext							*GetContext() { return m_HBOContext;  }
 	bool									GetEmitterBounds(CAABB &bounds);
 
+	SLayerHolder							*GetLayerHolder() const { return m_LayerHolder; }
+
+	// Memory budget, see AEGP_SceneMemory.h. Render lock held, and layer lock for ComputeMemoryUsage().
+	virtual u32								MemoryClientID() const override { return m_ID; }
+	virtual void							ComputeMemoryUsage(SSceneMemoryUsage &outUsage) override;
+	// Skipped when the layer is busy with an AE update
+	virtual bool							TryReleaseDerivedState(SSceneMemoryUsage &outRemainingUsage) override;
+	// Releases what the next render rebuilds: simulated particles, batches and their buffers, draw calls and skinned data.
+	void									ReleaseDerivedState();
+
 	void									SetLayerHolder(SLayerHolder *parent);
 	void									SetCameraViewMatrix(const CFloat4x4 &viewMatrix, const CFloat4 &pos, const float cameraZoom);
 
@@ -310,6 +323,8 @@ protected:
 private:
 	TArray<SRendererProperties*>			m_OverridableProperties;
 	bool									m_ForceRestartSeeking;
+	bool									m_SimulationReset;			// Medium collection cleared outside of the seeking: the next update restarts from the effect start
+	bool									m_LastRenderCompleted;
 };
 PK_DECLARE_REFPTRCLASS(AAEScene);
 
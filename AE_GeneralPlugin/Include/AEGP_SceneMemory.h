@@ -0,0 +1,119 @@
+//----------------------------------------------------------------------------
+// Copyright Persistant Studios, SARL.
+// https://popcornfx.com/popcornfx-community-license/
+//----------------------------------------------------------------------------
+#pragma once
+
+#ifndef	__FX_AEGP_SCENEMEMORY_H__
+#define	__FX_AEGP_SCENEMEMORY_H__
+
+#include "AEGP_Define.h"
+
+#include <pk_kernel/include/kr_threads_basics.h>
+
+__AEGP_PK_BEGIN
+
+//----------------------------------------------------------------------------
+
+struct	SSceneMemoryUsage
+{
+	enum	ECategory
+	{
+		Category_Particles = 0,		// Estimated from the particle counts of the last draw calls
+		Category_RenderBuffers,		// GPU buffers referenced by the last draw calls
+		Category_SkinnedMeshes,
+		Category_ImageSamplers,
+		Category_AudioSamplers,
+		_Category_Count
+	};
+
+	u64		m_Bytes[_Category_Count];
+
+	SSceneMemoryUsage() { Clear(); }
+
+	void	Clear() { Mem::Clear(m_Bytes); }
+	u64		Total() const;
+};
+
+//----------------------------------------------------------------------------
+
+// A scene as seen by the memory budget. Implemented by CAAEScene.
+class	ISceneMemoryClient
+{
+public:
+	virtual ~ISceneMemoryClient() { }
+
+	virtual u32		MemoryClientID() const = 0;
+	virtual void	ComputeMemoryUsage(SSceneMemoryUsage &outUsage) = 0;
+	// Releases what the next render rebuilds and fills the remaining usage.
+	// Returns false without releasing anything when the scene is busy: the tracker lock is held, it must not wait.
+	virtual bool	TryReleaseDerivedState(SSceneMemoryUsage &outRemainingUsage) = 0;
+};
+
+//----------------------------------------------------------------------------
+
+// After each render, the least recently rendered clients release their derived state until the total fits the budget.
+// The client just rendered and the busy ones are skipped.
+class	CSceneMemoryTracker
+{
+public:
+	CSceneMemoryTracker(u64 budgetInBytes);
+
+	// 0 disables the eviction
+	void				SetBudget(u64 budgetInBytes);
+	u64					Budget() const;
+	u64					TotalUsedBytes() const;
+	// Per category, all the registered clients
+	SSceneMemoryUsage	TotalUsage() const;
+
+	void				OnSceneRendered(ISceneMemoryClient *client);
+	// Before 'client' releases its resources, waits for an eviction in progress
+	void				UnregisterScene(ISceneMemoryClient *client);
+
+private:
+	struct	SSceneEntry
+	{
+		ISceneMemoryClient	*m_Client;
+		SSceneMemoryUsage	m_Usage;
+		u64					m_LastRenderedTick;
+		bool				m_Released;
+	};
+
+	u64					_TotalUsedBytes() const;
+	CGuid				_FindScene(const ISceneMemoryClient *client) const;
+
+	// Eviction and unregistration are serialized: a client cannot be destroyed while it is being released
+	mutable Threads::CCriticalSection	m_Lock;
+	TArray<SSceneEntry>					m_Scenes;
+	u64									m_BudgetInBytes;
+	u64									m_RenderTick;
+	bool								m_OverBudgetReported;
+};
+
+//----------------------------------------------------------------------------
+
+// Global memory budget of the scenes (see CAAEScene::TryReleaseDerivedState()).
+// Released scenes are rebuilt by their next render, which restarts the simulation from the effect start.
+class	CSceneMemoryBudget
+{
+public:
+	enum	{ kDefaultBudgetInMB = 4096 };
+
+	// 0 disables the eviction
+	static void		SetBudget(u64 budgetInBytes);
+	static u64		Budget();
+	static u64		TotalUsedBytes();
+	// Per category, all the registered scenes
+	static SSceneMemoryUsage	TotalUsage();
+
+	// Render lock and layer lock of 'scene' held
+	static void		OnSceneRendered(ISceneMemoryClient *scene);
+	// Before 'scene' releases its resources, waits for an eviction in progress
+	static void		UnregisterScene(ISceneMemoryClient *scene);
+};
+
+//----------------------------------------------------------------------------
+
+__AEGP_PK_END
+
+#endif
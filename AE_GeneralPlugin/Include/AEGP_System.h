@@ -40,6 +40,10 @@ public: // Get Hardware ID
 
 	static bool				LaunchEditorAsPopup();
 
+	static u32				GetCurrentProcessID();
+	// Also true for the processes of other users
+	static bool				IsProcessRunning(u32 processID);
+
 private:
 	static u16			*_ComputeSystemUniqueId();
 
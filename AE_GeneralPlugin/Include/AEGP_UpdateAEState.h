@@ -34,6 +34,8 @@ public:
 
 	static bool		GetLightsAtTime(SLayerHolder *layer, A_Time &AETime, TArray<SLightDesc> &lights);
 	static bool		GetCameraViewMatrixAtTime(SLayerHolder *layer, CFloat4x4 &view, CFloat4 &pos, A_Time &AETime, float &cameraZoom);
+	// Attribute and sampler parameters only, without sampling other layers: false when a sampler needs them (image, audio)
+	static bool		UpdateParametersAtTime(SLayerHolder *targetLayer, A_Time &AETime);
 
 	static int		s_AttributeIndexes[__Attribute_Parameters_Count];
 	static int		s_EmitterIndexes[__Effect_Parameters_Count];
@@ -32,6 +32,7 @@
 #include "AEGP_Scene.h"
 #include "AEGP_LayerHolder.h"
 #include "AEGP_VaultHandler.h"
+#include "AEGP_FrameCache.h"
 
 #include <pk_rhi/include/Enums.h>
 
@@ -265,6 +266,15 @@ public:
 private:
 	CPopcornFXWorld();
 
+	// Profiler trace of a single AE render, when enabled by the PK_AE_PROFILER_TRACE environment variable
+	void					_BeginRenderTrace();
+	void					_EndRenderTrace(SLayerHolder *layer);
+
+	// Frame cache, see AEGP_FrameCache.h. Layer lock held.
+	bool					_AppendParameterAnimations(CFrameCacheKeyBuilder &builder, SLayerHolder *layer);
+	bool					_BuildFrameCacheKey(SAAEIOData &AAEData, SLayerHolder *layer, SEmitterDesc *desc, A_Time &AETime, SFrameCacheKey &outKey);
+	bool					_FetchCachedFrame(SAAEIOData &AAEData, const SFrameCacheKey &key);
+	void					_StoreRenderedFrame(SAAEIOData &AAEData, const SFrameCacheKey &key);
 
 	static CPopcornFXWorld			*m_Instance;
 
@@ -313,6 +323,11 @@ private:
 	TArray<SUIEvent*>				m_UIEvents;
 
 	Threads::CCriticalSection		m_RenderLock;
+
+	bool							m_ProfilingSession = false;		// Started from the panel
+	bool							m_TraceEachRender = false;
+
+	CFrameResultCache				m_FrameCache;
 };
 
 //----------------------------------------------------------------------------
@@ -9,6 +9,7 @@
 
 #include "AEGP_Define.h"
 #include <PK-SampleLib/RHIRenderParticleSceneHelpers.h>
+#include <PK-SampleLib/PipelineCacheHelper.h>
 #include "AEGP_RenderContext.h"
 
 namespace AAePk {
@@ -39,7 +40,11 @@ public:
 	virtual bool	InitIFN()			{ return true; };
 
 	virtual bool	CreatePlatformContext(void *winHandle, void *deviceContext) { (void)winHandle; (void)deviceContext; return false; };
+	// Makes a render target of 'size' current. Contexts that keep the render targets of the previous sizes give back the same
+	// render target objects when a size is requested again: the renderers drawing into them do not need to be resized.
 	virtual bool	CreateRenderTarget(RHI::EPixelFormat format, CUint3 size) { (void)format; (void)size; return false; };
+	// The kept render target of 'size' is not needed anymore (never releases the current one)
+	virtual void	ReleaseRenderTarget(RHI::EPixelFormat format, CUint3 size) { (void)format; (void)size; };
 
 	virtual TMemoryView<const RHI::PRenderTarget>	GetCurrentSwapChain() { return TMemoryView<const RHI::PRenderTarget>(); };
 
@@ -47,6 +52,11 @@ public:
 
 	virtual bool	FillRenderBuffer(PRefCountedMemoryBuffer dstBuffer, RHI::PFrameBuffer srcBuffer, RHI::EPixelFormat format, u32 width, u32 height, u32 rowLength) { (void)dstBuffer; (void)srcBuffer; (void)format; (void)width; (void)height; (void)rowLength;  return false; };
 
+	// Reads the rendered frame straight from the readback memory (no FillRenderBuffer() copy), until UnmapRenderBuffer() is called.
+	// Returns false if the context cannot map it: FillRenderBuffer() must be used.
+	virtual bool	MapRenderBuffer(RHI::EPixelFormat format, u32 width, u32 height, const u8 *&outRows, u32 &outRowPitch) { (void)format; (void)width; (void)height; (void)outRows; (void)outRowPitch; return false; };
+	virtual void	UnmapRenderBuffer() { };
+
 	virtual bool	FillCompositingTexture(void* srcBuffer, RHI::EPixelFormat format, u32 width, u32 height, u32 rowLength) { (void)srcBuffer; (void)format; (void)width; (void)height; (void)rowLength; return false; };
 
 	RHI::PApiManager			GetApiManager();
@@ -54,11 +64,20 @@ public:
 	RHI::PTexture				GetCompositingTexture();
 
 protected:
+	// Pipeline cache, persisted in the vault. The contexts call _LoadPipelineCache() with their adapter's IDs once the api manager is initialized,
+	// _UpdatePipelineCache() at the end of each frame, and _FlushPipelineCache() before releasing their device.
+	void						_LoadPipelineCache(const PKSample::SPipelineCacheDeviceID &deviceID);
+	void						_UpdatePipelineCache();
+	void						_FlushPipelineCache();
+
 	bool						m_Initialized = false;
 	RHI::PApiManager			m_ApiManager;
 	RHI::SApiContext			*m_ApiContext;
 
 	RHI::PTexture				m_CompositingTexture;
+
+	PKSample::CPipelineCacheHelper	m_PipelineCache;
+	CString						m_PipelineCachePath;
 };
 
 //----------------------------------------------------------------------------
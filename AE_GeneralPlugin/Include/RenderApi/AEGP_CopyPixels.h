@@ -27,6 +27,10 @@ struct	SCopyPixel {
 
 	bool						m_IsAlphaOverride;
 	double						m_AlphaOverrideValue;
+
+	// CopyPixelOut: rendered pixels, can point to the mapped readback memory (not to m_BufferPtr)
+	const u8					*m_SrcRows;
+	u32							m_SrcRowPitch;
 };
 
 //----------------------------------------------------------------------------
@@ -35,9 +39,15 @@ PF_Err	CopyPixelIn32(void *refcon, A_long x, A_long y, PF_Pixel32 *inP, PF_Pixel
 PF_Err	CopyPixelIn16(void *refcon, A_long x, A_long y, PF_Pixel16 *inP, PF_Pixel16 *);
 PF_Err	CopyPixelIn8(void *refcon, A_long x, A_long y, PF_Pixel8 *inP, PF_Pixel8 *);
 
+// Whether CopyPixelIn* would write the same value for the whole input world (solid or empty layer), returns that value.
+// Only reads the pixels inside 'extentHint': the layer is transparent outside of it.
+bool	GetConstantPixelIn(const SCopyPixel &refcon, PF_PixelFormat format, const PF_Rect &extentHint, bool hasOrigin, CFloat4 &outValue);
+
 PF_Err	CopyPixelOut32(void *refcon, A_long x, A_long y, PF_Pixel32 *, PF_Pixel32 *outP);
 PF_Err	CopyPixelOut16(void *refcon, A_long x, A_long y, PF_Pixel16 *, PF_Pixel16 *outP);
 PF_Err	CopyPixelOut8(void *refcon, A_long x, A_long y, PF_Pixel8 *, PF_Pixel8 *outP);
+// Rendered pixels already sRGB encoded and quantized by the GPU (FormatSrgb8RGBA): only reordered to ARGB
+PF_Err	CopyPixelOutSrgb8(void *refcon, A_long x, A_long y, PF_Pixel8 *, PF_Pixel8 *outP);
 
 //----------------------------------------------------------------------------
 
@@ -42,10 +42,13 @@ public:
 	virtual bool	InitIFN()				override;
 	virtual bool	CreatePlatformContext(void *winHandle, void *deviceContext)	override;
 	virtual bool	CreateRenderTarget(RHI::EPixelFormat format, CUint3 size)	override;
+	virtual void	ReleaseRenderTarget(RHI::EPixelFormat format, CUint3 size)	override;
 
 	virtual bool	SetAsCurrent(void *deviceContext) override;
 
 	virtual bool	FillRenderBuffer(PRefCountedMemoryBuffer dstBuffer, RHI::PFrameBuffer srcBuffer, RHI::EPixelFormat format, u32 width, u32 height, u32 rowLength)	override;
+	virtual bool	MapRenderBuffer(RHI::EPixelFormat format, u32 width, u32 height, const u8 *&outRows, u32 &outRowPitch) override;
+	virtual void	UnmapRenderBuffer() override;
 
 	virtual bool	FillCompositingTexture(void* srcBuffer, RHI::EPixelFormat format, u32 width, u32 height, u32 rowLength) override;
 	
@@ -60,8 +63,22 @@ private:
 	RHI::CD3D11ApiManager		*m_D3D11Manager = null;
 	SD3D11PlatformContext		*m_Context = null;
 
+	// Render targets kept for each requested size, m_Texture and m_StagingTexture are the current ones
+	struct	SRenderTargetSet
+	{
+		RHI::EPixelFormat			m_Format;
+		CUint3						m_Size;
+		ID3D11Texture2D				*m_Texture;
+		ID3D11Texture2D				*m_StagingTexture;
+		RHI::PD3D11RenderTarget		m_RenderTarget;
+	};
+	void	_SetCurrentRenderTarget(const SRenderTargetSet &set);
+	void	_ReleaseRenderTargetSet(SRenderTargetSet &set);
+
+	TArray<SRenderTargetSet>		m_RenderTargetSets;
 	ID3D11Texture2D					*m_Texture = null;
 	ID3D11Texture2D					*m_StagingTexture = null;
+	bool							m_StagingTextureMapped = false;
 	RHI::PD3D11RenderTarget			m_SwapChainRenderTarget;
 
 
@@ -57,11 +57,14 @@ public:
 	virtual bool	InitIFN()				override;
 	virtual bool	CreatePlatformContext(void *winHandle, void *deviceContext)	override;
 	virtual bool	CreateRenderTarget(RHI::EPixelFormat format, CUint3 size)	override;
+	virtual void	ReleaseRenderTarget(RHI::EPixelFormat format, CUint3 size)	override;
 
 
 	virtual bool	SetAsCurrent(void *deviceContext) override;
 
 	virtual bool	FillRenderBuffer(PRefCountedMemoryBuffer dstBuffer, RHI::PFrameBuffer srcBuffer, RHI::EPixelFormat format, u32 width, u32 height, u32 rowLength) override;
+	virtual bool	MapRenderBuffer(RHI::EPixelFormat format, u32 width, u32 height, const u8 *&outRows, u32 &outRowPitch) override;
+	virtual void	UnmapRenderBuffer() override;
 
 	virtual bool	FillCompositingTexture(void* srcBuffer, RHI::EPixelFormat format, u32 width, u32 height, u32 rowLength) override;
 
@@ -81,11 +84,13 @@ private:
 	bool					CreateDescriptorAllocator();
 	PRefCountedMemoryBuffer CreateBufferFromReadBackTexture(RHI::PCReadBackTexture readBackTexture) const;
 	void					ClearContextSwapchainsRT();
+	void					SetCurrentSwapchainRT(u32 keptIdx);
 
 	RHI::CD3D12ApiManager		*m_D3D12Manager;
 	SD3D12PlatformContext		*m_Context;
 	RHI::PD3D12Fence			m_Fence;
 	u64							m_FrameCount = 0;
+	RHI::PReadBackTexture		m_MappedReadBackTexture;
 
 
 	ID3D12Resource					*m_Resources[CAAED3D12Context::kFrameCount];
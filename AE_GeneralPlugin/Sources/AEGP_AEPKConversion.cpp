@@ -69,6 +69,7 @@ u32	GetPixelSizeFromPixelFormat(RHI::EPixelFormat format)
 	switch (format)
 	{
 	case RHI::EPixelFormat::FormatUnorm8RGBA:
+	case RHI::EPixelFormat::FormatSrgb8RGBA:
 		return sizeof(PF_Pixel8);
 		break;
 	case  RHI::EPixelFormat::FormatUnorm16RGBA:
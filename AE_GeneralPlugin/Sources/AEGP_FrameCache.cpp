@@ -0,0 +1,744 @@
+//----------------------------------------------------------------------------
+// Copyright Persistant Studios, SARL.
+// https://popcornfx.com/popcornfx-community-license/
+//----------------------------------------------------------------------------
+#include "ae_precompiled.h"
+
+#include "AEGP_FrameCache.h"
+
+#include <pk_kernel/include/kr_file.h>
+#include <pk_kernel/include/kr_file_directory_walker.h>
+
+#include <string.h>
+
+__AEGP_PK_BEGIN
+//----------------------------------------------------------------------------
+
+namespace
+{
+	const u32	kSpillFileMagic = 0x43464B50;	// 'PKFC'
+	const u32	kSpillFileVersion = 1;
+	const char	kSpillFileExtension[] = "pkfc";
+
+	// Token of the run-length encoding: high bit set for a run of identical pixels followed by the pixel,
+	// else literal pixels follow. The 7 low bits are the pixel count - 1.
+	const u32	kRunFlag = 0x80;
+	const u32	kMaxTokenPixels = 0x80;
+
+	struct	SSpillFileHeader
+	{
+		u32		m_Magic;
+		u32		m_Version;
+		u64		m_Key[2];
+		u32		m_Width;
+		u32		m_Height;
+		u32		m_PixelSizeInBytes;
+		u32		m_DataSizeInBytes;
+		u64		m_DataChecksum;
+	};
+
+	//----------------------------------------------------------------------------
+
+	inline u64	_Rotl64(u64 value, u32 shift)
+	{
+		return (value << shift) | (value >> (64 - shift));
+	}
+
+	//----------------------------------------------------------------------------
+
+	inline u64	_FMix64(u64 value)
+	{
+		value ^= value >> 33;
+		value *= 0xFF51AFD7ED558CCDULL;
+		value ^= value >> 33;
+		value *= 0xC4CEB9FE1A85EC53ULL;
+		value ^= value >> 33;
+		return value;
+	}
+
+	//----------------------------------------------------------------------------
+
+	u64		_Checksum(const void *data, u64 sizeInBytes)
+	{
+		CFrameCacheKeyBuilder	builder;
+		builder.Append(data, sizeInBytes);
+		return builder.Finish().m_Hash[0];
+	}
+
+	//----------------------------------------------------------------------------
+
+	u64		_DiskSizeInBytes(u32 dataSizeInBytes)
+	{
+		return sizeof(SSpillFileHeader) + dataSizeInBytes;
+	}
+
+	//----------------------------------------------------------------------------
+
+	// Returns the size of the encoded row, 'dst' holds at least width * (pixelSizeInBytes + 1) bytes
+	u32		_EncodeRow(const u8 *src, u32 width, u32 pixelSizeInBytes, u8 *dst)
+	{
+		u8		*out = dst;
+		u32		x = 0;
+		while (x < width)
+		{
+			const u8	*pixel = src + x * pixelSizeInBytes;
+			u32			runLength = 1;
+			while (x + runLength < width && runLength < kMaxTokenPixels &&
+				   memcmp(pixel, pixel + runLength * pixelSizeInBytes, pixelSizeInBytes) == 0)
+				++runLength;
+			if (runLength > 1)
+			{
+				*out++ = static_cast<u8>(kRunFlag | (runLength - 1));
+				Mem::Copy(out, pixel, pixelSizeInBytes);
+				out += pixelSizeInBytes;
+				x += runLength;
+				continue;
+			}
+
+			// Literals up to the next pair of identical pixels
+			u32		literalCount = 1;
+			while (x + literalCount < width && literalCount < kMaxTokenPixels)
+			{
+				const u8	*next = pixel + literalCount * pixelSizeInBytes;
+				if (x + literalCount + 1 < width && memcmp(next, next + pixelSizeInBytes, pixelSizeInBytes) == 0)
+					break;
+				++literalCount;
+			}
+			*out++ = static_cast<u8>(literalCount - 1);
+			Mem::Copy(out, pixel, literalCount * pixelSizeInBytes);
+			out += literalCount * pixelSizeInBytes;
+			x += literalCount;
+		}
+		return static_cast<u32>(out - dst);
+	}
+
+	//----------------------------------------------------------------------------
+
+	bool	_Encode(const u8 *rows, u32 rowPitch, u32 width, u32 height, u32 pixelSizeInBytes, TArray<u8> &outData)
+	{
+		TArray<u8>	encodedRow;
+		if (!encodedRow.Resize(width * (pixelSizeInBytes + 1)))
+			return false;
+		outData.Clear();
+		for (u32 y = 0; y < height; ++y)
+		{
+			const u32	rowSize = _EncodeRow(rows + u64(y) * rowPitch, width, pixelSizeInBytes, encodedRow.RawDataPointer());
+			const u32	offset = outData.Count();
+			if (u64(offset) + rowSize > TNumericTraits<u32>::kMax ||
+				!outData.Resize(offset + rowSize))
+				return false;
+			Mem::Copy(outData.RawDataPointer() + offset, encodedRow.RawDataPointer(), rowSize);
+		}
+		return true;
+	}
+
+	//----------------------------------------------------------------------------
+
+	// Validates the whole stream: the spilled files are decoded with it too
+	bool	_Decode(const u8 *src, u32 srcSizeInBytes, u8 *rows, u32 rowPitch, u32 width, u32 height, u32 pixelSizeInBytes)
+	{
+		const u8	*srcEnd = src + srcSizeInBytes;
+		for (u32 y = 0; y < height; ++y)
+		{
+			u8		*dst = rows + u64(y) * rowPitch;
+			u32		x = 0;
+			while (x < width)
+			{
+				if (src >= srcEnd)
+					return false;
+				const u32	token = *src++;
+				const u32	count = (token & ~kRunFlag) + 1;
+				if (x + count > width)
+					return false;
+				if ((token & kRunFlag) != 0)
+				{
+					if (u64(srcEnd - src) < pixelSizeInBytes)
+						return false;
+					for (u32 i = 0; i < count; ++i)
+						Mem::Copy(dst + (x + i) * pixelSizeInBytes, src, pixelSizeInBytes);
+					src += pixelSizeInBytes;
+				}
+				else
+				{
+					const u32	sizeInBytes = count * pixelSizeInBytes;
+					if (u64(srcEnd - src) < sizeInBytes)
+						return false;
+					Mem::Copy(dst + x * pixelSizeInBytes, src, sizeInBytes);
+					src += sizeInBytes;
+				}
+				x += count;
+			}
+		}
+		return src == srcEnd;
+	}
+
+	//----------------------------------------------------------------------------
+
+	bool	_WriteSpillFile(const CString &path, const SFrameCacheKey &key, u32 width, u32 height, u32 pixelSizeInBytes, const u8 *data, u32 dataSizeInBytes)
+	{
+		PK_NAMEDSCOPEDPROFILE("CFrameResultCache::WriteSpillFile");
+		SSpillFileHeader	header;
+		header.m_Magic = kSpillFileMagic;
+		header.m_Version = kSpillFileVersion;
+		header.m_Key[0] = key.m_Hash[0];
+		header.m_Key[1] = key.m_Hash[1];
+		header.m_Width = width;
+		header.m_Height = height;
+		header.m_PixelSizeInBytes = pixelSizeInBytes;
+		header.m_DataSizeInBytes = dataSizeInBytes;
+		header.m_DataChecksum = _Checksum(data, dataSizeInBytes);
+
+		IFileSystem		*fs = File::DefaultFileSystem();
+		PFileStream		fileView = fs->OpenStream(path, IFileSystem::Access_WriteCreate, true);
+		if (fileView == null)
+		{
+			CLog::Log(PK_WARN, "Could not spill the cached frame: failed opening \"%s\"", path.Data());
+			return false;
+		}
+		const bool		written =	fileView->Write(&header, sizeof(header)) != 0 &&
+									fileView->Write(data, dataSizeInBytes) != 0;
+		fileView->Close();
+		if (!written)
+		{
+			CLog::Log(PK_WARN, "Could not spill the cached frame: failed writing \"%s\"", path.Data());
+			fs->FileDelete(path, true);
+			return false;
+		}
+		return true;
+	}
+
+	//----------------------------------------------------------------------------
+
+	PRefCountedMemoryBuffer	_ReadSpillFile(const CString &path, const SFrameCacheKey &key, u32 width, u32 height, u32 pixelSizeInBytes, u32 &outDataSizeInBytes)
+	{
+		PK_NAMEDSCOPEDPROFILE("CFrameResultCache::ReadSpillFile");
+		PFileStream		fileView = File::DefaultFileSystem()->OpenStream(path, IFileSystem::Access_Read, true);
+		if (fileView == null)
+			return null;
+		u32				fileSize = 0;
+		u8				*fileData = static_cast<u8*>(fileView->Bufferize(fileSize));
+		fileView->Close();
+		if (fileData == null)
+			return null;
+
+		PRefCountedMemoryBuffer	data;
+		SSpillFileHeader		header;
+		if (fileSize >= sizeof(header))
+		{
+			Mem::Copy(&header, fileData, sizeof(header));
+			const u8	*payload = fileData + sizeof(header);
+			if (header.m_Magic == kSpillFileMagic &&
+				header.m_Version == kSpillFileVersion &&
+				header.m_Key[0] == key.m_Hash[0] &&
+				header.m_Key[1] == key.m_Hash[1] &&
+				header.m_Width == width &&
+				header.m_Height == height &&
+				header.m_PixelSizeInBytes == pixelSizeInBytes &&
+				_DiskSizeInBytes(header.m_DataSizeInBytes) == fileSize &&
+				header.m_DataChecksum == _Checksum(payload, header.m_DataSizeInBytes))
+			{
+				data = CRefCountedMemoryBuffer::Alloc(header.m_DataSizeInBytes);
+				if (data != null)
+				{
+					Mem::Copy(data->Data<u8>(), payload, header.m_DataSizeInBytes);
+					outDataSizeInBytes = header.m_DataSizeInBytes;
+				}
+			}
+		}
+		PK_FREE(fileData);
+		if (data == null)
+			CLog::Log(PK_WARN, "Ignored the invalid cached frame \"%s\"", path.Data());
+		return data;
+	}
+
+	//----------------------------------------------------------------------------
+
+	class	CSpilledFramesWalker : public CFileDirectoryWalker
+	{
+	public:
+		TArray<CString>	m_Files;
+
+		CSpilledFramesWalker(const CString &directory)
+		:	CFileDirectoryWalker(directory, IgnoreVirtualFS)
+		{
+		}
+
+		virtual bool	DirectoryNotifier(const CFilePack *, const char *, u32) override
+		{
+			return false;
+		}
+
+		virtual void	FileNotifier(const CFilePack *, const char *fullPath, u32) override
+		{
+			const char	*extension = CFilePath::ExtractExtension(fullPath);
+			if (extension != null && !strcasecmp(extension, kSpillFileExtension))
+				m_Files.PushBack(fullPath);
+		}
+	};
+}
+
+//----------------------------------------------------------------------------
+//
+//	CFrameCacheKeyBuilder
+//
+//----------------------------------------------------------------------------
+
+CFrameCacheKeyBuilder::CFrameCacheKeyBuilder()
+:	m_Length(0)
+{
+	m_Lanes[0] = 0x9E3779B97F4A7C15ULL;
+	m_Lanes[1] = 0xC2B2AE3D27D4EB4FULL;
+}
+
+//----------------------------------------------------------------------------
+
+void	CFrameCacheKeyBuilder::_MixWord(u64 word)
+{
+	const u64	k0 = _Rotl64(word * 0x87C37B91114253D5ULL, 31) * 0x4CF5AD432745937FULL;
+	m_Lanes[0] = (_Rotl64(m_Lanes[0] ^ k0, 27) + m_Lanes[1]) * 5 + 0x52DCE729;
+	const u64	k1 = _Rotl64(word * 0x4CF5AD432745937FULL, 33) * 0x87C37B91114253D5ULL;
+	m_Lanes[1] = (_Rotl64(m_Lanes[1] ^ k1, 31) + m_Lanes[0]) * 5 + 0x38495AB5;
+}
+
+//----------------------------------------------------------------------------
+
+void	CFrameCacheKeyBuilder::Append(const void *data, u64 sizeInBytes)
+{
+	const u8	*src = static_cast<const u8*>(data);
+	m_Length += sizeInBytes;
+	while (sizeInBytes >= sizeof(u64))
+	{
+		u64		word;
+		Mem::Copy(&word, src, sizeof(u64));
+		_MixWord(word);
+		src += sizeof(u64);
+		sizeInBytes -= sizeof(u64);
+	}
+	if (sizeInBytes != 0)
+	{
+		// Tail tagged with its size in the unused high byte
+		u64		word = 0;
+		Mem::Copy(&word, src, sizeInBytes);
+		_MixWord(word ^ (sizeInBytes << 56));
+	}
+}
+
+//----------------------------------------------------------------------------
+
+void	CFrameCacheKeyBuilder::AppendString(const char *str)
+{
+	const u64	length = str != null ? strlen(str) : 0;
+	AppendValue(length);
+	Append(str, length);
+}
+
+//----------------------------------------------------------------------------
+
+SFrameCacheKey	CFrameCacheKeyBuilder::Finish() const
+{
+	u64		h0 = m_Lanes[0] ^ m_Length;
+	u64		h1 = m_Lanes[1] ^ m_Length;
+	h0 += h1;
+	h1 += h0;
+	h0 = _FMix64(h0);
+	h1 = _FMix64(h1);
+	h0 += h1;
+	h1 += h0;
+
+	SFrameCacheKey	key;
+	key.m_Hash[0] = h0;
+	key.m_Hash[1] = h1;
+	return key;
+}
+
+//----------------------------------------------------------------------------
+//
+//	CFrameResultCache
+//
+//----------------------------------------------------------------------------
+
+CFrameResultCache::CFrameResultCache()
+:	m_RAMLimitInBytes(u64(kDefaultRAMLimitInMB) << 20)
+,	m_DiskLimitInBytes(u64(kDefaultDiskLimitInMB) << 20)
+,	m_RAMBytes(0)
+,	m_DiskBytes(0)
+,	m_Tick(0)
+,	m_Hits(0)
+,	m_Misses(0)
+{
+}
+
+//----------------------------------------------------------------------------
+
+CFrameResultCache::~CFrameResultCache()
+{
+	// The spilled files are deleted by Clear(), before the file system shuts down
+	PK_ASSERT(m_DiskBytes == 0);
+}
+
+//----------------------------------------------------------------------------
+
+void	CFrameResultCache::SetLimits(u64 RAMLimitInBytes, u64 diskLimitInBytes, const CString &spillDirectory)
+{
+	Clear();
+
+	PK_SCOPEDLOCK(m_Lock);
+	m_RAMLimitInBytes = RAMLimitInBytes;
+	m_DiskLimitInBytes = diskLimitInBytes;
+	m_SpillDirectory = null;
+	if (RAMLimitInBytes == 0 || diskLimitInBytes == 0 || spillDirectory.Empty())
+		return;
+	if (!PK_VERIFY(CFilePath::IsAbsolute(spillDirectory)))
+		return;
+
+	IFileSystem		*fs = File::DefaultFileSystem();
+	if (!fs->CreateDirectoryChainIFN(spillDirectory, true))
+	{
+		CLog::Log(PK_WARN, "Could not create the frame cache directory \"%s\", frames are not spilled to disk", spillDirectory.Data());
+		return;
+	}
+	// Frames of a previous session cannot be matched: their inputs were not seen by this one
+	DeleteSpilledFrames(spillDirectory);
+	m_SpillDirectory = spillDirectory;
+}
+
+//----------------------------------------------------------------------------
+
+CGuid	CFrameResultCache::_FindEntry(const SFrameCacheKey &key) const
+{
+	for (u32 i = 0; i < m_Entries.Count(); ++i)
+	{
+		if (m_Entries[i].m_Key == key)
+			return i;
+	}
+	return CGuid::INVALID;
+}
+
+//----------------------------------------------------------------------------
+
+CString	CFrameResultCache::_EntryPath(const SFrameCacheKey &key) const
+{
+	return m_SpillDirectory / CString::Format("%016llx%016llx.%s", key.m_Hash[0], key.m_Hash[1], kSpillFileExtension);
+}
+
+//----------------------------------------------------------------------------
+
+void	CFrameResultCache::_RemoveEntry(u32 entryIdx, TArray<CString> &filesToDelete)
+{
+	const SEntry	&entry = m_Entries[entryIdx];
+	if (entry.m_Data != null)
+	{
+		PK_ASSERT(m_RAMBytes >= entry.m_DataSizeInBytes);
+		m_RAMBytes -= entry.m_DataSizeInBytes;
+	}
+	if (entry.m_OnDisk)
+	{
+		PK_ASSERT(m_DiskBytes >= _DiskSizeInBytes(entry.m_DataSizeInBytes));
+		m_DiskBytes -= _DiskSizeInBytes(entry.m_DataSizeInBytes);
+		filesToDelete.PushBack(_EntryPath(entry.m_Key));
+	}
+	m_Entries.Remove(entryIdx);
+}
+
+//----------------------------------------------------------------------------
+
+void	CFrameResultCache::_EvictRAM(TArray<SSpill> &spills, TArray<CString> &filesToDelete)
+{
+	const bool	canSpill = !m_SpillDirectory.Empty() && m_DiskLimitInBytes != 0;
+	while (m_RAMBytes > m_RAMLimitInBytes)
+	{
+		CGuid	oldestIdx = CGuid::INVALID;
+		for (u32 i = 0; i < m_Entries.Count(); ++i)
+		{
+			if (m_Entries[i].m_Data != null &&
+				(!oldestIdx.Valid() || m_Entries[i].m_LastUsedTick < m_Entries[oldestIdx].m_LastUsedTick))
+				oldestIdx = i;
+		}
+		if (!PK_VERIFY(oldestIdx.Valid()))
+			break;
+
+		SEntry	&entry = m_Entries[oldestIdx];
+		if (entry.m_OnDisk)
+		{
+			// Already spilled by a previous eviction
+			m_RAMBytes -= entry.m_DataSizeInBytes;
+			entry.m_Data = null;
+			continue;
+		}
+		if (canSpill && _DiskSizeInBytes(entry.m_DataSizeInBytes) <= m_DiskLimitInBytes)
+		{
+			// Out of the entries until written: fetched meanwhile, it is a miss
+			const CGuid	spillIdx = spills.PushBack();
+			if (spillIdx.Valid())
+			{
+				spills[spillIdx].m_Entry = entry;
+				spills[spillIdx].m_Path = _EntryPath(entry.m_Key);
+			}
+		}
+		_RemoveEntry(oldestIdx, filesToDelete);
+	}
+}
+
+//----------------------------------------------------------------------------
+
+void	CFrameResultCache::_EvictDisk(TArray<CString> &filesToDelete)
+{
+	while (m_DiskBytes > m_DiskLimitInBytes)
+	{
+		CGuid	oldestIdx = CGuid::INVALID;
+		for (u32 i = 0; i < m_Entries.Count(); ++i)
+		{
+			if (m_Entries[i].m_OnDisk &&
+				(!oldestIdx.Valid() || m_Entries[i].m_LastUsedTick < m_Entries[oldestIdx].m_LastUsedTick))
+				oldestIdx = i;
+		}
+		if (!PK_VERIFY(oldestIdx.Valid()))
+			break;
+
+		SEntry	&entry = m_Entries[oldestIdx];
+		if (entry.m_Data == null)
+		{
+			_RemoveEntry(oldestIdx, filesToDelete);
+			continue;
+		}
+		// Still in RAM: only its file goes
+		m_DiskBytes -= _DiskSizeInBytes(entry.m_DataSizeInBytes);
+		entry.m_OnDisk = false;
+		filesToDelete.PushBack(_EntryPath(entry.m_Key));
+	}
+}
+
+//----------------------------------------------------------------------------
+
+void	CFrameResultCache::_WriteSpills(TArray<SSpill> &spills, TArray<CString> &filesToDelete)
+{
+	for (SSpill &spill : spills)
+	{
+		const SEntry	&spilledEntry = spill.m_Entry;
+		const bool		written = _WriteSpillFile(	spill.m_Path, spilledEntry.m_Key,
+													spilledEntry.m_Width, spilledEntry.m_Height, spilledEntry.m_PixelSizeInBytes,
+													spilledEntry.m_Data->Data<u8>(), spilledEntry.m_DataSizeInBytes);
+		PK_SCOPEDLOCK(m_Lock);
+		if (!written)
+			continue;
+		if (m_SpillDirectory.Empty() || _EntryPath(spilledEntry.m_Key) != spill.m_Path)
+		{
+			// Spill directory changed during the write
+			filesToDelete.PushBack(spill.m_Path);
+			continue;
+		}
+		CGuid	entryIdx = _FindEntry(spilledEntry.m_Key);
+		if (entryIdx.Valid())
+		{
+			// Stored again during the write: same key, same frame
+			if (m_Entries[entryIdx].m_OnDisk)
+				continue;
+			m_Entries[entryIdx].m_OnDisk = true;
+		}
+		else
+		{
+			entryIdx = m_Entries.PushBack(spilledEntry);
+			if (!entryIdx.Valid())
+			{
+				filesToDelete.PushBack(spill.m_Path);
+				continue;
+			}
+			m_Entries[entryIdx].m_Data = null;
+			m_Entries[entryIdx].m_OnDisk = true;
+		}
+		m_DiskBytes += _DiskSizeInBytes(spilledEntry.m_DataSizeInBytes);
+		_EvictDisk(filesToDelete);
+	}
+	spills.Clear();
+}
+
+//----------------------------------------------------------------------------
+
+void	CFrameResultCache::_DeleteFiles(const TArray<CString> &filesToDelete)
+{
+	IFileSystem		*fs = File::DefaultFileSystem();
+	for (const CString &path : filesToDelete)
+		fs->FileDelete(path, true);
+}
+
+//----------------------------------------------------------------------------
+
+bool	CFrameResultCache::Store(const SFrameCacheKey &key, const u8 *rows, u32 rowPitch, u32 width, u32 height, u32 pixelSizeInBytes)
+{
+	PK_SCOPEDPROFILE();
+	if (!Enabled() || rows == null || width == 0 || height == 0)
+		return false;
+	if (!PK_VERIFY(pixelSizeInBytes != 0 && rowPitch >= width * pixelSizeInBytes))
+		return false;
+
+	TArray<u8>	encoded;
+	if (!_Encode(rows, rowPitch, width, height, pixelSizeInBytes, encoded))
+		return false;
+	const u32	dataSizeInBytes = encoded.Count();
+	PRefCountedMemoryBuffer	data = CRefCountedMemoryBuffer::Alloc(dataSizeInBytes);
+	if (!PK_VERIFY(data != null))
+		return false;
+	Mem::Copy(data->Data<u8>(), encoded.RawDataPointer(), dataSizeInBytes);
+	encoded.Clean();
+
+	TArray<SSpill>	spills;
+	TArray<CString>	filesToDelete;
+	{
+		PK_SCOPEDLOCK(m_Lock);
+		if (dataSizeInBytes > m_RAMLimitInBytes)
+			return false;
+		CGuid	entryIdx = _FindEntry(key);
+		if (entryIdx.Valid())
+		{
+			// Rendered again: by another thread, or while the frame was on disk
+			SEntry	&entry = m_Entries[entryIdx];
+			entry.m_LastUsedTick = ++m_Tick;
+			if (entry.m_Data != null)
+				return true;
+			if (entry.m_DataSizeInBytes != dataSizeInBytes)
+			{
+				_RemoveEntry(entryIdx, filesToDelete);
+				entryIdx = CGuid::INVALID;
+			}
+			else
+				entry.m_Data = data;
+		}
+		if (!entryIdx.Valid())
+		{
+			entryIdx = m_Entries.PushBack();
+			if (!PK_VERIFY(entryIdx.Valid()))
+				return false;
+			SEntry	&entry = m_Entries[entryIdx];
+			entry.m_Key = key;
+			entry.m_Width = width;
+			entry.m_Height = height;
+			entry.m_PixelSizeInBytes = pixelSizeInBytes;
+			entry.m_Data = data;
+			entry.m_DataSizeInBytes = dataSizeInBytes;
+			entry.m_LastUsedTick = ++m_Tick;
+			entry.m_OnDisk = false;
+		}
+		m_RAMBytes += dataSizeInBytes;
+		_EvictRAM(spills, filesToDelete);
+	}
+	_WriteSpills(spills, filesToDelete);
+	_DeleteFiles(filesToDelete);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+bool	CFrameResultCache::Fetch(const SFrameCacheKey &key, u8 *rows, u32 rowPitch, u32 width, u32 height, u32 pixelSizeInBytes)
+{
+	PK_SCOPEDPROFILE();
+	if (!Enabled() || rows == null)
+		return false;
+
+	PRefCountedMemoryBuffer	data;
+	u32						dataSizeInBytes = 0;
+	CString					spillPath;
+	{
+		PK_SCOPEDLOCK(m_Lock);
+		const CGuid	entryIdx = _FindEntry(key);
+		if (!entryIdx.Valid() ||
+			m_Entries[entryIdx].m_Width != width ||
+			m_Entries[entryIdx].m_Height != height ||
+			m_Entries[entryIdx].m_PixelSizeInBytes != pixelSizeInBytes)
+		{
+			++m_Misses;
+			return false;
+		}
+		SEntry	&entry = m_Entries[entryIdx];
+		entry.m_LastUsedTick = ++m_Tick;
+		data = entry.m_Data;
+		dataSizeInBytes = entry.m_DataSizeInBytes;
+		if (data == null)
+			spillPath = _EntryPath(key);
+	}
+
+	if (data == null)
+	{
+		// Brought back to RAM: the file is kept, a later eviction does not rewrite it
+		data = _ReadSpillFile(spillPath, key, width, height, pixelSizeInBytes, dataSizeInBytes);
+
+		TArray<SSpill>	spills;
+		TArray<CString>	filesToDelete;
+		{
+			PK_SCOPEDLOCK(m_Lock);
+			const CGuid	entryIdx = _FindEntry(key);
+			if (data == null)
+			{
+				if (entryIdx.Valid() && m_Entries[entryIdx].m_Data == null)
+					_RemoveEntry(entryIdx, filesToDelete);
+				++m_Misses;
+			}
+			else if (entryIdx.Valid() && m_Entries[entryIdx].m_Data == null && dataSizeInBytes <= m_RAMLimitInBytes)
+			{
+				m_Entries[entryIdx].m_Data = data;
+				m_RAMBytes += dataSizeInBytes;
+				_EvictRAM(spills, filesToDelete);
+			}
+		}
+		_WriteSpills(spills, filesToDelete);
+		_DeleteFiles(filesToDelete);
+		if (data == null)
+			return false;
+	}
+
+	const bool	decoded = _Decode(data->Data<u8>(), dataSizeInBytes, rows, rowPitch, width, height, pixelSizeInBytes);
+	PK_ASSERT(decoded);
+	PK_SCOPEDLOCK(m_Lock);
+	if (decoded)
+		++m_Hits;
+	else
+		++m_Misses;
+	return decoded;
+}
+
+//----------------------------------------------------------------------------
+
+void	CFrameResultCache::Clear()
+{
+	TArray<CString>	filesToDelete;
+	{
+		PK_SCOPEDLOCK(m_Lock);
+		for (const SEntry &entry : m_Entries)
+		{
+			if (entry.m_OnDisk)
+				filesToDelete.PushBack(_EntryPath(entry.m_Key));
+		}
+		m_Entries.Clean();
+		m_RAMBytes = 0;
+		m_DiskBytes = 0;
+	}
+	_DeleteFiles(filesToDelete);
+}
+
+//----------------------------------------------------------------------------
+
+SFrameCacheStats	CFrameResultCache::Stats()
+{
+	PK_SCOPEDLOCK(m_Lock);
+	SFrameCacheStats	stats;
+	stats.m_Hits = m_Hits;
+	stats.m_Misses = m_Misses;
+	stats.m_RAMBytes = m_RAMBytes;
+	stats.m_DiskBytes = m_DiskBytes;
+	stats.m_EntryCount = m_Entries.Count();
+	return stats;
+}
+
+//----------------------------------------------------------------------------
+
+void	CFrameResultCache::DeleteSpilledFrames(const CString &spillDirectory)
+{
+	IFileSystem				*fs = File::DefaultFileSystem();
+	CSpilledFramesWalker	walker(spillDirectory);
+	walker.Walk();
+	for (const CString &path : walker.m_Files)
+		fs->FileDelete(path, true);
+}
+
+//----------------------------------------------------------------------------
+
+__AEGP_PK_END
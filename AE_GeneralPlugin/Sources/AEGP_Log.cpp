@@ -5,6 +5,7 @@
 #include "ae_precompiled.h"
 
 #include "AEGP_Log.h"
+#include "AEGP_LogQueue.h"
 #include "AEGP_World.h"
 
 //Suite
@@ -16,11 +17,81 @@
 #include <SuiteHelper.h>
 #include <AEGP_SuiteHandler.h>
 
+#include <atomic>
+#include <chrono>
+
 __AEGP_PK_BEGIN
 //----------------------------------------------------------------------------
 
+namespace
+{
+	// When the idle hook does not run (command line renders), the messages are flushed at the end of each render
+	CLogMessageQueue			s_Queue(CLogMessageQueue::kDefaultMaxPendingMessages, CLogMessageQueue::kDefaultMaxReportedMessages, 5.0);
+	std::atomic<bool>			s_IdleHookRan(false);
+
+	thread_local SAAEIOData		*s_ThreadIOData = null;
+
+	//----------------------------------------------------------------------------
+
+	double	_Now()
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	//----------------------------------------------------------------------------
+
+	// Forwards the flushed messages to the AE debug log and UI
+	struct	SAEReport
+	{
+		SPBasicSuite				*m_BasicSuite;
+		bool						m_ReportInfoShown = false;
+		CString						m_LastText;
+		CLogMessageQueue::ELevel	m_LastLevel = CLogMessageQueue::Level_Info;
+
+		SAEReport(SPBasicSuite *basicSuite) : m_BasicSuite(basicSuite) { PK_ASSERT(basicSuite != null); }
+
+		void	Report(CLogMessageQueue::ELevel level, const CString &text)
+		{
+			AEGP_SuiteHandler	suites(m_BasicSuite);
+
+			suites.UtilitySuite6()->AEGP_WriteToDebugLog("PopcornFX Plugin", level == CLogMessageQueue::Level_Error ? "Error" : "Info", text.Data());
+			// Modal: once per flush
+			if (level == CLogMessageQueue::Level_Info && !m_ReportInfoShown)
+			{
+				suites.UtilitySuite6()->AEGP_ReportInfo(CPopcornFXWorld::Instance().GetPluginID(), text.Data());
+				m_ReportInfoShown = true;
+			}
+			m_LastText = text;
+			m_LastLevel = level;
+		}
+
+		// The info panel shows a single line: the most recent one
+		void	DrawLastText()
+		{
+			if (m_LastText.Empty())
+				return;
+			AEGP_SuiteHandler	suites(m_BasicSuite);
+
+			suites.AdvAppSuite2()->PF_InfoDrawText(m_LastLevel == CLogMessageQueue::Level_Error ? "PopcornFX Plugin [ERROR]" : "PopcornFX Plugin [INFO]", m_LastText.Data());
+		}
+	};
+
+	//----------------------------------------------------------------------------
+
+	void	_Flush()
+	{
+		SPBasicSuite	*basicSuite = CPopcornFXWorld::Instance().GetAESuites();
+		if (basicSuite == null)
+			return;
+		SAEReport	report(basicSuite);
+		s_Queue.Flush(CLogMessageQueue::CbReport(&report, &SAEReport::Report), _Now(), false);
+		report.DrawLastText();
+	}
+}
+
+//----------------------------------------------------------------------------
+
 bool		CAELog::s_PKState = false;
-SAAEIOData	*CAELog::s_IOData = null;
 
 //----------------------------------------------------------------------------
 
@@ -30,21 +101,12 @@ bool	CAELog::LogErrorWindows(SAAEIOData *AAEData, const CString errorStr)
 
 	if (s_PKState)
 		CLog::Log(PK_ERROR, errorStr);
+	s_Queue.Push(CLogMessageQueue::Level_Error, errorStr);
 	if (AAEData == null || AAEData->m_OutData == null)
 		return false;
+	// Out data of the AE call running on this thread: the only synchronous part
 	AAEData->m_OutData->out_flags |= PF_OutFlag_DISPLAY_ERROR_MESSAGE;
 	sprintf(AAEData->m_OutData->return_msg, "%s", errorStr.Data());
-
-	CPopcornFXWorld		&instance = AEGPPk::CPopcornFXWorld::Instance();
-	SPBasicSuite		*basicSuite = instance.GetAESuites();
-
-	if (basicSuite)
-	{
-		AEGP_SuiteHandler	suites(basicSuite);
-
-		suites.UtilitySuite6()->AEGP_WriteToDebugLog("PopcornFX Plugin", "Error", errorStr.Data());
-		suites.AdvAppSuite2()->PF_InfoDrawText("PopcornFX Plugin [ERROR]", errorStr.Data());
-	}
 	return false;
 }
 
@@ -52,7 +114,7 @@ bool	CAELog::LogErrorWindows(SAAEIOData *AAEData, const CString errorStr)
 
 bool	CAELog::SetIOData(SAAEIOData *AAEData)
 {
-	s_IOData = AAEData;
+	s_ThreadIOData = AAEData;
 	return true;
 }
 
@@ -60,16 +122,16 @@ bool	CAELog::SetIOData(SAAEIOData *AAEData)
 
 void	CAELog::ClearIOData()
 {
-	s_IOData = null;
+	s_ThreadIOData = null;
 }
 
 //----------------------------------------------------------------------------
 
 bool	CAELog::TryLogErrorWindows(const CString errorStr)
 {
-	if (s_IOData == null)
+	if (s_ThreadIOData == null)
 		return false;
-	LogErrorWindows(s_IOData, errorStr);
+	LogErrorWindows(s_ThreadIOData, errorStr);
 	return false;
 }
 
@@ -78,30 +140,43 @@ bool	CAELog::TryLogErrorWindows(const CString errorStr)
 void CAELog::SetPKLogState(bool state)
 {
 	s_PKState = state;
+	if (!state)
+	{
+		// Shutdown: the AE suites are gone, the PopcornFX allocators are about to be.
+		// The messages logged while s_PKState was set already went to the CLog listeners.
+		s_Queue.Flush(CLogMessageQueue::CbReport(), _Now(), true);
+		s_Queue.ClearHistory();
+	}
 }
 
 //----------------------------------------------------------------------------
 
 bool CAELog::TryLogInfoWindows(const CString infoStr)
 {
-	CPopcornFXWorld			&instance = AEGPPk::CPopcornFXWorld::Instance();
-
 	if (s_PKState)
 		CLog::Log(PK_INFO, infoStr);
+	s_Queue.Push(CLogMessageQueue::Level_Info, infoStr);
+	return true;
+}
 
-	SPBasicSuite	*basicSuite = instance.GetAESuites();
-
-	if (basicSuite)
-	{
-		AEGP_SuiteHandler	suites(basicSuite);
+//----------------------------------------------------------------------------
 
-		suites.UtilitySuite6()->AEGP_ReportInfo(instance.GetPluginID(), infoStr.Data());
+void	CAELog::FlushPendingMessages()
+{
+	s_IdleHookRan.store(true);
+	// Called on every idle: skip the lock when there is nothing new and no repeat left to report
+	if (!s_Queue.HasWork())
+		return;
+	_Flush();
+}
 
-		suites.UtilitySuite6()->AEGP_WriteToDebugLog("PopcornFX Plugin", "Info", infoStr.Data());
+//----------------------------------------------------------------------------
 
-		suites.AdvAppSuite2()->PF_InfoDrawText("PopcornFX Plugin [INFO]", infoStr.Data());
-	}
-	return true;
+void	CAELog::FlushPendingMessagesWithoutIdleHook()
+{
+	if (s_IdleHookRan.load() || !s_Queue.HasWork())
+		return;
+	_Flush();
 }
 
 //----------------------------------------------------------------------------
@@ -0,0 +1,172 @@
+//----------------------------------------------------------------------------
+// Copyright Persistant Studios, SARL.
+// https://popcornfx.com/popcornfx-community-license/
+//----------------------------------------------------------------------------
+#include "ae_precompiled.h"
+
+#include "AEGP_LogQueue.h"
+
+__AEGP_PK_BEGIN
+//----------------------------------------------------------------------------
+
+CLogMessageQueue::CLogMessageQueue(u32 maxPendingMessages, u32 maxReportedMessages, double repeatDelay)
+:	m_MaxPendingMessages(maxPendingMessages)
+,	m_MaxReportedMessages(PKMax(maxReportedMessages, 1U))
+,	m_RepeatDelay(repeatDelay)
+,	m_PendingHead(null)
+,	m_PendingCount(0)
+,	m_DroppedCount(0)
+,	m_SuppressedCount(0)
+{
+}
+
+//----------------------------------------------------------------------------
+
+CLogMessageQueue::~CLogMessageQueue()
+{
+	SMessage	*message = m_PendingHead.exchange(null);
+	while (message != null)
+	{
+		SMessage	*next = message->m_Next;
+		PK_DELETE(message);
+		message = next;
+	}
+}
+
+//----------------------------------------------------------------------------
+
+void	CLogMessageQueue::Push(ELevel level, const CString &text)
+{
+	if (m_PendingCount.fetch_add(1) >= m_MaxPendingMessages)
+	{
+		m_PendingCount.fetch_sub(1);
+		m_DroppedCount.fetch_add(1);
+		return;
+	}
+	SMessage	*message = PK_NEW(SMessage);
+	if (message == null)
+	{
+		m_PendingCount.fetch_sub(1);
+		m_DroppedCount.fetch_add(1);
+		return;
+	}
+	message->m_Level = level;
+	message->m_Text = text;
+
+	SMessage	*head = m_PendingHead.load(std::memory_order_relaxed);
+	do
+	{
+		message->m_Next = head;
+	} while (!m_PendingHead.compare_exchange_weak(head, message, std::memory_order_release, std::memory_order_relaxed));
+}
+
+//----------------------------------------------------------------------------
+
+bool	CLogMessageQueue::HasWork() const
+{
+	return m_PendingHead.load(std::memory_order_acquire) != null || m_DroppedCount.load() != 0 || m_SuppressedCount.load() != 0;
+}
+
+//----------------------------------------------------------------------------
+
+// Returns false if the same message was reported less than m_RepeatDelay ago
+bool	CLogMessageQueue::_ShouldReport(ELevel level, const CString &text, double now, u32 &outRepeatCount)
+{
+	outRepeatCount = 0;
+	u32	oldest = 0;
+	for (u32 i = 0; i < m_ReportedMessages.Count(); ++i)
+	{
+		SReportedMessage	&reported = m_ReportedMessages[i];
+		if (reported.m_Level == level && reported.m_Text == text)
+		{
+			if (now - reported.m_LastReportTime < m_RepeatDelay)
+			{
+				++reported.m_SuppressedCount;
+				m_SuppressedCount.fetch_add(1);
+				return false;
+			}
+			outRepeatCount = reported.m_SuppressedCount;
+			m_SuppressedCount.fetch_sub(reported.m_SuppressedCount);
+			reported.m_SuppressedCount = 0;
+			reported.m_LastReportTime = now;
+			return true;
+		}
+		if (reported.m_LastReportTime < m_ReportedMessages[oldest].m_LastReportTime)
+			oldest = i;
+	}
+	SReportedMessage	newMessage;
+	newMessage.m_Level = level;
+	newMessage.m_Text = text;
+	newMessage.m_LastReportTime = now;
+	newMessage.m_SuppressedCount = 0;
+	if (m_ReportedMessages.Count() < m_MaxReportedMessages)
+		m_ReportedMessages.PushBack(newMessage);
+	else
+	{
+		// The repeats of the evicted message are never reported
+		m_SuppressedCount.fetch_sub(m_ReportedMessages[oldest].m_SuppressedCount);
+		m_ReportedMessages[oldest] = newMessage;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+void	CLogMessageQueue::Flush(const CbReport &report, double now, bool flushRepeats)
+{
+	PK_SCOPEDLOCK(m_FlushLock);
+	const bool	hasReport = !report.empty();	// Without callback: the messages are dropped
+
+	// Taken under the lock: concurrent flushes report in the logging order
+	SMessage	*message = m_PendingHead.exchange(null, std::memory_order_acquire);
+	SMessage	*ordered = null;
+	while (message != null)
+	{
+		SMessage	*next = message->m_Next;
+		message->m_Next = ordered;
+		ordered = message;
+		message = next;
+	}
+
+	while (ordered != null)
+	{
+		SMessage	*next = ordered->m_Next;
+		u32			repeatCount = 0;
+		if (_ShouldReport(ordered->m_Level, ordered->m_Text, now, repeatCount) && hasReport)
+			report(ordered->m_Level, repeatCount == 0 ? ordered->m_Text : CString::Format("%s (repeated %u times)", ordered->m_Text.Data(), repeatCount));
+		PK_DELETE(ordered);
+		m_PendingCount.fetch_sub(1);
+		ordered = next;
+	}
+
+	// Repeats that were not followed by a new report
+	for (u32 i = 0; i < m_ReportedMessages.Count(); ++i)
+	{
+		SReportedMessage	&reported = m_ReportedMessages[i];
+		if (reported.m_SuppressedCount == 0 || (!flushRepeats && now - reported.m_LastReportTime < m_RepeatDelay))
+			continue;
+		const u32	repeatCount = reported.m_SuppressedCount;
+		m_SuppressedCount.fetch_sub(repeatCount);
+		reported.m_SuppressedCount = 0;
+		reported.m_LastReportTime = now;
+		if (hasReport)
+			report(reported.m_Level, CString::Format("%s (repeated %u times)", reported.m_Text.Data(), repeatCount));
+	}
+
+	const u32	droppedCount = m_DroppedCount.exchange(0);
+	if (droppedCount != 0 && hasReport)
+		report(Level_Error, CString::Format("%u messages were dropped", droppedCount));
+}
+
+//----------------------------------------------------------------------------
+
+void	CLogMessageQueue::ClearHistory()
+{
+	PK_SCOPEDLOCK(m_FlushLock);
+	m_ReportedMessages.Clean();
+	m_SuppressedCount.store(0);
+}
+
+//----------------------------------------------------------------------------
+
+__AEGP_PK_END
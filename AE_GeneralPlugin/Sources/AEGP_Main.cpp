@@ -14,6 +14,8 @@
 #include "AEGP_VaultHandler.h"
 #include <PopcornFX_Suite.h>
 
+#include <PK-SampleLib/SampleScene/Entities/EnvironmentMapEntity.h>
+
 //AE
 #include <AE_GeneralPlug.h>
 #include <SuiteHelper.h>
@@ -77,7 +79,10 @@ static SPAPI bool		CheckEmitterValidity(AAePk::SAAEIOData &AAEData, AAePk::SEmit
 static SPAPI A_Err		UpdateScene(AAePk::SAAEIOData &AAEData, AAePk::SEmitterDesc *descriptor)
 {
 	AEGPPk::CAELog::SetIOData(&AAEData);
-	if (AEGPPk::CPopcornFXWorld::Instance().UpdateScene(AAEData, descriptor) == false)
+	const bool	success = AEGPPk::CPopcornFXWorld::Instance().UpdateScene(AAEData, descriptor);
+	// Command line renders have no idle hook: the render forwards the queued messages
+	AEGPPk::CAELog::FlushPendingMessagesWithoutIdleHook();
+	if (!success)
 	{
 		AEGPPk::CAELog::ClearIOData();
 		return A_Err_GENERIC;
@@ -227,6 +232,13 @@ static SPAPI A_Err		DisplayBrowseEnvironmentMapDialog(AAePk::SAAEIOData &AAEData
 
 				bakeConfig.m_StraightCopy = true;
 				m_Descriptor->m_BackdropEnvironmentMap.m_Path = world.GetVaultHandler().BakeResource(path, bakeConfig).Data();
+#if	(PK_IMAGING_ENABLE_WRITE_CODECS != 0)
+				// Prefiltered on the CPU now, picked up by CEnvironmentMap::Load(): the first render does not wait for the GPU prefiltering
+				const CFilePackPath	filePackPath = CFilePackPath::FromPhysicalPath(m_Descriptor->m_BackdropEnvironmentMap.m_Path.data(), File::DefaultFileSystem());
+				if (!filePackPath.Path().Empty() &&
+					!PKSample::CEnvironmentMapPrefilter::BakeCache(Resource::DefaultManager(), filePackPath.Path(), CString::EmptyString, PKSample::CEnvironmentMap::PrefilterParams()))
+					CLog::Log(PK_WARN, "Could not bake the environment map cache of \"%s\", it will be prefiltered on the GPU", filePackPath.Path().Data());
+#endif
 				m_Descriptor->m_Update = true;
 			}
 		}
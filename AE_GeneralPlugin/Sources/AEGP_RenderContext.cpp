@@ -62,6 +62,17 @@ Threads::CCriticalSection	CAAERenderContext::m_AEGraphicContextLock;
 
 //----------------------------------------------------------------------------
 
+static RHI::EPixelFormat	RenderTargetFormatFromAE(RHI::EPixelFormat aeFormat)
+{
+	// 8bpc: the GPU encodes to sRGB and quantizes when writing the final pass, the readback is already in AE's precision.
+	// Otherwise force the format to 32bpc for precision issues (AE's 16bpc is 15 bits sRGB encoded, not a GPU format).
+	if (aeFormat == RHI::EPixelFormat::FormatUnorm8RGBA || aeFormat == RHI::EPixelFormat::FormatSrgb8RGBA)
+		return RHI::EPixelFormat::FormatSrgb8RGBA;
+	return RHI::EPixelFormat::FormatFloat32RGBA;
+}
+
+//----------------------------------------------------------------------------
+
 CAAERenderContext::CAAERenderContext()
 :	m_WindowHandle(null)
 ,	m_DeviceContext(null)
@@ -140,7 +151,10 @@ bool	CAAERenderContext::InitializeIFN(RHI::EGraphicalApi api, const CString &cla
 
 bool	CAAERenderContext::Destroy()
 {
-	PK_SAFE_DELETE(m_RHIRendering);
+	for (u32 i = 0; i < m_SceneRenderers.Count(); ++i)
+		PK_SAFE_DELETE(m_SceneRenderers[i].m_Renderer);
+	m_SceneRenderers.Clear();
+	m_RHIRendering = null;
 	PK_SAFE_DELETE(m_AEGraphicContext);
 	m_Initialized = false;
 	return true;
@@ -240,82 +254,168 @@ bool	CAAERenderContext::InitGraphicContext(RHI::EPixelFormat rhiformat, u32 widt
 {
 	PK_SCOPEDPROFILE();
 
-	// Force the format to 32bpc for precision issues:
-	rhiformat = RHI::EPixelFormat::FormatFloat32RGBA;
-
-	bool updateRHISize = false;
-	if (m_Format != rhiformat || m_Width != width || m_Height != height)
-		updateRHISize = true;
-	m_Format = rhiformat;
+	m_Format = RenderTargetFormatFromAE(rhiformat);
 	m_Width = width;
 	m_Height = height;
 
-	RHI::PApiManager apiManager = m_AEGraphicContext->GetApiManager();
-
 	if (!m_AEGraphicContext->CreateRenderTarget(m_Format, CUint3{ m_Width, m_Height, 1 }))
 	{
 		CLog::Log(PK_ERROR, "Graphic context CreateRenderTarget failed");
 		return false;
 	}
+	m_RHIRendering = null;
 
-	bool newRHIRendering = false;
-	if (m_RHIRendering == null)
+	const u32	renderPasses = PKSample::CRHIParticleSceneRenderHelper::PlanRenderPasses(m_SceneOptions);
+	CGuid		sceneRendererIdx;
+	for (u32 i = 0; i < m_SceneRenderers.Count(); ++i)
 	{
-		m_RHIRendering = PK_NEW(PKSample::CRHIParticleSceneRenderHelper);
-		if (!PK_VERIFY(m_RHIRendering != null))
-			return false;
-		if (!PK_VERIFY(m_ShaderLoader != null))
-		{
-			CLog::Log(PK_ERROR, "Shader loader was not properly set on the render context");
-			return false;
-		}
-
-		if (!m_RHIRendering->Init(	apiManager, m_ShaderLoader, Resource::DefaultManager(),
-									PKSample::CRHIParticleSceneRenderHelper::InitRP_All))
+		if (m_SceneRenderers[i].m_Format == m_Format &&
+			m_SceneRenderers[i].m_Size == CUint2(m_Width, m_Height) &&
+			m_SceneRenderers[i].m_RenderPasses == renderPasses)
 		{
-			CLog::Log(PK_ERROR, "RHIRendering Initialisation failed");
-			return false;
+			sceneRendererIdx = i;
+			break;
 		}
-		newRHIRendering = true;
 	}
-	if (updateRHISize || newRHIRendering)
+
+	bool newRHIRendering = false;
+	if (!sceneRendererIdx.Valid())
 	{
-		if (!m_RHIRendering->Resize(m_AEGraphicContext->GetCurrentSwapChain()))
-		{
-			CLog::Log(PK_ERROR, "Particle render scene Resize failed");
-			return false;
-		}
-		if (!m_RHIRendering->SetupPostFX_Distortion(m_SceneOptions.m_Distortion, newRHIRendering))
+		// Makes room for the new size: drops the least recently used one
+		if (m_SceneRenderers.Count() >= kMaxSceneRenderers)
 		{
-			CLog::Log(PK_ERROR, "Particle render scene SetupPostFX_Distortion failed");
-			return false;
+			u32	oldestIdx = 0;
+			for (u32 i = 1; i < m_SceneRenderers.Count(); ++i)
+			{
+				if (m_SceneRenderers[i].m_LastUsedFrame < m_SceneRenderers[oldestIdx].m_LastUsedFrame)
+					oldestIdx = i;
+			}
+			_ReleaseSceneRenderer(oldestIdx);
 		}
-		if (!m_RHIRendering->SetupPostFX_ToneMapping(m_SceneOptions.m_ToneMapping, m_SceneOptions.m_Vignetting, true /*dithering*/, newRHIRendering, false))
+
+		if (!PK_VERIFY(m_ShaderLoader != null))
 		{
-			CLog::Log(PK_ERROR, "Particle render scene SetupPostFX_ToneMapping failed");
+			CLog::Log(PK_ERROR, "Shader loader was not properly set on the render context");
 			return false;
 		}
-		if (!m_RHIRendering->SetupPostFX_Bloom(m_SceneOptions.m_Bloom, newRHIRendering, true))
-		{
-			CLog::Log(PK_ERROR, "Particle render scene SetupPostFX_Bloom failed");
+		SSceneRenderer	sceneRenderer;
+		sceneRenderer.m_Format = m_Format;
+		sceneRenderer.m_Size = CUint2(m_Width, m_Height);
+		sceneRenderer.m_RenderPasses = renderPasses;
+		sceneRenderer.m_Renderer = PK_NEW(PKSample::CRHIParticleSceneRenderHelper);
+		if (!PK_VERIFY(sceneRenderer.m_Renderer != null))
 			return false;
-		}
-		if (!m_RHIRendering->SetupPostFX_FXAA(m_SceneOptions.m_FXAA, newRHIRendering, false))
+		if (!sceneRenderer.m_Renderer->Init(m_AEGraphicContext->GetApiManager(), m_ShaderLoader, Resource::DefaultManager(),
+											renderPasses))
 		{
-			CLog::Log(PK_ERROR, "Particle render scene SetupPostFX_FXAA failed");
+			CLog::Log(PK_ERROR, "RHIRendering Initialisation failed");
+			PK_DELETE(sceneRenderer.m_Renderer);
 			return false;
 		}
-		if (!m_RHIRendering->SetupShadows())
+		sceneRendererIdx = m_SceneRenderers.PushBack(sceneRenderer);
+		if (!PK_VERIFY(sceneRendererIdx.Valid()))
 		{
-			CLog::Log(PK_ERROR, "Particle render scene SetupShadows failed");
+			PK_DELETE(sceneRenderer.m_Renderer);
 			return false;
 		}
+		newRHIRendering = true;
 	}
+
+	SSceneRenderer	&sceneRenderer = m_SceneRenderers[sceneRendererIdx];
+	sceneRenderer.m_LastUsedFrame = m_FrameIndex;
+	m_RHIRendering = sceneRenderer.m_Renderer;
+
+	// The graphic context gave back the render targets this renderer was resized with: nothing to do
+	const TMemoryView<const RHI::PRenderTarget>	swapChain = m_AEGraphicContext->GetCurrentSwapChain();
+	bool										sameRenderTargets = !newRHIRendering && sceneRenderer.m_RenderTargets.Count() == swapChain.Count();
+	for (u32 i = 0; sameRenderTargets && i < swapChain.Count(); ++i)
+		sameRenderTargets = sceneRenderer.m_RenderTargets[i] == swapChain[i];
+	if (sameRenderTargets)
+		return true;
+
+	if (!_SetupSceneRenderer(sceneRenderer, newRHIRendering))
+		return false;
+	if (!sceneRenderer.m_RenderTargets.Resize(swapChain.Count()))
+		return false;
+	for (u32 i = 0; i < swapChain.Count(); ++i)
+		sceneRenderer.m_RenderTargets[i] = swapChain[i];
 	return true;
 }
 
 //----------------------------------------------------------------------------
 
+bool	CAAERenderContext::_SetupSceneRenderer(SSceneRenderer &sceneRenderer, bool newRenderer)
+{
+	PKSample::CRHIParticleSceneRenderHelper	*renderer = sceneRenderer.m_Renderer;
+
+	if (!renderer->Resize(m_AEGraphicContext->GetCurrentSwapChain()))
+	{
+		CLog::Log(PK_ERROR, "Particle render scene Resize failed");
+		return false;
+	}
+	if (!renderer->SetupPostFX_Distortion(m_SceneOptions.m_Distortion, newRenderer))
+	{
+		CLog::Log(PK_ERROR, "Particle render scene SetupPostFX_Distortion failed");
+		return false;
+	}
+	// 8bpc renders into an sRGB target, 16/32bpc into a float target encoded by CopyPixelOut*: same tone-mapping gamma on both
+	renderer->SetToneMappingFixedGamma(true);
+	if (!renderer->SetupPostFX_ToneMapping(m_SceneOptions.m_ToneMapping, m_SceneOptions.m_Vignetting, true /*dithering*/, newRenderer, false))
+	{
+		CLog::Log(PK_ERROR, "Particle render scene SetupPostFX_ToneMapping failed");
+		return false;
+	}
+	if (!renderer->SetupPostFX_Bloom(m_SceneOptions.m_Bloom, newRenderer, true))
+	{
+		CLog::Log(PK_ERROR, "Particle render scene SetupPostFX_Bloom failed");
+		return false;
+	}
+	if (!renderer->SetupPostFX_FXAA(m_SceneOptions.m_FXAA, newRenderer, false))
+	{
+		CLog::Log(PK_ERROR, "Particle render scene SetupPostFX_FXAA failed");
+		return false;
+	}
+	if (!renderer->SetupShadows())
+	{
+		CLog::Log(PK_ERROR, "Particle render scene SetupShadows failed");
+		return false;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+void	CAAERenderContext::_ReleaseSceneRenderer(u32 index)
+{
+	SSceneRenderer	&sceneRenderer = m_SceneRenderers[index];
+	PK_ASSERT(sceneRenderer.m_Renderer != m_RHIRendering);
+
+	// Scene renderers of different render passes share the render targets of their size, the current one included
+	bool	renderTargetShared = sceneRenderer.m_Format == m_Format && sceneRenderer.m_Size == CUint2(m_Width, m_Height);
+	for (u32 i = 0; i < m_SceneRenderers.Count() && !renderTargetShared; ++i)
+		renderTargetShared = i != index && m_SceneRenderers[i].m_Format == sceneRenderer.m_Format && m_SceneRenderers[i].m_Size == sceneRenderer.m_Size;
+	if (!renderTargetShared)
+		m_AEGraphicContext->ReleaseRenderTarget(sceneRenderer.m_Format, CUint3(sceneRenderer.m_Size, 1));
+	PK_DELETE(sceneRenderer.m_Renderer);
+	m_SceneRenderers.Remove(index);
+}
+
+//----------------------------------------------------------------------------
+
+void	CAAERenderContext::_ReleaseAgedSceneRenderers()
+{
+	for (u32 i = 0; i < m_SceneRenderers.Count(); )
+	{
+		if (m_SceneRenderers[i].m_Renderer != m_RHIRendering &&
+			m_FrameIndex - m_SceneRenderers[i].m_LastUsedFrame > kSceneRendererMaxAge)
+			_ReleaseSceneRenderer(i);
+		else
+			++i;
+	}
+}
+
+//----------------------------------------------------------------------------
+
 bool	CAAERenderContext::AERenderFrameBegin(SAAEIOData &AAEData, bool getBackground /*=true*/)
 {
 	PK_SCOPEDPROFILE();
@@ -351,7 +451,16 @@ bool	CAAERenderContext::AERenderFrameBegin(SAAEIOData &AAEData, bool getBackgrou
 	
 	m_AAEFormat = format;
 
-	if (m_Width != width || m_Height != height)
+	++m_FrameIndex;
+	// Last use, not last switch: the age and the eviction order of the kept renderers rely on it
+	for (SSceneRenderer &sceneRenderer : m_SceneRenderers)
+	{
+		if (sceneRenderer.m_Renderer == m_RHIRendering)
+			sceneRenderer.m_LastUsedFrame = m_FrameIndex;
+	}
+	const bool	renderPassesChanged =	m_RHIRendering != null &&
+										m_RHIRendering->InitializedRenderPasses() != PKSample::CRHIParticleSceneRenderHelper::PlanRenderPasses(m_SceneOptions);
+	if (m_Width != width || m_Height != height || m_Format != RenderTargetFormatFromAE(rhiFormat) || renderPassesChanged)
 	{
 		if (InitGraphicContext(rhiFormat, width, height) == false)
 		{
@@ -360,6 +469,7 @@ bool	CAAERenderContext::AERenderFrameBegin(SAAEIOData &AAEData, bool getBackgrou
 			return false;
 		}
 	}
+	_ReleaseAgedSceneRenderers();
 	
 	//Frame
 	if (!PK_VERIFY(m_AEGraphicContext->BeginFrame()))
@@ -409,22 +519,30 @@ bool	CAAERenderContext::RenderToSAAEWorld(SAAEIOData &AAEData, AEGP_SuiteHandler
 {
 	PK_SCOPEDPROFILE();
 
-	u32		requiredBufferSize = GetPixelSizeFromPixelFormat(m_Format) * inputWorld->width * inputWorld->height;
-	if (m_DownloadBuffer == null || m_DownloadBufferSize < requiredBufferSize)
-	{
-		m_DownloadBufferSize = requiredBufferSize;
-		if (m_DownloadBuffer != null)
-			m_DownloadBuffer = null;
-		m_DownloadBuffer = CRefCountedMemoryBuffer::Alloc(requiredBufferSize);
-		PK_ASSERT(m_DownloadBuffer != null);
-	}
+	SCopyPixel	refcon = { null, inputWorld, m_Gamma, m_IsOverride, m_AlphaValue, null, 0 };
 
-	if (!m_AEGraphicContext->FillRenderBuffer(m_DownloadBuffer, m_RHIRendering->GetFinalFrameBuffers(0), m_Format, m_Width, m_Height, m_Width))
+	// Converts straight from the readback memory when the context can map it, else from a copy
+	const bool	mapped = m_AEGraphicContext->MapRenderBuffer(m_Format, m_Width, m_Height, refcon.m_SrcRows, refcon.m_SrcRowPitch);
+	if (!mapped)
 	{
-		CLog::Log(PK_ERROR, "FillRenderBuffer failed");
-		return false;
+		u32		requiredBufferSize = GetPixelSizeFromPixelFormat(m_Format) * inputWorld->width * inputWorld->height;
+		if (m_DownloadBuffer == null || m_DownloadBufferSize < requiredBufferSize)
+		{
+			m_DownloadBufferSize = requiredBufferSize;
+			if (m_DownloadBuffer != null)
+				m_DownloadBuffer = null;
+			m_DownloadBuffer = CRefCountedMemoryBuffer::Alloc(requiredBufferSize);
+			PK_ASSERT(m_DownloadBuffer != null);
+		}
+
+		if (!m_AEGraphicContext->FillRenderBuffer(m_DownloadBuffer, m_RHIRendering->GetFinalFrameBuffers(0), m_Format, m_Width, m_Height, m_Width))
+		{
+			CLog::Log(PK_ERROR, "FillRenderBuffer failed");
+			return false;
+		}
+		refcon.m_SrcRows = m_DownloadBuffer->Data<u8>();
+		refcon.m_SrcRowPitch = GetPixelSizeFromPixelFormat(m_Format) * inputWorld->width;
 	}
-	
 
 	PF_Err		res = PF_Err_NONE;
 
@@ -433,8 +551,7 @@ bool	CAAERenderContext::RenderToSAAEWorld(SAAEIOData &AAEData, AEGP_SuiteHandler
 	case	PF_PixelFormat_ARGB128:
 	{
 		PK_NAMEDSCOPEDPROFILE("CopyPixelOut32");
-		SCopyPixel					refcon = { m_DownloadBuffer, inputWorld, m_Gamma, m_IsOverride, m_AlphaValue };
-		
+
 		res = suiteHandler.IterateFloatSuite1()->iterate(	AAEData.m_InData,
 															0,
 															inputWorld->height,
@@ -448,8 +565,7 @@ bool	CAAERenderContext::RenderToSAAEWorld(SAAEIOData &AAEData, AEGP_SuiteHandler
 	case	PF_PixelFormat_ARGB64:
 	{
 		PK_NAMEDSCOPEDPROFILE("CopyPixelOut16");
-		SCopyPixel					refcon = { m_DownloadBuffer, inputWorld, m_Gamma, m_IsOverride, m_AlphaValue };
-		
+
 		res = suiteHandler.Iterate16Suite1()->iterate(	AAEData.m_InData,
 														0,
 														inputWorld->height,
@@ -464,7 +580,6 @@ bool	CAAERenderContext::RenderToSAAEWorld(SAAEIOData &AAEData, AEGP_SuiteHandler
 	case	PF_PixelFormat_ARGB32:
 	{
 		PK_NAMEDSCOPEDPROFILE("CopyPixelOut8");
-		SCopyPixel					refcon = { m_DownloadBuffer, inputWorld, m_Gamma, m_IsOverride, m_AlphaValue };
 
 		res = suiteHandler.Iterate8Suite1()->iterate(	AAEData.m_InData,
 														0,
@@ -472,7 +587,7 @@ bool	CAAERenderContext::RenderToSAAEWorld(SAAEIOData &AAEData, AEGP_SuiteHandler
 														inputWorld,
 														null,
 														reinterpret_cast<void*>(&refcon),
-														CopyPixelOut8,
+														m_Format == RHI::EPixelFormat::FormatSrgb8RGBA ? CopyPixelOutSrgb8 : CopyPixelOut8,
 														effectWorld);
 		break;
 	}
@@ -480,6 +595,8 @@ bool	CAAERenderContext::RenderToSAAEWorld(SAAEIOData &AAEData, AEGP_SuiteHandler
 		PK_ASSERT(true);
 		break;
 	}
+	if (mapped)
+		m_AEGraphicContext->UnmapRenderBuffer();
 
 	if (res != PF_Err_NONE)
 	{
@@ -503,6 +620,17 @@ bool	CAAERenderContext::GetCompositingBuffer(SAAEIOData &AAEData, AEGP_SuiteHand
 	origin.h = (A_short)(AAEData.m_InData->output_origin_x);
 	origin.v = (A_short)(AAEData.m_InData->output_origin_y);
 
+	// Solid or empty layer (emitters are mostly on null solids): drawn with a constant color, nothing to copy nor upload
+	{
+		const SCopyPixel	refcon = { null, inputWorld, m_Gamma, m_IsOverride, m_AlphaValue };
+		CFloat4				constantColor;
+		if (GetConstantPixelIn(refcon, format, rect, origin.h != 0 || origin.v != 0, constantColor))
+		{
+			m_RHIRendering->SetBackGroundConstantColor(constantColor);
+			return true;
+		}
+	}
+
 	// We always copy the pixels in 32 bpc
 	u32		requiredBufferSize = sizeof(CFloat4) * inputWorld->width * inputWorld->height;
 	if (m_UploadBuffer == null || m_UploadBufferSize < requiredBufferSize)
@@ -17,6 +17,7 @@
 #include "AEGP_Attribute.h"
 #include "AEGP_Log.h"
 #include "AEGP_PackExplorer.h"
+#include "AEGP_SceneMemory.h"
 
 #include "AEGP_Main.h"
 #include "AEGP_Attribute.h"
@@ -148,6 +149,8 @@ CAAEScene::CAAEScene()
 ,	m_ColorStreamID(0)
 ,	m_WeightStreamID(0)
 ,	m_ForceRestartSeeking(true)
+,	m_SimulationReset(true)
+,	m_LastRenderCompleted(false)
 {
 	m_ID = s_SceneID++;
 }
@@ -384,6 +387,8 @@ bool	CAAEScene::SetupScene(bool seeking, bool refresh)
 
 bool	CAAEScene::Quit()
 {
+	CSceneMemoryBudget::UnregisterScene(this);
+
 	m_EffectRef = null;
 	m_EffectDesc = null;
 
@@ -430,12 +435,12 @@ bool	CAAEScene::Quit()
 		m_FrameCollector.UninstallFromMediumCollection(m_ParticleMediumCollection);
 		m_FrameCollector.DeleteUnloadedRenderMediums();
 		m_FrameCollector.Destroy();
-
-		if (m_ParticleMediumCollection)
-		{
-			m_ParticleMediumCollection->Clear();
-			PK_SAFE_DELETE(m_ParticleMediumCollection);
-		}
+	}
+	// Also without frame collector: released by the memory budget (see ReleaseDerivedState())
+	if (m_ParticleMediumCollection)
+	{
+		m_ParticleMediumCollection->Clear();
+		PK_SAFE_DELETE(m_ParticleMediumCollection);
 	}
 
 	m_ResourceManager = null;
@@ -492,11 +497,13 @@ bool	CAAEScene::Update(SAAEIOData &AAEData)
 		{
 			AAEData.m_ReturnCode = m_FrameAbortedDuringSeeking;
 			m_ParticleMediumCollection->Clear();
+			m_SimulationReset = true;
 			return true;
 		}
 		if (_CheckRenderAbort(&AAEData))
 		{
 			m_ParticleMediumCollection->Clear();
+			m_SimulationReset = true;
 			return true;
 		}
 		_CollectCurrentFrame();
@@ -750,6 +757,7 @@ bool	CAAEScene::UpdateBackdrop(SLayerHolder *layer,SEmitterDesc *desc)
 
 bool	CAAEScene::Render(SAAEIOData &AAEData)
 {
+	m_LastRenderCompleted = false;
 	if (_CheckRenderAbort(&AAEData))
 		return true;
 
@@ -765,6 +773,12 @@ bool	CAAEScene::Render(SAAEIOData &AAEData)
 	if (_CheckRenderAbort(&AAEData))
 		return true;
 
+	// Before AERenderFrameBegin(): the options select the render passes of the scene renderer
+	PKSample::SParticleSceneOptions	sceneOptions;
+
+	AAEToPK(m_EffectDesc->m_Rendering, sceneOptions);
+	currentRenderContext->SetPostFXOptions(sceneOptions);
+
 	if (!(currentRenderContext->AERenderFrameBegin(AAEData, !m_BackdropData.m_BackgroundUsesEnvironmentMap)))
 		return true;
 
@@ -789,11 +803,6 @@ bool	CAAEScene::Render(SAAEIOData &AAEData)
 	//// Flush all graphical resources
 	PKSample::CRendererCacheInstance_UpdateThread::RenderThread_FlushAllResources();
 
-	PKSample::SParticleSceneOptions	sceneOptions;
-
-	AAEToPK(m_EffectDesc->m_Rendering, sceneOptions);
-	currentRenderContext->SetPostFXOptions(sceneOptions);
-
 	currentRenderContext->SetBackgroundOptions(m_EffectDesc->m_IsAlphaBGOverride, m_EffectDesc->m_AlphaBGOverride);
 
 	// Render ------------------------------------------------------------------------------------------
@@ -805,7 +814,11 @@ bool	CAAEScene::Render(SAAEIOData &AAEData)
 		PK_ASSERT(vpSize.x() != 0 || vpSize.y() != 0);
 
 		RHI::PCommandBuffer	preRenderCmdBuff = apiManager->CreateCommandBuffer(RHI::SRHIResourceInfos("PK-RHI Pre Render command buffer"));
-		RHI::PCommandBuffer	postRenderCmdBuff = apiManager->CreateCommandBuffer(RHI::SRHIResourceInfos("PK-RHI Post Render command buffer"));
+		if (!PK_VERIFY(preRenderCmdBuff != null))
+		{
+			PK_VERIFY(currentRenderContext->AERenderFrameEnd(AAEData));
+			return false;
+		}
 		
 		renderHelper->SetupPostFX_Bloom(sceneOptions.m_Bloom, false, false);
 		renderHelper->SetupPostFX_Distortion(sceneOptions.m_Distortion, false);
@@ -842,7 +855,7 @@ bool	CAAEScene::Render(SAAEIOData &AAEData)
 
 		preRenderCmdBuff->Stop();
 		apiManager->SubmitCommandBufferDirect(preRenderCmdBuff);
-		postRenderCmdBuff->Start();
+		// RenderScene() records and submits its own command buffers
 		if (!PK_VERIFY(renderHelper->RenderScene(AAEToPK(m_EffectDesc->m_Rendering.m_Type), m_DrawOutputs, 0)))
 		{
 			CLog::Log(PK_ERROR, "renderHelper->RenderScene() failed.");
@@ -850,16 +863,10 @@ bool	CAAEScene::Render(SAAEIOData &AAEData)
 			return false;
 		}
 
-		if (!PK_VERIFY(postRenderCmdBuff->Stop()))
-		{
-			CLog::Log(PK_ERROR, "postRenderCmdBuff->Stop() failed.");
-			PK_VERIFY(currentRenderContext->AERenderFrameEnd(AAEData));
-			return false;
-		}
-		apiManager->SubmitCommandBufferDirect(postRenderCmdBuff);
 		if (!PK_VERIFY(currentRenderContext->AERenderFrameEnd(AAEData)))
 			return false;
 	}
+	m_LastRenderCompleted = true;
 	return true;
 }
 
@@ -872,6 +879,7 @@ bool	CAAEScene::ResetEffect(bool unload)
 	m_EffectLastInstance = null;
 	if (m_ParticleMediumCollection != null)
 		m_ParticleMediumCollection->Clear();
+	m_SimulationReset = true;
 	m_Effect = null;
 	if (unload && m_EffectFile != null)
 	{
@@ -1869,11 +1877,14 @@ bool	CAAEScene::_RebuildAttributes(const SSimpleSceneDef &sceneDef)
 void	CAAEScene::_ExtractAEFrameInfo(SAAEIOData &AAEData)
 {
 	u32 targetFrame = AAEData.m_InData->current_time / AAEData.m_InData->local_time_step;
-	if (m_FrameNumber + 1 != targetFrame)
+	// 'm_FrameNumber' is the last simulated frame: the frames served by the frame cache are skipped (see CPopcornFXWorld::UpdateScene()).
+	// Later frames are seeked forward from it, earlier ones restart from the effect start.
+	if (targetFrame <= m_FrameNumber || m_SimulationReset)
 		m_ForceRestartSeeking = true;
 	else
 		m_ForceRestartSeeking = false;
 	m_FrameNumber = targetFrame;
+	m_SimulationReset = false;
 
 	m_DT = (float)((double)AAEData.m_InData->local_time_step / (double)AAEData.m_InData->time_scale);
 	m_PreviousTimeSec = m_CurrentTimeSec;
@@ -2018,6 +2029,107 @@ void	CAAEScene::_FillAdditionnalDataForRender()
 
 //----------------------------------------------------------------------------
 
+static u64	_AudioPyramidSizeInBytes(const SSamplerAudio *audioSampler)
+{
+	if (audioSampler == null)
+		return 0;
+	u64		sizeInBytes = 0;
+	u32		sampleCount = audioSampler->m_SampleCount;
+	for (u32 i = 0; i < audioSampler->m_WaveformPyramid.Count(); ++i, sampleCount >>= 1)
+		sizeInBytes += (2 + sampleCount + 2) * sizeof(float);	// Two borders on each side
+	return sizeInBytes;
+}
+
+//----------------------------------------------------------------------------
+
+void	CAAEScene::ComputeMemoryUsage(SSceneMemoryUsage &outUsage)
+{
+	// Rough size of a simulated particle with its render streams: the medium collection does not report its allocations
+	const u64	kEstimatedBytesPerParticle = 128;
+
+	outUsage.Clear();
+
+	TArray<const RHI::IGpuBuffer*>	countedBuffers;
+	for (const PKSample::SRHIDrawCall &drawCall : m_DrawOutputs.m_DrawCalls)
+	{
+		outUsage.m_Bytes[SSceneMemoryUsage::Category_Particles] += drawCall.m_EstimatedParticleCount * kEstimatedBytesPerParticle;
+
+		// Buffers are shared between the draw calls of a batch
+		for (const RHI::PGpuBuffer &buffer : drawCall.m_VertexBuffers)
+		{
+			if (buffer != null && !countedBuffers.Contains(buffer.Get()) && countedBuffers.PushBack(buffer.Get()).Valid())
+				outUsage.m_Bytes[SSceneMemoryUsage::Category_RenderBuffers] += buffer->GetByteSize();
+		}
+		if (drawCall.m_IndexBuffer != null && !countedBuffers.Contains(drawCall.m_IndexBuffer.Get()) && countedBuffers.PushBack(drawCall.m_IndexBuffer.Get()).Valid())
+			outUsage.m_Bytes[SSceneMemoryUsage::Category_RenderBuffers] += drawCall.m_IndexBuffer->GetByteSize();
+	}
+
+	for (const SSkinnedDataSimple &skinnedData : m_FXInstancesSkinnedData)
+	{
+		for (u32 smidx = 0; smidx < skinnedData.m_SubMeshes.Count(); ++smidx)
+			outUsage.m_Bytes[SSceneMemoryUsage::Category_SkinnedMeshes] += skinnedData.m_SubMeshes[smidx].m_RawDataForRendering.CoveredBytes();
+	}
+
+	if (m_LayerHolder == null)
+		return;
+
+	// The AE sound data is released after each update, only the waveform pyramids are kept (see SSamplerAudio::BuildAudioPyramidIFN())
+	const SSamplerAudio	*audioSamplers[] = { m_LayerHolder->m_BackdropAudioWaveform, m_LayerHolder->m_BackdropAudioSpectrum };
+	for (const SSamplerAudio *audioSampler : audioSamplers)
+		outUsage.m_Bytes[SSceneMemoryUsage::Category_AudioSamplers] += _AudioPyramidSizeInBytes(audioSampler);
+
+	for (auto it = m_LayerHolder->m_SpawnedAttributesSampler.Begin(); it != m_LayerHolder->m_SpawnedAttributesSampler.End(); ++it)
+	{
+		const SAttributeSamplerDesc	*descriptor = static_cast<SAttributeSamplerDesc*>(it->m_Desc);
+		if (descriptor == null || it->m_PKDesc == null)
+			continue;
+		if (descriptor->m_Type == AttributeSamplerType_Image)
+			outUsage.m_Bytes[SSceneMemoryUsage::Category_ImageSamplers] += static_cast<const SSamplerImage*>(it->m_PKDesc)->m_SizeInBytes;
+		else if (descriptor->m_Type == AttributeSamplerType_Audio)
+			outUsage.m_Bytes[SSceneMemoryUsage::Category_AudioSamplers] += _AudioPyramidSizeInBytes(static_cast<const SSamplerAudio*>(it->m_PKDesc));
+	}
+}
+
+//----------------------------------------------------------------------------
+
+bool	CAAEScene::TryReleaseDerivedState(SSceneMemoryUsage &outRemainingUsage)
+{
+	// The layer lock orders us after its pending AE updates. Never waited on: the budget lock is held.
+	if (m_LayerHolder == null || !m_LayerHolder->m_LayerLock.TryLock())
+		return false;
+	ReleaseDerivedState();
+	ComputeMemoryUsage(outRemainingUsage);
+	m_LayerHolder->m_LayerLock.Unlock();
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+void	CAAEScene::ReleaseDerivedState()
+{
+	PK_SCOPEDPROFILE();
+
+	// Same as an aborted render: the next one restarts the simulation from the effect start.
+	// The samplers are kept, they can only be read back from AE during the update of their own layer.
+	m_FrameCollector.ReleaseRenderedFrame();
+	m_DrawOutputs.Clear();
+	if (m_Initialized)
+	{
+		// The batches own their vertex and index buffers: destroyed with the render mediums of the frame collector,
+		// which _LateInitializeIFN() installs again on the next render.
+		m_FrameCollector.UninstallFromMediumCollection(m_ParticleMediumCollection);
+		m_FrameCollector.DeleteUnloadedRenderMediums();
+		m_FrameCollector.Destroy();
+		m_Initialized = false;
+	}
+	if (m_ParticleMediumCollection != null)
+		m_ParticleMediumCollection->Clear();
+	m_FXInstancesSkinnedData.Clean();
+	m_SimulationReset = true;
+}
+
+//----------------------------------------------------------------------------
+
 #if (PK_PARTICLES_UPDATER_USE_D3D12 != 0 || PK_PARTICLES_UPDATER_USE_D3D11 != 0)
 bool	CAAEScene::SimDispatchMask(const PopcornFX::CParticleDescriptor *descriptor, PopcornFX::SSimDispatchHint &outHint)
 {
@@ -0,0 +1,230 @@
+//----------------------------------------------------------------------------
+// Copyright Persistant Studios, SARL.
+// https://popcornfx.com/popcornfx-community-license/
+//----------------------------------------------------------------------------
+#include "ae_precompiled.h"
+
+#include "AEGP_SceneMemory.h"
+
+__AEGP_PK_BEGIN
+//----------------------------------------------------------------------------
+
+namespace
+{
+	CSceneMemoryTracker		s_Tracker(u64(CSceneMemoryBudget::kDefaultBudgetInMB) << 20);
+}
+
+//----------------------------------------------------------------------------
+
+u64		SSceneMemoryUsage::Total() const
+{
+	u64		total = 0;
+	for (u32 i = 0; i < _Category_Count; ++i)
+		total += m_Bytes[i];
+	return total;
+}
+
+//----------------------------------------------------------------------------
+//
+//	CSceneMemoryTracker
+//
+//----------------------------------------------------------------------------
+
+CSceneMemoryTracker::CSceneMemoryTracker(u64 budgetInBytes)
+:	m_BudgetInBytes(budgetInBytes)
+,	m_RenderTick(0)
+,	m_OverBudgetReported(false)
+{
+}
+
+//----------------------------------------------------------------------------
+
+void	CSceneMemoryTracker::SetBudget(u64 budgetInBytes)
+{
+	PK_SCOPEDLOCK(m_Lock);
+	m_BudgetInBytes = budgetInBytes;
+	m_OverBudgetReported = false;
+}
+
+//----------------------------------------------------------------------------
+
+u64		CSceneMemoryTracker::Budget() const
+{
+	PK_SCOPEDLOCK(m_Lock);
+	return m_BudgetInBytes;
+}
+
+//----------------------------------------------------------------------------
+
+u64		CSceneMemoryTracker::TotalUsedBytes() const
+{
+	PK_SCOPEDLOCK(m_Lock);
+	return _TotalUsedBytes();
+}
+
+//----------------------------------------------------------------------------
+
+SSceneMemoryUsage	CSceneMemoryTracker::TotalUsage() const
+{
+	PK_SCOPEDLOCK(m_Lock);
+	SSceneMemoryUsage	usage;
+	for (const SSceneEntry &entry : m_Scenes)
+	{
+		for (u32 i = 0; i < SSceneMemoryUsage::_Category_Count; ++i)
+			usage.m_Bytes[i] += entry.m_Usage.m_Bytes[i];
+	}
+	return usage;
+}
+
+//----------------------------------------------------------------------------
+
+u64		CSceneMemoryTracker::_TotalUsedBytes() const
+{
+	u64		total = 0;
+	for (const SSceneEntry &entry : m_Scenes)
+		total += entry.m_Usage.Total();
+	return total;
+}
+
+//----------------------------------------------------------------------------
+
+CGuid	CSceneMemoryTracker::_FindScene(const ISceneMemoryClient *client) const
+{
+	for (u32 i = 0; i < m_Scenes.Count(); ++i)
+	{
+		if (m_Scenes[i].m_Client == client)
+			return i;
+	}
+	return CGuid::INVALID;
+}
+
+//----------------------------------------------------------------------------
+
+void	CSceneMemoryTracker::OnSceneRendered(ISceneMemoryClient *client)
+{
+	PK_SCOPEDPROFILE();
+	if (!PK_VERIFY(client != null))
+		return;
+	PK_SCOPEDLOCK(m_Lock);
+
+	CGuid	sceneIdx = _FindScene(client);
+	if (!sceneIdx.Valid())
+	{
+		sceneIdx = m_Scenes.PushBack();
+		if (!PK_VERIFY(sceneIdx.Valid()))
+			return;
+		m_Scenes[sceneIdx].m_Client = client;
+	}
+	SSceneEntry	&renderedEntry = m_Scenes[sceneIdx];
+	client->ComputeMemoryUsage(renderedEntry.m_Usage);
+	renderedEntry.m_LastRenderedTick = ++m_RenderTick;
+	renderedEntry.m_Released = false;
+
+	u64		totalBytes = _TotalUsedBytes();
+	if (m_BudgetInBytes == 0 || totalBytes <= m_BudgetInBytes)
+	{
+		m_OverBudgetReported = false;
+		return;
+	}
+
+	// Least recently rendered first, the scene just rendered is kept
+	TArray<u32>	evictionOrder;
+	for (u32 i = 0; i < m_Scenes.Count(); ++i)
+	{
+		if (i == sceneIdx || m_Scenes[i].m_Released)
+			continue;
+		u32		insertIdx = evictionOrder.Count();
+		while (insertIdx > 0 && m_Scenes[evictionOrder[insertIdx - 1]].m_LastRenderedTick > m_Scenes[i].m_LastRenderedTick)
+			--insertIdx;
+		if (!PK_VERIFY(evictionOrder.Insert(i, insertIdx).Valid()))
+			return;
+	}
+
+	for (u32 i = 0; i < evictionOrder.Count() && totalBytes > m_BudgetInBytes; ++i)
+	{
+		SSceneEntry			&entry = m_Scenes[evictionOrder[i]];
+		const u64			usedBytes = entry.m_Usage.Total();
+		SSceneMemoryUsage	remainingUsage;
+		if (!entry.m_Client->TryReleaseDerivedState(remainingUsage))
+			continue;
+		entry.m_Usage = remainingUsage;
+		entry.m_Released = true;
+		const u64	remainingBytes = remainingUsage.Total();
+		PK_ASSERT(remainingBytes <= usedBytes);
+		totalBytes = totalBytes - usedBytes + remainingBytes;
+		if (remainingBytes < usedBytes)
+			CLog::Log(PK_INFO, "Scene %u released %llu KB to fit the scenes memory budget (%llu MB)", entry.m_Client->MemoryClientID(), (usedBytes - remainingBytes) >> 10, m_BudgetInBytes >> 20);
+	}
+
+	if (totalBytes > m_BudgetInBytes)
+	{
+		// The samplers, the busy scenes and the rendered scene are not released: reported once until the budget is met again
+		if (!m_OverBudgetReported)
+			CLog::Log(PK_WARN, "Scenes use %llu MB, over the memory budget of %llu MB", totalBytes >> 20, m_BudgetInBytes >> 20);
+		m_OverBudgetReported = true;
+	}
+	else
+		m_OverBudgetReported = false;
+}
+
+//----------------------------------------------------------------------------
+
+void	CSceneMemoryTracker::UnregisterScene(ISceneMemoryClient *client)
+{
+	PK_SCOPEDLOCK(m_Lock);
+	const CGuid	sceneIdx = _FindScene(client);
+	if (sceneIdx.Valid())
+		m_Scenes.Remove(sceneIdx);
+	if (m_Scenes.Empty())
+		m_Scenes.Clean();
+}
+
+//----------------------------------------------------------------------------
+//
+//	CSceneMemoryBudget
+//
+//----------------------------------------------------------------------------
+
+void	CSceneMemoryBudget::SetBudget(u64 budgetInBytes)
+{
+	s_Tracker.SetBudget(budgetInBytes);
+}
+
+//----------------------------------------------------------------------------
+
+u64		CSceneMemoryBudget::Budget()
+{
+	return s_Tracker.Budget();
+}
+
+//----------------------------------------------------------------------------
+
+u64		CSceneMemoryBudget::TotalUsedBytes()
+{
+	return s_Tracker.TotalUsedBytes();
+}
+
+//----------------------------------------------------------------------------
+
+SSceneMemoryUsage	CSceneMemoryBudget::TotalUsage()
+{
+	return s_Tracker.TotalUsage();
+}
+
+//----------------------------------------------------------------------------
+
+void	CSceneMemoryBudget::OnSceneRendered(ISceneMemoryClient *scene)
+{
+	s_Tracker.OnSceneRendered(scene);
+}
+
+//----------------------------------------------------------------------------
+
+void	CSceneMemoryBudget::UnregisterScene(ISceneMemoryClient *scene)
+{
+	s_Tracker.UnregisterScene(scene);
+}
+
+//----------------------------------------------------------------------------
+
+__AEGP_PK_END
@@ -20,6 +20,7 @@
 #	include <errno.h>
 #	include <signal.h>
 #	include <sys/utsname.h>
+#	include <unistd.h>
 #endif
 
 #if defined(PK_LINUX)
@@ -274,4 +275,33 @@ bool CSystemHelper::LaunchEditorAsPopup()
 }
 
 //----------------------------------------------------------------------------
+
+u32	CSystemHelper::GetCurrentProcessID()
+{
+#if defined(PK_WINDOWS)
+	return static_cast<u32>(::GetCurrentProcessId());
+#else
+	return static_cast<u32>(getpid());
+#endif
+}
+
+//----------------------------------------------------------------------------
+
+bool	CSystemHelper::IsProcessRunning(u32 processID)
+{
+#if defined(PK_WINDOWS)
+	HANDLE	process = ::OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, static_cast<DWORD>(processID));
+	if (process == null)
+		return ::GetLastError() == ERROR_ACCESS_DENIED;
+	DWORD		exitCode = 0;
+	const bool	running = ::GetExitCodeProcess(process, &exitCode) != 0 && exitCode == STILL_ACTIVE;
+	::CloseHandle(process);
+	return running;
+#else
+	return kill(static_cast<pid_t>(processID), 0) == 0 || errno == EPERM;
+#endif
+}
+
+//----------------------------------------------------------------------------
+
 __AEGP_PK_END
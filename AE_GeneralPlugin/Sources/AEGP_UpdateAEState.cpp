@@ -156,6 +156,70 @@ A_Err	CAEUpdater::_UpdateLayerAtTime(SLayerHolder *targetLayer, A_Time &AETime,
 
 //----------------------------------------------------------------------------
 
+bool	CAEUpdater::UpdateParametersAtTime(SLayerHolder *targetLayer, A_Time &AETime)
+{
+	PK_ASSERT(targetLayer != null);
+
+	PK_SCOPEDPROFILE();
+
+	A_Err				result = A_Err_NONE;
+	bool				paramsOnly = targetLayer->m_BackdropAudioWaveform == null && targetLayer->m_BackdropAudioSpectrum == null;
+	CPopcornFXWorld		&PKFXWorld = CPopcornFXWorld::Instance();
+	AEGP_SuiteHandler	suites(PKFXWorld.GetAESuites());
+	A_long				effectCount = 0;
+
+	result |= suites.EffectSuite4()->AEGP_GetLayerNumEffects(targetLayer->m_EffectLayer, &effectCount);
+
+	for (A_long j = effectCount - 1; j >= 0 && paramsOnly && result == A_Err_NONE; --j)
+	{
+		AEGP_EffectRefH				effectRef = null;
+		AEGP_InstalledEffectKey		installedKey;
+
+		result |= suites.EffectSuite4()->AEGP_GetLayerEffectByIndex(PKFXWorld.GetPluginID(), targetLayer->m_EffectLayer, j, &effectRef);
+		result |= suites.EffectSuite4()->AEGP_GetInstalledKeyFromLayerEffect(effectRef, &installedKey);
+
+		if (installedKey == PKFXWorld.GetPluginEffectKey(EPKChildPlugins::ATTRIBUTE))
+		{
+			CStringId id = PKFXWorld.GetAttributeID(effectRef);
+			if (targetLayer->m_SpawnedAttributes.Contains(id))
+				result |= _UpdateAttributeAtTime(targetLayer, targetLayer->m_SpawnedAttributes[id], effectRef, AETime, false);
+		}
+		else if (installedKey == PKFXWorld.GetPluginEffectKey(EPKChildPlugins::SAMPLER))
+		{
+			CStringId id = PKFXWorld.GetAttributeSamplerID(effectRef);
+			if (targetLayer->m_SpawnedAttributesSampler.Contains(id))
+			{
+				SPendingAttribute	*smplr = targetLayer->m_SpawnedAttributesSampler[id];
+
+				PK_ASSERT(smplr != null);
+				PK_ASSERT(smplr->m_Desc != null);
+
+				switch (static_cast<SAttributeSamplerDesc*>(smplr->m_Desc)->m_Type)
+				{
+				case AttributeSamplerType_None:
+					break;
+				case AttributeSamplerType_Geometry:
+				case AttributeSamplerType_Text:
+				case AttributeSamplerType_VectorField:
+					// Created by the first layer update
+					if (smplr->m_PKDesc != null)
+						result |= _UpdateSamplerAtTime(targetLayer, smplr, effectRef, AETime, false);
+					else
+						paramsOnly = false;
+					break;
+				default:
+					paramsOnly = false;
+					break;
+				}
+			}
+		}
+		result |= suites.EffectSuite4()->AEGP_DisposeEffect(effectRef);
+	}
+	return paramsOnly && result == A_Err_NONE;
+}
+
+//----------------------------------------------------------------------------
+
 bool	CAEUpdater::GetCameraViewMatrixAtTime(SLayerHolder *layer, CFloat4x4 &view, CFloat4 &pos, A_Time &AETime, float &cameraZoom)
 {
 	PK_SCOPEDPROFILE();
@@ -12,6 +12,7 @@
 
 #include "AEGP_AssetBaker.h"
 #include "AEGP_Log.h"
+#include "AEGP_SceneMemory.h"
 
 //Suite
 #include <PopcornFX_Suite.h>
@@ -38,6 +39,7 @@
 #include <pk_kernel/include/kr_resources.h>
 #include <pk_kernel/include/kr_log_listeners_file.h>
 #include <pk_kernel/include/kr_refptr.h>
+#include <pk_kernel/include/kr_file_directory_walker.h>
 
 #include <pk_maths/include/pk_maths_random.h>		// for PRNG
 #include <pk_maths/include/pk_maths_transforms.h>	// for CPlane in CParticleSceneBasic
@@ -52,6 +54,7 @@
 //Sample
 #include <PK-SampleLib/PKSampleInit.h>
 #include <PK-SampleLib/SampleUtils.h>
+#include <PK-SampleLib/ProfilerTraceExporter.h>
 
 #include <pk_rhi/include/FwdInterfaces.h>
 
@@ -61,6 +64,8 @@
 
 #include "AEGP_LayerHolder.h"
 #include "AEGP_UpdateAEState.h"
+#include "AEGP_RenderContext.h"
+#include "RenderApi/AEGP_BaseContext.h"
 
 #include "Panels/AEGP_PanelQT.h"
 
@@ -509,6 +514,43 @@ void	CPopcornFXWorld::SetRenderApi(EApiValue AEGraphicsApi)
 
 //----------------------------------------------------------------------------
 
+// The frame cache spills in '<root>/<process ID>': deletes the frames of the sessions that did not shut down
+static void	_DeleteStaleFrameCaches(const CString &frameCacheRoot)
+{
+	class	CProcessFolderWalker : public CFileDirectoryWalker
+	{
+	public:
+		TArray<CString>	m_Folders;
+
+		CProcessFolderWalker(const CString &rootDir)
+		:	CFileDirectoryWalker(rootDir, IgnoreVirtualFS)
+		{
+		}
+
+		virtual bool	DirectoryNotifier(const CFilePack *, const char *fullPath, u32) override
+		{
+			m_Folders.PushBack(fullPath);
+			return false;
+		}
+	};
+
+	CProcessFolderWalker	walker(frameCacheRoot);
+	walker.Walk();
+	for (const CString &folder : walker.m_Folders)
+	{
+		const CString	name = CFilePath::ExtractFilename(folder);
+		char			*nameEnd = null;
+		const u32		processID = static_cast<u32>(strtoul(name.Data(), &nameEnd, 10));
+		if (nameEnd == name.Data() || *nameEnd != '\0' ||
+			processID == CSystemHelper::GetCurrentProcessID() ||
+			CSystemHelper::IsProcessRunning(processID))
+			continue;
+		CFrameResultCache::DeleteSpilledFrames(folder);
+	}
+}
+
+//----------------------------------------------------------------------------
+
 bool	CPopcornFXWorld::InitializeIFN(SAAEIOData &AAEData)
 {
 	(void)AAEData;
@@ -520,6 +562,31 @@ bool	CPopcornFXWorld::InitializeIFN(SAAEIOData &AAEData)
 	m_ClassName = "PKPluginInterface";
 
 	m_VaultHandler.InitializeIFN();
+	const char	*memoryBudgetEnv = getenv("PK_AE_SCENE_MEMORY_BUDGET_MB");
+	if (memoryBudgetEnv != null && memoryBudgetEnv[0] != '\0')
+	{
+		const u64	budgetInMB = strtoull(memoryBudgetEnv, null, 10);
+		CSceneMemoryBudget::SetBudget(budgetInMB << 20);
+		CLog::Log(PK_INFO, "Scenes memory budget: %llu MB", budgetInMB);
+	}
+	const char	*frameCacheEnv = getenv("PK_AE_FRAME_CACHE_MB");
+	const char	*frameCacheDiskEnv = getenv("PK_AE_FRAME_CACHE_DISK_MB");
+	const bool	frameCacheOverride = frameCacheEnv != null && frameCacheEnv[0] != '\0';
+	const bool	frameCacheDiskOverride = frameCacheDiskEnv != null && frameCacheDiskEnv[0] != '\0';
+	const u64	frameCacheInMB = frameCacheOverride ? strtoull(frameCacheEnv, null, 10) : u64(CFrameResultCache::kDefaultRAMLimitInMB);
+	const u64	frameCacheDiskInMB = frameCacheDiskOverride ? strtoull(frameCacheDiskEnv, null, 10) : u64(CFrameResultCache::kDefaultDiskLimitInMB);
+	// Several AE processes (UI and aerender) share the vault: each one spills in its own directory
+	const CString	frameCacheRoot = m_VaultHandler.VaultPathRoot() / "FrameCache";
+	_DeleteStaleFrameCaches(frameCacheRoot);
+	m_FrameCache.SetLimits(frameCacheInMB << 20, frameCacheDiskInMB << 20, frameCacheRoot / CString::Format("%u", CSystemHelper::GetCurrentProcessID()));
+	if (frameCacheOverride || frameCacheDiskOverride)
+		CLog::Log(PK_INFO, "Frame cache: %llu MB in RAM, %llu MB on disk", frameCacheInMB, frameCacheDiskInMB);
+#if	(KR_PROFILER_ENABLED != 0)
+	const char	*traceEnv = getenv("PK_AE_PROFILER_TRACE");
+	m_TraceEachRender = traceEnv != null && traceEnv[0] != '\0' && traceEnv[0] != '0';
+	if (m_TraceEachRender)
+		CLog::Log(PK_INFO, "Profiler trace of each render written to \"%s\"", m_VaultHandler.VaultPathLog().Data());
+#endif
 	m_Initialized = true;
 	for (u32 i = 0; i < __Effect_Parameters_Count; ++i)
 		CAEUpdater::s_EmitterIndexes[i] = i;
@@ -536,6 +603,10 @@ bool	CPopcornFXWorld::ShutdownIFN()
 {
 	bool				result = true;
 
+	const SFrameCacheStats	frameCacheStats = m_FrameCache.Stats();
+	if (frameCacheStats.m_Hits != 0)
+		CLog::Log(PK_INFO, "Frame cache: %llu hits, %llu misses", frameCacheStats.m_Hits, frameCacheStats.m_Misses);
+	m_FrameCache.Clear();
 	m_VaultHandler.ShutdownIFN();
 	{
 		PK_SCOPEDLOCK(m_Lock);
@@ -606,15 +677,66 @@ bool	CPopcornFXWorld::ShutdownIFN()
 
 //----------------------------------------------------------------------------
 
+#if	(KR_PROFILER_ENABLED != 0)
+
+static bool	_WriteProfilerTrace(const Profiler::CProfilerReport &report, const CString &dir, const CString &baseName, SLayerHolder *layer, const SFrameCacheStats &frameCacheStats)
+{
+	PKSample::CProfilerTraceExporter	exporter;
+
+	if (!exporter.AddThreadName(0, "After Effects") ||
+		!exporter.AddReport(report))
+		return false;
+	if (layer != null)
+	{
+		const CString	label = CString::Format("%s / %s", layer->m_CompositionName.Data(), layer->m_LayerName.Data());
+		exporter.AddInstantEvent(0, label.Data(), exporter.LastReportEndUs());
+	}
+#if	(PK_BUILD_WITH_GPU_PROFILING_SUPPORT != 0)
+	// Not GetCurrentRenderContext(): the panel must not create the render context
+	if (s_AAEThreadRenderContexts != null && s_AAEThreadRenderContexts->GetAEGraphicContext() != null)
+	{
+		RHI::SApiContext	*apiContext = s_AAEThreadRenderContexts->GetAEGraphicContext()->GetApiContext();
+		if (apiContext != null && apiContext->m_UsedMemory != null)
+		{
+			const RHI::PMemoryUsage	&usedMemory = apiContext->m_UsedMemory;
+			const char				*seriesNames[] = { "Buffers", "Textures", "Render targets" };
+			const u64				values[] = { usedMemory->GetUsedBuffers(), usedMemory->GetUsedTextures(), usedMemory->GetUsedRenderTargets() };
+			exporter.AddCounter("GPU memory", exporter.LastReportEndUs(), TMemoryView<const char * const>(seriesNames), TMemoryView<const u64>(values));
+		}
+	}
+#endif
+	// CPU side: the scenes estimates (CAAEScene::ComputeMemoryUsage()) as of their last render, and the rendered frames cache
+	const SSceneMemoryUsage	sceneUsage = CSceneMemoryBudget::TotalUsage();
+	const char				*sceneSeriesNames[] = { "Particles", "Render buffers", "Skinned meshes", "Image samplers", "Audio samplers" };
+	PK_STATIC_ASSERT(PK_ARRAY_COUNT(sceneSeriesNames) == SSceneMemoryUsage::_Category_Count);
+	exporter.AddCounter("PopcornFX scenes memory", exporter.LastReportEndUs(), TMemoryView<const char * const>(sceneSeriesNames), TMemoryView<const u64>(sceneUsage.m_Bytes));
+
+	const char				*frameCacheSeriesNames[] = { "RAM", "Disk" };
+	const u64				frameCacheValues[] = { frameCacheStats.m_RAMBytes, frameCacheStats.m_DiskBytes };
+	exporter.AddCounter("Frame cache memory", exporter.LastReportEndUs(), TMemoryView<const char * const>(frameCacheSeriesNames), TMemoryView<const u64>(frameCacheValues));
+
+	CString	path;
+	if (!exporter.WriteRotatingFile(dir, baseName, PKSample::CProfilerTraceExporter::kDefaultRotatingFileCount, &path))
+		return false;
+	CLog::Log(PK_INFO, "Profiler trace written to %s (%u events)", path.Data(), exporter.EventCount());
+	return true;
+}
+
+#endif
+
+//----------------------------------------------------------------------------
+
 void CPopcornFXWorld::SetProfilingState(bool state)
 {
 #if	(KR_PROFILER_ENABLED != 0)
 	Profiler::CProfiler	*profiler = Profiler::MainEngineProfiler();
 	if (profiler == null)
 		return;
+	PK_SCOPEDLOCK(GetRenderLock());	// Not while a render is traced
 	profiler->GrabCallstacks(false);
 	profiler->Activate(state);
 	profiler->Reset();
+	m_ProfilingSession = state;
 
 	if (!state)
 	{
@@ -635,12 +757,585 @@ void CPopcornFXWorld::SetProfilingState(bool state)
 		else
 			CLog::Log(PK_ERROR, "Failed to write profile report to %s", path.Data());
 		stream.Close();
+
+		// Same capture, for chrome://tracing or Perfetto
+		_WriteProfilerTrace(report, m_VaultHandler.VaultPathRoot(), "profilerReport", null, m_FrameCache.Stats());
 	}
 #endif
 }
 
 //----------------------------------------------------------------------------
 
+void	CPopcornFXWorld::_BeginRenderTrace()
+{
+#if	(KR_PROFILER_ENABLED != 0)
+	// The panel capture spans several renders: do not reset it
+	if (!m_TraceEachRender || m_ProfilingSession)
+		return;
+	Profiler::CProfiler	*profiler = Profiler::MainEngineProfiler();
+	if (profiler == null)
+		return;
+	profiler->GrabCallstacks(false);
+	profiler->Reset();
+	profiler->Activate(true);
+#endif
+}
+
+//----------------------------------------------------------------------------
+
+void	CPopcornFXWorld::_EndRenderTrace(SLayerHolder *layer)
+{
+#if	(KR_PROFILER_ENABLED != 0)
+	if (!m_TraceEachRender || m_ProfilingSession)
+		return;
+	Profiler::CProfiler	*profiler = Profiler::MainEngineProfiler();
+	if (profiler == null)
+		return;
+	profiler->Activate(false);
+	Profiler::CProfilerReport	report;
+	profiler->BuildReport(&report);
+	profiler->Reset();
+	_WriteProfilerTrace(report, m_VaultHandler.VaultPathLog(), "renderTrace", layer, m_FrameCache.Stats());
+#else
+	(void)layer;
+#endif
+}
+
+//----------------------------------------------------------------------------
+
+static u32	_WorldPixelSizeInBytes(PF_PixelFormat format)
+{
+	switch (format)
+	{
+	case	PF_PixelFormat_ARGB32:
+		return sizeof(PF_Pixel8);
+	case	PF_PixelFormat_ARGB64:
+		return sizeof(PF_Pixel16);
+	case	PF_PixelFormat_ARGB128:
+		return sizeof(PF_PixelFloat);
+	default:
+		return 0;
+	}
+}
+
+//----------------------------------------------------------------------------
+
+static void	_AppendPoint(CFrameCacheKeyBuilder &builder, const A_FloatPoint3 &point)
+{
+	builder.AppendValue(point.x);
+	builder.AppendValue(point.y);
+	builder.AppendValue(point.z);
+}
+
+//----------------------------------------------------------------------------
+
+static void	_AppendEmitterDesc(CFrameCacheKeyBuilder &builder, const SEmitterDesc &desc)
+{
+	builder.AppendString(desc.m_Name.c_str());
+	builder.AppendString(desc.m_PathSource.c_str());
+	builder.AppendString(desc.m_UUID.c_str());
+	builder.AppendValue(desc.m_TransformType);
+	_AppendPoint(builder, desc.m_Position);
+	_AppendPoint(builder, desc.m_Rotation);
+	builder.AppendValue(desc.m_IsAlphaBGOverride);
+	builder.AppendValue(desc.m_AlphaBGOverride);
+	builder.AppendValue(desc.m_Seed);
+	builder.AppendValue(desc.m_ScaleFactor);
+
+	// Not m_AECameraPresent: never reset, the AE camera is part of the view matrix
+	const SCameraDesc	&camera = desc.m_Camera;
+	builder.AppendValue(camera.m_Internal);
+	_AppendPoint(builder, camera.m_Position);
+	_AppendPoint(builder, camera.m_Rotation);
+	builder.AppendValue(camera.m_FOV);
+	builder.AppendValue(camera.m_Near);
+	builder.AppendValue(camera.m_Far);
+
+	const SRenderingDesc	&rendering = desc.m_Rendering;
+	builder.AppendValue(rendering.m_Type);
+	builder.AppendValue(rendering.m_ReceiveLight);
+	builder.AppendValue(rendering.m_Distortion.m_Enable);
+	builder.AppendValue(rendering.m_Bloom.m_Enable);
+	builder.AppendValue(rendering.m_Bloom.m_BrightPassValue);
+	builder.AppendValue(rendering.m_Bloom.m_Intensity);
+	builder.AppendValue(rendering.m_Bloom.m_Attenuation);
+	builder.AppendValue(rendering.m_Bloom.m_GaussianBlur);
+	builder.AppendValue(rendering.m_Bloom.m_RenderPassCount);
+	builder.AppendValue(rendering.m_ToneMapping.m_Enable);
+	builder.AppendValue(rendering.m_ToneMapping.m_Saturation);
+	builder.AppendValue(rendering.m_ToneMapping.m_Exposure);
+	builder.AppendValue(rendering.m_FXAA.m_Enable);
+
+	const SBackdropMesh	&backdropMesh = desc.m_BackdropMesh;
+	builder.AppendString(backdropMesh.m_Path.c_str());
+	builder.AppendValue(backdropMesh.m_EnableRendering);
+	builder.AppendValue(backdropMesh.m_EnableCollisions);
+	builder.AppendValue(backdropMesh.m_EnableAnimations);
+	_AppendPoint(builder, backdropMesh.m_Position);
+	_AppendPoint(builder, backdropMesh.m_Rotation);
+	_AppendPoint(builder, backdropMesh.m_Scale);
+	builder.AppendValue(backdropMesh.m_Roughness);
+	builder.AppendValue(backdropMesh.m_Metalness);
+
+	const SBackdropEnvironmentMap	&environmentMap = desc.m_BackdropEnvironmentMap;
+	builder.AppendString(environmentMap.m_Path.c_str());
+	builder.AppendValue(environmentMap.m_EnableRendering);
+	builder.AppendValue(environmentMap.m_Intensity);
+	_AppendPoint(builder, environmentMap.m_Color);
+
+	// Fields set by the emitter effect: the AE lights are appended by _AppendAELight()
+	const SLightDesc	&light = desc.m_Light;
+	builder.AppendValue(light.m_Internal);
+	builder.AppendValue(light.m_Category);
+	_AppendPoint(builder, light.m_Direction);
+	_AppendPoint(builder, light.m_Color);
+	_AppendPoint(builder, light.m_Ambient);
+	builder.AppendValue(light.m_Intensity);
+}
+
+//----------------------------------------------------------------------------
+
+// Fields set by CAEUpdater::GetLightsAtTime() for the light type
+static void	_AppendAELight(CFrameCacheKeyBuilder &builder, const SLightDesc &light)
+{
+	builder.AppendValue(light.m_Type);
+	_AppendPoint(builder, light.m_Color);
+	builder.AppendValue(light.m_Intensity);
+	if (light.m_Type == AEGP_LightType_PARALLEL || light.m_Type == AEGP_LightType_SPOT)
+		_AppendPoint(builder, light.m_Direction);
+	if (light.m_Type == AEGP_LightType_POINT || light.m_Type == AEGP_LightType_SPOT)
+		_AppendPoint(builder, light.m_Position);
+	if (light.m_Type == AEGP_LightType_SPOT)
+	{
+		builder.AppendValue(light.m_Angle);
+		builder.AppendValue(light.m_Feather);
+	}
+}
+
+//----------------------------------------------------------------------------
+
+static void	_AppendAttributes(CFrameCacheKeyBuilder &builder, SLayerHolder *layer)
+{
+	for (auto it = layer->m_SpawnedAttributes.Begin(); it != layer->m_SpawnedAttributes.End(); ++it)
+	{
+		SAttributeDesc	*descriptor = static_cast<SAttributeDesc*>(it->m_Desc);
+		if (descriptor == null)
+			continue;
+		descriptor->m_Lock.lock();
+		const UAttributeValue	value = descriptor->m_Value;
+		descriptor->m_Lock.unlock();
+
+		builder.AppendString(descriptor->m_CategoryName.c_str());
+		builder.AppendString(descriptor->m_Name.c_str());
+		builder.AppendValue(descriptor->m_Type);
+		builder.AppendValue(descriptor->m_IsAffectedByScale);
+		if (descriptor->m_Type >= AttributeType_Bool1 && descriptor->m_Type <= AttributeType_Bool4)
+			builder.AppendValue(value.m_Bool4);
+		else if (descriptor->m_Type >= AttributeType_Int1 && descriptor->m_Type <= AttributeType_Int4)
+			builder.AppendValue(value.m_Int4);
+		else if (descriptor->m_Type >= AttributeType_Float1 && descriptor->m_Type <= AttributeType_Float4)
+			builder.AppendValue(value.m_Float4);
+	}
+}
+
+//----------------------------------------------------------------------------
+
+static void	_AppendSamplers(CFrameCacheKeyBuilder &builder, SLayerHolder *layer)
+{
+	for (auto it = layer->m_SpawnedAttributesSampler.Begin(); it != layer->m_SpawnedAttributesSampler.End(); ++it)
+	{
+		const SAttributeSamplerDesc	*descriptor = static_cast<const SAttributeSamplerDesc*>(it->m_Desc);
+		if (descriptor == null)
+			continue;
+		builder.AppendString(descriptor->m_CategoryName.c_str());
+		builder.AppendString(descriptor->m_Name.c_str());
+		builder.AppendValue(descriptor->m_Type);
+		builder.AppendString(descriptor->m_ResourcePath.c_str());
+		if (descriptor->m_Descriptor == null)
+			continue;
+
+		// Image and audio samplers disable the frame cache, see CAEUpdater::UpdateParametersAtTime()
+		switch (descriptor->m_Type)
+		{
+		case AttributeSamplerType_Geometry:
+		{
+			const SShapeSamplerDescriptor	*shape = static_cast<const SShapeSamplerDescriptor*>(descriptor->m_Descriptor);
+			builder.AppendValue(shape->m_Type);
+			builder.AppendValue(shape->m_Dimension);
+			builder.AppendString(shape->m_Path.c_str());
+			builder.AppendValue(shape->m_BindToBackdrop);
+			builder.AppendValue(shape->m_WeightedSampling);
+			builder.AppendValue(shape->m_ColorStreamID);
+			builder.AppendValue(shape->m_WeightStreamID);
+			break;
+		}
+		case AttributeSamplerType_Text:
+		{
+			const STextSamplerDescriptor	*text = static_cast<const STextSamplerDescriptor*>(descriptor->m_Descriptor);
+			builder.AppendValue(text->m_LayerID);
+			builder.AppendString(text->m_Data.c_str());
+			break;
+		}
+		case AttributeSamplerType_VectorField:
+		{
+			const SVectorFieldSamplerDescriptor	*vectorField = static_cast<const SVectorFieldSamplerDescriptor*>(descriptor->m_Descriptor);
+			builder.AppendString(vectorField->m_Path.c_str());
+			builder.AppendValue(vectorField->m_Interpolation);
+			builder.AppendValue(vectorField->m_Strength);
+			_AppendPoint(builder, vectorField->m_Position);
+			break;
+		}
+		default:
+			break;
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+
+// False when the stream animation cannot be hashed: expressions, or keyframes of non numeric values
+static bool	_AppendStreamKeyframes(CFrameCacheKeyBuilder &builder, AEGP_SuiteHandler &suites, AEGP_PluginID pluginID, AEGP_StreamRefH stream, A_Err &result)
+{
+	AEGP_StreamType	streamType = AEGP_StreamType_NO_DATA;
+	A_Boolean		canVary = FALSE;
+
+	result |= suites.StreamSuite5()->AEGP_GetStreamType(stream, &streamType);
+	if (result != A_Err_NONE || streamType == AEGP_StreamType_NO_DATA)
+		return true;
+	result |= suites.StreamSuite5()->AEGP_CanVaryOverTime(stream, &canVary);
+	if (result != A_Err_NONE || !canVary)
+		return true;
+
+	A_Boolean		expressionEnabled = FALSE;
+	result |= suites.StreamSuite5()->AEGP_GetExpressionState(pluginID, stream, &expressionEnabled);
+	if (expressionEnabled)
+		return false;
+
+	A_long			keyframeCount = 0;
+	A_short			temporalDimension = 0;
+	result |= suites.KeyframeSuite4()->AEGP_GetStreamNumKFs(stream, &keyframeCount);
+	builder.AppendValue(streamType);
+	builder.AppendValue(keyframeCount);
+	if (result != A_Err_NONE || keyframeCount <= 0)
+		return true;	// Not animated: the current value is hashed with the descs
+	result |= suites.KeyframeSuite4()->AEGP_GetStreamTemporalDimensionality(stream, &temporalDimension);
+
+	const bool		spatial = streamType == AEGP_StreamType_TwoD_SPATIAL || streamType == AEGP_StreamType_ThreeD_SPATIAL;
+	bool			hashable = true;
+	for (A_long i = 0; i < keyframeCount && hashable && result == A_Err_NONE; ++i)
+	{
+		A_Time							time = { 0, 1 };
+		AEGP_KeyframeInterpolationType	inInterpolation = AEGP_KeyInterp_NONE;
+		AEGP_KeyframeInterpolationType	outInterpolation = AEGP_KeyInterp_NONE;
+		AEGP_KeyframeFlags				flags = 0;
+
+		result |= suites.KeyframeSuite4()->AEGP_GetKeyframeTime(stream, i, AEGP_LTimeMode_CompTime, &time);
+		result |= suites.KeyframeSuite4()->AEGP_GetKeyframeInterpolation(stream, i, &inInterpolation, &outInterpolation);
+		result |= suites.KeyframeSuite4()->AEGP_GetKeyframeFlags(stream, i, &flags);
+		builder.AppendValue(time.value);
+		builder.AppendValue(time.scale);
+		builder.AppendValue(inInterpolation);
+		builder.AppendValue(outInterpolation);
+		builder.AppendValue(flags);
+		for (A_short dimension = 0; dimension < temporalDimension; ++dimension)
+		{
+			AEGP_KeyframeEase	inEase = { 0, 0 };
+			AEGP_KeyframeEase	outEase = { 0, 0 };
+			result |= suites.KeyframeSuite4()->AEGP_GetKeyframeTemporalEase(stream, i, dimension, &inEase, &outEase);
+			builder.AppendValue(inEase.speedF);
+			builder.AppendValue(inEase.influenceF);
+			builder.AppendValue(outEase.speedF);
+			builder.AppendValue(outEase.influenceF);
+		}
+
+		AEGP_StreamValue2	value;
+		result |= suites.KeyframeSuite4()->AEGP_GetNewKeyframeValue(pluginID, stream, i, &value);
+		if (result != A_Err_NONE)
+			break;
+		switch (streamType)
+		{
+		case	AEGP_StreamType_OneD:
+			builder.AppendValue(value.val.one_d);
+			break;
+		case	AEGP_StreamType_TwoD:
+		case	AEGP_StreamType_TwoD_SPATIAL:
+			builder.AppendValue(value.val.two_d.x);
+			builder.AppendValue(value.val.two_d.y);
+			break;
+		case	AEGP_StreamType_ThreeD:
+		case	AEGP_StreamType_ThreeD_SPATIAL:
+			builder.AppendValue(value.val.three_d.x);
+			builder.AppendValue(value.val.three_d.y);
+			builder.AppendValue(value.val.three_d.z);
+			break;
+		case	AEGP_StreamType_COLOR:
+			builder.AppendValue(value.val.color.alphaF);
+			builder.AppendValue(value.val.color.redF);
+			builder.AppendValue(value.val.color.greenF);
+			builder.AppendValue(value.val.color.blueF);
+			break;
+		case	AEGP_StreamType_LAYER_ID:
+			builder.AppendValue(value.val.layer_id);
+			break;
+		case	AEGP_StreamType_MASK_ID:
+			builder.AppendValue(value.val.mask_id);
+			break;
+		default:
+			hashable = false;
+			break;
+		}
+		result |= suites.StreamSuite5()->AEGP_DisposeStreamValue(&value);
+
+		if (spatial && hashable && result == A_Err_NONE)
+		{
+			AEGP_StreamValue2	inTangent;
+			AEGP_StreamValue2	outTangent;
+			result |= suites.KeyframeSuite4()->AEGP_GetNewKeyframeSpatialTangents(pluginID, stream, i, &inTangent, &outTangent);
+			if (result != A_Err_NONE)
+				break;
+			if (streamType == AEGP_StreamType_ThreeD_SPATIAL)
+			{
+				builder.AppendValue(inTangent.val.three_d.x);
+				builder.AppendValue(inTangent.val.three_d.y);
+				builder.AppendValue(inTangent.val.three_d.z);
+				builder.AppendValue(outTangent.val.three_d.x);
+				builder.AppendValue(outTangent.val.three_d.y);
+				builder.AppendValue(outTangent.val.three_d.z);
+			}
+			else
+			{
+				builder.AppendValue(inTangent.val.two_d.x);
+				builder.AppendValue(inTangent.val.two_d.y);
+				builder.AppendValue(outTangent.val.two_d.x);
+				builder.AppendValue(outTangent.val.two_d.y);
+			}
+			result |= suites.StreamSuite5()->AEGP_DisposeStreamValue(&inTangent);
+			result |= suites.StreamSuite5()->AEGP_DisposeStreamValue(&outTangent);
+		}
+	}
+	return hashable;
+}
+
+//----------------------------------------------------------------------------
+
+static bool	_AppendLayerStreamKeyframes(CFrameCacheKeyBuilder &builder, AEGP_SuiteHandler &suites, AEGP_PluginID pluginID, AEGP_LayerH layerH, AEGP_LayerStream which, A_Err &result)
+{
+	AEGP_StreamRefH	stream = null;
+	result |= suites.StreamSuite5()->AEGP_GetNewLayerStream(pluginID, layerH, which, &stream);
+	if (stream == null)
+		return result == A_Err_NONE;
+	builder.AppendValue(which);
+	const bool	hashable = _AppendStreamKeyframes(builder, suites, pluginID, stream, result);
+	result |= suites.StreamSuite5()->AEGP_DisposeStream(stream);
+	return hashable;
+}
+
+//----------------------------------------------------------------------------
+
+// Seeking simulates from the effect start, sampling the parameters at each step: a frame depends on
+// their whole animation, not only on the values at its time. Hashes the keyframes of the PopcornFX effects
+// of the layer, of the camera and of the text sampler layers. False when one cannot be hashed (expressions).
+bool	CPopcornFXWorld::_AppendParameterAnimations(CFrameCacheKeyBuilder &builder, SLayerHolder *layer)
+{
+	PK_SCOPEDPROFILE();
+
+	A_Err				result = A_Err_NONE;
+	bool				hashable = true;
+	AEGP_SuiteHandler	suites(m_Suites);
+	A_long				effectCount = 0;
+
+	result |= suites.EffectSuite4()->AEGP_GetLayerNumEffects(layer->m_EffectLayer, &effectCount);
+	for (A_long i = 0; i < effectCount && hashable && result == A_Err_NONE; ++i)
+	{
+		AEGP_EffectRefH				effectRef = null;
+		AEGP_InstalledEffectKey		installedKey;
+
+		result |= suites.EffectSuite4()->AEGP_GetLayerEffectByIndex(m_AEGPID, layer->m_EffectLayer, i, &effectRef);
+		result |= suites.EffectSuite4()->AEGP_GetInstalledKeyFromLayerEffect(effectRef, &installedKey);
+		if (result == A_Err_NONE &&
+			(installedKey == GetPluginEffectKey(EPKChildPlugins::EMITTER) ||
+			 installedKey == GetPluginEffectKey(EPKChildPlugins::ATTRIBUTE) ||
+			 installedKey == GetPluginEffectKey(EPKChildPlugins::SAMPLER)))
+		{
+			A_long	streamCount = 0;
+			result |= suites.StreamSuite5()->AEGP_GetEffectNumParamStreams(effectRef, &streamCount);
+			builder.AppendValue(i);
+			builder.AppendValue(installedKey);
+			// Stream 0 is the input layer
+			for (A_long j = 1; j < streamCount && hashable && result == A_Err_NONE; ++j)
+			{
+				AEGP_StreamRefH	stream = null;
+				result |= suites.StreamSuite5()->AEGP_GetNewEffectStreamByIndex(m_AEGPID, effectRef, j, &stream);
+				if (stream == null)
+					continue;
+				hashable = _AppendStreamKeyframes(builder, suites, m_AEGPID, stream, result);
+				result |= suites.StreamSuite5()->AEGP_DisposeStream(stream);
+			}
+		}
+		if (effectRef != null)
+			result |= suites.EffectSuite4()->AEGP_DisposeEffect(effectRef);
+	}
+
+	// The camera is sampled at each step too
+	if (hashable && result == A_Err_NONE && layer->m_CameraLayer != null)
+	{
+		const AEGP_LayerStream	cameraStreams[] =
+		{
+			AEGP_LayerStream_ANCHORPOINT,
+			AEGP_LayerStream_POSITION,
+			AEGP_LayerStream_ORIENTATION,
+			AEGP_LayerStream_ROTATE_X,
+			AEGP_LayerStream_ROTATE_Y,
+			AEGP_LayerStream_ROTATE_Z,
+			AEGP_LayerStream_ZOOM,
+		};
+		AEGP_LayerH	parentLayer = null;
+		result |= suites.LayerSuite8()->AEGP_GetLayerParent(layer->m_CameraLayer, &parentLayer);
+		// The animation of the parents is not followed
+		hashable = parentLayer == null;
+		for (u32 i = 0; i < PK_ARRAY_COUNT(cameraStreams) && hashable && result == A_Err_NONE; ++i)
+			hashable = _AppendLayerStreamKeyframes(builder, suites, m_AEGPID, layer->m_CameraLayer, cameraStreams[i], result);
+	}
+
+	// Text samplers read the source text of their layer: text keyframes are not hashable, the sampler disables the cache
+	for (auto it = layer->m_SpawnedAttributesSampler.Begin(); it != layer->m_SpawnedAttributesSampler.End() && hashable && result == A_Err_NONE; ++it)
+	{
+		const SAttributeSamplerDesc	*descriptor = static_cast<const SAttributeSamplerDesc*>(it->m_Desc);
+		if (descriptor == null || descriptor->m_Type != AttributeSamplerType_Text || descriptor->m_Descriptor == null)
+			continue;
+		const AEGP_LayerIDVal	textLayerID = static_cast<const STextSamplerDescriptor*>(descriptor->m_Descriptor)->m_LayerID;
+		if (textLayerID == AEGP_LayerIDVal_NONE)
+			continue;
+		AEGP_CompH	compH = null;
+		AEGP_LayerH	textLayer = null;
+		result |= suites.LayerSuite5()->AEGP_GetLayerParentComp(layer->m_EffectLayer, &compH);
+		result |= suites.LayerSuite7()->AEGP_GetLayerFromLayerID(compH, textLayerID, &textLayer);
+		if (result == A_Err_NONE && textLayer != null)
+			hashable = _AppendLayerStreamKeyframes(builder, suites, m_AEGPID, textLayer, AEGP_LayerStream_SOURCE_TEXT, result);
+	}
+	return hashable && result == A_Err_NONE;
+}
+
+//----------------------------------------------------------------------------
+
+bool	CPopcornFXWorld::_BuildFrameCacheKey(SAAEIOData &AAEData, SLayerHolder *layer, SEmitterDesc *desc, A_Time &AETime, SFrameCacheKey &outKey)
+{
+	PK_SCOPEDPROFILE();
+	// A paused simulation depends on when it was paused
+	if (!m_FrameCache.Enabled() || !desc->m_SimState)
+		return false;
+	// The attribute and sampler effects can render after the emitter: their values are read at the frame time
+	if (!CAEUpdater::UpdateParametersAtTime(layer, AETime))
+		return false;
+
+	CFrameCacheKeyBuilder	builder;
+
+	// The baked effect: its content changes bump the render generation
+	builder.AppendValue(layer->ID);
+	builder.AppendValue(layer->m_RenderGeneration.Load());
+	builder.AppendString(layer->m_SourcePackPath.Data());
+	_AppendEmitterDesc(builder, *desc);
+	_AppendAttributes(builder, layer);
+	_AppendSamplers(builder, layer);
+	if (!_AppendParameterAnimations(builder, layer))
+		return false;
+
+	CFloat4x4	viewMatrix = CFloat4x4::IDENTITY;
+	CFloat4		cameraPos = CFloat4::ZERO;
+	float		cameraZoom = 0.0f;
+	CAEUpdater::GetCameraViewMatrixAtTime(layer, viewMatrix, cameraPos, AETime, cameraZoom);
+	builder.AppendValue(viewMatrix);
+	builder.AppendValue(cameraPos);
+	builder.AppendValue(cameraZoom);
+	if (!desc->m_Light.m_Internal)
+	{
+		// Same time as CAAEScene::UpdateLight()
+		TArray<SLightDesc>	lights;
+		A_Time				lightsTime;
+
+		lightsTime.value = layer->m_CurrentTime;
+		lightsTime.scale = layer->m_TimeScale;
+		if (!CAEUpdater::GetLightsAtTime(layer, lightsTime, lights))
+			return false;
+		builder.AppendValue(lights.Count());
+		for (const SLightDesc &light : lights)
+			_AppendAELight(builder, light);
+	}
+
+	const PF_InData	*inData = AAEData.m_InData;
+	builder.AppendValue(inData->current_time);
+	builder.AppendValue(inData->time_step);
+	builder.AppendValue(inData->local_time_step);
+	builder.AppendValue(inData->time_scale);
+	builder.AppendValue(AETime.value);
+	builder.AppendValue(AETime.scale);
+	builder.AppendValue(inData->downsample_x.num);
+	builder.AppendValue(inData->downsample_x.den);
+	builder.AppendValue(inData->downsample_y.num);
+	builder.AppendValue(inData->downsample_y.den);
+
+	// The output is composited over the input layer
+	PF_EffectWorld	*inputWorld = null;
+	AAEData.m_ExtraData.m_SmartRenderData->cb->checkout_layer_pixels(inData->effect_ref, 0, &inputWorld);
+	if (inputWorld == null)
+		return false;
+	PF_PixelFormat	format = PF_PixelFormat_INVALID;
+	AAEData.m_WorldSuite->PF_GetPixelFormat(inputWorld, &format);
+	const u32		pixelSizeInBytes = _WorldPixelSizeInBytes(format);
+	if (pixelSizeInBytes != 0)
+	{
+		PK_NAMEDSCOPEDPROFILE("Hash input layer");
+		const u8	*rows = reinterpret_cast<const u8*>(inputWorld->data);
+		const u32	rowSizeInBytes = static_cast<u32>(inputWorld->width) * pixelSizeInBytes;
+
+		builder.AppendValue(format);
+		builder.AppendValue(inputWorld->width);
+		builder.AppendValue(inputWorld->height);
+		for (A_long y = 0; y < inputWorld->height; ++y)
+			builder.Append(rows + y * inputWorld->rowbytes, rowSizeInBytes);
+	}
+	AAEData.m_ExtraData.m_SmartRenderData->cb->checkin_layer_pixels(inData->effect_ref, 0);
+	if (pixelSizeInBytes == 0)
+		return false;
+
+	outKey = builder.Finish();
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+bool	CPopcornFXWorld::_FetchCachedFrame(SAAEIOData &AAEData, const SFrameCacheKey &key)
+{
+	PF_EffectWorld	*outputWorld = null;
+	AAEData.m_ExtraData.m_SmartRenderData->cb->checkout_output(AAEData.m_InData->effect_ref, &outputWorld);
+	if (outputWorld == null)
+		return false;
+	PF_PixelFormat	format = PF_PixelFormat_INVALID;
+	AAEData.m_WorldSuite->PF_GetPixelFormat(outputWorld, &format);
+	const u32		pixelSizeInBytes = _WorldPixelSizeInBytes(format);
+	if (pixelSizeInBytes == 0)
+		return false;
+	return m_FrameCache.Fetch(key, reinterpret_cast<u8*>(outputWorld->data), outputWorld->rowbytes, outputWorld->width, outputWorld->height, pixelSizeInBytes);
+}
+
+//----------------------------------------------------------------------------
+
+void	CPopcornFXWorld::_StoreRenderedFrame(SAAEIOData &AAEData, const SFrameCacheKey &key)
+{
+	PF_EffectWorld	*outputWorld = null;
+	AAEData.m_ExtraData.m_SmartRenderData->cb->checkout_output(AAEData.m_InData->effect_ref, &outputWorld);
+	if (outputWorld == null)
+		return;
+	PF_PixelFormat	format = PF_PixelFormat_INVALID;
+	AAEData.m_WorldSuite->PF_GetPixelFormat(outputWorld, &format);
+	const u32		pixelSizeInBytes = _WorldPixelSizeInBytes(format);
+	if (pixelSizeInBytes == 0)
+		return;
+	m_FrameCache.Store(key, reinterpret_cast<const u8*>(outputWorld->data), outputWorld->rowbytes, outputWorld->width, outputWorld->height, pixelSizeInBytes);
+}
+
+//----------------------------------------------------------------------------
+
 void	CPopcornFXWorld::SetParametersIndexes(const int *indexes, EPKChildPlugins plugin)
 {
 	if (plugin == EPKChildPlugins::EMITTER)
@@ -1300,16 +1995,27 @@ bool	CPopcornFXWorld::UpdateScene(SAAEIOData &AAEData, SEmitterDesc *desc)
 #if defined (PK_SCALE_DOWN)
 	layer->m_ScaleFactor = desc->m_ScaleFactor;
 #endif
+	// Before any simulation or render work. On a hit, the next rendered frame seeks from the last one the scene rendered.
+	SFrameCacheKey	frameCacheKey;
+	const bool		useFrameCache = _BuildFrameCacheKey(AAEData, layer, desc, AETime, frameCacheKey);
+	if (useFrameCache && _FetchCachedFrame(AAEData, frameCacheKey))
+		return PK_VERIFY(result == A_Err_NONE);
+
 	scene->UpdateLight(layer);
 	scene->UpdateBackdrop(layer, desc);
 	{
 		PK_SCOPEDLOCK(GetRenderLock());
+		_BeginRenderTrace();
 		scene->Update(AAEData);
 		if (AAEData.m_ReturnCode == A_Err_NONE)
 		{
 			scene->Render(AAEData);
 		}
+		_EndRenderTrace(layer);
+		CSceneMemoryBudget::OnSceneRendered(scene.Get());
 	}
+	if (useFrameCache && AAEData.m_ReturnCode == A_Err_NONE && scene->LastRenderCompleted())
+		_StoreRenderedFrame(AAEData, frameCacheKey);
 	if (!PK_VERIFY(result == A_Err_NONE))
 		return false;
 	return true;
@@ -1331,6 +2037,7 @@ bool	CPopcornFXWorld::InvalidateEmitterRender(SLayerHolder *layer , AEGP_EffectR
 {
 	if (layer == null)
 		return false;
+	layer->m_RenderGeneration.Inc();
 
 	A_Err								result = A_Err_NONE;
 
@@ -1420,6 +2127,8 @@ A_Err	CPopcornFXWorld::IdleHook(AEGP_GlobalRefcon pluginRefCon, AEGP_IdleRefcon
 	CPopcornFXWorld			&instance = AEGPPk::CPopcornFXWorld::Instance();
 
 	instance.IdleUpdate();
+	// Messages logged by the render threads since the last idle
+	CAELog::FlushPendingMessages();
 	return err;
 }
 
@@ -1622,6 +2331,8 @@ s32		CPopcornFXWorld::_ExecSPendingEmitters(SLayerHolder *layer)
 					CString effectName = emitter.m_Desc->m_Name.data();
 					if (!m_VaultHandler.LoadEffectIntoVault(sourcePackPath, effectName, walker.ProjectSettingsPath(), forceRefresh))
 						return false;
+					if (forceRefresh)
+						layer->m_RenderGeneration.Inc();
 					emitter.m_Desc->m_Name = effectName.Data();
 				}
 				scene->RefreshAssetList();
@@ -2108,6 +2819,8 @@ bool	CPopcornFXWorld::SetSelectedEffectFromPath(SEmitterDesc *desc, CString path
 
 				desc->m_PathSource = !relativeSrcPath.Empty() ? relativeSrcPath.Data() : root.Data();
 				desc->m_ReloadEffect = forceReload;
+				if (needRefresh)
+					layer->m_RenderGeneration.Inc();
 				SetSelectedEffect(layer, effectPath);
 			}
 		}
@@ -2120,6 +2833,8 @@ bool	CPopcornFXWorld::SetSelectedEffectFromPath(SEmitterDesc *desc, CString path
 
 				desc->m_PathSource = !relativeSrcPath.Empty() ? relativeSrcPath.Data() : root.Data();
 				desc->m_ReloadEffect = forceReload;
+				if (needRefresh)
+					layer->m_RenderGeneration.Inc();
 				SetSelectedEffect(layer, effectPath);
 			}
 		}
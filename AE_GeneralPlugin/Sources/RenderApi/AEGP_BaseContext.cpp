@@ -5,6 +5,8 @@
 #include "ae_precompiled.h"
 #include "RenderApi/AEGP_BaseContext.h"
 
+#include "AEGP_World.h"
+
 __AEGP_PK_BEGIN
 
 //----------------------------------------------------------------------------
@@ -52,4 +54,41 @@ RHI::PTexture CAAEBaseContext::GetCompositingTexture()
 
 //----------------------------------------------------------------------------
 
+void	CAAEBaseContext::_LoadPipelineCache(const PKSample::SPipelineCacheDeviceID &deviceID)
+{
+	PK_ASSERT(m_ApiManager != null);
+	const CString	vaultRoot = CPopcornFXWorld::Instance().GetVaultHandler().VaultPathRoot();
+	if (vaultRoot.Empty())
+		return;
+	m_PipelineCachePath = vaultRoot / "PipelineCache";	// The helper appends the API extension
+	m_PipelineCache.SetDeviceID(deviceID);
+	// Synchronous: AE renders right after the context is created, the pipelines must find the cache
+	m_PipelineCache.LoadPipelineCache(m_ApiManager, m_PipelineCachePath);
+}
+
+//----------------------------------------------------------------------------
+
+void	CAAEBaseContext::_UpdatePipelineCache()
+{
+	if (m_PipelineCachePath.Empty())
+		return;
+	// Not re-requested while pending: during a long render the cache is still written every 'kSaveDelay' seconds
+	const float	kSaveDelay = 10.0f;
+	if (!m_PipelineCache.SavePending())
+		m_PipelineCache.RequestSave(m_PipelineCachePath, kSaveDelay);
+	m_PipelineCache.Update(m_ApiManager);
+}
+
+//----------------------------------------------------------------------------
+
+void	CAAEBaseContext::_FlushPipelineCache()
+{
+	if (m_PipelineCachePath.Empty() || m_ApiManager == null)
+		return;
+	m_PipelineCache.Flush(m_ApiManager);
+	m_PipelineCachePath = CString();
+}
+
+//----------------------------------------------------------------------------
+
 __AEGP_PK_END
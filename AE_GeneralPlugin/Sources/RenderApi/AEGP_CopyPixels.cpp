@@ -140,6 +140,103 @@ PF_Err	CopyPixelIn8(	void			*refcon,
 
 //----------------------------------------------------------------------------
 
+template <typename _Word, u32 _WordsPerPixel>
+static bool	IsConstantRows(const PF_EffectWorld *world, A_long x0, A_long y0, A_long x1, A_long y1, u32 pixelSize)
+{
+	PK_ASSERT(sizeof(_Word) * _WordsPerPixel == pixelSize);
+	const u8	*data = reinterpret_cast<const u8*>(world->data);
+	_Word		pattern[_WordsPerPixel];
+	Mem::Copy(pattern, data + y0 * world->rowbytes + x0 * pixelSize, pixelSize);
+
+	// Whole words xor-ed against the first pixel, no early out inside a row: the compiler vectorizes the inner loop
+	const u32	wordCount = static_cast<u32>(x1 - x0) * _WordsPerPixel;
+	for (A_long y = y0; y < y1; ++y)
+	{
+		const _Word	*row = reinterpret_cast<const _Word*>(data + y * world->rowbytes + x0 * pixelSize);
+		_Word		diff = 0;
+		for (u32 i = 0; i < wordCount; i += _WordsPerPixel)
+		{
+			for (u32 w = 0; w < _WordsPerPixel; ++w)
+				diff |= row[i + w] ^ pattern[w];
+		}
+		if (diff != 0)
+			return false;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+bool	GetConstantPixelIn(const SCopyPixel &refcon, PF_PixelFormat format, const PF_Rect &extentHint, bool hasOrigin, CFloat4 &outValue)
+{
+	PK_SCOPEDPROFILE();
+	const PF_EffectWorld	*world = refcon.m_InputWorld;
+	const A_long			x0 = PKMax(extentHint.left, A_long(0));
+	const A_long			y0 = PKMax(extentHint.top, A_long(0));
+	const A_long			x1 = PKMin(extentHint.right, world->width);
+	const A_long			y1 = PKMin(extentHint.bottom, world->height);
+
+	u32		pixelSize = 0;
+	switch (format)
+	{
+	case	PF_PixelFormat_ARGB128:
+		pixelSize = sizeof(PF_Pixel32);
+		break;
+	case	PF_PixelFormat_ARGB64:
+		pixelSize = sizeof(PF_Pixel16);
+		break;
+	case	PF_PixelFormat_ARGB32:
+		pixelSize = sizeof(PF_Pixel8);
+		break;
+	default:
+		return false;
+	}
+
+	u8		pixel[sizeof(PF_Pixel32)] = {};	// Transparent
+	if (x0 < x1 && y0 < y1)
+	{
+		bool	isConstant = false;
+		if (format == PF_PixelFormat_ARGB128)
+			isConstant = IsConstantRows<u64, 2>(world, x0, y0, x1, y1, pixelSize);
+		else if (format == PF_PixelFormat_ARGB64)
+			isConstant = IsConstantRows<u64, 1>(world, x0, y0, x1, y1, pixelSize);
+		else
+			isConstant = IsConstantRows<u32, 1>(world, x0, y0, x1, y1, pixelSize);
+		if (!isConstant)
+			return false;
+		Mem::Copy(pixel, reinterpret_cast<const u8*>(world->data) + y0 * world->rowbytes + x0 * pixelSize, pixelSize);
+
+		// Transparent pixels around the extent (or not covered because of the origin): only a transparent layer is constant
+		const bool	coversWorld = !hasOrigin && x0 == 0 && y0 == 0 && x1 == world->width && y1 == world->height;
+		if (!coversWorld)
+		{
+			for (u32 i = 0; i < pixelSize; ++i)
+			{
+				if (pixel[i] != 0)
+					return false;
+			}
+		}
+	}
+
+	CFloat4	value;
+	if (format == PF_PixelFormat_ARGB128)
+		value = Pixel32ToCFloat4(*reinterpret_cast<const PF_Pixel32*>(pixel));
+	else if (format == PF_PixelFormat_ARGB64)
+		value = Pixel16ToCFloat4(*reinterpret_cast<const PF_Pixel16*>(pixel));
+	else
+		value = Pixel8ToCFloat4(*reinterpret_cast<const PF_Pixel8*>(pixel));
+
+	// Same as CopyPixelIn*
+	value.xyz() = PKSample::ConvertSRGBToLinear(value.xyz());
+	value = PKSaturate(value);
+	if (refcon.m_IsAlphaOverride)
+		value.w() = static_cast<float>(refcon.m_AlphaOverrideValue);
+	outValue = value;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
 PF_Err	CopyPixelOut32(	void			*refcon,
 						A_long			x,
 						A_long			y,
@@ -147,8 +244,7 @@ PF_Err	CopyPixelOut32(	void			*refcon,
 						PF_Pixel32		*outP)
 {
 	SCopyPixel				*thiS = reinterpret_cast<SCopyPixel*>(refcon);
-	const u32				size = sizeof(CFloat4);
-	const CFloat4			*inP = Mem::AdvanceRawPointer(thiS->m_BufferPtr->Data<CFloat4>(), size * y * thiS->m_InputWorld->width + x * size);
+	const CFloat4			*inP = reinterpret_cast<const CFloat4*>(thiS->m_SrcRows + y * thiS->m_SrcRowPitch + x * sizeof(CFloat4));
 	CFloat4					value = CFloat4(PKSample::ConvertLinearToSRGB(inP->xyz()), inP->w());
 	value = PKSaturate(value);
 	*outP = CFloat4ToPixel32(value);
@@ -164,8 +260,7 @@ PF_Err	CopyPixelOut16(	void			*refcon,
 						PF_Pixel16		*outP)
 {
 	SCopyPixel				*thiS = reinterpret_cast<SCopyPixel*>(refcon);
-	const u32				size = sizeof(CFloat4);
-	const CFloat4			*inP = Mem::AdvanceRawPointer(thiS->m_BufferPtr->Data<CFloat4>(), size * y * thiS->m_InputWorld->width + x * size);
+	const CFloat4			*inP = reinterpret_cast<const CFloat4*>(thiS->m_SrcRows + y * thiS->m_SrcRowPitch + x * sizeof(CFloat4));
 	CFloat4					value = CFloat4(PKSample::ConvertLinearToSRGB(inP->xyz()), inP->w());
 	value = PKSaturate(value);
 	*outP = CFloat4ToPixel16(value);
@@ -181,14 +276,30 @@ PF_Err	CopyPixelOut8(	void			*refcon,
 						PF_Pixel8		*outP)
 {
 	SCopyPixel				*thiS = reinterpret_cast<SCopyPixel*>(refcon);
-	const u32				size = sizeof(CFloat4);
-	const CFloat4			*inP = Mem::AdvanceRawPointer(thiS->m_BufferPtr->Data<CFloat4>(), size * y * thiS->m_InputWorld->width + x * size);
+	const CFloat4			*inP = reinterpret_cast<const CFloat4*>(thiS->m_SrcRows + y * thiS->m_SrcRowPitch + x * sizeof(CFloat4));
 	CFloat4					value = CFloat4(PKSample::ConvertLinearToSRGB(inP->xyz()), inP->w());
 	value = PKSaturate(value);
 	*outP = CFloat4ToPixel8(value);
 	return PF_Err_NONE;
 }
 
+//----------------------------------------------------------------------------
+
+PF_Err	CopyPixelOutSrgb8(	void			*refcon,
+							A_long			x,
+							A_long			y,
+							PF_Pixel8		*,
+							PF_Pixel8		*outP)
+{
+	SCopyPixel				*thiS = reinterpret_cast<SCopyPixel*>(refcon);
+	const u8				*inP = thiS->m_SrcRows + y * thiS->m_SrcRowPitch + x * 4;
+	outP->red = inP[0];
+	outP->green = inP[1];
+	outP->blue = inP[2];
+	outP->alpha = inP[3];
+	return PF_Err_NONE;
+}
+
 //----------------------------------------------------------------------------
 __AEGP_PK_END
 
@@ -97,16 +97,12 @@ CAAED3D11Context::CAAED3D11Context()
 
 CAAED3D11Context::~CAAED3D11Context()
 {
-	if (m_Texture != null)
-	{
-		m_Texture->Release();
-		m_Texture = null;
-	}
-	if (m_StagingTexture != null)
-	{
-		m_StagingTexture->Release();
-		m_StagingTexture = null;
-	}
+	_FlushPipelineCache();
+	for (u32 i = 0; i < m_RenderTargetSets.Count(); ++i)
+		_ReleaseRenderTargetSet(m_RenderTargetSets[i]);
+	m_RenderTargetSets.Clear();
+	m_Texture = null;
+	m_StagingTexture = null;
 	m_D3D11Context->m_SwapChainRenderTargets.Clear();
 	if (m_D3D11Context->m_ImmediateDeviceContext != null)
 	{
@@ -142,6 +138,19 @@ bool	CAAED3D11Context::InitIFN()
 	m_Tasks.Resize(m_WorkerCount);
 
 	m_ApiManager->InitApi(m_ApiContext);
+
+	PKSample::SPipelineCacheDeviceID	deviceID;
+	IDXGIAdapter1						*adapter = m_Context->m_HardwareAdapter;
+	DXGI_ADAPTER_DESC1					desc;
+	if (adapter != null && SUCCEEDED(adapter->GetDesc1(&desc)))
+	{
+		LARGE_INTEGER	driverVersion;
+		deviceID.m_VendorID = desc.VendorId;
+		deviceID.m_DeviceID = desc.DeviceId;
+		if (SUCCEEDED(adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion)))
+			deviceID.m_DriverVersion = static_cast<u64>(driverVersion.QuadPart);
+	}
+	_LoadPipelineCache(deviceID);
 	return true;
 }
 
@@ -161,6 +170,7 @@ bool	CAAED3D11Context::EndFrame()
 	LogApiError();
 
 	m_ApiManager->EndFrame();
+	_UpdatePipelineCache();
 
 	HRESULT	hr = 0;
 	if (m_Context->m_SwapChains.Count() > 0)
@@ -238,10 +248,27 @@ bool	CAAED3D11Context::CreatePlatformContext(void *winHandle, void *deviceContex
 
 bool	CAAED3D11Context::CreateRenderTarget(RHI::EPixelFormat format, CUint3 size)
 {
-	RHI::PD3D11RenderTarget		rt = PK_NEW(RHI::CD3D11RenderTarget(RHI::SRHIResourceInfos("Render Target")));
-	ID3D11Texture2D				*texture2D = null;
+	// Already created for this size:
+	for (u32 i = 0; i < m_RenderTargetSets.Count(); ++i)
+	{
+		if (m_RenderTargetSets[i].m_Format == format && m_RenderTargetSets[i].m_Size == size)
+		{
+			_SetCurrentRenderTarget(m_RenderTargetSets[i]);
+			return true;
+		}
+	}
+
+	SRenderTargetSet			set;
 	D3D11_TEXTURE2D_DESC		texDesc = {};
 
+	set.m_Format = format;
+	set.m_Size = size;
+	set.m_Texture = null;
+	set.m_StagingTexture = null;
+	set.m_RenderTarget = PK_NEW(RHI::CD3D11RenderTarget(RHI::SRHIResourceInfos("Render Target")));
+	if (set.m_RenderTarget == null)
+		return false;
+
 	texDesc.Width = size.x();
 	texDesc.Height = size.y();
 	texDesc.MipLevels = 1;
@@ -251,31 +278,11 @@ bool	CAAED3D11Context::CreateRenderTarget(RHI::EPixelFormat format, CUint3 size)
 	texDesc.Usage = D3D11_USAGE_DEFAULT;
 	texDesc.BindFlags = D3D11_BIND_RENDER_TARGET;
 
-	if (PK_D3D11_FAILED(m_D3D11Context->m_Device->CreateTexture2D(&texDesc, null, &texture2D)))
+	if (PK_D3D11_FAILED(m_D3D11Context->m_Device->CreateTexture2D(&texDesc, null, &set.m_Texture)))
 		return false;
-	texture2D->AddRef();
-	rt->D3D11SetRenderTarget(texture2D, format, size.xy(), true, null, RHI::SampleCount1);
-
-	if (m_Texture != null)
-	{
-		m_Texture->Release();
-		m_Texture = null;
-	}
-		
-	m_Texture = texture2D;
-	
-	if (m_D3D11Context->m_SwapChainCount != 0)
-	{
-		m_D3D11Context->m_SwapChainRenderTargets.Clear();
-		m_D3D11Manager->SwapChainRemoved(0);
-	}
+	set.m_Texture->AddRef();
+	set.m_RenderTarget->D3D11SetRenderTarget(set.m_Texture, format, size.xy(), true, null, RHI::SampleCount1);
 
-	m_D3D11Context->m_SwapChainRenderTargets.PushBack(rt);
-	m_D3D11Context->m_SwapChainCount = 1;
-
-	m_D3D11Manager->SwapChainAdded();
-
-	ID3D11Texture2D			*tex = null;
 	D3D11_TEXTURE2D_DESC	textureStagingDesc = {};
 
 	textureStagingDesc.Width = size.x();
@@ -287,16 +294,71 @@ bool	CAAED3D11Context::CreateRenderTarget(RHI::EPixelFormat format, CUint3 size)
 	textureStagingDesc.Usage = D3D11_USAGE_STAGING;
 	textureStagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
 	if (textureStagingDesc.Format == DXGI_FORMAT_UNKNOWN ||
-		PK_D3D11_FAILED(m_D3D11Context->m_Device->CreateTexture2D(&textureStagingDesc, null, &tex)))
+		PK_D3D11_FAILED(m_D3D11Context->m_Device->CreateTexture2D(&textureStagingDesc, null, &set.m_StagingTexture)) ||
+		!m_RenderTargetSets.PushBack(set).Valid())
+	{
+		_ReleaseRenderTargetSet(set);
 		return false;
+	}
+	_SetCurrentRenderTarget(set);
+	return true;
+}
 
-	if (m_StagingTexture != null)
+//----------------------------------------------------------------------------
+
+void	CAAED3D11Context::ReleaseRenderTarget(RHI::EPixelFormat format, CUint3 size)
+{
+	for (u32 i = 0; i < m_RenderTargetSets.Count(); ++i)
 	{
-		m_StagingTexture->Release();
-		m_StagingTexture = null;
+		SRenderTargetSet	&set = m_RenderTargetSets[i];
+		if (set.m_Format == format && set.m_Size == size)
+		{
+			if (set.m_Texture == m_Texture)
+				return;
+			_ReleaseRenderTargetSet(set);
+			m_RenderTargetSets.Remove(i);
+			return;
+		}
 	}
-	m_StagingTexture = tex;
-	return true;
+}
+
+//----------------------------------------------------------------------------
+
+void	CAAED3D11Context::_SetCurrentRenderTarget(const SRenderTargetSet &set)
+{
+	PK_ASSERT(!m_StagingTextureMapped);
+	if (m_Texture == set.m_Texture)
+		return;
+	m_Texture = set.m_Texture;
+	m_StagingTexture = set.m_StagingTexture;
+
+	if (m_D3D11Context->m_SwapChainCount != 0)
+	{
+		m_D3D11Context->m_SwapChainRenderTargets.Clear();
+		m_D3D11Manager->SwapChainRemoved(0);
+	}
+
+	m_D3D11Context->m_SwapChainRenderTargets.PushBack(set.m_RenderTarget);
+	m_D3D11Context->m_SwapChainCount = 1;
+
+	m_D3D11Manager->SwapChainAdded();
+}
+
+//----------------------------------------------------------------------------
+
+void	CAAED3D11Context::_ReleaseRenderTargetSet(SRenderTargetSet &set)
+{
+	if (set.m_Texture != null)
+	{
+		set.m_Texture->Release();
+		set.m_Texture = null;
+	}
+	if (set.m_StagingTexture != null)
+	{
+		set.m_StagingTexture->Release();
+		set.m_StagingTexture = null;
+	}
+	set.m_RenderTarget = null;
 }
 
 //----------------------------------------------------------------------------
@@ -387,6 +449,45 @@ bool	CAAED3D11Context::FillRenderBuffer(PRefCountedMemoryBuffer dstBuffer, RHI::
 
 //----------------------------------------------------------------------------
 
+bool	CAAED3D11Context::MapRenderBuffer(RHI::EPixelFormat format, u32 width, u32 height, const u8 *&outRows, u32 &outRowPitch)
+{
+	(void)height;
+
+	PK_SCOPEDPROFILE();
+	PK_ASSERT(!m_StagingTextureMapped);
+
+	m_D3D11Context->m_ImmediateDeviceContext->CopyResource(m_StagingTexture, m_Texture);
+
+	D3D11_MAPPED_SUBRESOURCE	resource;
+	UINT						subresource = D3D11CalcSubresource(0, 0, 0);
+
+	HRESULT hr = m_D3D11Context->m_ImmediateDeviceContext->Map(m_StagingTexture, subresource, D3D11_MAP_READ, 0, &resource);
+	if (FAILED(hr))
+	{
+		CLog::Log(PK_ERROR, "D3D11Context map failure");
+		return false;
+	}
+	PK_ASSERT(resource.RowPitch >= RHI::PixelFormatHelpers::PixelFormatToPixelByteSize(format) * width);
+
+	outRows = reinterpret_cast<const u8*>(resource.pData);
+	outRowPitch = resource.RowPitch;
+	m_StagingTextureMapped = true;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+void	CAAED3D11Context::UnmapRenderBuffer()
+{
+	if (m_StagingTextureMapped)
+	{
+		m_D3D11Context->m_ImmediateDeviceContext->Unmap(m_StagingTexture, D3D11CalcSubresource(0, 0, 0));
+		m_StagingTextureMapped = false;
+	}
+}
+
+//----------------------------------------------------------------------------
+
 bool	CAAED3D11Context::FillCompositingTexture(void *srcBuffer, RHI::EPixelFormat format, u32 width, u32 height, u32 rowLength)
 {
 	(void)rowLength;
@@ -39,11 +39,18 @@ public:
 
 	RHI::PD3D12RenderTarget		m_RenderTargets[CAAED3D12Context::kFrameCount];
 	RHI::PD3D12ReadBackTexture	m_ReadbackTextures[CAAED3D12Context::kFrameCount];
+	ID3D12Resource				*m_Resources[CAAED3D12Context::kFrameCount];
 
+	RHI::EPixelFormat			m_Format;
+	CUint3						m_Size;
 
 	CD3D12SwapChainRT()
 		: m_BufferIndex(0)
+		, m_Format(RHI::FormatUnknown)
+		, m_Size(0)
 	{
+		for (u32 i = 0; i < CAAED3D12Context::kFrameCount; ++i)
+			m_Resources[i] = null;
 	}
 
 	~CD3D12SwapChainRT()
@@ -112,7 +119,8 @@ struct	SD3D12PlatformContext
 	IDXGIFactory4				*m_Factory;
 	IDXGIAdapter1				*m_HardwareAdapter;
 
-	TArray<CD3D12SwapChainRT*>	m_SwapChainsRTs;
+	TArray<CD3D12SwapChainRT*>	m_SwapChainsRTs;		// Current one
+	TArray<CD3D12SwapChainRT*>	m_KeptSwapChainsRTs;	// One per requested size, owns them
 
 
 	PFN_D3D12_CREATE_DEVICE				m_CreateDeviceFunc;
@@ -170,6 +178,7 @@ CAAED3D12Context::CAAED3D12Context()
 
 CAAED3D12Context::~CAAED3D12Context()
 {
+	_FlushPipelineCache();
 	ClearContextSwapchainsRT();
 	m_D3D12Manager->SwapChainRemoved(0);
 
@@ -198,6 +207,19 @@ bool	CAAED3D12Context::InitIFN()
 
 	m_ApiManager->InitApi(m_ApiContext);
 	m_Fence = m_D3D12Manager->CreateFence(RHI::SRHIResourceInfos("Fence"));
+
+	PKSample::SPipelineCacheDeviceID	deviceID;
+	IDXGIAdapter1						*adapter = m_Context->m_HardwareAdapter;
+	DXGI_ADAPTER_DESC1					desc;
+	if (adapter != null && SUCCEEDED(adapter->GetDesc1(&desc)))
+	{
+		LARGE_INTEGER	driverVersion;	// User mode driver version, also reported for D3D12 adapters
+		deviceID.m_VendorID = desc.VendorId;
+		deviceID.m_DeviceID = desc.DeviceId;
+		if (SUCCEEDED(adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion)))
+			deviceID.m_DriverVersion = static_cast<u64>(driverVersion.QuadPart);
+	}
+	_LoadPipelineCache(deviceID);
 	return true;
 }
 
@@ -240,6 +262,7 @@ bool	CAAED3D12Context::EndFrame()
 	m_ApiManager->EndFrame();
 	//Keep that after the endframe;
 	m_Fence->Signal(m_FrameCount, m_D3D12Context->m_CommandQueue);
+	_UpdatePipelineCache();
 	return true;
 }
 
@@ -460,21 +483,21 @@ bool	CAAED3D12Context::CreateCommandQueue()
 
 bool	CAAED3D12Context::CreateRenderTarget(RHI::EPixelFormat format, CUint3 size)
 {
-	if (m_Context->m_SwapChainsRTs.Count() != 0)
+	// Already created for this size:
+	for (u32 i = 0; i < m_Context->m_KeptSwapChainsRTs.Count(); ++i)
 	{
-		ClearContextSwapchainsRT();
-		m_D3D12Manager->SwapChainRemoved(0);
+		if (m_Context->m_KeptSwapChainsRTs[i]->m_Format == format && m_Context->m_KeptSwapChainsRTs[i]->m_Size == size)
+		{
+			SetCurrentSwapchainRT(i);
+			return true;
+		}
 	}
 
 	CD3D12SwapChainRT	*swapchainRT = PK_NEW(CD3D12SwapChainRT());
-	const CGuid			idx = m_Context->m_SwapChainsRTs.PushBack(swapchainRT);
-	if (!PK_VERIFY(idx.Valid()))
-	{
-		PK_DELETE(swapchainRT);
+	if (!PK_VERIFY(swapchainRT != null))
 		return false;
-	}
-	m_D3D12Context->m_SwapChainCount = 1;
-	m_D3D12Context->m_SwapChains = TMemoryView<RHI::ID3D12SwapChain*>(m_Context->m_SwapChainsRTs.ViewForWriting());
+	swapchainRT->m_Format = format;
+	swapchainRT->m_Size = size;
 
 	for (u32 i = 0; i < CAAED3D12Context::kFrameCount; ++i)
 	{
@@ -508,31 +531,77 @@ bool	CAAED3D12Context::CreateRenderTarget(RHI::EPixelFormat format, CUint3 size)
 		if (PK_D3D_FAILED(m_D3D12Context->m_Device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &resDesc, initialState, null, PK_RHI_IID_PPV_ARGS(&resource))))
 		{
 			CLog::Log(PK_ERROR, "D3D12Context: CreateCommittedResource failure");
-			m_D3D12Context->m_SwapChainCount = 0;
-			m_D3D12Context->m_SwapChains = TMemoryView<RHI::ID3D12SwapChain*>();
-			ClearContextSwapchainsRT();
+			PK_DELETE(swapchainRT);
 			return false;
 		}
 		rt->D3D12SetRenderTarget(resource, format, size.xy(), true, null, RHI::SampleCount1);
-		m_Resources[i] = resource;
+		swapchainRT->m_Resources[i] = resource;
 
 		RHI::PReadBackTexture readbackTex = m_D3D12Manager->CreateReadBackTexture(RHI::SRHIResourceInfos("readback Texture"), rt);
 
 		if (readbackTex == null)
 		{
 			CLog::Log(PK_ERROR, "D3D12Context: CreateReadBackTexture failure");
+			PK_DELETE(swapchainRT);
 			return false;
 		}
-		m_Context->m_SwapChainsRTs[0]->m_RenderTargets[i] = rt;
-		m_Context->m_SwapChainsRTs[0]->m_ReadbackTextures[i] = CastD3D12(readbackTex);
+		swapchainRT->m_RenderTargets[i] = rt;
+		swapchainRT->m_ReadbackTextures[i] = CastD3D12(readbackTex);
 	}
-	m_D3D12Manager->SwapChainAdded();
 
+	const CGuid	idx = m_Context->m_KeptSwapChainsRTs.PushBack(swapchainRT);
+	if (!PK_VERIFY(idx.Valid()))
+	{
+		PK_DELETE(swapchainRT);
+		return false;
+	}
+	SetCurrentSwapchainRT(idx);
 	return true;
 }
 
 //----------------------------------------------------------------------------
 
+void	CAAED3D12Context::ReleaseRenderTarget(RHI::EPixelFormat format, CUint3 size)
+{
+	for (u32 i = 0; i < m_Context->m_KeptSwapChainsRTs.Count(); ++i)
+	{
+		CD3D12SwapChainRT	*swapchainRT = m_Context->m_KeptSwapChainsRTs[i];
+		if (swapchainRT->m_Format == format && swapchainRT->m_Size == size)
+		{
+			if (!m_Context->m_SwapChainsRTs.Empty() && m_Context->m_SwapChainsRTs[0] == swapchainRT)
+				return;
+			PK_DELETE(swapchainRT);
+			m_Context->m_KeptSwapChainsRTs.Remove(i);
+			return;
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+
+void	CAAED3D12Context::SetCurrentSwapchainRT(u32 keptIdx)
+{
+	CD3D12SwapChainRT	*swapchainRT = m_Context->m_KeptSwapChainsRTs[keptIdx];
+	if (!m_Context->m_SwapChainsRTs.Empty() && m_Context->m_SwapChainsRTs[0] == swapchainRT)
+		return;
+	PK_ASSERT(m_MappedReadBackTexture == null);
+
+	if (m_Context->m_SwapChainsRTs.Count() != 0)
+	{
+		m_Context->m_SwapChainsRTs.Clear();
+		m_D3D12Manager->SwapChainRemoved(0);
+	}
+	if (!PK_VERIFY(m_Context->m_SwapChainsRTs.PushBack(swapchainRT).Valid()))
+		return;
+	m_D3D12Context->m_SwapChainCount = 1;
+	m_D3D12Context->m_SwapChains = TMemoryView<RHI::ID3D12SwapChain*>(m_Context->m_SwapChainsRTs.ViewForWriting());
+	for (u32 i = 0; i < CAAED3D12Context::kFrameCount; ++i)
+		m_Resources[i] = swapchainRT->m_Resources[i];
+	m_D3D12Manager->SwapChainAdded();
+}
+
+//----------------------------------------------------------------------------
+
 bool	CAAED3D12Context::SetAsCurrent(void *deviceContext)
 {
 	(void)deviceContext;
@@ -669,6 +738,53 @@ bool	CAAED3D12Context::FillRenderBuffer(PRefCountedMemoryBuffer dstBuffer, RHI::
 
 //----------------------------------------------------------------------------
 
+bool	CAAED3D12Context::MapRenderBuffer(RHI::EPixelFormat format, u32 width, u32 height, const u8 *&outRows, u32 &outRowPitch)
+{
+	PK_SCOPEDPROFILE();
+	PK_ASSERT(m_MappedReadBackTexture == null);
+
+	{
+		PK_NAMEDSCOPEDPROFILE("m_Fence->Wait");
+		m_Fence->Wait(m_FrameCount);
+	}
+	RHI::PReadBackTexture	rbTexture = m_Context->m_SwapChainsRTs[0]->m_ReadbackTextures[m_Context->m_SwapChainsRTs[0]->m_BufferIndex];
+	if (rbTexture == null)
+	{
+		CLog::Log(PK_ERROR, "D3D12Context: No readback texture in swap chain");
+		return false;
+	}
+
+	RHI::PCD3D12ReadBackTexture	d3dReadBackTex = CastD3D12(rbTexture);
+	ID3D12Resource				*d3dResource = d3dReadBackTex->D3D12GetResource();
+	void						*mappedData = null;
+
+	PK_ASSERT(d3dReadBackTex->D3D12GetFootprint().m_RowCount >= height);
+	PK_ASSERT(d3dReadBackTex->D3D12GetFootprint().m_RowSizeInBytes >= RHI::PixelFormatHelpers::PixelFormatToPixelByteSize(format) * width);
+	if (PK_D3D_FAILED(d3dResource->Map(0, null, &mappedData)))
+	{
+		CLog::Log(PK_ERROR, "D3D12Context: map failure");
+		return false;
+	}
+
+	outRows = reinterpret_cast<const u8*>(mappedData);
+	outRowPitch = d3dReadBackTex->D3D12GetFootprint().m_Footprint.Footprint.RowPitch;
+	m_MappedReadBackTexture = rbTexture;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+void	CAAED3D12Context::UnmapRenderBuffer()
+{
+	if (m_MappedReadBackTexture != null)
+	{
+		CastD3D12(m_MappedReadBackTexture)->D3D12GetResource()->Unmap(0, null);
+		m_MappedReadBackTexture = null;
+	}
+}
+
+//----------------------------------------------------------------------------
+
 bool	CAAED3D12Context::FillCompositingTexture(void *srcBuffer, RHI::EPixelFormat format, u32 width, u32 height, u32 rowLength)
 {
 	(void)rowLength;
@@ -699,10 +815,11 @@ TMemoryView<const RHI::PRenderTarget>	CAAED3D12Context::GetCurrentSwapChain()
 
 void		CAAED3D12Context::ClearContextSwapchainsRT()
 {
-	for (u32 i = 0; i < m_Context->m_SwapChainsRTs.Count(); ++i)
+	for (u32 i = 0; i < m_Context->m_KeptSwapChainsRTs.Count(); ++i)
 	{
-		PK_DELETE(m_Context->m_SwapChainsRTs[i]);
+		PK_DELETE(m_Context->m_KeptSwapChainsRTs[i]);
 	}
+	m_Context->m_KeptSwapChainsRTs.Clear();
 	m_Context->m_SwapChainsRTs.Clear();
 }
 
@@ -14,6 +14,7 @@
 #include <pk_rhi/include/metal/MetalPopcornEnumConversion.h>
 
 #include <PK-SampleLib/ApiContext/Metal/MetalContext.h>
+#include <PK-SampleLib/SampleUtils.h>
 
 #include <pk_kernel/include/kr_thread_pool_default.h>
 
@@ -51,6 +52,7 @@ CAAEMetalContext::CAAEMetalContext()
 
 CAAEMetalContext::~CAAEMetalContext()
 {
+	_FlushPipelineCache();
 	PK_SAFE_DELETE(m_Data);
 	PK_SAFE_DELETE(m_ApiContext);
 	m_ApiManager = null;
@@ -68,6 +70,7 @@ bool	CAAEMetalContext::EndFrame()
 	void	*syncRenderData = m_ApiManager->EndFrame();
 	if (syncRenderData == null)
 		return false;
+	_UpdatePipelineCache();
 	m_LastFrameSyncInfo = reinterpret_cast<RHI::SWaitAllSwapChains*>(syncRenderData);
 	PKSample::CMetalContext::EndFrame(	m_Data->m_MetalContext->m_Queue,
 										m_Data->m_MetalContext->m_SwapChains,
@@ -101,6 +104,15 @@ bool	CAAEMetalContext::InitIFN()
 		return false;
 	if (!PKSample::CMetalContext::CreateFinalBlitData(device, m_Data->m_FinalBlit, RHI::FormatFloat32RGBA))
 		return false;
+
+	// Metal exposes no PCI IDs: the drivers ship with the OS, the GPU is identified by its name
+	const char							*deviceName = [[device name] UTF8String];
+	const NSOperatingSystemVersion		osVersion = [[NSProcessInfo processInfo] operatingSystemVersion];
+	PKSample::SPipelineCacheDeviceID	deviceID;
+	deviceID.m_VendorID = 0x106B;	// Apple
+	deviceID.m_DeviceID = deviceName != null ? PKSample::ComputeCRC32(deviceName, static_cast<u32>(strlen(deviceName))) : 0;
+	deviceID.m_DriverVersion = (static_cast<u64>(osVersion.majorVersion) << 32) | (static_cast<u64>(osVersion.minorVersion) << 16) | static_cast<u64>(osVersion.patchVersion);
+	_LoadPipelineCache(deviceID);
 	return true;
 }
 
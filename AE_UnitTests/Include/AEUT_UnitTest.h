@@ -0,0 +1,73 @@
+//----------------------------------------------------------------------------
+// Copyright Persistant Studios, SARL.
+// https://popcornfx.com/popcornfx-community-license/
+//----------------------------------------------------------------------------
+#pragma once
+
+#ifndef	__FX_AEUT_UNITTEST_H__
+#define	__FX_AEUT_UNITTEST_H__
+
+#include "AEGP_Define.h"
+
+__AEGP_PK_BEGIN
+
+//----------------------------------------------------------------------------
+//
+//	Minimal test registry for the parts of the plugin that do not need After Effects nor a GPU:
+//	each AEUT_TEST() registers itself at static init, AEUT_Main.cpp runs them all and returns the failure count.
+//
+//----------------------------------------------------------------------------
+
+struct	SUnitTestContext
+{
+	const char	*m_TestName;
+	u32			m_CheckCount;
+	u32			m_FailureCount;
+};
+
+typedef void	(*FnUnitTest)(SUnitTestContext &ctx);
+
+struct	SUnitTestRegistration
+{
+	const char				*m_Name;
+	FnUnitTest				m_Function;
+	SUnitTestRegistration	*m_Next;
+
+	SUnitTestRegistration(const char *name, FnUnitTest function);
+
+	static SUnitTestRegistration	*Head();
+};
+
+void	UnitTestCheckFailed(SUnitTestContext &ctx, const char *file, u32 line, const char *expression);
+
+//----------------------------------------------------------------------------
+
+#define	AEUT_TEST(__name)																	\
+	static void		_AEUT_ ## __name(AEGPPk::SUnitTestContext &_aeutCtx);					\
+	static AEGPPk::SUnitTestRegistration	_AEUT_Registration_ ## __name(#__name, &_AEUT_ ## __name);	\
+	static void		_AEUT_ ## __name(AEGPPk::SUnitTestContext &_aeutCtx)
+
+// Non fatal: the test keeps running, the failure is logged and counted
+#define	AEUT_CHECK(__expr)																					\
+	do {																									\
+		++_aeutCtx.m_CheckCount;																			\
+		if (!(__expr))																						\
+			AEGPPk::UnitTestCheckFailed(_aeutCtx, __FILE__, __LINE__, #__expr);								\
+	} while (0)
+
+// Fatal: returns from the test function
+#define	AEUT_REQUIRE(__expr)																				\
+	do {																									\
+		++_aeutCtx.m_CheckCount;																			\
+		if (!(__expr))																						\
+		{																									\
+			AEGPPk::UnitTestCheckFailed(_aeutCtx, __FILE__, __LINE__, #__expr);								\
+			return;																							\
+		}																									\
+	} while (0)
+
+//----------------------------------------------------------------------------
+
+__AEGP_PK_END
+
+#endif	// __FX_AEUT_UNITTEST_H__
@@ -0,0 +1,116 @@
+//----------------------------------------------------------------------------
+// Copyright Persistant Studios, SARL.
+// https://popcornfx.com/popcornfx-community-license/
+//----------------------------------------------------------------------------
+#include "ae_precompiled.h"
+
+#include "AEUT_UnitTest.h"
+#include "RenderApi/AEGP_CopyPixels.h"
+
+#include <PK-SampleLib/RHIRenderParticleSceneHelpers.h>
+#include <PK-SampleLib/SampleUtils.h>
+
+#include <math.h>
+
+__AEGP_PK_BEGIN
+
+//----------------------------------------------------------------------------
+
+namespace
+{
+	using PKSample::CRHIParticleSceneRenderHelper;
+
+	// 16/32bpc and the old 8bpc path: tone-mapping output stored in a FormatFloat32RGBA target, encoded by CopyPixelOut8
+	PF_Pixel8	_FloatPath(float toneMapped, float gamma)
+	{
+		const float	stored = powf(toneMapped, 1.f / gamma);
+		CFloat4		texel(stored, stored, stored, toneMapped);
+
+		SCopyPixel	refcon = {};
+		refcon.m_SrcRows = reinterpret_cast<const u8*>(&texel);
+		refcon.m_SrcRowPitch = sizeof(CFloat4);
+
+		PF_Pixel8	out = {};
+		CopyPixelOut8(&refcon, 0, 0, null, &out);
+		return out;
+	}
+
+	//----------------------------------------------------------------------------
+
+	// 8bpc path: tone-mapping output stored in a FormatSrgb8RGBA target, read back by CopyPixelOutSrgb8.
+	// The GPU store is emulated with the D3D/Metal conversion rules: sRGB encoding, then round to nearest.
+	PF_Pixel8	_Srgb8Path(float toneMapped, float gamma)
+	{
+		const float	stored = powf(toneMapped, 1.f / gamma);
+		const float	encoded = PKSaturate(PKSample::ConvertLinearToSRGB(CFloat3(stored)).x());
+		u8			texel[4];
+		texel[0] = static_cast<u8>(encoded * 255.f + 0.5f);
+		texel[1] = texel[0];
+		texel[2] = texel[0];
+		texel[3] = static_cast<u8>(PKSaturate(toneMapped) * 255.f + 0.5f);	// Alpha is not sRGB encoded
+
+		SCopyPixel	refcon = {};
+		refcon.m_SrcRows = texel;
+		refcon.m_SrcRowPitch = sizeof(texel);
+
+		PF_Pixel8	out = {};
+		CopyPixelOutSrgb8(&refcon, 0, 0, null, &out);
+		return out;
+	}
+
+	//----------------------------------------------------------------------------
+
+	u32		_MaxChannelDiff(const PF_Pixel8 &a, const PF_Pixel8 &b)
+	{
+		const s32	diffs[] = { a.red - b.red, a.green - b.green, a.blue - b.blue, a.alpha - b.alpha };
+		u32			maxDiff = 0;
+		for (u32 i = 0; i < PK_ARRAY_COUNT(diffs); ++i)
+			maxDiff = PKMax(maxDiff, static_cast<u32>(PKAbs(diffs[i])));
+		return maxDiff;
+	}
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(ToneMappingGamma_IndependentOfFormatWhenFixed)
+{
+	const float	gammaFloat = CRHIParticleSceneRenderHelper::ToneMappingGamma(RHI::FormatFloat32RGBA, true);
+	const float	gammaSrgb8 = CRHIParticleSceneRenderHelper::ToneMappingGamma(RHI::FormatSrgb8RGBA, true);
+	AEUT_CHECK(gammaFloat == gammaSrgb8);
+	AEUT_CHECK(gammaFloat == CRHIParticleSceneRenderHelper::ToneMappingGamma(RHI::FormatFloat32RGBA, false));
+
+	// Default behavior of the samples: the GPU encoding replaces the gamma correction
+	AEUT_CHECK(CRHIParticleSceneRenderHelper::ToneMappingGamma(RHI::FormatSrgb8RGBA, false) == 1.f);
+	AEUT_CHECK(CRHIParticleSceneRenderHelper::ToneMappingGamma(RHI::FormatFloat32RGBA, false) == 2.2f);
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(CopyPixelsOut8_Srgb8TargetMatchesFloatTarget)
+{
+	// Gammas used by the AE render context (CAAERenderContext::_SetupSceneRenderer)
+	const float	gammaFloat = CRHIParticleSceneRenderHelper::ToneMappingGamma(RHI::FormatFloat32RGBA, true);
+	const float	gammaSrgb8 = CRHIParticleSceneRenderHelper::ToneMappingGamma(RHI::FormatSrgb8RGBA, true);
+
+	// The CPU path truncates where the GPU rounds: at most 1 LSB apart, anywhere in the tone-mapped range
+	const u32	kSteps = 4096;
+	u32			maxDiff = 0;
+	for (u32 i = 0; i <= kSteps; ++i)
+	{
+		const float	toneMapped = static_cast<float>(i) / static_cast<float>(kSteps);
+		maxDiff = PKMax(maxDiff, _MaxChannelDiff(_FloatPath(toneMapped, gammaFloat), _Srgb8Path(toneMapped, gammaSrgb8)));
+	}
+	AEUT_CHECK(maxDiff <= 1);
+
+	// Out of range values are clamped the same way
+	AEUT_CHECK(_MaxChannelDiff(_FloatPath(4.f, gammaFloat), _Srgb8Path(4.f, gammaSrgb8)) == 0);
+	AEUT_CHECK(_MaxChannelDiff(_FloatPath(0.f, gammaFloat), _Srgb8Path(0.f, gammaSrgb8)) == 0);
+
+	// What the tolerance catches: the format-dependent gamma shifts mid-tones by far more than 1 LSB
+	const float	gammaSrgb8Default = CRHIParticleSceneRenderHelper::ToneMappingGamma(RHI::FormatSrgb8RGBA, false);
+	AEUT_CHECK(_MaxChannelDiff(_FloatPath(0.18f, gammaFloat), _Srgb8Path(0.18f, gammaSrgb8Default)) > 1);
+}
+
+//----------------------------------------------------------------------------
+
+__AEGP_PK_END
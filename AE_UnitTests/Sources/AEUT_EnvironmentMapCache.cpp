@@ -0,0 +1,120 @@
+//----------------------------------------------------------------------------
+// Copyright Persistant Studios, SARL.
+// https://popcornfx.com/popcornfx-community-license/
+//----------------------------------------------------------------------------
+#include "ae_precompiled.h"
+
+#include "AEUT_UnitTest.h"
+
+#include <PK-SampleLib/SampleScene/Entities/EnvironmentMapEntity.h>
+
+__AEGP_PK_BEGIN
+
+//----------------------------------------------------------------------------
+
+namespace
+{
+	using PKSample::CEnvironmentMap;
+	using PKSample::CEnvironmentMapPrefilter;
+	using PKSample::SEnvironmentMapPrefilterParams;
+
+	void	_FillTestFile(TArray<u8> &file, u32 size)
+	{
+		file.Resize(size);
+		for (u32 i = 0; i < size; ++i)
+			file[i] = static_cast<u8>((i * 17) ^ (i >> 2));
+	}
+
+	//----------------------------------------------------------------------------
+
+	u64		_Key(const TArray<u8> &file, const SEnvironmentMapPrefilterParams &params, PKSample::EEnvironmentMapBaker baker = PKSample::EnvironmentMapBaker_GPU)
+	{
+		return CEnvironmentMapPrefilter::CacheKey(file.View(), params, baker);
+	}
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(EnvironmentMapCache_KeyIsDeterministic)
+{
+	TArray<u8>	file;
+	_FillTestFile(file, 4096);
+	const SEnvironmentMapPrefilterParams	params = CEnvironmentMap::PrefilterParams();
+	AEUT_CHECK(_Key(file, params) == _Key(file, params));
+	AEUT_CHECK(CEnvironmentMapPrefilter::CacheBasePath(CString::EmptyString, _Key(file, params)) == CEnvironmentMapPrefilter::CacheBasePath(CString::EmptyString, _Key(file, params)));
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(EnvironmentMapCache_CPUAndGPUBakesAreNotShared)
+{
+	// The CPU prefilter is close to the compute shaders, not bit exact: each baker has its own cache files
+	TArray<u8>	file;
+	_FillTestFile(file, 4096);
+	const SEnvironmentMapPrefilterParams	params = CEnvironmentMap::PrefilterParams();
+	const u64	gpuKey = _Key(file, params, PKSample::EnvironmentMapBaker_GPU);
+	const u64	cpuKey = _Key(file, params, PKSample::EnvironmentMapBaker_CPU);
+	AEUT_CHECK(gpuKey != cpuKey);
+	AEUT_CHECK(CEnvironmentMapPrefilter::CacheBasePath(CString::EmptyString, gpuKey) != CEnvironmentMapPrefilter::CacheBasePath(CString::EmptyString, cpuKey));
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(EnvironmentMapCache_KeySensitivity)
+{
+	TArray<u8>	file;
+	_FillTestFile(file, 4096);
+	const SEnvironmentMapPrefilterParams	params = CEnvironmentMap::PrefilterParams();
+	const u64								key = _Key(file, params);
+
+	// Any edited byte of the source file
+	const u32	kOffsets[] = { 0, 1, 2047, 4095 };
+	for (u32 i = 0; i < PK_ARRAY_COUNT(kOffsets); ++i)
+	{
+		file[kOffsets[i]] ^= 0x01;
+		AEUT_CHECK(_Key(file, params) != key);
+		file[kOffsets[i]] ^= 0x01;
+	}
+	AEUT_CHECK(_Key(file, params) == key);
+
+	// Truncated source file
+	TArray<u8>	truncated;
+	_FillTestFile(truncated, file.Count() - 1);
+	AEUT_CHECK(_Key(truncated, params) != key);
+
+	// Any prefilter param
+	u32 SEnvironmentMapPrefilterParams::*	kParams[] =
+	{
+		&SEnvironmentMapPrefilterParams::m_FaceSize,
+		&SEnvironmentMapPrefilterParams::m_MipmapCount,
+		&SEnvironmentMapPrefilterParams::m_FaceSizeIBL,
+		&SEnvironmentMapPrefilterParams::m_MipmapCountIBL,
+		&SEnvironmentMapPrefilterParams::m_SampleCount,
+	};
+	for (u32 i = 0; i < PK_ARRAY_COUNT(kParams); ++i)
+	{
+		SEnvironmentMapPrefilterParams	otherParams = params;
+		otherParams.*kParams[i] += 1;
+		AEUT_CHECK(_Key(file, otherParams) != key);
+		AEUT_CHECK(_Key(file, otherParams, PKSample::EnvironmentMapBaker_CPU) != _Key(file, params, PKSample::EnvironmentMapBaker_CPU));
+	}
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(EnvironmentMapCache_EntityParamsMatchBakerDefaults)
+{
+	// The AE browse dialog bakes with CEnvironmentMap::PrefilterParams(): the defaults describe the same cubemaps
+	const SEnvironmentMapPrefilterParams	entityParams = CEnvironmentMap::PrefilterParams();
+	const SEnvironmentMapPrefilterParams	defaultParams;
+	AEUT_CHECK(entityParams.m_FaceSize == defaultParams.m_FaceSize);
+	AEUT_CHECK(entityParams.m_MipmapCount == defaultParams.m_MipmapCount);
+	AEUT_CHECK(entityParams.m_FaceSizeIBL == defaultParams.m_FaceSizeIBL);
+	AEUT_CHECK(entityParams.m_MipmapCountIBL == defaultParams.m_MipmapCountIBL);
+	AEUT_CHECK(entityParams.m_SampleCount == defaultParams.m_SampleCount);
+	AEUT_CHECK(entityParams.m_MipmapCount == IntegerTools::Log2(entityParams.m_FaceSize) + 1);
+}
+
+//----------------------------------------------------------------------------
+
+__AEGP_PK_END
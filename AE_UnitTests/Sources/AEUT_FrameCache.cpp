@@ -0,0 +1,468 @@
+//----------------------------------------------------------------------------
+// Copyright Persistant Studios, SARL.
+// https://popcornfx.com/popcornfx-community-license/
+//----------------------------------------------------------------------------
+#include "ae_precompiled.h"
+
+#include "AEUT_UnitTest.h"
+
+#include "AEGP_FrameCache.h"
+
+#include <pk_kernel/include/kr_file.h>
+#include <pk_kernel/include/kr_file_directory_walker.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+__AEGP_PK_BEGIN
+
+//----------------------------------------------------------------------------
+
+namespace
+{
+	// Frame with its own row pitch: the padding bytes must not be read nor written by the cache
+	struct	STestFrame
+	{
+		u32			m_Width;
+		u32			m_Height;
+		u32			m_PixelSizeInBytes;
+		u32			m_RowPitch;
+		TArray<u8>	m_Data;
+
+		bool	Init(u32 width, u32 height, u32 pixelSizeInBytes, u32 rowPadding, u8 paddingValue)
+		{
+			m_Width = width;
+			m_Height = height;
+			m_PixelSizeInBytes = pixelSizeInBytes;
+			m_RowPitch = width * pixelSizeInBytes + rowPadding;
+			if (!m_Data.Resize(m_RowPitch * height))
+				return false;
+			Mem::Set(m_Data.RawDataPointer(), paddingValue, m_Data.CoveredBytes());
+			return true;
+		}
+
+		u8		*Row(u32 y) { return m_Data.RawDataPointer() + y * m_RowPitch; }
+		u8		*Pixel(u32 x, u32 y) { return Row(y) + x * m_PixelSizeInBytes; }
+	};
+
+	//----------------------------------------------------------------------------
+
+	enum	EPattern
+	{
+		Pattern_Solid,			// Runs only
+		Pattern_Noise,			// Literals only
+		Pattern_Stripes,		// Runs and literals, crossing the 128 pixels token limit
+	};
+
+	u32		_NextRandom(u32 &state)
+	{
+		state = state * 1664525U + 1013904223U;
+		return state >> 8;
+	}
+
+	void	_FillPattern(STestFrame &frame, EPattern pattern, u32 seed)
+	{
+		for (u32 y = 0; y < frame.m_Height; ++y)
+		{
+			for (u32 x = 0; x < frame.m_Width; ++x)
+			{
+				u8	*pixel = frame.Pixel(x, y);
+				for (u32 b = 0; b < frame.m_PixelSizeInBytes; ++b)
+				{
+					switch (pattern)
+					{
+					case	Pattern_Solid:
+						pixel[b] = static_cast<u8>(seed + b);
+						break;
+					case	Pattern_Noise:
+						pixel[b] = static_cast<u8>(_NextRandom(seed));
+						break;
+					case	Pattern_Stripes:
+						// 200 identical pixels, then 70 distinct ones
+						pixel[b] = (x % 270) < 200 ? static_cast<u8>(y + b) : static_cast<u8>(x * 7 + y * 13 + b);
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	//----------------------------------------------------------------------------
+
+	bool	_SamePixels(STestFrame &a, STestFrame &b)
+	{
+		if (a.m_Width != b.m_Width || a.m_Height != b.m_Height || a.m_PixelSizeInBytes != b.m_PixelSizeInBytes)
+			return false;
+		for (u32 y = 0; y < a.m_Height; ++y)
+		{
+			if (memcmp(a.Row(y), b.Row(y), a.m_Width * a.m_PixelSizeInBytes) != 0)
+				return false;
+		}
+		return true;
+	}
+
+	//----------------------------------------------------------------------------
+
+	bool	_PaddingUntouched(STestFrame &frame, u8 paddingValue)
+	{
+		const u32	rowBytes = frame.m_Width * frame.m_PixelSizeInBytes;
+		for (u32 y = 0; y < frame.m_Height; ++y)
+		{
+			for (u32 i = rowBytes; i < frame.m_RowPitch; ++i)
+			{
+				if (frame.Row(y)[i] != paddingValue)
+					return false;
+			}
+		}
+		return true;
+	}
+
+	//----------------------------------------------------------------------------
+
+	SFrameCacheKey	_Key(u32 value)
+	{
+		CFrameCacheKeyBuilder	builder;
+		builder.AppendValue(value);
+		return builder.Finish();
+	}
+
+	//----------------------------------------------------------------------------
+
+	bool	_Store(CFrameResultCache &cache, const SFrameCacheKey &key, STestFrame &frame)
+	{
+		return cache.Store(key, frame.m_Data.RawDataPointer(), frame.m_RowPitch, frame.m_Width, frame.m_Height, frame.m_PixelSizeInBytes);
+	}
+
+	//----------------------------------------------------------------------------
+
+	// Fetched into a fresh frame of the same layout, compared with 'expected'
+	bool	_FetchMatches(CFrameResultCache &cache, const SFrameCacheKey &key, STestFrame &expected)
+	{
+		STestFrame	fetched;
+		if (!fetched.Init(expected.m_Width, expected.m_Height, expected.m_PixelSizeInBytes, 0, 0xCD))
+			return false;
+		if (!cache.Fetch(key, fetched.m_Data.RawDataPointer(), fetched.m_RowPitch, fetched.m_Width, fetched.m_Height, fetched.m_PixelSizeInBytes))
+			return false;
+		return _SamePixels(fetched, expected);
+	}
+
+	//----------------------------------------------------------------------------
+
+	// Physical test directory, emptied of its spilled frames
+	CString	_SpillDirectory(const char *name)
+	{
+		const char	*tempEnvs[] = { "TMPDIR", "TEMP", "TMP" };
+		CString		tempDir = "/tmp";
+		for (const char *tempEnv : tempEnvs)
+		{
+			const char	*value = getenv(tempEnv);
+			if (value != null && value[0] != '\0')
+			{
+				tempDir = value;
+				break;
+			}
+		}
+		CString	directory = tempDir / "AEUT_FrameCache" / name;
+		CFilePath::Purify(directory);
+		File::DefaultFileSystem()->CreateDirectoryChainIFN(directory, true);
+		CFrameResultCache::DeleteSpilledFrames(directory);
+		return directory;
+	}
+
+	//----------------------------------------------------------------------------
+
+	u32		_SpilledFileCount(const CString &directory)
+	{
+		class	CSpilledFilesCounter : public CFileDirectoryWalker
+		{
+		public:
+			u32		m_Count = 0;
+
+			CSpilledFilesCounter(const CString &rootDir)
+			:	CFileDirectoryWalker(rootDir, IgnoreVirtualFS)
+			{
+			}
+
+			virtual bool	DirectoryNotifier(const CFilePack *, const char *, u32) override
+			{
+				return false;
+			}
+
+			virtual void	FileNotifier(const CFilePack *, const char *fullPath, u32) override
+			{
+				const char	*extension = CFilePath::ExtractExtension(fullPath);
+				if (extension != null && !strcmp(extension, "pkfc"))
+					++m_Count;
+			}
+		};
+
+		CSpilledFilesCounter	counter(directory);
+		counter.Walk();
+		return counter.m_Count;
+	}
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(FrameCache_RLERoundTrip)
+{
+	// AE 8, 16 bits and float pixels. Widths around the 128 pixels token limit.
+	const u32		kPixelSizes[] = { 4, 8, 16 };
+	const u32		kWidths[] = { 1, 2, 127, 128, 129, 300 };
+	const EPattern	kPatterns[] = { Pattern_Solid, Pattern_Noise, Pattern_Stripes };
+	const u8		kPadding = 0xAB;
+
+	CFrameResultCache	cache;
+	cache.SetLimits(256 << 20, 0, CString::EmptyString);
+
+	u32		keyValue = 0;
+	bool	allStored = true;
+	bool	allMatch = true;
+	bool	paddingKept = true;
+	for (u32 pixelSize : kPixelSizes)
+	{
+		for (u32 width : kWidths)
+		{
+			for (EPattern pattern : kPatterns)
+			{
+				STestFrame	frame;
+				AEUT_REQUIRE(frame.Init(width, 5, pixelSize, 12, kPadding));
+				_FillPattern(frame, pattern, keyValue);
+
+				const SFrameCacheKey	key = _Key(++keyValue);
+				allStored &= _Store(cache, key, frame);
+
+				// Fetched into a padded frame too: only the pixels are written
+				STestFrame	fetched;
+				AEUT_REQUIRE(fetched.Init(width, 5, pixelSize, 7, kPadding));
+				const bool	fetchedOk = cache.Fetch(key, fetched.m_Data.RawDataPointer(), fetched.m_RowPitch, width, 5, pixelSize);
+				allMatch &= fetchedOk && _SamePixels(fetched, frame);
+				paddingKept &= _PaddingUntouched(fetched, kPadding);
+			}
+		}
+	}
+	AEUT_CHECK(allStored);
+	AEUT_CHECK(allMatch);
+	AEUT_CHECK(paddingKept);
+
+	// A solid frame is encoded in a few bytes per row
+	const u64	ramBefore = cache.Stats().m_RAMBytes;
+	STestFrame	solid;
+	AEUT_REQUIRE(solid.Init(1920, 4, 16, 0, 0));
+	_FillPattern(solid, Pattern_Solid, 3);
+	AEUT_REQUIRE(_Store(cache, _Key(0xFFFF), solid));
+	AEUT_CHECK(cache.Stats().m_RAMBytes - ramBefore < 4 * 1920);
+	AEUT_CHECK(_FetchMatches(cache, _Key(0xFFFF), solid));
+
+	// Other dimensions or pixel size: miss
+	STestFrame	other;
+	AEUT_REQUIRE(other.Init(1920, 4, 8, 0, 0));
+	AEUT_CHECK(!cache.Fetch(_Key(0xFFFF), other.m_Data.RawDataPointer(), other.m_RowPitch, 1920, 4, 8));
+	AEUT_CHECK(!cache.Fetch(_Key(0xFFFF), other.m_Data.RawDataPointer(), other.m_RowPitch, 1919, 4, 8));
+	AEUT_CHECK(!cache.Fetch(_Key(0x10000), other.m_Data.RawDataPointer(), other.m_RowPitch, 1920, 4, 8));
+
+	cache.Clear();
+	AEUT_CHECK(cache.Stats().m_EntryCount == 0 && cache.Stats().m_RAMBytes == 0);
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(FrameCache_LRUAndSpill)
+{
+	// Noise frames do not compress: each one takes a bit more than its raw size
+	STestFrame	frames[3];
+	for (u32 i = 0; i < 3; ++i)
+	{
+		AEUT_REQUIRE(frames[i].Init(64, 64, 4, 0, 0));
+		_FillPattern(frames[i], Pattern_Noise, 100 + i);
+	}
+	const u64		frameBytes = 64 * 64 * 4;
+	const CString	directory = _SpillDirectory("LRUAndSpill");
+
+	CFrameResultCache	cache;
+	cache.SetLimits(frameBytes * 5 / 2, frameBytes * 10, directory);
+	AEUT_REQUIRE(_Store(cache, _Key(0), frames[0]));
+	AEUT_REQUIRE(_Store(cache, _Key(1), frames[1]));
+	AEUT_CHECK(cache.Stats().m_DiskBytes == 0);
+
+	// Frame 0 used last: frame 1 is the least recently used, spilled by the third frame
+	AEUT_CHECK(_FetchMatches(cache, _Key(0), frames[0]));
+	AEUT_REQUIRE(_Store(cache, _Key(2), frames[2]));
+	SFrameCacheStats	stats = cache.Stats();
+	AEUT_CHECK(stats.m_EntryCount == 3);
+	AEUT_CHECK(stats.m_RAMBytes <= frameBytes * 5 / 2);
+	AEUT_CHECK(stats.m_DiskBytes > frameBytes);
+	AEUT_CHECK(_SpilledFileCount(directory) == 1);
+
+	// Read back from the disk: frame 0 is now the least recently used in RAM, and goes to disk
+	AEUT_CHECK(_FetchMatches(cache, _Key(1), frames[1]));
+	AEUT_CHECK(_SpilledFileCount(directory) == 2);
+	AEUT_CHECK(_FetchMatches(cache, _Key(0), frames[0]));
+	AEUT_CHECK(_FetchMatches(cache, _Key(2), frames[2]));
+	AEUT_CHECK(cache.Stats().m_RAMBytes <= frameBytes * 5 / 2);
+
+	// Disk limit of one frame: the oldest spilled frame is deleted
+	cache.SetLimits(frameBytes * 3 / 2, frameBytes * 3 / 2, directory);
+	AEUT_CHECK(_SpilledFileCount(directory) == 0);
+	AEUT_REQUIRE(_Store(cache, _Key(0), frames[0]));
+	AEUT_REQUIRE(_Store(cache, _Key(1), frames[1]));	// Spills frame 0
+	AEUT_REQUIRE(_Store(cache, _Key(2), frames[2]));	// Spills frame 1, deletes frame 0
+	AEUT_CHECK(_SpilledFileCount(directory) == 1);
+	AEUT_CHECK(cache.Stats().m_EntryCount == 2);
+	AEUT_CHECK(!_FetchMatches(cache, _Key(0), frames[0]));
+
+	// Frame 1 back in RAM spills frame 2, the disk limit then deletes frame 2: older than frame 1
+	AEUT_CHECK(_FetchMatches(cache, _Key(1), frames[1]));
+	AEUT_CHECK(!_FetchMatches(cache, _Key(2), frames[2]));
+	AEUT_CHECK(_SpilledFileCount(directory) == 1);
+
+	// A corrupted spill file is a miss, not a wrong frame
+	AEUT_REQUIRE(_Store(cache, _Key(0), frames[0]));	// Frame 1 leaves the RAM, its file is kept
+	AEUT_REQUIRE(_SpilledFileCount(directory) == 1);
+	{
+		class	CSpillCorrupter : public CFileDirectoryWalker
+		{
+		public:
+			CSpillCorrupter(const CString &rootDir) : CFileDirectoryWalker(rootDir, IgnoreVirtualFS) { }
+			virtual bool	DirectoryNotifier(const CFilePack *, const char *, u32) override { return false; }
+			virtual void	FileNotifier(const CFilePack *, const char *fullPath, u32) override
+			{
+				PFileStream	stream = File::DefaultFileSystem()->OpenStream(fullPath, IFileSystem::Access_WriteCreate, true);
+				if (stream != null)
+				{
+					const char	garbage[] = "not a cached frame";
+					stream->Write(garbage, sizeof(garbage));
+					stream->Close();
+				}
+			}
+		};
+		CSpillCorrupter	corrupter(directory);
+		corrupter.Walk();
+	}
+	AEUT_CHECK(!_FetchMatches(cache, _Key(1), frames[1]));
+	AEUT_CHECK(_SpilledFileCount(directory) == 0);
+	AEUT_CHECK(_FetchMatches(cache, _Key(0), frames[0]));
+
+	cache.Clear();
+	stats = cache.Stats();
+	AEUT_CHECK(stats.m_EntryCount == 0 && stats.m_RAMBytes == 0 && stats.m_DiskBytes == 0);
+	AEUT_CHECK(_SpilledFileCount(directory) == 0);
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(FrameCache_SpillDirectoriesAreNotShared)
+{
+	// Two processes, two directories: a new cache does not delete the frames of the other one
+	STestFrame	frames[2];
+	for (u32 i = 0; i < 2; ++i)
+	{
+		AEUT_REQUIRE(frames[i].Init(32, 32, 4, 0, 0));
+		_FillPattern(frames[i], Pattern_Noise, 200 + i);
+	}
+	const u64		frameBytes = 32 * 32 * 4;
+	const CString	directoryA = _SpillDirectory("ProcessA");
+	const CString	directoryB = _SpillDirectory("ProcessB");
+
+	CFrameResultCache	cacheA;
+	cacheA.SetLimits(frameBytes * 3 / 2, frameBytes * 10, directoryA);
+	AEUT_REQUIRE(_Store(cacheA, _Key(0), frames[0]));
+	AEUT_REQUIRE(_Store(cacheA, _Key(1), frames[1]));	// Spills frame 0
+	AEUT_REQUIRE(_SpilledFileCount(directoryA) == 1);
+
+	CFrameResultCache	cacheB;
+	cacheB.SetLimits(frameBytes * 3 / 2, frameBytes * 10, directoryB);
+	AEUT_REQUIRE(_Store(cacheB, _Key(0), frames[1]));
+	cacheB.Clear();
+	AEUT_CHECK(_SpilledFileCount(directoryA) == 1);
+	AEUT_CHECK(_FetchMatches(cacheA, _Key(0), frames[0]));
+
+	// Left by a crashed session: emptied by DeleteSpilledFrames()
+	CFrameResultCache::DeleteSpilledFrames(directoryA);
+	AEUT_CHECK(_SpilledFileCount(directoryA) == 0);
+	cacheA.Clear();
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(FrameCache_KeySensitivity)
+{
+	u8	data[1001];
+	for (u32 i = 0; i < sizeof(data); ++i)
+		data[i] = static_cast<u8>(i * 31 + 7);
+
+	CFrameCacheKeyBuilder	reference;
+	reference.Append(data, sizeof(data));
+	const SFrameCacheKey	key = reference.Finish();
+
+	// Deterministic
+	CFrameCacheKeyBuilder	same;
+	same.Append(data, sizeof(data));
+	AEUT_CHECK(same.Finish() == key);
+
+	// Any flipped bit changes both halves, in the 8 bytes words and in the tail
+	bool	allDiffer = true;
+	for (u32 i = 0; i < sizeof(data); i += 37)
+	{
+		for (u32 bit = 0; bit < 8; bit += 3)
+		{
+			data[i] ^= (1 << bit);
+			CFrameCacheKeyBuilder	builder;
+			builder.Append(data, sizeof(data));
+			const SFrameCacheKey	otherKey = builder.Finish();
+			allDiffer &= otherKey.m_Hash[0] != key.m_Hash[0] && otherKey.m_Hash[1] != key.m_Hash[1];
+			data[i] ^= (1 << bit);
+		}
+	}
+	data[sizeof(data) - 1] ^= 0x80;
+	{
+		CFrameCacheKeyBuilder	builder;
+		builder.Append(data, sizeof(data));
+		allDiffer &= builder.Finish() != key;
+	}
+	data[sizeof(data) - 1] ^= 0x80;
+	AEUT_CHECK(allDiffer);
+
+	// Trailing zeros change the length
+	const u8		zeros[16] = {};
+	SFrameCacheKey	zeroKeys[16];
+	bool			lengthsDiffer = true;
+	for (u32 length = 0; length < 16; ++length)
+	{
+		CFrameCacheKeyBuilder	builder;
+		builder.Append(zeros, length);
+		zeroKeys[length] = builder.Finish();
+		for (u32 shorter = 0; shorter < length; ++shorter)
+			lengthsDiffer &= zeroKeys[shorter] != zeroKeys[length];
+	}
+	AEUT_CHECK(lengthsDiffer);
+
+	// Strings carry their length: the split between two strings matters
+	CFrameCacheKeyBuilder	splitA;
+	splitA.AppendString("ab");
+	splitA.AppendString("c");
+	CFrameCacheKeyBuilder	splitB;
+	splitB.AppendString("a");
+	splitB.AppendString("bc");
+	AEUT_CHECK(splitA.Finish() != splitB.Finish());
+
+	// Values are hashed bitwise: -0.0f is another frame input than 0.0f
+	CFrameCacheKeyBuilder	positiveZero;
+	positiveZero.AppendValue(0.0f);
+	CFrameCacheKeyBuilder	negativeZero;
+	negativeZero.AppendValue(-0.0f);
+	AEUT_CHECK(positiveZero.Finish() != negativeZero.Finish());
+
+	// Consecutive small values do not collide
+	bool	noCollision = true;
+	for (u32 i = 0; i < 256; ++i)
+	{
+		for (u32 j = i + 1; j < 256; ++j)
+			noCollision &= _Key(i) != _Key(j);
+	}
+	AEUT_CHECK(noCollision);
+}
+
+//----------------------------------------------------------------------------
+
+__AEGP_PK_END
@@ -0,0 +1,215 @@
+//----------------------------------------------------------------------------
+// Copyright Persistant Studios, SARL.
+// https://popcornfx.com/popcornfx-community-license/
+//----------------------------------------------------------------------------
+#include "ae_precompiled.h"
+
+#include "AEUT_UnitTest.h"
+
+#include "AEGP_LogQueue.h"
+
+#include <pk_kernel/include/kr_threads_basics.h>
+#include <pk_kernel/include/kr_thread_pool_default.h>
+
+#include <atomic>
+#include <stdio.h>
+#include <thread>
+
+__AEGP_PK_BEGIN
+
+//----------------------------------------------------------------------------
+
+namespace
+{
+	// Records the reports of one or more flushing threads
+	struct	SReportCollector
+	{
+		Threads::CCriticalSection			m_Lock;
+		TArray<CLogMessageQueue::ELevel>	m_Levels;
+		TArray<CString>						m_Texts;
+
+		void	Report(CLogMessageQueue::ELevel level, const CString &text)
+		{
+			PK_SCOPEDLOCK(m_Lock);
+			PK_VERIFY(m_Levels.PushBack(level).Valid());
+			PK_VERIFY(m_Texts.PushBack(text).Valid());
+		}
+
+		CLogMessageQueue::CbReport	Callback() { return CLogMessageQueue::CbReport(this, &SReportCollector::Report); }
+
+		bool	Has(u32 index, CLogMessageQueue::ELevel level, const char *text) const
+		{
+			return index < m_Texts.Count() && m_Levels[index] == level && m_Texts[index] == text;
+		}
+	};
+
+	//----------------------------------------------------------------------------
+
+	const u32	kFloodThreadCount = 8;
+	const u32	kFloodMessagesPerThread = 4000;
+	const u32	kFloodMaxPending = 256;
+	const u32	kFloodConsumerCount = 2;
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(LogQueue_FloodFromManyThreads)
+{
+	// Distinct messages, no repeat delay: every message is either reported or counted as dropped
+	CLogMessageQueue	queue(kFloodMaxPending, CLogMessageQueue::kDefaultMaxReportedMessages, 0.0);
+	SReportCollector	collector;
+	std::atomic<u32>	producersLeft(kFloodThreadCount);
+	std::atomic<u32>	maxPendingSeen(0);
+	// Like the AE render threads, the PopcornFX allocators see registered user threads
+	CThreadID			consumerIds[kFloodConsumerCount];
+	CThreadID			producerIds[kFloodThreadCount];
+
+	std::thread	consumers[kFloodConsumerCount];
+	for (u32 c = 0; c < kFloodConsumerCount; ++c)
+	{
+		consumers[c] = std::thread([&, c]()
+		{
+			consumerIds[c] = CCurrentThread::RegisterUserThread();
+			while (producersLeft.load() != 0)
+			{
+				const u32	pending = queue.PendingCount();
+				u32			seen = maxPendingSeen.load();
+				while (pending > seen && !maxPendingSeen.compare_exchange_weak(seen, pending)) { }
+				queue.Flush(collector.Callback(), 0.0, false);
+				std::this_thread::yield();
+			}
+		});
+	}
+
+	std::thread	producers[kFloodThreadCount];
+	for (u32 t = 0; t < kFloodThreadCount; ++t)
+	{
+		producers[t] = std::thread([&queue, &producersLeft, &producerIds, t]()
+		{
+			producerIds[t] = CCurrentThread::RegisterUserThread();
+			for (u32 i = 0; i < kFloodMessagesPerThread; ++i)
+				queue.Push(CLogMessageQueue::Level_Info, CString::Format("T%u #%u", t, i));
+			producersLeft.fetch_sub(1);
+		});
+	}
+	for (u32 t = 0; t < kFloodThreadCount; ++t)
+		producers[t].join();
+	for (u32 c = 0; c < kFloodConsumerCount; ++c)
+		consumers[c].join();
+	for (u32 t = 0; t < kFloodThreadCount; ++t)
+		CThreadManager::UnsafeUnregisterUserThread(producerIds[t]);
+	for (u32 c = 0; c < kFloodConsumerCount; ++c)
+		CThreadManager::UnsafeUnregisterUserThread(consumerIds[c]);
+	queue.Flush(collector.Callback(), 0.0, true);
+
+	AEUT_CHECK(queue.PendingCount() == 0);
+	AEUT_CHECK(!queue.HasWork());
+	AEUT_CHECK(maxPendingSeen.load() <= kFloodMaxPending);
+
+	// Each thread's messages are reported in its logging order, gaps are the dropped ones
+	u32		nextIndex[kFloodThreadCount] = {};
+	u32		reportedCount = 0;
+	u32		droppedCount = 0;
+	bool	ordered = true;
+	bool	wellFormed = true;
+	for (u32 i = 0; i < collector.m_Texts.Count(); ++i)
+	{
+		u32	a = 0;
+		u32	b = 0;
+		if (collector.m_Levels[i] == CLogMessageQueue::Level_Error)
+		{
+			wellFormed &= sscanf(collector.m_Texts[i].Data(), "%u messages were dropped", &a) == 1;
+			droppedCount += a;
+			continue;
+		}
+		if (sscanf(collector.m_Texts[i].Data(), "T%u #%u", &a, &b) != 2 || a >= kFloodThreadCount)
+		{
+			wellFormed = false;
+			continue;
+		}
+		ordered &= b >= nextIndex[a];
+		nextIndex[a] = b + 1;
+		++reportedCount;
+	}
+	AEUT_CHECK(wellFormed);
+	AEUT_CHECK(ordered);
+	AEUT_CHECK(reportedCount + droppedCount == kFloodThreadCount * kFloodMessagesPerThread);
+	AEUT_CHECK(reportedCount != 0);
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(LogQueue_DroppedAboveLimit)
+{
+	CLogMessageQueue	queue(4, CLogMessageQueue::kDefaultMaxReportedMessages, 5.0);
+	for (u32 i = 0; i < 10; ++i)
+		queue.Push(CLogMessageQueue::Level_Info, CString::Format("Message %u", i));
+	AEUT_CHECK(queue.PendingCount() == 4);
+	AEUT_CHECK(queue.HasWork());
+
+	// The first ones are kept, the drop count is reported last
+	SReportCollector	collector;
+	queue.Flush(collector.Callback(), 0.0, false);
+	AEUT_REQUIRE(collector.m_Texts.Count() == 5);
+	AEUT_CHECK(collector.Has(0, CLogMessageQueue::Level_Info, "Message 0"));
+	AEUT_CHECK(collector.Has(3, CLogMessageQueue::Level_Info, "Message 3"));
+	AEUT_CHECK(collector.Has(4, CLogMessageQueue::Level_Error, "6 messages were dropped"));
+	AEUT_CHECK(queue.PendingCount() == 0);
+	AEUT_CHECK(!queue.HasWork());
+
+	// Without callback, the messages are released
+	queue.Push(CLogMessageQueue::Level_Error, "Lost");
+	queue.Flush(CLogMessageQueue::CbReport(), 0.0, true);
+	AEUT_CHECK(queue.PendingCount() == 0);
+	AEUT_CHECK(!queue.HasWork());
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(LogQueue_RepeatsAreSuppressed)
+{
+	CLogMessageQueue	queue(16, 4, 5.0);
+	SReportCollector	collector;
+
+	for (u32 i = 0; i < 3; ++i)
+		queue.Push(CLogMessageQueue::Level_Info, "Repeated");
+	queue.Flush(collector.Callback(), 0.0, false);
+	AEUT_REQUIRE(collector.m_Texts.Count() == 1);
+	AEUT_CHECK(collector.Has(0, CLogMessageQueue::Level_Info, "Repeated"));
+	AEUT_CHECK(queue.HasWork());	// 2 repeats not reported yet
+
+	// Within the repeat delay: nothing new
+	queue.Flush(collector.Callback(), 1.0, false);
+	AEUT_CHECK(collector.m_Texts.Count() == 1);
+
+	// Next log after the delay carries the repeat count
+	queue.Push(CLogMessageQueue::Level_Info, "Repeated");
+	queue.Flush(collector.Callback(), 6.0, false);
+	AEUT_REQUIRE(collector.m_Texts.Count() == 2);
+	AEUT_CHECK(collector.Has(1, CLogMessageQueue::Level_Info, "Repeated (repeated 2 times)"));
+	AEUT_CHECK(!queue.HasWork());
+
+	// 'flushRepeats' does not wait for the delay
+	queue.Push(CLogMessageQueue::Level_Info, "Repeated");
+	queue.Push(CLogMessageQueue::Level_Info, "Repeated");
+	queue.Flush(collector.Callback(), 7.0, true);
+	AEUT_REQUIRE(collector.m_Texts.Count() == 3);
+	AEUT_CHECK(collector.Has(2, CLogMessageQueue::Level_Info, "Repeated (repeated 2 times)"));
+
+	// Same text, other level: another message
+	queue.Push(CLogMessageQueue::Level_Error, "Repeated");
+	queue.Flush(collector.Callback(), 8.0, false);
+	AEUT_REQUIRE(collector.m_Texts.Count() == 4);
+	AEUT_CHECK(collector.Has(3, CLogMessageQueue::Level_Error, "Repeated"));
+
+	// Forgotten history: reported again right away
+	queue.ClearHistory();
+	queue.Push(CLogMessageQueue::Level_Error, "Repeated");
+	queue.Flush(collector.Callback(), 8.5, false);
+	AEUT_REQUIRE(collector.m_Texts.Count() == 5);
+	AEUT_CHECK(collector.Has(4, CLogMessageQueue::Level_Error, "Repeated"));
+}
+
+//----------------------------------------------------------------------------
+
+__AEGP_PK_END
@@ -0,0 +1,82 @@
+//----------------------------------------------------------------------------
+// Copyright Persistant Studios, SARL.
+// https://popcornfx.com/popcornfx-community-license/
+//----------------------------------------------------------------------------
+#include "ae_precompiled.h"
+
+#include "AEUT_UnitTest.h"
+
+#include <PK-SampleLib/PopcornStartup/PopcornStartup.h>
+
+#include <string.h>
+
+__AEGP_PK_BEGIN
+
+//----------------------------------------------------------------------------
+
+namespace
+{
+	SUnitTestRegistration	*s_Head = null;	// Zero initialized before any dynamic initialization: safe from the registrations
+}
+
+//----------------------------------------------------------------------------
+
+SUnitTestRegistration::SUnitTestRegistration(const char *name, FnUnitTest function)
+:	m_Name(name)
+,	m_Function(function)
+,	m_Next(s_Head)
+{
+	s_Head = this;
+}
+
+//----------------------------------------------------------------------------
+
+SUnitTestRegistration	*SUnitTestRegistration::Head()
+{
+	return s_Head;
+}
+
+//----------------------------------------------------------------------------
+
+void	UnitTestCheckFailed(SUnitTestContext &ctx, const char *file, u32 line, const char *expression)
+{
+	++ctx.m_FailureCount;
+	CLog::Log(PK_ERROR, "[%s] %s(%u): check failed: %s", ctx.m_TestName, file, line, expression);
+}
+
+//----------------------------------------------------------------------------
+
+__AEGP_PK_END
+
+//----------------------------------------------------------------------------
+
+// Usage: AE_UnitTests [test name filter]
+int		main(int argc, char **argv)
+{
+	using namespace	AEGPPk;
+
+	if (!PKSample::PopcornStartup(true))
+		return -1;
+
+	const char	*filter = argc > 1 ? argv[1] : null;
+	u32			testCount = 0;
+	u32			failedTestCount = 0;
+	for (SUnitTestRegistration *test = SUnitTestRegistration::Head(); test != null; test = test->m_Next)
+	{
+		if (filter != null && strstr(test->m_Name, filter) == null)
+			continue;
+		SUnitTestContext	ctx;
+		ctx.m_TestName = test->m_Name;
+		ctx.m_CheckCount = 0;
+		ctx.m_FailureCount = 0;
+		test->m_Function(ctx);
+		++testCount;
+		if (ctx.m_FailureCount != 0)
+			++failedTestCount;
+		CLog::Log(ctx.m_FailureCount == 0 ? PK_INFO : PK_ERROR, "%s %s (%u checks, %u failed)", ctx.m_FailureCount == 0 ? "PASS" : "FAIL", test->m_Name, ctx.m_CheckCount, ctx.m_FailureCount);
+	}
+	CLog::Log(failedTestCount == 0 ? PK_INFO : PK_ERROR, "%u/%u tests passed", testCount - failedTestCount, testCount);
+
+	PKSample::PopcornShutdown();
+	return static_cast<int>(failedTestCount);
+}
@@ -0,0 +1,224 @@
+//----------------------------------------------------------------------------
+// Copyright Persistant Studios, SARL.
+// https://popcornfx.com/popcornfx-community-license/
+//----------------------------------------------------------------------------
+#include "ae_precompiled.h"
+
+#include "AEUT_UnitTest.h"
+
+#include <PK-SampleLib/SampleScene/Entities/MeshOptimizer.h>
+
+#include <pk_kernel/include/kr_sort.h>
+
+__AEGP_PK_BEGIN
+
+//----------------------------------------------------------------------------
+
+namespace
+{
+	using PKSample::CMeshOptimizer;
+
+	const u32	kGridSize = 128;	// Vertices per side: 16384 vertices, u16 indices
+	const u32	kGridVertexCount = kGridSize * kGridSize;
+
+	// Deterministic LCG: the same shuffle on every platform
+	u32		_NextRandom(u32 &state)
+	{
+		state = state * 1664525U + 1013904223U;
+		return state >> 8;
+	}
+
+	//----------------------------------------------------------------------------
+
+	// Two triangles per quad, triangles and vertex numbering shuffled: worst case source order
+	void	_BuildShuffledGrid(TArray<u32> &outIndices)
+	{
+		u32			seed = 0x1234567;
+		TArray<u32>	vertexIds;
+		vertexIds.Resize(kGridVertexCount);
+		for (u32 v = 0; v < kGridVertexCount; ++v)
+			vertexIds[v] = v;
+		for (u32 v = kGridVertexCount - 1; v > 0; --v)
+			PKSwap(vertexIds[v], vertexIds[_NextRandom(seed) % (v + 1)]);
+
+		const u32	quadsPerSide = kGridSize - 1;
+		outIndices.Resize(quadsPerSide * quadsPerSide * 6);
+		for (u32 y = 0; y < quadsPerSide; ++y)
+		{
+			for (u32 x = 0; x < quadsPerSide; ++x)
+			{
+				const u32	v0 = vertexIds[y * kGridSize + x];
+				const u32	v1 = vertexIds[y * kGridSize + x + 1];
+				const u32	v2 = vertexIds[(y + 1) * kGridSize + x];
+				const u32	v3 = vertexIds[(y + 1) * kGridSize + x + 1];
+				u32			*quad = &outIndices[(y * quadsPerSide + x) * 6];
+				quad[0] = v0; quad[1] = v2; quad[2] = v1;
+				quad[3] = v1; quad[4] = v2; quad[5] = v3;
+			}
+		}
+
+		const u32	triangleCount = outIndices.Count() / 3;
+		for (u32 t = triangleCount - 1; t > 0; --t)
+		{
+			const u32	other = _NextRandom(seed) % (t + 1);
+			for (u32 i = 0; i < 3; ++i)
+				PKSwap(outIndices[t * 3 + i], outIndices[other * 3 + i]);
+		}
+	}
+
+	//----------------------------------------------------------------------------
+
+	// Sorted triangles, each rotated to start with its smallest index: winding is kept, order is not
+	void	_CanonicalTriangles(const TArray<u32> &indices, const u32 *newToOld, TArray<u64> &outTriangles)
+	{
+		outTriangles.Resize(indices.Count() / 3);
+		for (u32 t = 0; t < outTriangles.Count(); ++t)
+		{
+			u32	tri[3];
+			for (u32 i = 0; i < 3; ++i)
+				tri[i] = newToOld != null ? newToOld[indices[t * 3 + i]] : indices[t * 3 + i];
+			while (tri[0] > tri[1] || tri[0] > tri[2])
+			{
+				const u32	first = tri[0];
+				tri[0] = tri[1];
+				tri[1] = tri[2];
+				tri[2] = first;
+			}
+			outTriangles[t] = (u64(tri[0]) << 42) | (u64(tri[1]) << 21) | u64(tri[2]);
+		}
+		QuickSort(outTriangles);
+	}
+
+	//----------------------------------------------------------------------------
+
+	bool	_SameTriangles(const TArray<u64> &a, const TArray<u64> &b)
+	{
+		if (a.Count() != b.Count())
+			return false;
+		for (u32 i = 0; i < a.Count(); ++i)
+		{
+			if (a[i] != b[i])
+				return false;
+		}
+		return true;
+	}
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(MeshOptimizer_ACMR)
+{
+	TArray<u32>	indices;
+	_BuildShuffledGrid(indices);
+
+	const float	acmrBefore = CMeshOptimizer::ComputeACMR(indices.View(), kGridVertexCount);
+	AEUT_REQUIRE(CMeshOptimizer::OptimizeVertexCache(indices.View(), kGridVertexCount));
+	const float	acmrAfter = CMeshOptimizer::ComputeACMR(indices.View(), kGridVertexCount);
+	if (acmrAfter > 0.8f)
+		CLog::Log(PK_ERROR, "Shuffled %ux%u grid: ACMR %.3f -> %.3f", kGridSize, kGridSize, acmrBefore, acmrAfter);
+
+	// Shuffled: close to 3 misses per triangle. Regular grid, 16 entries FIFO: ~0.6 (0.5 is the limit)
+	AEUT_CHECK(acmrBefore > 2.5f);
+	AEUT_CHECK(acmrAfter < 0.8f);
+	AEUT_CHECK(acmrAfter >= 0.5f);
+
+	// Renumbering the vertices does not change the vertex shader invocations
+	TArray<u32>	newToOld;
+	AEUT_REQUIRE(CMeshOptimizer::OptimizeVertexFetch(indices.View(), kGridVertexCount, newToOld));
+	AEUT_CHECK(CMeshOptimizer::ComputeACMR(indices.View(), kGridVertexCount) == acmrAfter);
+
+	// Known values: one triangle is 3 misses, repeating it is free, a cache of 0 misses everything
+	const u32	triangle[] = { 0, 1, 2, 2, 1, 0 };
+	AEUT_CHECK(CMeshOptimizer::CountCacheMisses(TMemoryView<const u32>(triangle, 3), 3) == 3);
+	AEUT_CHECK(CMeshOptimizer::CountCacheMisses(TMemoryView<const u32>(triangle, 6), 3) == 3);
+	AEUT_CHECK(CMeshOptimizer::CountCacheMisses(TMemoryView<const u32>(triangle, 6), 3, 0) == 6);
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(MeshOptimizer_ByteSizesAreKept)
+{
+	TArray<u32>	sourceIndices;
+	_BuildShuffledGrid(sourceIndices);
+	TArray<u64>	sourceTriangles;
+	_CanonicalTriangles(sourceIndices, null, sourceTriangles);
+
+	TArray<u32>	indices;
+	indices.Resize(sourceIndices.Count());
+	Mem::Copy(indices.RawDataPointer(), sourceIndices.RawDataPointer(), sourceIndices.CoveredBytes());
+	TArray<u32>	newToOld;
+	AEUT_REQUIRE(CMeshOptimizer::OptimizeVertexCache(indices.View(), kGridVertexCount));
+	AEUT_REQUIRE(CMeshOptimizer::OptimizeVertexFetch(indices.View(), kGridVertexCount, newToOld));
+
+	// Index buffer: same index count, and every index still fits the source u16 width
+	AEUT_CHECK(indices.Count() == sourceIndices.Count());
+	u32	maxIndex = 0;
+	for (u32 i = 0; i < indices.Count(); ++i)
+		maxIndex = PKMax(maxIndex, indices[i]);
+	AEUT_CHECK(maxIndex < kGridVertexCount);
+	AEUT_CHECK(maxIndex <= 0xFFFF);
+
+	// Vertex buffer: a permutation of the source vertices, same byte size
+	AEUT_REQUIRE(newToOld.Count() == kGridVertexCount);
+	TArray<u32>	useCount;
+	useCount.Resize(kGridVertexCount);
+	Mem::Clear(useCount.RawDataPointer(), useCount.CoveredBytes());
+	bool		isPermutation = true;
+	for (u32 v = 0; v < newToOld.Count(); ++v)
+	{
+		isPermutation &= newToOld[v] < kGridVertexCount;
+		if (newToOld[v] < kGridVertexCount)
+			isPermutation &= useCount[newToOld[v]]++ == 0;
+	}
+	AEUT_CHECK(isPermutation);
+
+	// Vertices in first use order
+	u32		nextNew = 0;
+	bool	firstUseOrder = true;
+	for (u32 i = 0; i < indices.Count(); ++i)
+	{
+		if (indices[i] == nextNew)
+			++nextNew;
+		else
+			firstUseOrder &= indices[i] < nextNew;
+	}
+	AEUT_CHECK(firstUseOrder);
+
+	// Same triangles, same winding
+	TArray<u64>	optimizedTriangles;
+	_CanonicalTriangles(indices, newToOld.RawDataPointer(), optimizedTriangles);
+	AEUT_CHECK(_SameTriangles(sourceTriangles, optimizedTriangles));
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(MeshOptimizer_TriangleOrderOnly)
+{
+	// Skinned meshes: the triangles are reordered, the vertex numbering is the source one
+	TArray<u32>	indices;
+	_BuildShuffledGrid(indices);
+	TArray<u64>	sourceTriangles;
+	_CanonicalTriangles(indices, null, sourceTriangles);
+
+	AEUT_REQUIRE(CMeshOptimizer::OptimizeVertexCache(indices.View(), kGridVertexCount));
+	TArray<u64>	optimizedTriangles;
+	_CanonicalTriangles(indices, null, optimizedTriangles);
+	AEUT_CHECK(_SameTriangles(sourceTriangles, optimizedTriangles));
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(MeshOptimizer_UnreferencedVerticesGoLast)
+{
+	u32			indices[] = { 4, 2, 3 };
+	TArray<u32>	newToOld;
+	AEUT_REQUIRE(CMeshOptimizer::OptimizeVertexFetch(TMemoryView<u32>(indices), 6, newToOld));
+	AEUT_REQUIRE(newToOld.Count() == 6);
+	AEUT_CHECK(indices[0] == 0 && indices[1] == 1 && indices[2] == 2);
+	AEUT_CHECK(newToOld[0] == 4 && newToOld[1] == 2 && newToOld[2] == 3);
+	AEUT_CHECK(newToOld[3] == 0 && newToOld[4] == 1 && newToOld[5] == 5);
+}
+
+//----------------------------------------------------------------------------
+
+__AEGP_PK_END
@@ -0,0 +1,157 @@
+//----------------------------------------------------------------------------
+// Copyright Persistant Studios, SARL.
+// https://popcornfx.com/popcornfx-community-license/
+//----------------------------------------------------------------------------
+#include "ae_precompiled.h"
+
+#include "AEUT_UnitTest.h"
+
+#include <PK-SampleLib/PipelineCacheHelper.h>
+#include <PK-SampleLib/SampleUtils.h>
+
+#include <string.h>
+
+__AEGP_PK_BEGIN
+
+//----------------------------------------------------------------------------
+
+namespace
+{
+	using PKSample::CPipelineCacheHelper;
+	using PKSample::SPipelineCacheDeviceID;
+	using PKSample::SPipelineCacheFileHeader;
+
+	SPipelineCacheDeviceID	_TestDeviceID()
+	{
+		SPipelineCacheDeviceID	deviceID;
+		deviceID.m_VendorID = 0x10DE;
+		deviceID.m_DeviceID = 0x2204;
+		deviceID.m_DriverVersion = 0x001F000F000D1234ULL;
+		return deviceID;
+	}
+
+	//----------------------------------------------------------------------------
+
+	void	_FillTestBlob(TArray<u8> &blob, u32 size)
+	{
+		blob.Resize(size);
+		for (u32 i = 0; i < size; ++i)
+			blob[i] = static_cast<u8>((i * 31) ^ (i >> 3));
+	}
+
+	//----------------------------------------------------------------------------
+
+	void	_CopyFile(TArray<u8> &dst, const TArray<u8> &src, u32 count)
+	{
+		dst.Resize(count);
+		Mem::Copy(dst.RawDataPointer(), src.RawDataPointer(), PKMin(count, src.Count()));
+	}
+
+	//----------------------------------------------------------------------------
+
+	bool	_Unwrap(const SPipelineCacheDeviceID &deviceID, RHI::EGraphicalApi api, const TArray<u8> &fileData)
+	{
+		TMemoryView<const u8>	blob;
+		return CPipelineCacheHelper::UnwrapBlob(deviceID, api, fileData.View(), blob);
+	}
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(CRC32_KnownValues)
+{
+	const char	*check = "123456789";
+	AEUT_CHECK(PKSample::ComputeCRC32(check, 9) == 0xCBF43926U);	// Standard CRC-32 check value
+	AEUT_CHECK(PKSample::ComputeCRC32(check, 0) == 0);
+
+	// Chained
+	const u32	partial = PKSample::ComputeCRC32(check, 4);
+	AEUT_CHECK(PKSample::ComputeCRC32(check + 4, 5, partial) == 0xCBF43926U);
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(PipelineCache_RoundTrip)
+{
+	const SPipelineCacheDeviceID	deviceID = _TestDeviceID();
+	const u32						kBlobSizes[] = { 0, 1, 37, 4096 };
+
+	for (u32 i = 0; i < PK_ARRAY_COUNT(kBlobSizes); ++i)
+	{
+		TArray<u8>	blob;
+		_FillTestBlob(blob, kBlobSizes[i]);
+
+		TArray<u8>	fileData;
+		AEUT_REQUIRE(CPipelineCacheHelper::WrapBlob(deviceID, RHI::GApi_D3D12, blob.View(), fileData));
+		AEUT_CHECK(fileData.Count() == sizeof(SPipelineCacheFileHeader) + blob.Count());
+
+		TMemoryView<const u8>	unwrapped;
+		AEUT_REQUIRE(CPipelineCacheHelper::UnwrapBlob(deviceID, RHI::GApi_D3D12, fileData.View(), unwrapped));
+		AEUT_REQUIRE(unwrapped.Count() == blob.Count());
+		AEUT_CHECK(blob.Empty() || memcmp(unwrapped.Data(), blob.RawDataPointer(), blob.Count()) == 0);
+		// The blob is handed to the driver from the file data, not copied
+		AEUT_CHECK(blob.Empty() || unwrapped.Data() == fileData.RawDataPointer() + sizeof(SPipelineCacheFileHeader));
+	}
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(PipelineCache_RejectsOtherDeviceOrApi)
+{
+	const SPipelineCacheDeviceID	deviceID = _TestDeviceID();
+	TArray<u8>						blob;
+	TArray<u8>						fileData;
+	_FillTestBlob(blob, 256);
+	AEUT_REQUIRE(CPipelineCacheHelper::WrapBlob(deviceID, RHI::GApi_D3D12, blob.View(), fileData));
+
+	SPipelineCacheDeviceID	otherVendor = deviceID;
+	SPipelineCacheDeviceID	otherDevice = deviceID;
+	SPipelineCacheDeviceID	otherDriver = deviceID;
+	otherVendor.m_VendorID = 0x1002;
+	otherDevice.m_DeviceID += 1;
+	otherDriver.m_DriverVersion += 1;
+
+	AEUT_CHECK(_Unwrap(deviceID, RHI::GApi_D3D12, fileData));
+	AEUT_CHECK(!_Unwrap(otherVendor, RHI::GApi_D3D12, fileData));
+	AEUT_CHECK(!_Unwrap(otherDevice, RHI::GApi_D3D12, fileData));
+	AEUT_CHECK(!_Unwrap(otherDriver, RHI::GApi_D3D12, fileData));
+	AEUT_CHECK(!_Unwrap(deviceID, RHI::GApi_D3D11, fileData));
+	AEUT_CHECK(!_Unwrap(deviceID, RHI::GApi_Metal, fileData));
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(PipelineCache_RejectsCorruptedFiles)
+{
+	const SPipelineCacheDeviceID	deviceID = _TestDeviceID();
+	TArray<u8>						blob;
+	TArray<u8>						fileData;
+	_FillTestBlob(blob, 256);
+	AEUT_REQUIRE(CPipelineCacheHelper::WrapBlob(deviceID, RHI::GApi_D3D11, blob.View(), fileData));
+	AEUT_REQUIRE(_Unwrap(deviceID, RHI::GApi_D3D11, fileData));
+
+	// A single flipped bit anywhere in the file is caught, header (magic/version/IDs/CRCs) or blob
+	const u32	headerSize = sizeof(SPipelineCacheFileHeader);
+	const u32	kOffsets[] = { 0, 4, 12, 20, 24, 32, 36, headerSize, headerSize + 100, fileData.Count() - 1 };
+	for (u32 i = 0; i < PK_ARRAY_COUNT(kOffsets); ++i)
+	{
+		TArray<u8>	corrupted;
+		_CopyFile(corrupted, fileData, fileData.Count());
+		corrupted[kOffsets[i]] ^= 0x10;
+		AEUT_CHECK(!_Unwrap(deviceID, RHI::GApi_D3D11, corrupted));
+	}
+
+	// Wrong sizes: partial header, missing blob byte, trailing byte, empty file
+	TArray<u8>	truncated;
+	_CopyFile(truncated, fileData, headerSize - 1);
+	AEUT_CHECK(!_Unwrap(deviceID, RHI::GApi_D3D11, truncated));
+	_CopyFile(truncated, fileData, fileData.Count() - 1);
+	AEUT_CHECK(!_Unwrap(deviceID, RHI::GApi_D3D11, truncated));
+	_CopyFile(truncated, fileData, fileData.Count() + 1);	// Trailing byte (zeroed by Resize() or not, the size check rejects it)
+	AEUT_CHECK(!_Unwrap(deviceID, RHI::GApi_D3D11, truncated));
+	AEUT_CHECK(!_Unwrap(deviceID, RHI::GApi_D3D11, TArray<u8>()));
+}
+
+//----------------------------------------------------------------------------
+
+__AEGP_PK_END
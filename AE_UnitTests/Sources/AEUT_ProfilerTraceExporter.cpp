@@ -0,0 +1,407 @@
+//----------------------------------------------------------------------------
+// Copyright Persistant Studios, SARL.
+// https://popcornfx.com/popcornfx-community-license/
+//----------------------------------------------------------------------------
+#include "ae_precompiled.h"
+
+#include "AEUT_UnitTest.h"
+
+#include <PK-SampleLib/ProfilerTraceExporter.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+__AEGP_PK_BEGIN
+
+//----------------------------------------------------------------------------
+
+namespace
+{
+	using PKSample::CProfilerTraceExporter;
+
+	// Minimal JSON reader: enough to check that the exported traces are valid and read them back
+	struct	SJsonValue : public CNonCopyable
+	{
+		enum	EType
+		{
+			Type_Null = 0,
+			Type_Bool,
+			Type_Number,
+			Type_String,
+			Type_Array,
+			Type_Object,
+		};
+
+		EType					m_Type;
+		bool					m_Bool;
+		double					m_Number;
+		CString					m_String;
+		TArray<CString>			m_Keys;		// Type_Object: one per item
+		TArray<SJsonValue*>		m_Items;
+
+		SJsonValue() : m_Type(Type_Null), m_Bool(false), m_Number(0.0) { }
+		~SJsonValue()
+		{
+			for (u32 i = 0; i < m_Items.Count(); ++i)
+				PK_DELETE(m_Items[i]);
+		}
+
+		const SJsonValue	*Find(const char *key) const
+		{
+			for (u32 i = 0; i < m_Keys.Count(); ++i)
+			{
+				if (m_Keys[i] == key)
+					return m_Items[i];
+			}
+			return null;
+		}
+
+		bool	IsString(const char *key, const char *value) const
+		{
+			const SJsonValue	*item = Find(key);
+			return item != null && item->m_Type == Type_String && item->m_String == value;
+		}
+
+		bool	IsNumber(const char *key, double value) const
+		{
+			const SJsonValue	*item = Find(key);
+			return item != null && item->m_Type == Type_Number && PKAbs(item->m_Number - value) < 1.0e-3;
+		}
+	};
+
+	//----------------------------------------------------------------------------
+
+	class	CJsonReader
+	{
+	public:
+		CJsonReader(const TMemoryView<const char> &json) : m_Cursor(json.Data()), m_End(json.Data() + json.Count()) { }
+
+		// The whole document must be a single value
+		bool	Read(SJsonValue &outValue)
+		{
+			if (!_ReadValue(outValue, 0))
+				return false;
+			_SkipSpaces();
+			return m_Cursor == m_End;
+		}
+
+	private:
+		enum	{ kMaxDepth = 32 };
+
+		void	_SkipSpaces()
+		{
+			while (m_Cursor != m_End && (*m_Cursor == ' ' || *m_Cursor == '\n' || *m_Cursor == '\r' || *m_Cursor == '\t'))
+				++m_Cursor;
+		}
+
+		bool	_Expect(const char *token)
+		{
+			const u32	length = static_cast<u32>(strlen(token));
+			if (static_cast<u32>(m_End - m_Cursor) < length || memcmp(m_Cursor, token, length) != 0)
+				return false;
+			m_Cursor += length;
+			return true;
+		}
+
+		bool	_ReadString(CString &outString)
+		{
+			if (!_Expect("\""))
+				return false;
+			TArray<char>	chars;
+			while (m_Cursor != m_End && *m_Cursor != '"')
+			{
+				char	chr = *m_Cursor++;
+				if (static_cast<u8>(chr) < 0x20)
+					return false;	// Control characters must be escaped
+				if (chr == '\\')
+				{
+					if (m_Cursor == m_End)
+						return false;
+					const char	escape = *m_Cursor++;
+					switch (escape)
+					{
+					case	'"':	chr = '"'; break;
+					case	'\\':	chr = '\\'; break;
+					case	'/':	chr = '/'; break;
+					case	'b':	chr = '\b'; break;
+					case	'f':	chr = '\f'; break;
+					case	'n':	chr = '\n'; break;
+					case	'r':	chr = '\r'; break;
+					case	't':	chr = '\t'; break;
+					case	'u':
+					{
+						if (m_End - m_Cursor < 4)
+							return false;
+						char	hex[5] = { m_Cursor[0], m_Cursor[1], m_Cursor[2], m_Cursor[3], '\0' };
+						char	*hexEnd = null;
+						const u32	codePoint = static_cast<u32>(strtoul(hex, &hexEnd, 16));
+						if (hexEnd != hex + 4 || codePoint > 0x7F)
+							return false;	// The exporter only escapes control characters
+						chr = static_cast<char>(codePoint);
+						m_Cursor += 4;
+						break;
+					}
+					default:
+						return false;
+					}
+				}
+				if (!chars.PushBack(chr).Valid())
+					return false;
+			}
+			if (!_Expect("\"") || !chars.PushBack('\0').Valid())
+				return false;
+			outString = chars.RawDataPointer();
+			return true;
+		}
+
+		bool	_ReadNumber(double &outNumber)
+		{
+			// strtod() needs a terminated string: numbers are short
+			char	buffer[64];
+			u32		length = 0;
+			while (m_Cursor + length != m_End && length + 1 < sizeof(buffer) && strchr("+-0123456789.eE", m_Cursor[length]) != null)
+			{
+				buffer[length] = m_Cursor[length];
+				++length;
+			}
+			buffer[length] = '\0';
+			char	*numberEnd = null;
+			outNumber = strtod(buffer, &numberEnd);
+			if (length == 0 || numberEnd != buffer + length)
+				return false;
+			m_Cursor += length;
+			return true;
+		}
+
+		bool	_ReadItem(SJsonValue &outValue, u32 depth)
+		{
+			SJsonValue	*item = PK_NEW(SJsonValue);
+			if (item == null)
+				return false;
+			if (!outValue.m_Items.PushBack(item).Valid())
+			{
+				PK_DELETE(item);
+				return false;
+			}
+			return _ReadValue(*item, depth + 1);
+		}
+
+		bool	_ReadValue(SJsonValue &outValue, u32 depth)
+		{
+			if (depth > kMaxDepth)
+				return false;
+			_SkipSpaces();
+			if (m_Cursor == m_End)
+				return false;
+			const char	chr = *m_Cursor;
+			if (chr == '{')
+			{
+				++m_Cursor;
+				outValue.m_Type = SJsonValue::Type_Object;
+				_SkipSpaces();
+				if (_Expect("}"))
+					return true;
+				do
+				{
+					_SkipSpaces();
+					CString	key;
+					if (!_ReadString(key) || !outValue.m_Keys.PushBack(key).Valid())
+						return false;
+					_SkipSpaces();
+					if (!_Expect(":") || !_ReadItem(outValue, depth))
+						return false;
+					_SkipSpaces();
+				} while (_Expect(","));
+				return _Expect("}");
+			}
+			if (chr == '[')
+			{
+				++m_Cursor;
+				outValue.m_Type = SJsonValue::Type_Array;
+				_SkipSpaces();
+				if (_Expect("]"))
+					return true;
+				do
+				{
+					if (!_ReadItem(outValue, depth))
+						return false;
+					_SkipSpaces();
+				} while (_Expect(","));
+				return _Expect("]");
+			}
+			if (chr == '"')
+			{
+				outValue.m_Type = SJsonValue::Type_String;
+				return _ReadString(outValue.m_String);
+			}
+			if (_Expect("true") || _Expect("false"))
+			{
+				outValue.m_Type = SJsonValue::Type_Bool;
+				outValue.m_Bool = chr == 't';
+				return true;
+			}
+			if (_Expect("null"))
+				return true;
+			outValue.m_Type = SJsonValue::Type_Number;
+			return _ReadNumber(outValue.m_Number);
+		}
+
+		const char	*m_Cursor;
+		const char	*m_End;
+	};
+
+	//----------------------------------------------------------------------------
+
+	// Checks the trace document layout, returns its event list
+	const SJsonValue	*_ReadTrace(CProfilerTraceExporter &exporter, SJsonValue &outRoot)
+	{
+		const TMemoryView<const char>	json = exporter.Finish();
+		CJsonReader						reader(json);
+		if (json.Empty() || !reader.Read(outRoot) || outRoot.m_Type != SJsonValue::Type_Object || !outRoot.IsString("displayTimeUnit", "ms"))
+			return null;
+		const SJsonValue	*events = outRoot.Find("traceEvents");
+		if (events == null || events->m_Type != SJsonValue::Type_Array || events->m_Items.Count() != exporter.EventCount())
+			return null;
+		return events;
+	}
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(ProfilerTraceExporter_RoundTrip)
+{
+	CProfilerTraceExporter	exporter;
+	const char				*trickyName = "Update \"quoted\" \\ back\tslash\nline";
+	const char				*seriesNames[] = { "Buffers", "Textures" };
+	const u64				values[] = { 1234, u64(5) << 40 };	// Beyond 2^32: written as integers, not truncated
+
+	AEUT_REQUIRE(exporter.AddThreadName(0, "After Effects"));
+	AEUT_REQUIRE(exporter.AddThreadName(1, "Worker \"1\""));
+	AEUT_REQUIRE(exporter.AddEvent(1, trickyName, "PopcornFX", 10.5, 2.25));
+	AEUT_REQUIRE(exporter.AddEvent(1, "Negative", "PopcornFX", 20.0, -1.0));
+	AEUT_REQUIRE(exporter.AddInstantEvent(0, "Comp 1 / Layer 1", 23.0));
+	AEUT_REQUIRE(exporter.AddCounter("GPU memory", 24.0, TMemoryView<const char * const>(seriesNames), TMemoryView<const u64>(values)));
+	AEUT_CHECK(exporter.EventCount() == 6);
+
+	SJsonValue			root;
+	const SJsonValue	*events = _ReadTrace(exporter, root);
+	AEUT_REQUIRE(events != null);
+
+	const SJsonValue	&thread0 = *events->m_Items[0];
+	AEUT_CHECK(thread0.IsString("ph", "M") && thread0.IsNumber("tid", 0) && thread0.IsString("name", "thread_name"));
+	AEUT_CHECK(thread0.Find("args") != null && thread0.Find("args")->IsString("name", "After Effects"));
+	AEUT_CHECK(events->m_Items[1]->Find("args") != null && events->m_Items[1]->Find("args")->IsString("name", "Worker \"1\""));
+
+	const SJsonValue	&event = *events->m_Items[2];
+	AEUT_CHECK(event.IsString("ph", "X") && event.IsNumber("pid", 1) && event.IsNumber("tid", 1));
+	AEUT_CHECK(event.IsNumber("ts", 10.5) && event.IsNumber("dur", 2.25));
+	AEUT_CHECK(event.IsString("cat", "PopcornFX"));
+	AEUT_CHECK(event.IsString("name", trickyName));
+	AEUT_CHECK(events->m_Items[3]->IsNumber("dur", 0.0));	// Negative durations are clamped
+
+	const SJsonValue	&instant = *events->m_Items[4];
+	AEUT_CHECK(instant.IsString("ph", "i") && instant.IsNumber("tid", 0) && instant.IsNumber("ts", 23.0));
+	AEUT_CHECK(instant.IsString("name", "Comp 1 / Layer 1"));
+
+	const SJsonValue	&counter = *events->m_Items[5];
+	const SJsonValue	*counterArgs = counter.Find("args");
+	AEUT_CHECK(counter.IsString("ph", "C") && counter.IsNumber("ts", 24.0) && counter.IsString("name", "GPU memory"));
+	AEUT_REQUIRE(counterArgs != null && counterArgs->m_Items.Count() == 2);
+	AEUT_CHECK(counterArgs->IsNumber("Buffers", 1234.0));
+	AEUT_CHECK(counterArgs->IsNumber("Textures", static_cast<double>(values[1])));
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(ProfilerTraceExporter_FinishAndReopen)
+{
+	// Empty trace: still a valid document
+	CProfilerTraceExporter	exporter;
+	{
+		SJsonValue	root;
+		AEUT_CHECK(_ReadTrace(exporter, root) != null);
+	}
+
+	// Events added after Finish() reopen the event list, Finish() twice returns the same document
+	AEUT_REQUIRE(exporter.AddInstantEvent(0, "First", 1.0));
+	const u32	firstLength = exporter.Finish().Count();
+	AEUT_CHECK(exporter.Finish().Count() == firstLength);
+	AEUT_REQUIRE(exporter.AddInstantEvent(0, "Second", 2.0));
+	{
+		SJsonValue			root;
+		const SJsonValue	*events = _ReadTrace(exporter, root);
+		AEUT_REQUIRE(events != null && events->m_Items.Count() == 2);
+		AEUT_CHECK(events->m_Items[0]->IsString("name", "First"));
+		AEUT_CHECK(events->m_Items[1]->IsString("name", "Second"));
+	}
+
+	exporter.Clear();
+	AEUT_CHECK(exporter.Empty());
+	{
+		SJsonValue			root;
+		const SJsonValue	*events = _ReadTrace(exporter, root);
+		AEUT_CHECK(events != null && events->m_Items.Empty());
+	}
+}
+
+//----------------------------------------------------------------------------
+
+#if	(KR_PROFILER_ENABLED != 0)
+
+AEUT_TEST(ProfilerTraceExporter_Report)
+{
+	Profiler::CProfiler	*profiler = Profiler::MainEngineProfiler();
+	AEUT_REQUIRE(profiler != null);
+
+	// A real capture of a known scope
+	profiler->GrabCallstacks(false);
+	profiler->Reset();
+	profiler->Activate(true);
+	volatile u32	sink = 0;
+	{
+		PK_NAMEDSCOPEDPROFILE("AEUT_ProfilerTraceExporter_Scope");
+		for (u32 i = 0; i < 10000; ++i)
+			sink = sink + i;
+	}
+	profiler->Activate(false);
+	Profiler::CProfilerReport	report;
+	profiler->BuildReport(&report);
+	profiler->Reset();
+
+	CProfilerTraceExporter	exporter;
+	AEUT_REQUIRE(exporter.AddThreadName(0, "After Effects"));
+	AEUT_REQUIRE(exporter.AddReport(report));
+	AEUT_CHECK(exporter.LastReportEndUs() >= 0.0);
+
+	SJsonValue			root;
+	const SJsonValue	*events = _ReadTrace(exporter, root);
+	AEUT_REQUIRE(events != null);
+
+	// The scope is on a named report track, not on the caller's track 0
+	const SJsonValue	*scopeEvent = null;
+	for (u32 i = 0; i < events->m_Items.Count() && scopeEvent == null; ++i)
+	{
+		if (events->m_Items[i]->IsString("name", "AEUT_ProfilerTraceExporter_Scope"))
+			scopeEvent = events->m_Items[i];
+	}
+	AEUT_REQUIRE(scopeEvent != null);
+	AEUT_CHECK(scopeEvent->IsString("ph", "X") && scopeEvent->IsString("cat", "PopcornFX"));
+	const SJsonValue	*tid = scopeEvent->Find("tid");
+	const SJsonValue	*ts = scopeEvent->Find("ts");
+	const SJsonValue	*dur = scopeEvent->Find("dur");
+	AEUT_REQUIRE(tid != null && ts != null && dur != null);
+	AEUT_CHECK(tid->m_Number >= 1.0);
+	AEUT_CHECK(ts->m_Number >= 0.0 && dur->m_Number >= 0.0);
+	AEUT_CHECK(ts->m_Number + dur->m_Number <= exporter.LastReportEndUs() + 1.0e-3);
+
+	bool	trackIsNamed = false;
+	for (u32 i = 0; i < events->m_Items.Count(); ++i)
+		trackIsNamed |= events->m_Items[i]->IsString("ph", "M") && events->m_Items[i]->IsNumber("tid", tid->m_Number);
+	AEUT_CHECK(trackIsNamed);
+}
+
+#endif
+
+//----------------------------------------------------------------------------
+
+__AEGP_PK_END
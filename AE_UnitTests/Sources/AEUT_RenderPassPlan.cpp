@@ -0,0 +1,100 @@
+//----------------------------------------------------------------------------
+// Copyright Persistant Studios, SARL.
+// https://popcornfx.com/popcornfx-community-license/
+//----------------------------------------------------------------------------
+#include "ae_precompiled.h"
+
+#include "AEUT_UnitTest.h"
+
+#include <PK-SampleLib/RHIRenderParticleSceneHelpers.h>
+
+__AEGP_PK_BEGIN
+
+//----------------------------------------------------------------------------
+
+namespace
+{
+	using PKSample::CRHIParticleSceneRenderHelper;
+	using PKSample::SParticleSceneOptions;
+
+	enum
+	{
+		RP_GBuffer		= CRHIParticleSceneRenderHelper::InitRP_GBuffer,
+		RP_Distortion	= CRHIParticleSceneRenderHelper::InitRP_Distortion,
+		RP_Bloom		= CRHIParticleSceneRenderHelper::InitRP_Bloom,
+		RP_ToneMapping	= CRHIParticleSceneRenderHelper::InitRP_ToneMapping,
+		RP_ColorRemap	= CRHIParticleSceneRenderHelper::InitRP_ColorRemap,
+		RP_FXAA			= CRHIParticleSceneRenderHelper::InitRP_FXAA,
+		RP_Debug		= CRHIParticleSceneRenderHelper::InitRP_Debug,
+		RP_All			= CRHIParticleSceneRenderHelper::InitRP_All,
+		RP_None			= CRHIParticleSceneRenderHelper::InitRP_None,
+	};
+
+	struct	SRenderPassPlanCase
+	{
+		const char	*m_Name;
+		bool		m_Distortion;
+		bool		m_Bloom;
+		bool		m_ToneMapping;
+		bool		m_ColorRemap;
+		const char	*m_RemapTexture;
+		const char	*m_OverdrawTexture;
+		bool		m_FXAA;
+		u32			m_InitRP;
+		u32			m_Expected;
+	};
+
+	const SRenderPassPlanCase	kRenderPassPlanCases[] =
+	{
+		//	name							disto	bloom	tone	remap	LUT				overdraw		FXAA	initRP							expected
+		{ "all enabled",					true,	true,	true,	true,	"Remap.png",	"",				true,	RP_All,							RP_All },
+		{ "bloom disabled",					true,	false,	true,	true,	"Remap.png",	"",				true,	RP_All,							RP_All & ~RP_Bloom },
+		{ "tone-mapping disabled",			true,	true,	false,	true,	"Remap.png",	"",				true,	RP_All,							RP_All & ~RP_ToneMapping },
+		{ "FXAA disabled",					true,	true,	true,	true,	"Remap.png",	"",				false,	RP_All,							RP_All & ~RP_FXAA },
+		{ "color remap without LUT",		true,	true,	true,	true,	"",				"",				true,	RP_All,							RP_All & ~RP_ColorRemap },
+		{ "color remap disabled",			true,	true,	true,	false,	"Remap.png",	"",				true,	RP_All,							RP_All & ~RP_ColorRemap },
+		{ "overdraw texture, no remap",		true,	true,	true,	false,	"",				"Heatmap.png",	true,	RP_All,							RP_All },
+		{ "overdraw texture, no LUT",		true,	true,	true,	true,	"",				"Heatmap.png",	true,	RP_All,							RP_All },
+		{ "distortion disabled is kept",	false,	true,	true,	true,	"Remap.png",	"",				true,	RP_All,							RP_All },
+		{ "all post-FX disabled",			false,	false,	false,	false,	"",				"",				false,	RP_All,							RP_GBuffer | RP_Distortion | RP_Debug },
+		{ "never adds to initRP",			true,	true,	true,	true,	"Remap.png",	"",				true,	RP_All & ~RP_Bloom & ~RP_FXAA,	RP_All & ~RP_Bloom & ~RP_FXAA },
+		{ "no pass requested",				true,	true,	true,	true,	"Remap.png",	"Heatmap.png",	true,	RP_None,						RP_None },
+		{ "only post-FX requested",			true,	false,	true,	true,	"",				"",				false,	RP_Bloom | RP_ToneMapping | RP_ColorRemap | RP_FXAA,	RP_ToneMapping },
+	};
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(PlanRenderPasses_Table)
+{
+	for (u32 i = 0; i < PK_ARRAY_COUNT(kRenderPassPlanCases); ++i)
+	{
+		const SRenderPassPlanCase	&testCase = kRenderPassPlanCases[i];
+		SParticleSceneOptions		options;
+		options.m_Distortion.m_Enable = testCase.m_Distortion;
+		options.m_Bloom.m_Enable = testCase.m_Bloom;
+		options.m_ToneMapping.m_Enable = testCase.m_ToneMapping;
+		options.m_ColorRemap.m_Enable = testCase.m_ColorRemap;
+		options.m_ColorRemap.m_RemapTexturePath = testCase.m_RemapTexture;
+		options.m_Overdraw.m_OverdrawTexturePath = testCase.m_OverdrawTexture;
+		options.m_FXAA.m_Enable = testCase.m_FXAA;
+
+		const u32	planned = CRHIParticleSceneRenderHelper::PlanRenderPasses(options, testCase.m_InitRP);
+		if (planned != testCase.m_Expected)
+			CLog::Log(PK_ERROR, "PlanRenderPasses \"%s\": got 0x%02X, expected 0x%02X", testCase.m_Name, planned, testCase.m_Expected);
+		AEUT_CHECK(planned == testCase.m_Expected);
+	}
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(PlanRenderPasses_DefaultOptions)
+{
+	// Default options: FXAA is off and there is no LUT, everything else is planned
+	const SParticleSceneOptions	options;
+	AEUT_CHECK(CRHIParticleSceneRenderHelper::PlanRenderPasses(options) == (RP_All & ~RP_ColorRemap & ~RP_FXAA));
+}
+
+//----------------------------------------------------------------------------
+
+__AEGP_PK_END
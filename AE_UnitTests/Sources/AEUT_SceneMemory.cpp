@@ -0,0 +1,201 @@
+//----------------------------------------------------------------------------
+// Copyright Persistant Studios, SARL.
+// https://popcornfx.com/popcornfx-community-license/
+//----------------------------------------------------------------------------
+#include "ae_precompiled.h"
+
+#include "AEUT_UnitTest.h"
+
+#include "AEGP_SceneMemory.h"
+
+__AEGP_PK_BEGIN
+
+//----------------------------------------------------------------------------
+
+namespace
+{
+	const u64	kRenderBufferBytes = 1024 * 1024;
+	const u64	kSamplerBytes = 16 * 1024;	// Kept by a released scene
+
+	// Scene with a fixed footprint: render buffers while rendered, samplers only once released
+	class	CFakeScene : public ISceneMemoryClient
+	{
+	public:
+		u32		m_ID = 0;
+		u64		m_LastRender = 0;	// Test render counter, 0: never rendered
+		u32		m_ReleaseCount = 0;
+		bool	m_Released = false;
+		bool	m_Busy = false;
+
+		void	Render(CSceneMemoryTracker &tracker, u64 renderIndex)
+		{
+			m_Released = false;
+			m_LastRender = renderIndex;
+			tracker.OnSceneRendered(this);
+		}
+
+		virtual u32		MemoryClientID() const override { return m_ID; }
+
+		virtual void	ComputeMemoryUsage(SSceneMemoryUsage &outUsage) override
+		{
+			outUsage.Clear();
+			outUsage.m_Bytes[SSceneMemoryUsage::Category_ImageSamplers] = kSamplerBytes;
+			if (!m_Released)
+				outUsage.m_Bytes[SSceneMemoryUsage::Category_RenderBuffers] = kRenderBufferBytes;
+		}
+
+		virtual bool	TryReleaseDerivedState(SSceneMemoryUsage &outRemainingUsage) override
+		{
+			if (m_Busy)
+				return false;
+			m_Released = true;
+			++m_ReleaseCount;
+			ComputeMemoryUsage(outRemainingUsage);
+			return true;
+		}
+	};
+
+	//----------------------------------------------------------------------------
+
+	u64		_LiveBytes(const CFakeScene *scenes, u32 sceneCount)
+	{
+		u64		total = 0;
+		for (u32 i = 0; i < sceneCount; ++i)
+			total += kSamplerBytes + (scenes[i].m_Released ? 0 : kRenderBufferBytes);
+		return total;
+	}
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(SceneMemory_ManyScenesSmallBudget)
+{
+	const u32	kSceneCount = 64;
+	const u64	kBudget = 10 * 1024 * 1024;
+	// The samplers of every scene take 1 MB: room for 9 scenes with their render buffers
+	const u32	kMaxLiveScenes = u32((kBudget - kSceneCount * kSamplerBytes) / kRenderBufferBytes);
+
+	CSceneMemoryTracker	tracker(kBudget);
+	CFakeScene			scenes[kSceneCount];
+	for (u32 i = 0; i < kSceneCount; ++i)
+		scenes[i].m_ID = i;
+
+	// Round robin, like a composition with many PopcornFX layers rendered frame after frame
+	u64		renderIndex = 0;
+	bool	withinBudget = true;
+	bool	matchesScenes = true;
+	bool	lruOrder = true;
+	bool	renderedKept = true;
+	for (u32 pass = 0; pass < 3; ++pass)
+	{
+		for (u32 s = 0; s < kSceneCount; ++s)
+		{
+			scenes[s].Render(tracker, ++renderIndex);
+			renderedKept &= !scenes[s].m_Released;
+			withinBudget &= tracker.TotalUsedBytes() <= kBudget;
+			const u32	registeredCount = pass == 0 ? s + 1 : kSceneCount;
+			matchesScenes &= tracker.TotalUsedBytes() == _LiveBytes(scenes, registeredCount);
+
+			// Every scene still holding its buffers was rendered after every released one
+			u64		oldestLive = ~0ULL;
+			u64		newestReleased = 0;
+			for (u32 i = 0; i < kSceneCount; ++i)
+			{
+				if (scenes[i].m_LastRender == 0)
+					continue;
+				if (scenes[i].m_Released)
+					newestReleased = PKMax(newestReleased, scenes[i].m_LastRender);
+				else
+					oldestLive = PKMin(oldestLive, scenes[i].m_LastRender);
+			}
+			lruOrder &= newestReleased < oldestLive;
+		}
+	}
+	AEUT_CHECK(withinBudget);
+	AEUT_CHECK(matchesScenes);
+	AEUT_CHECK(lruOrder);
+	AEUT_CHECK(renderedKept);
+
+	// Steady state: the most recent renders stay, one release per render
+	u32		liveCount = 0;
+	for (u32 i = 0; i < kSceneCount; ++i)
+		liveCount += scenes[i].m_Released ? 0 : 1;
+	AEUT_CHECK(liveCount == kMaxLiveScenes);
+	AEUT_CHECK(scenes[kSceneCount - 1].m_ReleaseCount == 2);
+
+	const SSceneMemoryUsage	usage = tracker.TotalUsage();
+	AEUT_CHECK(usage.m_Bytes[SSceneMemoryUsage::Category_ImageSamplers] == kSceneCount * kSamplerBytes);
+	AEUT_CHECK(usage.m_Bytes[SSceneMemoryUsage::Category_RenderBuffers] == liveCount * kRenderBufferBytes);
+	AEUT_CHECK(usage.Total() == tracker.TotalUsedBytes());
+
+	for (u32 i = 0; i < kSceneCount; ++i)
+		tracker.UnregisterScene(&scenes[i]);
+	AEUT_CHECK(tracker.TotalUsedBytes() == 0);
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(SceneMemory_BusyScenesAreSkipped)
+{
+	CSceneMemoryTracker	tracker(2 * kRenderBufferBytes + 3 * kSamplerBytes);
+	CFakeScene			scenes[3];
+	for (u32 i = 0; i < 3; ++i)
+		scenes[i].m_ID = i;
+
+	scenes[0].Render(tracker, 1);
+	scenes[1].Render(tracker, 2);
+	AEUT_CHECK(!scenes[0].m_Released && !scenes[1].m_Released);
+
+	// Least recently rendered is busy (AE update in progress): the next one goes instead
+	scenes[0].m_Busy = true;
+	scenes[2].Render(tracker, 3);
+	AEUT_CHECK(!scenes[0].m_Released);
+	AEUT_CHECK(scenes[1].m_Released);
+	AEUT_CHECK(!scenes[2].m_Released);
+	AEUT_CHECK(tracker.TotalUsedBytes() <= tracker.Budget());
+
+	scenes[1].Render(tracker, 4);
+	AEUT_CHECK(scenes[2].m_Released);
+	AEUT_CHECK(!scenes[1].m_Released);
+
+	// Nothing else to release: over budget, the rendered scene is kept
+	scenes[1].m_Busy = true;
+	scenes[2].Render(tracker, 5);
+	AEUT_CHECK(!scenes[0].m_Released && !scenes[1].m_Released && !scenes[2].m_Released);
+	AEUT_CHECK(tracker.TotalUsedBytes() > tracker.Budget());
+
+	// Idle again: the least recently rendered is released by the next render
+	scenes[0].m_Busy = false;
+	scenes[1].m_Busy = false;
+	scenes[2].Render(tracker, 6);
+	AEUT_CHECK(scenes[0].m_Released);
+	AEUT_CHECK(!scenes[1].m_Released);
+	AEUT_CHECK(tracker.TotalUsedBytes() <= tracker.Budget());
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(SceneMemory_DisabledBudget)
+{
+	CSceneMemoryTracker	tracker(0);
+	CFakeScene			scenes[16];
+	for (u32 i = 0; i < 16; ++i)
+		scenes[i].Render(tracker, i + 1);
+	u32		releaseCount = 0;
+	for (u32 i = 0; i < 16; ++i)
+		releaseCount += scenes[i].m_ReleaseCount;
+	AEUT_CHECK(releaseCount == 0);
+	AEUT_CHECK(tracker.TotalUsedBytes() == 16 * (kRenderBufferBytes + kSamplerBytes));
+
+	// Lowered budget: applied by the next render
+	tracker.SetBudget(4 * kRenderBufferBytes);
+	scenes[0].Render(tracker, 17);
+	AEUT_CHECK(tracker.TotalUsedBytes() <= tracker.Budget());
+	AEUT_CHECK(!scenes[0].m_Released);
+	AEUT_CHECK(scenes[1].m_Released);
+	AEUT_CHECK(!scenes[15].m_Released);
+}
+
+//----------------------------------------------------------------------------
+
+__AEGP_PK_END
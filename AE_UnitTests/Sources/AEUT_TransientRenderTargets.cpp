@@ -0,0 +1,181 @@
+//----------------------------------------------------------------------------
+// Copyright Persistant Studios, SARL.
+// https://popcornfx.com/popcornfx-community-license/
+//----------------------------------------------------------------------------
+#include "ae_precompiled.h"
+
+#include "AEUT_UnitTest.h"
+
+#include <PK-SampleLib/RenderIntegrationRHI/RHITransientRenderTargets.h>
+#include <PK-SampleLib/RHIRenderParticleSceneHelpers.h>
+
+__AEGP_PK_BEGIN
+
+//----------------------------------------------------------------------------
+
+namespace
+{
+	using PKSample::CTransientRenderTargetAllocator;
+	using PKSample::CRHIParticleSceneRenderHelper;
+
+	const u32	kKeyRGBA16F = 1;
+	const u32	kKeyRGBA8 = 2;
+	const u64	kSize = 1920 * 1080 * 8;
+
+	enum
+	{
+		RP_GBuffer		= CRHIParticleSceneRenderHelper::InitRP_GBuffer,
+		RP_Distortion	= CRHIParticleSceneRenderHelper::InitRP_Distortion,
+		RP_Bloom		= CRHIParticleSceneRenderHelper::InitRP_Bloom,
+		RP_ToneMapping	= CRHIParticleSceneRenderHelper::InitRP_ToneMapping,
+		RP_ColorRemap	= CRHIParticleSceneRenderHelper::InitRP_ColorRemap,
+		RP_FXAA			= CRHIParticleSceneRenderHelper::InitRP_FXAA,
+		RP_Debug		= CRHIParticleSceneRenderHelper::InitRP_Debug,
+	};
+
+	enum
+	{
+		Stage_Input			= CRHIParticleSceneRenderHelper::PostFxStage_Input,
+		Stage_ToneMapping	= CRHIParticleSceneRenderHelper::PostFxStage_ToneMapping,
+		Stage_ColorRemap	= CRHIParticleSceneRenderHelper::PostFxStage_ColorRemap,
+		Stage_FXAA			= CRHIParticleSceneRenderHelper::PostFxStage_FXAA,
+		Stage_Count			= CRHIParticleSceneRenderHelper::__MaxPostFxStages,
+		Stage_None			= -1,	// Creates its own render target
+	};
+
+	struct	SPostFxAliasingCase
+	{
+		const char	*m_Name;
+		u32			m_InitRP;
+		u32			m_ResourceCount;
+		u32			m_PhysicalCount;
+		s32			m_AliasedStages[Stage_Count];
+	};
+
+	const SPostFxAliasingCase	kPostFxAliasingCases[] =
+	{
+		// ToneMap -> FXAA: FXAA writes into the distortion output, read by the tone-mapping only
+		{	"tone-mapping, FXAA",	RP_GBuffer | RP_Distortion | RP_ToneMapping | RP_FXAA | RP_Debug,				3, 2,
+			{ Stage_None, Stage_None, Stage_None, Stage_Input } },
+		{	"full chain",			RP_GBuffer | RP_Distortion | RP_ToneMapping | RP_ColorRemap | RP_FXAA | RP_Debug,	4, 2,
+			{ Stage_None, Stage_None, Stage_Input, Stage_ToneMapping } },
+		// The distortion output is in the before-bloom render pass
+		{	"full chain, bloom",	RP_GBuffer | RP_Distortion | RP_Bloom | RP_ToneMapping | RP_ColorRemap | RP_FXAA | RP_Debug,	3, 2,
+			{ Stage_None, Stage_None, Stage_None, Stage_ToneMapping } },
+		{	"tone-mapping, FXAA, bloom",	RP_GBuffer | RP_Distortion | RP_Bloom | RP_ToneMapping | RP_FXAA | RP_Debug,	2, 2,
+			{ Stage_None, Stage_None, Stage_None, Stage_None } },
+		// FXAA renders in the swap chain, the tone-mapping output is read while it is written
+		{	"FXAA last",			RP_GBuffer | RP_Distortion | RP_ToneMapping | RP_FXAA,							2, 2,
+			{ Stage_None, Stage_None, Stage_None, Stage_None } },
+		{	"tone-mapping only",	RP_GBuffer | RP_Distortion | RP_ToneMapping | RP_Debug,						2, 2,
+			{ Stage_None, Stage_None, Stage_None, Stage_None } },
+		// Without distortion, the merge buffer is the input: sampled by the debug views, never aliased
+		{	"no distortion",		RP_GBuffer | RP_ToneMapping | RP_FXAA | RP_Debug,								2, 2,
+			{ Stage_None, Stage_None, Stage_None, Stage_None } },
+	};
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(TransientRenderTargets_Chain)
+{
+	// Each pass reads the previous pass output: two render targets ping-pong
+	CTransientRenderTargetAllocator	allocator;
+	CGuid							resources[4];
+	for (u32 i = 0; i < PK_ARRAY_COUNT(resources); ++i)
+		resources[i] = allocator.AddResource(kKeyRGBA16F, kSize, i, i + 1);
+	AEUT_REQUIRE(allocator.Allocate());
+
+	AEUT_CHECK(allocator.PhysicalCount() == 2);
+	AEUT_CHECK(allocator.PhysicalIndex(resources[0]) == allocator.PhysicalIndex(resources[2]));
+	AEUT_CHECK(allocator.PhysicalIndex(resources[1]) == allocator.PhysicalIndex(resources[3]));
+	AEUT_CHECK(allocator.PhysicalIndex(resources[0]) != allocator.PhysicalIndex(resources[1]));
+	AEUT_CHECK(allocator.AllocatedBytes() == 2 * kSize);
+	AEUT_CHECK(allocator.UnaliasedBytes() == 4 * kSize);
+	AEUT_CHECK(allocator.PeakLiveBytes() == 2 * kSize);
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(TransientRenderTargets_OverlapsAreNotAliased)
+{
+	// A render target read by pass 2 cannot be written by pass 2
+	CTransientRenderTargetAllocator	allocator;
+	const CGuid	a = allocator.AddResource(kKeyRGBA16F, kSize, 0, 2);
+	const CGuid	b = allocator.AddResource(kKeyRGBA16F, kSize, 1, 3);
+	const CGuid	c = allocator.AddResource(kKeyRGBA16F, kSize, 2, 4);
+	AEUT_REQUIRE(allocator.Allocate());
+	AEUT_CHECK(allocator.PhysicalCount() == 3);
+	AEUT_CHECK(allocator.PhysicalIndex(a) != allocator.PhysicalIndex(c));
+	AEUT_CHECK(allocator.PhysicalIndex(b) != allocator.PhysicalIndex(c));
+	AEUT_CHECK(allocator.AllocatedBytes() == allocator.PeakLiveBytes());
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(TransientRenderTargets_IncompatibleAreNotAliased)
+{
+	CTransientRenderTargetAllocator	allocator;
+	const CGuid	a = allocator.AddResource(kKeyRGBA16F, kSize, 0, 1);
+	const CGuid	otherKey = allocator.AddResource(kKeyRGBA8, kSize, 2, 3);
+	const CGuid	otherSize = allocator.AddResource(kKeyRGBA16F, kSize / 4, 4, 5);
+	const CGuid	same = allocator.AddResource(kKeyRGBA16F, kSize, 6, 7);
+	AEUT_REQUIRE(allocator.Allocate());
+	AEUT_CHECK(allocator.PhysicalCount() == 3);
+	AEUT_CHECK(allocator.PhysicalIndex(a) != allocator.PhysicalIndex(otherKey));
+	AEUT_CHECK(allocator.PhysicalIndex(a) != allocator.PhysicalIndex(otherSize));
+	AEUT_CHECK(allocator.PhysicalIndex(a) == allocator.PhysicalIndex(same));
+	AEUT_CHECK(allocator.AllocatedBytes() == 2 * kSize + kSize / 4);
+	AEUT_CHECK(allocator.PeakLiveBytes() == kSize);
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(TransientRenderTargets_OrderAndReuse)
+{
+	// Added out of pass order: allocated in first pass order all the same
+	CTransientRenderTargetAllocator	allocator;
+	const CGuid	late = allocator.AddResource(kKeyRGBA16F, kSize, 5, 6);
+	const CGuid	early0 = allocator.AddResource(kKeyRGBA16F, kSize, 0, 1);
+	const CGuid	early1 = allocator.AddResource(kKeyRGBA16F, kSize, 0, 3);
+	AEUT_REQUIRE(allocator.Allocate());
+	AEUT_CHECK(allocator.PhysicalCount() == 2);
+	// Both are free at pass 5: the one free the longest time ago is reused
+	AEUT_CHECK(allocator.PhysicalIndex(late) == allocator.PhysicalIndex(early0));
+	AEUT_CHECK(allocator.PhysicalIndex(late) != allocator.PhysicalIndex(early1));
+
+	// Clear() then empty
+	allocator.Clear();
+	AEUT_CHECK(allocator.Resources().Empty());
+	AEUT_REQUIRE(allocator.Allocate());
+	AEUT_CHECK(allocator.PhysicalCount() == 0);
+	AEUT_CHECK(allocator.AllocatedBytes() == 0);
+	AEUT_CHECK(allocator.PeakLiveBytes() == 0);
+}
+
+//----------------------------------------------------------------------------
+
+AEUT_TEST(TransientRenderTargets_PostFxAliasing)
+{
+	for (u32 i = 0; i < PK_ARRAY_COUNT(kPostFxAliasingCases); ++i)
+	{
+		const SPostFxAliasingCase		&testCase = kPostFxAliasingCases[i];
+		CTransientRenderTargetAllocator	allocator;
+		CGuid							aliasedStages[Stage_Count];
+		AEUT_REQUIRE(CRHIParticleSceneRenderHelper::PlanPostFxAliasing(testCase.m_InitRP, CUint2(1920, 1080), allocator, aliasedStages));
+
+		bool	success = allocator.Resources().Count() == testCase.m_ResourceCount && allocator.PhysicalCount() == testCase.m_PhysicalCount;
+		for (u32 stage = 0; stage < Stage_Count; ++stage)
+		{
+			const s32	aliasedStage = aliasedStages[stage].Valid() ? static_cast<s32>(static_cast<u32>(aliasedStages[stage])) : Stage_None;
+			success &= aliasedStage == testCase.m_AliasedStages[stage];
+		}
+		if (!success)
+			CLog::Log(PK_ERROR, "PlanPostFxAliasing \"%s\": %u resources in %u render targets", testCase.m_Name, allocator.Resources().Count(), allocator.PhysicalCount());
+		AEUT_CHECK(success);
+	}
+}
+
+//----------------------------------------------------------------------------
+
+__AEGP_PK_END
@@ -14,72 +14,399 @@
 #include "PipelineCacheHelper.h"
 #include "SampleUtils.h"
 
+#include "pk_render_helpers/include/draw_requests/rh_job_pools.h"
+
+#if	defined(PK_WINDOWS)
+#	pragma warning(push)
+#	pragma warning(disable : 4668) // C4668 (level 4)	'symbol' is not defined as a preprocessor macro, replacing with '0' for 'directives'
+#	include <windows.h>
+#	pragma warning(pop)
+#else
+#	include <stdio.h>
+#endif
+
 __PK_SAMPLE_API_BEGIN
 //----------------------------------------------------------------------------
 
-CPipelineCacheHelper::CPipelineCacheHelper()
+namespace
 {
-}
+	u32		_HeaderCRC32(const SPipelineCacheFileHeader &header)
+	{
+		return ComputeCRC32(&header, PK_MEMBER_OFFSET(SPipelineCacheFileHeader, m_HeaderCRC32));
+	}
 
-//----------------------------------------------------------------------------
+	//----------------------------------------------------------------------------
 
-CPipelineCacheHelper::~CPipelineCacheHelper()
-{
+	// Replaces 'dstPath' by 'srcPath'. Only done on physical paths: the default file system has no rename.
+	bool	_ReplaceFile(const CString &srcPath, const CString &dstPath)
+	{
+#if	defined(PK_WINDOWS)
+		return MoveFileExA(srcPath.Data(), dstPath.Data(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+		return rename(srcPath.Data(), dstPath.Data()) == 0;	// Atomic on posix file systems
+#endif
+	}
 }
 
+//----------------------------------------------------------------------------
+//
+//	CPipelineCacheIOJob: reads + validates, or writes a pipeline cache file on the worker pool
+//
 //----------------------------------------------------------------------------
 
-void	CPipelineCacheHelper::LoadPipelineCache(const RHI::PApiManager &apiManager, const CString &filePath)
+class	CPipelineCacheIOJob : public CAsynchronousJob
 {
-	if (apiManager->ApiDesc().m_SupportPipelineCache)
+public:
+	enum	EMode
 	{
-		CString			apiFilePath = filePath + GetShaderExtensionStringFromApi(apiManager->ApiName());
-		PFileStream		fileView = File::DefaultFileSystem()->OpenStream(apiFilePath, IFileSystem::Access_Read);
+		Mode_Load,
+		Mode_Save,
+	};
+
+	EMode					m_Mode;
+	CString					m_FilePath;
+	RHI::EGraphicalApi		m_Api;
+	SPipelineCacheDeviceID	m_DeviceID;
+
+	// Mode_Load: validated blob, written by the worker thread
+	// Mode_Save: wrapped file data, read by the worker thread
+	TArray<u8>				m_Data;
+	bool					m_Success;
+	TAtomic<u32>			m_Done;
+	Threads::CEvent			m_Finished;
+
+	CPipelineCacheIOJob(EMode mode) : m_Mode(mode), m_Api(RHI::GApi_Null), m_Success(false), m_Done(0) { }
+	~CPipelineCacheIOJob() { }
 
+protected:
+	virtual void		_VirtualLaunch(Threads::SThreadContext &) override
+	{
+		m_Success = m_Mode == Mode_Load ? _Load() : _Save();
+		m_Done.Inc();
+		m_Finished.Trigger();
+	}
+
+private:
+	bool		_Load()
+	{
+		PK_NAMEDSCOPEDPROFILE("Load pipeline cache");
+		const bool		isAbsolute = CFilePath::IsAbsolute(m_FilePath);
+		PFileStream		fileView = File::DefaultFileSystem()->OpenStream(m_FilePath, IFileSystem::Access_Read, isAbsolute);
 		if (fileView == null)
 		{
 			CLog::Log(PK_INFO, "Could not load pipeline cache");
-			return;
+			return false;
 		}
 
-		u32				cacheSize = 0;
-		void			*cacheData = fileView->Bufferize(cacheSize);
-		if (!apiManager->SetProgramCache(cacheData, cacheSize))
+		u32				fileSize = 0;
+		void			*fileData = fileView->Bufferize(fileSize);
+		fileView->Close();
+
+		TMemoryView<const u8>	blob;
+		bool					success = CPipelineCacheHelper::UnwrapBlob(m_DeviceID, m_Api, TMemoryView<const u8>(static_cast<const u8*>(fileData), fileSize), blob);
+		if (success)
 		{
-			CLog::Log(PK_WARN, "The cache data loaded is not valid");
+			success = m_Data.Resize(blob.Count());
+			if (success && !blob.Empty())
+				Mem::Copy(m_Data.RawDataPointer(), blob.Data(), blob.CoveredBytes());
 		}
-		else
+		PK_FREE(fileData);
+		return success;
+	}
+
+	bool		_Save()
+	{
+		PK_NAMEDSCOPEDPROFILE("Save pipeline cache");
+		IFileSystem		*fs = File::DefaultFileSystem();
+		const bool		isAbsolute = CFilePath::IsAbsolute(m_FilePath);
+
+		// Write to a temporary file then swap it with the previous cache, so that a crash or
+		// a concurrent reader never sees a partially written file.
+		// Relative (virtual) paths cannot be renamed: they are written in place, the CRCs catch torn writes.
+		const CString	writePath = isAbsolute ? m_FilePath + ".tmp" : m_FilePath;
+		PFileStream		fileView = fs->OpenStream(writePath, IFileSystem::Access_WriteCreate, isAbsolute);
+		if (fileView == null)
+		{
+			CLog::Log(PK_ERROR, "Could not save the pipeline cache: failed opening \"%s\"", writePath.Data());
+			return false;
+		}
+		const bool		written = fileView->Write(m_Data.RawDataPointer(), m_Data.Count()) != 0;
+		fileView->Close();
+		fileView = null;
+
+		if (!written)
 		{
-			CLog::Log(PK_INFO, "Pipeline cache successfully loaded");
+			CLog::Log(PK_ERROR, "Could not save the pipeline cache: failed writing \"%s\"", writePath.Data());
+			fs->FileDelete(writePath, isAbsolute);
+			return false;
 		}
-		PK_FREE(cacheData);
+		if (isAbsolute && !_ReplaceFile(writePath, m_FilePath))
+		{
+			CLog::Log(PK_ERROR, "Could not save the pipeline cache: failed replacing \"%s\"", m_FilePath.Data());
+			fs->FileDelete(writePath, isAbsolute);
+			return false;
+		}
+		return true;
 	}
+};
+PK_DECLARE_REFPTRCLASS(PipelineCacheIOJob);
+
+//----------------------------------------------------------------------------
+//
+//	CPipelineCacheHelper
+//
+//----------------------------------------------------------------------------
+
+CPipelineCacheHelper::CPipelineCacheHelper()
+:	m_SaveDebounceDelay(0.0f)
+,	m_SaveDebounceElapsed(0.0)
+,	m_SavePending(false)
+{
+}
+
+//----------------------------------------------------------------------------
+
+CPipelineCacheHelper::~CPipelineCacheHelper()
+{
+	// Jobs hold their own data: nothing references this helper once launched.
+	// Still wait for the write so the application does not exit with a half written temporary file.
+	_WaitPendingSave();
+	if (m_LoadJob != null)
+		m_LoadJob->m_Finished.Wait();
+}
+
+//----------------------------------------------------------------------------
+
+void	CPipelineCacheHelper::LoadPipelineCache(const RHI::PApiManager &apiManager, const CString &filePath)
+{
+	StartLoadPipelineCache(apiManager, filePath);
+	FinishLoadPipelineCache(apiManager);
 }
 
 //----------------------------------------------------------------------------
 
 bool	CPipelineCacheHelper::SavePipelineCache(const RHI::PApiManager &apiManager, const CString &filePath)
 {
-	if (apiManager->ApiDesc().m_SupportPipelineCache)
+	RequestSave(filePath, 0.0f);
+	return Flush(apiManager);
+}
+
+//----------------------------------------------------------------------------
+
+void	CPipelineCacheHelper::StartLoadPipelineCache(const RHI::PApiManager &apiManager, const CString &filePath)
+{
+	if (!apiManager->ApiDesc().m_SupportPipelineCache)
+		return;
+	if (m_LoadJob != null)
+		m_LoadJob->m_Finished.Wait();
+
+	m_LoadJob = PK_NEW(CPipelineCacheIOJob(CPipelineCacheIOJob::Mode_Load));
+	if (!PK_VERIFY(m_LoadJob != null))
+		return;
+	m_LoadJob->m_FilePath = filePath + GetShaderExtensionStringFromApi(apiManager->ApiName());
+	m_LoadJob->m_Api = apiManager->ApiName();
+	m_LoadJob->m_DeviceID = m_DeviceID;
+	m_LoadJob->AddToPool(Scheduler::ThreadPool());
+	Scheduler::ThreadPool()->KickTasks(true);
+}
+
+//----------------------------------------------------------------------------
+
+bool	CPipelineCacheHelper::FinishLoadPipelineCache(const RHI::PApiManager &apiManager)
+{
+	if (m_LoadJob == null)
+		return false;
+	PK_NAMEDSCOPEDPROFILE("Apply pipeline cache");
+	m_LoadJob->m_Finished.Wait();
+
+	PPipelineCacheIOJob	job = m_LoadJob;
+	m_LoadJob = null;
+	if (!job->m_Success)
+		return false;
+	PK_ASSERT(job->m_Api == apiManager->ApiName());
+	if (!apiManager->SetProgramCache(job->m_Data.RawDataPointer(), job->m_Data.Count()))
 	{
-		CString			apiFilePath = filePath + GetShaderExtensionStringFromApi(apiManager->ApiName());
-		PFileStream		fileView = File::DefaultFileSystem()->OpenStream(apiFilePath, IFileSystem::Access_WriteCreate);
+		CLog::Log(PK_WARN, "The cache data loaded is not valid");
+		return false;
+	}
+	CLog::Log(PK_INFO, "Pipeline cache successfully loaded");
+	return true;
+}
 
-		void			*cacheData = null;
-		u32				cacheSize = 0;
-		if (!apiManager->RetrieveProgramCache(cacheData, cacheSize))
-		{
-			CLog::Log(PK_ERROR, "Could not retrieve the pipeline cache");
-			return false;
-		}
-		if (fileView == null || !fileView->Write(cacheData, cacheSize))
-		{
-			PK_FREE(cacheData);
-			CLog::Log(PK_ERROR, "Could not save the pipeline cache");
+//----------------------------------------------------------------------------
+
+void	CPipelineCacheHelper::RequestSave(const CString &filePath, float debounceDelay)
+{
+	m_PendingSavePath = filePath;
+	m_SaveDebounceDelay = debounceDelay;
+	m_SaveDebounceElapsed = 0.0;
+	m_SaveDebounceTimer.Start();
+	m_SavePending = true;
+}
+
+//----------------------------------------------------------------------------
+
+void	CPipelineCacheHelper::Update(const RHI::PApiManager &apiManager)
+{
+	if (!m_SavePending)
+		return;
+	m_SaveDebounceElapsed += m_SaveDebounceTimer.Restart();
+	if (m_SaveDebounceElapsed < m_SaveDebounceDelay)
+		return;
+	// Previous write still in flight: retry next update rather than stalling the caller
+	if (m_SaveJob != null && m_SaveJob->m_Done.Load() == 0)
+		return;
+	_WaitPendingSave();
+	_StartSave(apiManager);
+}
+
+//----------------------------------------------------------------------------
+
+bool	CPipelineCacheHelper::Flush(const RHI::PApiManager &apiManager)
+{
+	if (m_SavePending)
+	{
+		_WaitPendingSave();
+		if (!_StartSave(apiManager))
 			return false;
-		}
-		PK_FREE(cacheData);
 	}
+	if (m_SaveJob == null)
+		return true;
+	m_SaveJob->m_Finished.Wait();
+	const bool	success = m_SaveJob->m_Success;
+	m_SaveJob = null;
+	return success;
+}
+
+//----------------------------------------------------------------------------
+
+bool	CPipelineCacheHelper::_StartSave(const RHI::PApiManager &apiManager)
+{
+	PK_NAMEDSCOPEDPROFILE("Retrieve pipeline cache");
+	m_SavePending = false;
+	m_SaveDebounceTimer.Stop();
+	if (!apiManager->ApiDesc().m_SupportPipelineCache)
+		return true;
+
+	// The cache must be retrieved from the thread owning the api manager, only the wrap + write are deferred
+	void			*cacheData = null;
+	u32				cacheSize = 0;
+	if (!apiManager->RetrieveProgramCache(cacheData, cacheSize))
+	{
+		CLog::Log(PK_ERROR, "Could not retrieve the pipeline cache");
+		return false;
+	}
+
+	PPipelineCacheIOJob	job = PK_NEW(CPipelineCacheIOJob(CPipelineCacheIOJob::Mode_Save));
+	const bool			wrapped = job != null && WrapBlob(m_DeviceID, apiManager->ApiName(), TMemoryView<const u8>(static_cast<const u8*>(cacheData), cacheSize), job->m_Data);
+	PK_FREE(cacheData);
+	if (!wrapped)
+	{
+		CLog::Log(PK_ERROR, "Could not save the pipeline cache");
+		return false;
+	}
+	job->m_FilePath = m_PendingSavePath + GetShaderExtensionStringFromApi(apiManager->ApiName());
+	job->m_Api = apiManager->ApiName();
+	job->m_DeviceID = m_DeviceID;
+	m_SaveJob = job;
+	job->AddToPool(Scheduler::ThreadPool());
+	Scheduler::ThreadPool()->KickTasks(true);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+void	CPipelineCacheHelper::_WaitPendingSave()
+{
+	if (m_SaveJob == null)
+		return;
+	m_SaveJob->m_Finished.Wait();
+	m_SaveJob = null;
+}
+
+//----------------------------------------------------------------------------
+
+bool	CPipelineCacheHelper::WrapBlob(	const SPipelineCacheDeviceID	&deviceID,
+										RHI::EGraphicalApi				api,
+										const TMemoryView<const u8>		&blob,
+										TArray<u8>						&outFileData)
+{
+	SPipelineCacheFileHeader	header;
+	Mem::Clear(header);
+	header.m_Magic = SPipelineCacheFileHeader::kMagic;
+	header.m_Version = SPipelineCacheFileHeader::kVersion;
+	header.m_Api = static_cast<u32>(api);
+	header.m_VendorID = deviceID.m_VendorID;
+	header.m_DeviceID = deviceID.m_DeviceID;
+	header.m_DriverVersion = deviceID.m_DriverVersion;
+	header.m_BlobSizeInBytes = blob.CoveredBytes();
+	header.m_BlobCRC32 = ComputeCRC32(blob.Data(), blob.CoveredBytes());
+	header.m_HeaderCRC32 = _HeaderCRC32(header);
+
+	if (!outFileData.Resize(sizeof(header) + blob.CoveredBytes()))
+		return false;
+	Mem::Copy(outFileData.RawDataPointer(), &header, sizeof(header));
+	if (!blob.Empty())
+		Mem::Copy(outFileData.RawDataPointer() + sizeof(header), blob.Data(), blob.CoveredBytes());
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+bool	CPipelineCacheHelper::UnwrapBlob(	const SPipelineCacheDeviceID	&deviceID,
+											RHI::EGraphicalApi				api,
+											const TMemoryView<const u8>		&fileData,
+											TMemoryView<const u8>			&outBlob)
+{
+	outBlob = TMemoryView<const u8>();
+
+	SPipelineCacheFileHeader	header;
+	if (fileData.CoveredBytes() < sizeof(header))
+	{
+		CLog::Log(PK_WARN, "Pipeline cache rejected: file too small (%d bytes)", fileData.CoveredBytes());
+		return false;
+	}
+	Mem::Copy(&header, fileData.Data(), sizeof(header));	// Unaligned
+
+	if (header.m_Magic != SPipelineCacheFileHeader::kMagic)
+	{
+		CLog::Log(PK_WARN, "Pipeline cache rejected: unknown file format");
+		return false;
+	}
+	if (header.m_HeaderCRC32 != _HeaderCRC32(header))
+	{
+		CLog::Log(PK_WARN, "Pipeline cache rejected: corrupted header");
+		return false;
+	}
+	if (header.m_Version != SPipelineCacheFileHeader::kVersion)
+	{
+		CLog::Log(PK_INFO, "Pipeline cache rejected: version %d, expected %d", header.m_Version, SPipelineCacheFileHeader::kVersion);
+		return false;
+	}
+	if (header.m_Api != static_cast<u32>(api))
+	{
+		CLog::Log(PK_INFO, "Pipeline cache rejected: created with another graphics API");
+		return false;
+	}
+	if (header.m_VendorID != deviceID.m_VendorID ||
+		header.m_DeviceID != deviceID.m_DeviceID ||
+		header.m_DriverVersion != deviceID.m_DriverVersion)
+	{
+		CLog::Log(PK_INFO, "Pipeline cache rejected: created with another device or driver");
+		return false;
+	}
+	if (header.m_BlobSizeInBytes != fileData.CoveredBytes() - sizeof(header))
+	{
+		CLog::Log(PK_WARN, "Pipeline cache rejected: truncated file");
+		return false;
+	}
+	const u8	*blobData = fileData.Data() + sizeof(header);
+	if (header.m_BlobCRC32 != ComputeCRC32(blobData, header.m_BlobSizeInBytes))
+	{
+		CLog::Log(PK_WARN, "Pipeline cache rejected: checksum mismatch");
+		return false;
+	}
+	outBlob = TMemoryView<const u8>(blobData, header.m_BlobSizeInBytes);
 	return true;
 }
 
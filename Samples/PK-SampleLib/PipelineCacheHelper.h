@@ -12,18 +12,99 @@
 
 #include "PKSample.h"
 #include <pk_rhi/include/interfaces/IApiManager.h>
+#include <pk_kernel/include/kr_timers.h>
 
 __PK_SAMPLE_API_BEGIN
 //----------------------------------------------------------------------------
 
+PK_FORWARD_DECLARE(PipelineCacheIOJob);
+
+//----------------------------------------------------------------------------
+
+// The pipeline cache blob returned by the API is stored in a small container, so that
+// stale (other device/driver/API) or corrupted caches are rejected before reaching the driver:
+//	[SPipelineCacheFileHeader][blob]
+struct	SPipelineCacheFileHeader
+{
+	enum
+	{
+		kMagic = 0x43504B50,	// 'PKPC'
+		kVersion = 1,
+	};
+
+	u32		m_Magic;
+	u32		m_Version;
+	u32		m_Api;				// RHI::EGraphicalApi
+	u32		m_VendorID;
+	u32		m_DeviceID;
+	u32		m_BlobSizeInBytes;
+	u64		m_DriverVersion;
+	u32		m_BlobCRC32;
+	u32		m_HeaderCRC32;		// CRC of all the previous fields
+};
+PK_STATIC_ASSERT(sizeof(SPipelineCacheFileHeader) == 40);
+
+//----------------------------------------------------------------------------
+
+// Identifies the device the pipeline cache was created with, filled by the API context (adapter description)
+struct	SPipelineCacheDeviceID
+{
+	u32		m_VendorID;
+	u32		m_DeviceID;
+	u64		m_DriverVersion;
+
+	SPipelineCacheDeviceID() : m_VendorID(0), m_DeviceID(0), m_DriverVersion(0) {}
+};
+
+//----------------------------------------------------------------------------
+
 class	CPipelineCacheHelper
 {
 public:
 	CPipelineCacheHelper();
 	~CPipelineCacheHelper();
 
+	void			SetDeviceID(const SPipelineCacheDeviceID &deviceID) { m_DeviceID = deviceID; }
+
+	// Synchronous load/save (kept for compatibility): StartLoad + FinishLoad, RequestSave + Flush
 	void			LoadPipelineCache(const RHI::PApiManager &apiManager, const CString &filePath);
 	bool			SavePipelineCache(const RHI::PApiManager &apiManager, const CString &filePath);
+
+	// Reads and validates the cache file on the worker pool. FinishLoad() waits for it and hands the blob to the API.
+	void			StartLoadPipelineCache(const RHI::PApiManager &apiManager, const CString &filePath);
+	bool			FinishLoadPipelineCache(const RHI::PApiManager &apiManager);
+
+	// Saves are debounced: the cache is retrieved and written once no new request was made for 'debounceDelay' seconds.
+	// Call Update() regularly (ie. once per frame) from the thread owning the api manager.
+	void			RequestSave(const CString &filePath, float debounceDelay = 2.0f);
+	void			Update(const RHI::PApiManager &apiManager);
+	bool			Flush(const RHI::PApiManager &apiManager);	// Saves now if a save is pending, waits for the write
+	bool			SavePending() const { return m_SavePending; }
+
+	// Container format, no file IO
+	static bool		WrapBlob(	const SPipelineCacheDeviceID &deviceID,
+								RHI::EGraphicalApi api,
+								const TMemoryView<const u8> &blob,
+								TArray<u8> &outFileData);
+	static bool		UnwrapBlob(	const SPipelineCacheDeviceID &deviceID,
+								RHI::EGraphicalApi api,
+								const TMemoryView<const u8> &fileData,
+								TMemoryView<const u8> &outBlob);
+
+private:
+	bool			_StartSave(const RHI::PApiManager &apiManager);
+	void			_WaitPendingSave();
+
+	SPipelineCacheDeviceID	m_DeviceID;
+
+	PPipelineCacheIOJob		m_LoadJob;
+	PPipelineCacheIOJob		m_SaveJob;
+
+	CString					m_PendingSavePath;
+	float					m_SaveDebounceDelay;
+	double					m_SaveDebounceElapsed;
+	CTimer					m_SaveDebounceTimer;
+	bool					m_SavePending;
 };
 
 //----------------------------------------------------------------------------
@@ -0,0 +1,336 @@
+//----------------------------------------------------------------------------
+// This program is the property of Persistant Studios SARL.
+//
+// You may not redistribute it and/or modify it under any conditions
+// without written permission from Persistant Studios SARL, unless
+// otherwise stated in the latest Persistant Studios Code License.
+//
+// See the Persistant Studios Code License for further details.
+//----------------------------------------------------------------------------
+
+#include "precompiled.h"
+
+#include "ProfilerTraceExporter.h"
+
+#if	defined(PK_WINDOWS)
+#	pragma warning(push)
+#	pragma warning(disable : 4668) // C4668 (level 4)	'symbol' is not defined as a preprocessor macro, replacing with '0' for 'directives'
+#	include <windows.h>
+#	pragma warning(pop)
+#else
+#	include <stdio.h>
+#endif
+
+__PK_SAMPLE_API_BEGIN
+//----------------------------------------------------------------------------
+
+namespace
+{
+	const char	kTraceHeader[] = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	const char	kTraceFooter[] = "\n]}\n";
+	const u32	kTraceFooterLength = sizeof(kTraceFooter) - 1;
+
+	//----------------------------------------------------------------------------
+
+	// Physical paths only: the default file system has no rename
+	bool	_MoveFile(const CString &srcPath, const CString &dstPath)
+	{
+#if	defined(PK_WINDOWS)
+		return MoveFileExA(srcPath.Data(), dstPath.Data(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		return rename(srcPath.Data(), dstPath.Data()) == 0;
+#endif
+	}
+}
+
+//----------------------------------------------------------------------------
+
+CProfilerTraceExporter::CProfilerTraceExporter()
+:	m_EventCount(0)
+,	m_Finished(false)
+#if	(KR_PROFILER_ENABLED != 0)
+,	m_TimeOriginTicks(0)
+,	m_HasTimeOrigin(false)
+,	m_LastReportEndUs(0.0)
+#endif
+{
+}
+
+//----------------------------------------------------------------------------
+
+CProfilerTraceExporter::~CProfilerTraceExporter()
+{
+}
+
+//----------------------------------------------------------------------------
+
+void	CProfilerTraceExporter::Clear()
+{
+	m_Json.Clear();
+	m_EventCount = 0;
+	m_Finished = false;
+	m_ThreadTracks.Clear();
+#if	(KR_PROFILER_ENABLED != 0)
+	m_TimeOriginTicks = 0;
+	m_HasTimeOrigin = false;
+	m_LastReportEndUs = 0.0;
+#endif
+}
+
+//----------------------------------------------------------------------------
+
+bool	CProfilerTraceExporter::_Append(const char *str, u32 length)
+{
+	const u32	offset = m_Json.Count();
+	if (!m_Json.Resize(offset + length))
+		return false;
+	Mem::Copy(m_Json.RawDataPointer() + offset, str, length);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+bool	CProfilerTraceExporter::_AppendEscaped(const char *str)
+{
+	if (!_Append("\"", 1))
+		return false;
+	if (str != null)
+	{
+		for (const char *c = str; *c != '\0'; ++c)
+		{
+			const u8	chr = static_cast<u8>(*c);
+			bool		success = true;
+			if (chr == '"' || chr == '\\')
+			{
+				const char	escaped[2] = { '\\', *c };
+				success = _Append(escaped, 2);
+			}
+			else if (chr < 0x20)	// Control characters: \u00XX
+				success = _Append(CString::Format("\\u%04x", chr));
+			else
+				success = _Append(c, 1);
+			if (!success)
+				return false;
+		}
+	}
+	return _Append("\"", 1);
+}
+
+//----------------------------------------------------------------------------
+
+bool	CProfilerTraceExporter::_BeginEvent()
+{
+	if (m_Finished)
+	{
+		// Reopens the event list
+		PK_ASSERT(m_Json.Count() >= kTraceFooterLength);
+		if (!m_Json.Resize(m_Json.Count() - kTraceFooterLength))
+			return false;
+		m_Finished = false;
+	}
+	const bool	success = m_EventCount == 0 ? _Append(kTraceHeader, sizeof(kTraceHeader) - 1) : _Append(",\n", 2);
+	if (success)
+		++m_EventCount;
+	return success;
+}
+
+//----------------------------------------------------------------------------
+
+bool	CProfilerTraceExporter::AddThreadName(u32 threadId, const char *name)
+{
+	return	_BeginEvent() &&
+			_Append(CString::Format("{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":", threadId)) &&
+			_AppendEscaped(name) &&
+			_Append("}}", 2);
+}
+
+//----------------------------------------------------------------------------
+
+bool	CProfilerTraceExporter::AddEvent(u32 threadId, const char *name, const char *category, double startUs, double durationUs)
+{
+	return	_BeginEvent() &&
+			_Append(CString::Format("{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"cat\":", threadId, startUs, PKMax(durationUs, 0.0))) &&
+			_AppendEscaped(category) &&
+			_Append(",\"name\":", 8) &&
+			_AppendEscaped(name) &&
+			_Append("}", 1);
+}
+
+//----------------------------------------------------------------------------
+
+bool	CProfilerTraceExporter::AddInstantEvent(u32 threadId, const char *name, double timeUs)
+{
+	return	_BeginEvent() &&
+			_Append(CString::Format("{\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"name\":", threadId, timeUs)) &&
+			_AppendEscaped(name) &&
+			_Append("}", 1);
+}
+
+//----------------------------------------------------------------------------
+
+bool	CProfilerTraceExporter::AddCounter(const char *name, double timeUs, const TMemoryView<const char * const> &seriesNames, const TMemoryView<const u64> &values)
+{
+	if (!PK_VERIFY(seriesNames.Count() == values.Count()) || values.Empty())
+		return false;
+	if (!_BeginEvent() ||
+		!_Append(CString::Format("{\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"name\":", timeUs)) ||
+		!_AppendEscaped(name) ||
+		!_Append(",\"args\":{", 9))
+		return false;
+	for (u32 i = 0; i < values.Count(); ++i)
+	{
+		if ((i > 0 && !_Append(",", 1)) ||
+			!_AppendEscaped(seriesNames[i]) ||
+			!_Append(CString::Format(":%llu", static_cast<unsigned long long>(values[i]))))
+			return false;
+	}
+	return _Append("}}", 2);
+}
+
+//----------------------------------------------------------------------------
+
+u32		CProfilerTraceExporter::_ThreadTrackId(const CString &threadName)
+{
+	// Track 0 is left to the caller's own events
+	for (u32 i = 0; i < m_ThreadTracks.Count(); ++i)
+	{
+		if (m_ThreadTracks[i] == threadName)
+			return i + 1;
+	}
+	const u32	trackId = m_ThreadTracks.Count() + 1;
+	if (!m_ThreadTracks.PushBack(threadName).Valid())
+		return trackId;
+	const CString	trackName = threadName.Empty() ? CString::Format("Thread %u", trackId) : threadName;
+	AddThreadName(trackId, trackName.Data());
+	return trackId;
+}
+
+//----------------------------------------------------------------------------
+
+#if	(KR_PROFILER_ENABLED != 0)
+
+bool	CProfilerTraceExporter::AddReport(const Profiler::CProfilerReport &report)
+{
+	PK_NAMEDSCOPEDPROFILE("CProfilerTraceExporter::AddReport");
+
+	// Profiler records are in CPU ticks
+	if (!PK_VERIFY(report.m_TicksPerSecond > 0))
+		return false;
+	const double	ticksToUs = 1.0e+6 / static_cast<double>(report.m_TicksPerSecond);
+
+	if (!m_HasTimeOrigin)
+	{
+		u64		firstTick = TNumericTraits<u64>::kMax;
+		for (const auto &thread : report.m_ThreadReports)
+		{
+			for (const auto &record : thread.m_Records)
+				firstTick = PKMin(firstTick, record.m_Start);
+		}
+		if (firstTick == TNumericTraits<u64>::kMax)
+			return true;	// Nothing recorded
+		m_TimeOriginTicks = firstTick;
+		m_HasTimeOrigin = true;
+	}
+
+	for (const auto &thread : report.m_ThreadReports)
+	{
+		if (thread.m_Records.Empty())
+			continue;
+		const u32	trackId = _ThreadTrackId(thread.m_ThreadName);
+		for (const auto &record : thread.m_Records)
+		{
+			// Records of a previous capture that ended before the time origin are clamped to it
+			const u64		startTicks = PKMax(record.m_Start, m_TimeOriginTicks);
+			const u64		endTicks = PKMax(record.m_End, startTicks);
+			const double	startUs = static_cast<double>(startTicks - m_TimeOriginTicks) * ticksToUs;
+			const double	endUs = static_cast<double>(endTicks - m_TimeOriginTicks) * ticksToUs;
+			const char		*name = record.m_NodeDescriptor != null ? record.m_NodeDescriptor->m_Name : null;
+			if (!AddEvent(trackId, name != null ? name : "<unknown>", "PopcornFX", startUs, endUs - startUs))
+				return false;
+			m_LastReportEndUs = PKMax(m_LastReportEndUs, endUs);
+		}
+	}
+	return true;
+}
+
+#endif
+
+//----------------------------------------------------------------------------
+
+TMemoryView<const char>	CProfilerTraceExporter::Finish()
+{
+	if (!m_Finished)
+	{
+		if (m_EventCount == 0 && !_Append(kTraceHeader, sizeof(kTraceHeader) - 1))
+			return TMemoryView<const char>();
+		if (!_Append(kTraceFooter, kTraceFooterLength))
+			return TMemoryView<const char>();
+		m_Finished = true;
+	}
+	return TMemoryView<const char>(m_Json.RawDataPointer(), m_Json.Count());
+}
+
+//----------------------------------------------------------------------------
+
+bool	CProfilerTraceExporter::WriteFile(const CString &path)
+{
+	PK_NAMEDSCOPEDPROFILE("CProfilerTraceExporter::WriteFile");
+	const TMemoryView<const char>	json = Finish();
+	if (json.Empty())
+		return false;
+
+	IFileSystem		*fs = File::DefaultFileSystem();
+	const bool		isAbsolute = CFilePath::IsAbsolute(path);
+	PFileStream		fileView = fs->OpenStream(path, IFileSystem::Access_WriteCreate, isAbsolute);
+	if (fileView == null)
+	{
+		CLog::Log(PK_ERROR, "Could not write the profiler trace: failed opening \"%s\"", path.Data());
+		return false;
+	}
+	const bool		written = fileView->Write(json.Data(), json.Count()) != 0;
+	fileView->Close();
+	if (!written)
+	{
+		CLog::Log(PK_ERROR, "Could not write the profiler trace: failed writing \"%s\"", path.Data());
+		fs->FileDelete(path, isAbsolute);
+		return false;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+bool	CProfilerTraceExporter::WriteRotatingFile(const CString &dir, const CString &baseName, u32 fileCount, CString *outPath)
+{
+	if (!PK_VERIFY(fileCount > 0) ||
+		!PK_VERIFY(CFilePath::IsAbsolute(dir)))
+		return false;
+
+	// Written next to the others first: the previous traces are only rotated once the new one is complete
+	const CString	basePath = dir / baseName;
+	const CString	tmpPath = basePath + ".json.tmp";
+	if (!WriteFile(tmpPath))
+		return false;
+
+	IFileSystem		*fs = File::DefaultFileSystem();
+	fs->FileDelete(CString::Format("%s.%u.json", basePath.Data(), fileCount - 1), true);
+	for (u32 i = fileCount - 1; i-- > 0; )
+	{
+		const CString	srcPath = i == 0 ? basePath + ".json" : CString::Format("%s.%u.json", basePath.Data(), i);
+		if (fs->Exists(srcPath, true))
+			_MoveFile(srcPath, CString::Format("%s.%u.json", basePath.Data(), i + 1));
+	}
+	const CString	dstPath = basePath + ".json";
+	if (!_MoveFile(tmpPath, dstPath))
+	{
+		CLog::Log(PK_ERROR, "Could not write the profiler trace: failed replacing \"%s\"", dstPath.Data());
+		fs->FileDelete(tmpPath, true);
+		return false;
+	}
+	if (outPath != null)
+		*outPath = dstPath;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+__PK_SAMPLE_API_END
@@ -0,0 +1,79 @@
+#pragma once
+
+//----------------------------------------------------------------------------
+// This program is the property of Persistant Studios SARL.
+//
+// You may not redistribute it and/or modify it under any conditions
+// without written permission from Persistant Studios SARL, unless
+// otherwise stated in the latest Persistant Studios Code License.
+//
+// See the Persistant Studios Code License for further details.
+//----------------------------------------------------------------------------
+
+#include "PKSample.h"
+
+__PK_SAMPLE_API_BEGIN
+//----------------------------------------------------------------------------
+//
+//	Headless export of profiler reports to the Chrome trace event JSON format,
+//	opened by chrome://tracing, Perfetto (ui.perfetto.dev) or Speedscope.
+//	No RHI dependency: usable from the plugins without a profiler renderer.
+//
+//----------------------------------------------------------------------------
+
+class	CProfilerTraceExporter : public CNonCopyable
+{
+public:
+	enum	{ kDefaultRotatingFileCount = 8 };
+
+	CProfilerTraceExporter();
+	~CProfilerTraceExporter();
+
+	void				Clear();
+	bool				Empty() const { return m_EventCount == 0; }
+	u32					EventCount() const { return m_EventCount; }
+
+	// Timestamps are in microseconds. Thread ids are the trace tracks, named once with AddThreadName().
+	bool				AddThreadName(u32 threadId, const char *name);
+	bool				AddEvent(u32 threadId, const char *name, const char *category, double startUs, double durationUs);
+	bool				AddInstantEvent(u32 threadId, const char *name, double timeUs);
+	// Counter track 'name', one series per value ("Buffers", "Textures", ...)
+	bool				AddCounter(const char *name, double timeUs, const TMemoryView<const char * const> &seriesNames, const TMemoryView<const u64> &values);
+
+#if	(KR_PROFILER_ENABLED != 0)
+	// Appends the records of 'report', one track per profiled thread.
+	// Successive reports keep their relative timings: the first one starts at 0.
+	bool				AddReport(const Profiler::CProfilerReport &report);
+	// Time of the end of the last added report, to place the counters and markers after it
+	double				LastReportEndUs() const { return m_LastReportEndUs; }
+#endif
+
+	// Complete JSON document, valid as long as the exporter is not modified
+	TMemoryView<const char>	Finish();
+
+	bool				WriteFile(const CString &path);
+	// Writes '<dir>/<baseName>.json' and shifts the previous ones to '<baseName>.1.json' ... '<baseName>.<fileCount - 1>.json'.
+	// 'dir' must be a physical path.
+	bool				WriteRotatingFile(const CString &dir, const CString &baseName, u32 fileCount = kDefaultRotatingFileCount, CString *outPath = null);
+
+private:
+	bool				_BeginEvent();
+	bool				_Append(const char *str, u32 length);
+	bool				_Append(const CString &str) { return _Append(str.Data(), str.Length()); }
+	bool				_AppendEscaped(const char *str);
+	u32					_ThreadTrackId(const CString &threadName);
+
+	TArray<char>		m_Json;
+	u32					m_EventCount;
+	bool				m_Finished;
+
+	TArray<CString>		m_ThreadTracks;		// Track id - 1 of the report threads, by name: stable across reports
+#if	(KR_PROFILER_ENABLED != 0)
+	u64					m_TimeOriginTicks;
+	bool				m_HasTimeOrigin;
+	double				m_LastReportEndUs;
+#endif
+};
+
+//----------------------------------------------------------------------------
+__PK_SAMPLE_API_END
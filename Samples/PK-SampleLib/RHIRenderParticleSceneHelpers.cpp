@@ -7,6 +7,7 @@
 #include "PK-SampleLib/ShaderDefinitions/BasicSceneShaderDefinitions.h"
 #include "PK-SampleLib/ShaderDefinitions/SampleLibShaderDefinitions.h"
 #include "PK-SampleLib/RenderIntegrationRHI/MaterialToRHI.h"
+#include "PK-SampleLib/RenderIntegrationRHI/RHIGpuBufferPool.h"
 #include "PK-SampleLib/BRDFLUT.h"
 
 #include <pk_rhi/include/AllInterfaces.h>
@@ -73,6 +74,9 @@ CRHIParticleSceneRenderHelper::CRHIParticleSceneRenderHelper()
 ,	m_EnableColorRemap(false)
 ,	m_EnableFXAA(true)
 ,	m_CoordinateFrame(CCoordinateFrame::GlobalFrame())
+,	m_EnableDrawCallCulling(true)
+,	m_EnablePostFXRegions(true)
+,	m_PreparedRenderQueueCount(0)
 ,	m_GridIdxCount(0)
 ,	m_GridSubdivIdxCount(0)
 {
@@ -571,6 +575,8 @@ bool	CRHIParticleSceneRenderHelper::Resize(TMemoryView<const RHI::PRenderTarget>
 		currentLoadOp = &finalLoadOp;
 	}
 
+	_AllocatePostFxRenderTargets(currentFrameBuffers.First()->GetSize());
+
 	// ------------------------------------------
 	//
 	// TONE-MAPPING
@@ -599,9 +605,15 @@ bool	CRHIParticleSceneRenderHelper::Resize(TMemoryView<const RHI::PRenderTarget>
 		CPostFxColorRemap::SInOutRenderTargets	inOut;
 
 		_FillColorRemapInOut(inOut);
+		const SSamplableRenderTarget	*aliasedOutput = _AliasedPostFxOutput(PostFxStage_ColorRemap, inOut.m_OutputRenderTargetIdx);
 		m_ColorRemap.SetRemapTexture(m_DummyWhite, true); // Placeholder
 		if (!PK_VERIFY(m_ColorRemap.UpdateFrameBuffer(currentFrameBuffers, *currentLoadOp, &inOut)))
 			return false;
+		if (aliasedOutput != null)
+		{
+			m_ColorRemap.m_OutputRenderTarget = *aliasedOutput;
+			m_ColorRemap.m_OutputRenderTargetIdx = inOut.m_OutputRenderTargetIdx;
+		}
 
 		if (!PK_VERIFY(m_ColorRemap.AddSubPasses(currentRenderPass, &inOut)))
 			return false;		
@@ -618,11 +630,17 @@ bool	CRHIParticleSceneRenderHelper::Resize(TMemoryView<const RHI::PRenderTarget>
 		CPostFxFXAA::SInOutRenderTargets		inOut;
 
 		_FillFXAAInOut(inOut);
+		const SSamplableRenderTarget	*aliasedOutput = _AliasedPostFxOutput(PostFxStage_FXAA, inOut.m_OutputRtIdx);
 		if (!PK_VERIFY(m_FXAA.UpdateFrameBuffer(currentFrameBuffers,
 												*currentLoadOp,
 												*currentClearValues,
 												&inOut)))
 			return false;
+		if (aliasedOutput != null)
+		{
+			m_FXAA.m_OutputRenderTarget = *aliasedOutput;
+			m_FXAA.m_OutputRenderTargetIdx = inOut.m_OutputRtIdx;
+		}
 
 		if (!PK_VERIFY(m_FXAA.AddSubPasses(currentRenderPass, &inOut)))
 			return false;
@@ -792,6 +810,25 @@ bool	CRHIParticleSceneRenderHelper::Resize(TMemoryView<const RHI::PRenderTarget>
 
 //----------------------------------------------------------------------------
 
+u32	CRHIParticleSceneRenderHelper::PlanRenderPasses(const SParticleSceneOptions &options, u32 initRP /* = InitRP_All */)
+{
+	u32	renderPasses = initRP;
+
+	if (!options.m_Bloom.m_Enable)
+		renderPasses &= ~InitRP_Bloom;
+	if (!options.m_ToneMapping.m_Enable)
+		renderPasses &= ~InitRP_ToneMapping;
+	// Without a LUT, the color remap is a copy. The overdraw heatmap texture is also loaded when this pass exists.
+	if ((!options.m_ColorRemap.m_Enable || options.m_ColorRemap.m_RemapTexturePath.Empty()) &&
+		options.m_Overdraw.m_OverdrawTexturePath.Empty())
+		renderPasses &= ~InitRP_ColorRemap;
+	if (!options.m_FXAA.m_Enable)
+		renderPasses &= ~InitRP_FXAA;
+	return renderPasses;
+}
+
+//----------------------------------------------------------------------------
+
 bool	CRHIParticleSceneRenderHelper::SetupPostFX_Distortion(const SParticleSceneOptions::SDistortion &config, bool /*firstInit*/)
 {
 	if ((m_InitializedRP & InitRP_Distortion) != 0)
@@ -876,14 +913,11 @@ bool	CRHIParticleSceneRenderHelper::SetupPostFX_ToneMapping(	const SParticleScen
 
 		m_ToneMapping.SetPrecomputeLuma(precomputeLuma);
 
-		// Gamma correction is needed only if the render targets are in linear-space.
-		bool isSRGB = true;
 		PK_ASSERT(!m_FinalFrameBuffers.Empty());
 		PK_ASSERT(!m_FinalFrameBuffers[0]->GetRenderTargets().Empty());
 		RHI::PTexture	texture = m_FinalFrameBuffers[0]->GetRenderTargets()[0]->GetTexture();
-		if (texture != null)
-			isSRGB = (u32(texture->GetFormat()) & RHI::FlagSrgb) != 0;
-		m_ToneMapping.SetGamma(isSRGB ? 1.f : 2.2f);
+		const RHI::EPixelFormat	finalFormat = texture != null ? texture->GetFormat() : RHI::FormatSrgb8RGBA;
+		m_ToneMapping.SetGamma(ToneMappingGamma(finalFormat, m_ToneMappingFixedGamma));
 		m_ToneMapping.SetScreenSize(m_FinalFrameBuffers[0]->GetRenderTargets()[0]->GetSize().x(), m_FinalFrameBuffers[0]->GetRenderTargets()[0]->GetSize().y());
 	}
 	return true;
@@ -891,6 +925,15 @@ bool	CRHIParticleSceneRenderHelper::SetupPostFX_ToneMapping(	const SParticleScen
 
 //----------------------------------------------------------------------------
 
+float	CRHIParticleSceneRenderHelper::ToneMappingGamma(RHI::EPixelFormat finalFormat, bool fixedGamma)
+{
+	// Gamma correction is needed only if the render targets are in linear-space.
+	const bool	isSRGB = (u32(finalFormat) & RHI::FlagSrgb) != 0;
+	return (isSRGB && !fixedGamma) ? 1.f : 2.2f;
+}
+
+//----------------------------------------------------------------------------
+
 bool	CRHIParticleSceneRenderHelper::SetupPostFX_ColorRemap(	const SParticleSceneOptions::SColorRemap &config,
 																bool firstInit)
 {
@@ -1158,6 +1201,8 @@ bool	CRHIParticleSceneRenderHelper::SetBackdropInfo(const SBackdropsData &backdr
 			m_MeshBackdrop.IsDirty())
 		{
 			Mem::Reinit(m_MeshBackdrop);
+			// Drawn by the opaque pass and by each shadow cascade
+			m_MeshBackdrop.m_OptimizeVertexCache = true;
 
 			if (!backdropData.m_MeshPath.Empty())
 				m_MeshBackdrop.m_MeshPath = backdropData.m_MeshPath;
@@ -1246,6 +1291,7 @@ void	CRHIParticleSceneRenderHelper::SetBackGroundColor(const CFloat3 &top, const
 void	CRHIParticleSceneRenderHelper::SetBackGroundTexture(const RHI::PTexture &background)
 {
 	m_BackgroundTexture = background;
+	m_BackgroundIsConstant = false;
 	if (m_BackgroundTexture != null && m_BackgroundTextureConstantSet != null)
 	{
 		m_BackgroundTextureConstantSet->SetConstants(m_DefaultSampler, m_BackgroundTexture, 0);
@@ -1255,6 +1301,15 @@ void	CRHIParticleSceneRenderHelper::SetBackGroundTexture(const RHI::PTexture &ba
 
 //----------------------------------------------------------------------------
 
+void	CRHIParticleSceneRenderHelper::SetBackGroundConstantColor(const CFloat4 &linearColor)
+{
+	m_BackgroundTexture = null;
+	m_BackgroundIsConstant = true;
+	m_BackgroundConstantColor = linearColor;
+}
+
+//----------------------------------------------------------------------------
+
 CGBuffer	&CRHIParticleSceneRenderHelper::GetDeferredSetup()
 {
 	return m_GBuffer;
@@ -1268,6 +1323,24 @@ bool	CRHIParticleSceneRenderHelper::RenderScene(	ERenderTargetDebug		renderTarge
 {
 	PK_SCOPEDPROFILE();
 
+	// Billboarding batches buffers recycled some frames ago can be reused, old ones are destroyed
+	CRHIGpuBufferPool::Instance().RenderThread_NextFrame();
+
+	// Visible draw-calls of the camera passes (null if culling is disabled: all the draw-calls are rendered)
+	const TArray<SRHIDrawCall>	&drawCalls = drawOutputs.m_DrawCalls;
+	const TArray<u32>			*cameraVisibleDrawCalls = null;
+	bool						drawCallsCullable = false;
+	if (m_EnableDrawCallCulling)
+	{
+		PK_NAMEDSCOPEDPROFILE("Cull draw-calls");
+		const TStridedMemoryView<const CAABB>	bboxes = drawCalls.Empty() ? TStridedMemoryView<const CAABB>() : TStridedMemoryView<const CAABB>(&drawCalls.First().m_BBox, drawCalls.Count(), sizeof(SRHIDrawCall));
+		drawCallsCullable = m_DrawCallCuller.SetBBoxes(bboxes);
+		SCullingFrustum	cameraFrustum;
+		cameraFrustum.SetupFromViewProj(m_SceneInfoData.m_ViewProj, true);
+		if (drawCallsCullable && m_DrawCallCuller.Cull(cameraFrustum, &m_OcclusionCullingDepth, m_CameraVisibleDrawCalls))
+			cameraVisibleDrawCalls = &m_CameraVisibleDrawCalls;
+	}
+
 	RHI::PCommandBuffer	preOpaqueCmdBuff = m_ApiManager->CreateCommandBuffer(RHI::SRHIResourceInfos("PK-RHI Pre Opaque command buffer"));
 	RHI::PCommandBuffer	postOpaqueCmdBuff = m_ApiManager->CreateCommandBuffer(RHI::SRHIResourceInfos("PK-RHI Post Opaque command buffer"));
 
@@ -1298,29 +1371,34 @@ bool	CRHIParticleSceneRenderHelper::RenderScene(	ERenderTargetDebug		renderTarge
 	const TMemoryView<RHI::SFrameBufferClearValue>	&clearValues = hasBloom ? m_BeforeBloomClearValues : m_FinalClearValues;
 
 	// Render pass shadows:
-	if (!m_Lights.m_DirectionalLights.Empty() && m_Lights.m_DirectionalShadows.GetShadowEnabled())
+	const bool									renderShadows = !m_Lights.m_DirectionalLights.Empty() && m_Lights.m_DirectionalShadows.GetShadowEnabled();
+	TStaticCountedArray<const TArray<u32>*, 4>	shadowVisibleDrawCalls;	// Per valid cascade
+	if (renderShadows)
 	{
 		const SLightRenderPass::SPerLightData	&curLight = m_Lights.m_DirectionalLights.First();
 		const CFloat3							lightDir = curLight.m_LightParam0.xyz();
-		bool									hasShadows = false;
 
 		m_Lights.m_DirectionalShadows.UpdateSceneInfo(m_SceneInfoData);
 		m_Lights.m_DirectionalShadows.InitFrameUpdateSceneInfo(lightDir, m_CoordinateFrame, *m_ShaderLoader, m_MeshBackdrop, m_BackdropsData.m_CastShadows);
-		_UpdateShadowsBBox(m_Lights.m_DirectionalShadows, drawOutputs.m_DrawCalls);
+		_UpdateShadowsBBox(m_Lights.m_DirectionalShadows, drawOutputs.m_DrawCalls, cameraVisibleDrawCalls);
 		m_Lights.m_DirectionalShadows.FinalizeFrameUpdateSceneInfo();
 		m_Lights.UpdateShadowsInfo(m_ApiManager);
+		PK_ASSERT(m_Lights.m_DirectionalShadows.CascadeShadowCount() <= m_ShadowVisibleDrawCalls.Count());
 		for (u32 j = 0; j < m_Lights.m_DirectionalShadows.CascadeShadowCount(); ++j)
 		{
 			if (m_Lights.m_DirectionalShadows.IsSliceValidForDraw(j))
 			{
-				m_Lights.m_DirectionalShadows.BeginDrawShadowRenderPass(preOpaqueCmdBuff, j, m_BackdropsData.m_CastShadows ? &m_MeshBackdrop : null);
-				_RenderParticles(false, ParticlePass_OpaqueShadow, drawOutputs.m_DrawCalls, preOpaqueCmdBuff, m_Lights.m_DirectionalShadows.GetSceneInfoConstSet(j));
-				m_Lights.m_DirectionalShadows.EndDrawShadowRenderPass(preOpaqueCmdBuff, j);
-				hasShadows = true;
+				const TArray<u32>	*cascadeVisibleDrawCalls = null;
+				if (drawCallsCullable)
+				{
+					SCullingFrustum	cascadeFrustum;
+					cascadeFrustum.SetupFromViewProj(m_Lights.m_DirectionalShadows.GetWorldToShadow(j), false);
+					if (m_DrawCallCuller.Cull(cascadeFrustum, null, m_ShadowVisibleDrawCalls[j]))
+						cascadeVisibleDrawCalls = &m_ShadowVisibleDrawCalls[j];
+				}
+				shadowVisibleDrawCalls.PushBack(cascadeVisibleDrawCalls);
 			}
 		}
-		if (hasShadows)
-			preOpaqueCmdBuff->SyncPreviousRenderPass(RHI::OutputColorPipelineStage, RHI::TopOfPipePipelineStage);
 	}
 	else
 	{
@@ -1328,6 +1406,28 @@ bool	CRHIParticleSceneRenderHelper::RenderScene(	ERenderTargetDebug		renderTarge
 		m_Lights.UpdateShadowsInfo(m_ApiManager);
 	}
 
+	// The render queues of the particle passes are sorted on the worker threads,
+	// the command buffers are still recorded in order below (identical commands).
+	_PrepareParticleRenderQueues(drawCalls, cameraVisibleDrawCalls, shadowVisibleDrawCalls.View());
+
+	if (renderShadows)
+	{
+		bool	hasShadows = false;
+		u32		shadowIdx = 0;
+		for (u32 j = 0; j < m_Lights.m_DirectionalShadows.CascadeShadowCount(); ++j)
+		{
+			if (m_Lights.m_DirectionalShadows.IsSliceValidForDraw(j))
+			{
+				m_Lights.m_DirectionalShadows.BeginDrawShadowRenderPass(preOpaqueCmdBuff, j, m_BackdropsData.m_CastShadows ? &m_MeshBackdrop : null);
+				_RenderParticles(false, ParticlePass_OpaqueShadow, drawOutputs.m_DrawCalls, preOpaqueCmdBuff, m_Lights.m_DirectionalShadows.GetSceneInfoConstSet(j), shadowVisibleDrawCalls[shadowIdx++]);
+				m_Lights.m_DirectionalShadows.EndDrawShadowRenderPass(preOpaqueCmdBuff, j);
+				hasShadows = true;
+			}
+		}
+		if (hasShadows)
+			preOpaqueCmdBuff->SyncPreviousRenderPass(RHI::OutputColorPipelineStage, RHI::TopOfPipePipelineStage);
+	}
+
 	// -- START RENDER PASS: Deferred -------------------
 	{
 		PK_NAMEDSCOPEDPROFILE("START RENDER PASS: Deferred");
@@ -1365,7 +1465,7 @@ bool	CRHIParticleSceneRenderHelper::RenderScene(	ERenderTargetDebug		renderTarge
 			PK_NAMEDSCOPEDPROFILE_GPU(postOpaqueCmdBuff->ProfileEventContext(), "Opaque particles");
 
 			if (m_EnableParticleRender)
-				_RenderParticles(false, ParticlePass_Opaque, drawOutputs.m_DrawCalls, postOpaqueCmdBuff);
+				_RenderParticles(false, ParticlePass_Opaque, drawOutputs.m_DrawCalls, postOpaqueCmdBuff, null, cameraVisibleDrawCalls);
 		}
 		// Sub-pass: Decal
 		{
@@ -1373,7 +1473,7 @@ bool	CRHIParticleSceneRenderHelper::RenderScene(	ERenderTargetDebug		renderTarge
 			PK_NAMEDSCOPEDPROFILE_GPU(postOpaqueCmdBuff->ProfileEventContext(), "Decal particles");
 			postOpaqueCmdBuff->NextRenderSubPass();
 			if (m_EnableParticleRender)
-				_RenderParticles(false, ParticlePass_Decal, drawOutputs.m_DrawCalls, postOpaqueCmdBuff);
+				_RenderParticles(false, ParticlePass_Decal, drawOutputs.m_DrawCalls, postOpaqueCmdBuff, null, cameraVisibleDrawCalls);
 		}
 		// Sub-pass: backdrop directional light + light particles:
 		{
@@ -1417,7 +1517,7 @@ bool	CRHIParticleSceneRenderHelper::RenderScene(	ERenderTargetDebug		renderTarge
 			if (m_EnableParticleRender)
 			{
 				PK_NAMEDSCOPEDPROFILE_GPU(postOpaqueCmdBuff->ProfileEventContext(), "Transparent particles");
-				_RenderParticles(false, ParticlePass_Transparent, drawOutputs.m_DrawCalls, postOpaqueCmdBuff);
+				_RenderParticles(false, ParticlePass_Transparent, drawOutputs.m_DrawCalls, postOpaqueCmdBuff, null, cameraVisibleDrawCalls);
 			}
 
 			_RenderEditorMisc(postOpaqueCmdBuff);
@@ -1431,7 +1531,7 @@ bool	CRHIParticleSceneRenderHelper::RenderScene(	ERenderTargetDebug		renderTarge
 		if (m_EnableParticleRender)
 		{
 			PK_NAMEDSCOPEDPROFILE_GPU(postOpaqueCmdBuff->ProfileEventContext(), "Transparent particles");
-			_RenderParticles(false, ParticlePass_Transparent, drawOutputs.m_DrawCalls, postOpaqueCmdBuff);
+			_RenderParticles(false, ParticlePass_Transparent, drawOutputs.m_DrawCalls, postOpaqueCmdBuff, null, cameraVisibleDrawCalls);
 		}
 
 		_RenderEditorMisc(postOpaqueCmdBuff);
@@ -1439,6 +1539,7 @@ bool	CRHIParticleSceneRenderHelper::RenderScene(	ERenderTargetDebug		renderTarge
 
 	if (_EndRenderPass(InitRP_GBuffer, postOpaqueCmdBuff))
 	{
+		_ReleasePreparedRenderQueues();
 		postOpaqueCmdBuff->Stop();
 		m_ApiManager->SubmitCommandBufferDirect(postOpaqueCmdBuff);
 		return true;
@@ -1453,11 +1554,13 @@ bool	CRHIParticleSceneRenderHelper::RenderScene(	ERenderTargetDebug		renderTarge
 
 		PK_NAMEDSCOPEDPROFILE("Sub-pass: Distortion-Map");
 		postOpaqueCmdBuff->NextRenderSubPass();
+		SScreenRegion	distortionRegion;
 		if (PostFXEnabled_Distortion() && m_EnableParticleRender && !m_EnableOverdrawRender)
 		{
 			PK_NAMEDSCOPEDPROFILE_GPU(postOpaqueCmdBuff->ProfileEventContext(), "Distortion particles");
-			_RenderParticles(false, ParticlePass_Distortion, drawOutputs.m_DrawCalls, postOpaqueCmdBuff);
+			_RenderParticles(false, ParticlePass_Distortion, drawOutputs.m_DrawCalls, postOpaqueCmdBuff, null, cameraVisibleDrawCalls, &distortionRegion);
 		}
+		m_Distortion.SetBlurRegion(m_EnablePostFXRegions ? distortionRegion : SScreenRegion::Full());
 
 		{
 			PK_NAMEDSCOPEDPROFILE("Sub-passes: Distortion-PostFX");
@@ -1481,17 +1584,20 @@ bool	CRHIParticleSceneRenderHelper::RenderScene(	ERenderTargetDebug		renderTarge
 					ParticlePass_TransparentPostDisto
 				};
 
-				_RenderParticles(false, renderPasses, drawOutputs.m_DrawCalls, postOpaqueCmdBuff);
+				_RenderParticles(false, renderPasses, drawOutputs.m_DrawCalls, postOpaqueCmdBuff, null, cameraVisibleDrawCalls);
 			}
 		}
 
 		if (_EndRenderPass(InitRP_Distortion, postOpaqueCmdBuff))
 		{
+			_ReleasePreparedRenderQueues();
 			postOpaqueCmdBuff->Stop();
 			m_ApiManager->SubmitCommandBufferDirect(postOpaqueCmdBuff);
 			return true;
 		}
 	}
+	// All the prepared particle passes are rendered
+	_ReleasePreparedRenderQueues();
 
 	// -- START RENDER PASS: Bloom Post-FX -------------------------
 	// Input: m_DeferredSetup.m_DistortionPostFX.m_OutputRenderTarget
@@ -1504,6 +1610,7 @@ bool	CRHIParticleSceneRenderHelper::RenderScene(	ERenderTargetDebug		renderTarge
 		postOpaqueCmdBuff->SyncPreviousRenderPass(RHI::FragmentPipelineStage, RHI::FragmentPipelineStage);
 		if (PostFXEnabled_Bloom() && !m_EnableOverdrawRender)
 		{
+			m_Bloom.SetSourceRegion(_BloomSourceRegion(drawOutputs.m_DrawCalls));
 			m_Bloom.Draw(postOpaqueCmdBuff, finalRtIdx);
 			postOpaqueCmdBuff->SyncPreviousRenderPass(RHI::FragmentPipelineStage, RHI::FragmentPipelineStage);
 		}
@@ -1793,30 +1900,103 @@ bool	CRHIParticleSceneRenderHelper::_BindDebugConstantSets(const RHI::PRenderSta
 
 //----------------------------------------------------------------------------
 
-void	CRHIParticleSceneRenderHelper::_RenderParticles(bool											debugMode,
-														CRenderPassArray								renderPasses,
-														const TArray<SRHIDrawCall>						&drawCalls,
-														const RHI::PCommandBuffer						&cmdBuff,
-														const RHI::PConstantSet							&sceneInfo)
+// Whether draws with this render state can be reordered, see CRenderQueue::EBlendClass
+static CRenderQueue::EBlendClass	_GetBlendClass(const RHI::PRenderState &renderState)
 {
-	PK_SCOPEDPROFILE();
-	RHI::PRenderState							renderState = null;
-	const void									*lastBatch = null;
+	const RHI::SRenderState	&state = renderState->m_RenderState;
+	if (!state.m_PipelineState.m_Blending)
+		return state.m_PipelineState.m_DepthWrite ? CRenderQueue::BlendClass_Opaque : CRenderQueue::BlendClass_Ordered;
+
+	// Blended and writing depth: the draws occlude each other, whatever the blend equation the result depends on their order
+	if (state.m_PipelineState.m_DepthWrite)
+		return CRenderQueue::BlendClass_Ordered;
+	// The alpha channel must be kept or summed
+	if (state.m_PipelineState.m_AlphaBlendingDst != RHI::BlendOne ||
+		(state.m_PipelineState.m_AlphaBlendingSrc != RHI::BlendOne && state.m_PipelineState.m_AlphaBlendingSrc != RHI::BlendZero))
+		return CRenderQueue::BlendClass_Ordered;
+	if (state.m_PipelineState.m_ColorBlendingDst == RHI::BlendOne)
+		return CRenderQueue::BlendClass_Additive;
+	if (state.m_PipelineState.m_ColorBlendingSrc == RHI::BlendDstColor && state.m_PipelineState.m_ColorBlendingDst == RHI::BlendZero)
+		return CRenderQueue::BlendClass_Multiply;
+	return CRenderQueue::BlendClass_Ordered;
+}
+
+//----------------------------------------------------------------------------
+
+static bool	_SameConstantSets(const TMemoryView<const RHI::PConstantSet> &a, const TMemoryView<const RHI::PConstantSet> &b)
+{
+	if (a.Count() != b.Count())
+		return false;
+	for (u32 i = 0; i < a.Count(); ++i)
+	{
+		if (a[i] != b[i])
+			return false;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
 
-	for (const SRHIDrawCall &dc : drawCalls)
+static bool	_SameGeometryBindings(const SRHIDrawCall &a, const SRHIDrawCall &b)
+{
+	if (a.m_IndexBuffer != b.m_IndexBuffer ||
+		(a.m_IndexBuffer != null && a.m_IndexSize != b.m_IndexSize) ||
+		a.m_VertexBuffers.Count() != b.m_VertexBuffers.Count() ||
+		a.m_VertexOffsets.Count() != b.m_VertexOffsets.Count())
+		return false;
+	for (u32 i = 0; i < a.m_VertexBuffers.Count(); ++i)
+	{
+		if (a.m_VertexBuffers[i] != b.m_VertexBuffers[i])
+			return false;
+	}
+	for (u32 i = 0; i < a.m_VertexOffsets.Count(); ++i)
 	{
+		if (a.m_VertexOffsets[i] != b.m_VertexOffsets[i])
+			return false;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+template<typename _RenderQueue>
+static bool	_SameRenderQueueInputs(const _RenderQueue &queue, const TArray<SRHIDrawCall> &drawCalls, const CRenderPassArray &renderPasses, const TArray<u32> *visibleDrawCalls)
+{
+	if (queue.m_DrawCalls != &drawCalls ||
+		queue.m_VisibleDrawCalls != visibleDrawCalls ||
+		queue.m_RenderPasses.Count() != renderPasses.Count())
+		return false;
+	for (u32 i = 0; i < renderPasses.Count(); ++i)
+	{
+		if (queue.m_RenderPasses[i] != renderPasses[i])
+			return false;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+bool	CRHIParticleSceneRenderHelper::_BuildParticleRenderQueue(SParticleRenderQueue &queue, bool debugMode, bool prepare)
+{
+	PK_SCOPEDPROFILE();
+	const TArray<SRHIDrawCall>					&drawCalls = *queue.m_DrawCalls;
+	const TArray<u32>							*visibleDrawCalls = queue.m_VisibleDrawCalls;
+	const CRenderPassArray						&renderPasses = queue.m_RenderPasses;
+	const u32									dcCount = visibleDrawCalls != null ? visibleDrawCalls->Count() : drawCalls.Count();
+	const CFloat3								cameraPosition = m_SceneInfoData.m_InvView.WAxis().xyz();
+
+	PK_ASSERT(!prepare || m_DrawCallCacheInstances.Count() == drawCalls.Count());
+	queue.m_Queue.Clear();
+	queue.m_Draws.Clear();
+	queue.m_NeedsRenderStateRequests = false;
+	for (u32 dcIdx = 0; dcIdx < dcCount; ++dcIdx)
+	{
+		const u32			drawCallIdx = visibleDrawCalls != null ? (*visibleDrawCalls)[dcIdx] : dcIdx;
+		const SRHIDrawCall	&dc = drawCalls[drawCallIdx];
 		// Here we either get the render state from the renderer cache or we choose between the debug render states:
 		EShaderOptions							shaderOptions = static_cast<EShaderOptions>(dc.m_ShaderOptions);
 		ESampleLibGraphicResources_RenderPass	cacheRenderPass = __MaxParticlePass;
-		u32										neededConstants = 0;
-		PCRendererCacheInstance					cacheInstance = null;
-		RHI::PRenderState						newRenderState = null;
-		const bool								isGeomShaderBB = !!(shaderOptions & Option_GeomBillboarding);
-		const bool								isVertexShaderBB =	(shaderOptions & Option_VertexBillboarding) ||
-																	(shaderOptions & Option_TriangleVertexBillboarding) ||
-																	(shaderOptions & Option_RibbonVertexBillboarding);
 		const bool								gpuStorage = (shaderOptions & PKSample::Option_GPUStorage) != 0;
-		const bool								GPUMesh = (shaderOptions & PKSample::Option_GPUMesh) != 0;
 
 		if (debugMode && gpuStorage)
 		{
@@ -1824,8 +2004,13 @@ void	CRHIParticleSceneRenderHelper::_RenderParticles(bool											debugMode,
 				continue; // Ribbon GPU particles debug draw not currently supported
 		}
 
-		for (ESampleLibGraphicResources_RenderPass renderPass : renderPasses)
+		for (u32 passIdx = 0; passIdx < renderPasses.Count(); ++passIdx)
 		{
+			const ESampleLibGraphicResources_RenderPass	renderPass = renderPasses[passIdx];
+			u32											neededConstants = 0;
+			PCRendererCacheInstance						cacheInstance = null;
+			RHI::PRenderState							newRenderState = null;
+
 			//------------------------------------------------------
 			// Retrieve renderer cache instance:
 			//------------------------------------------------------
@@ -1835,15 +2020,24 @@ void	CRHIParticleSceneRenderHelper::_RenderParticles(bool											debugMode,
 				{
 					if (renderPass == ParticlePass_OpaqueShadow && !srcRendererCache->CastShadows())
 						continue;
-					cacheInstance = srcRendererCache->RenderThread_GetCacheInstance();
+					cacheInstance = prepare ? m_DrawCallCacheInstances[drawCallIdx] : srcRendererCache->RenderThread_GetCacheInstance();
 					if (cacheInstance != null)
 					{
 						const PRendererCache	layout = cacheInstance->m_Cache;
 						if (layout != null)
-							newRenderState = layout->GetRenderState(shaderOptions, renderPass, &neededConstants);
+						{
+							if (prepare)
+							{
+								bool	needsRequest = false;
+								newRenderState = layout->FindRenderState(shaderOptions, renderPass, &neededConstants, &needsRequest);
+								queue.m_NeedsRenderStateRequests |= needsRequest;
+							}
+							else
+								newRenderState = layout->GetRenderState(shaderOptions, renderPass, &neededConstants);
+						}
 					}
 				}
-				else
+				else if (!prepare) // Already logged when resolving the cache instances
 					CLog::Log(PK_ERROR, "The renderer does not have a cache instance: some graphical resource creation must have failed");
 			}
 
@@ -1867,111 +2061,294 @@ void	CRHIParticleSceneRenderHelper::_RenderParticles(bool											debugMode,
 				continue;
 			}
 
-			//------------------------------------------------------
-			// Bind render state and constants:
-			//------------------------------------------------------
-			if (renderState != newRenderState)
-			{
-				renderState = newRenderState;
-				cmdBuff->BindRenderState(newRenderState);
-			}
+			const float	depth = (dc.m_BBox.Valid() && dc.m_BBox.IsFinite()) ? (dc.m_BBox.Center() - cameraPosition).Length() : 0.0f;
+			if (!PK_VERIFY(queue.m_Draws.PushBack().Valid()) ||
+				!PK_VERIFY(queue.m_Queue.Push(queue.m_Draws.Count() - 1, passIdx, newRenderState.Get(), cacheInstance.Get(), _GetBlendClass(newRenderState), depth)))
+				return false;
+			SQueuedParticleDraw	&queuedDraw = queue.m_Draws.Last();
+			queuedDraw.m_DrawCallIdx = drawCallIdx;
+			queuedDraw.m_RenderPass = renderPass;
+			queuedDraw.m_RenderState = newRenderState;
+			queuedDraw.m_CacheInstance = cacheInstance;
+			queuedDraw.m_NeededConstants = neededConstants;
+		}
+	}
 
-			// First we add the scene info constant set and then the renderer cache constant sets:
-			TStaticCountedArray<RHI::PConstantSet, 0x10>	constantSets;
-			if (!debugMode)
-			{
-				PK_ASSERT(cacheInstance != null);
-				if ((m_InitializedRP & InitRP_GBuffer) != 0)
-				{
-					if (neededConstants & MaterialToRHI::NeedSampleDepth)
-						constantSets.PushBack(GBufferRT(SPassDescription::GBufferRT_Depth).m_SamplerConstantSet);
-					if (neededConstants & MaterialToRHI::NeedSampleNormalRoughMetal)
-						constantSets.PushBack(m_GBuffer.m_NormalRoughMetal.m_SamplerConstantSet);
-					if (neededConstants & MaterialToRHI::NeedSampleDiffuse)
-						constantSets.PushBack(GBufferRT(SPassDescription::GBufferRT_Diffuse).m_SamplerConstantSet);
-				}
-				else
-				{
-					if (neededConstants & MaterialToRHI::NeedSampleDepth)
-						constantSets.PushBack(m_DummyWhiteConstantSet);
-					if (neededConstants & MaterialToRHI::NeedSampleNormalRoughMetal)
-						constantSets.PushBack(m_DummyBlackConstantSet);
-					if (neededConstants & MaterialToRHI::NeedSampleDiffuse)
-						constantSets.PushBack(m_DummyBlackConstantSet);
-				}
-				if (neededConstants & MaterialToRHI::NeedLightingInfo)
-				{
-					constantSets.PushBack(m_Lights.m_LightsInfoConstantSet);
-					if (renderPass == ParticlePass_OpaqueShadow)
-						constantSets.PushBack(m_Lights.m_DummyShadowsInfoConstantSet);
-					else
-						constantSets.PushBack(m_Lights.m_ShadowsInfoConstantSet);
-					constantSets.PushBack(m_BRDFLUTConstantSet);
-					const bool	envMapAffectsAmbient = (!m_EnvironmentMap.IsValid() || m_BackdropsData.m_EnvironmentMapPath.Empty()) ? false : m_BackdropsData.m_EnvironmentMapAffectsAmbient;
-					constantSets.PushBack(envMapAffectsAmbient ? m_EnvironmentMap.GetIBLCubemapConstantSet() : m_EnvironmentMap.GetWhiteEnvMapConstantSet());
-				}
-				if (neededConstants & MaterialToRHI::NeedAtlasInfo)
-				{
-					// If the atlas dimension is 1 * 1, it's null in the cache (see LoadRendererAtlas() in
-					// RHIGraphicResources) but the atlas feature is not disabled in the shader, so we load
-					// a valid 1 * 1 atlas definition.
-					if (cacheInstance->m_Atlas != null)
-						constantSets.PushBack(cacheInstance->m_Atlas->m_AtlasConstSet);
-					else
-						constantSets.PushBack(m_DummyAtlas.m_AtlasConstSet);
-				}
+	if (!queue.m_Queue.Sort())
+		CLog::Log(PK_ERROR, "Could not sort the particle render queue, draw-calls are rendered unsorted");
+	return true;
+}
+
+//----------------------------------------------------------------------------
+//
+//	Particle render queues prepared on the worker pool
+//
+//----------------------------------------------------------------------------
+
+void	CRHIParticleSceneRenderHelper::_PrepareParticleRenderQueues(const TArray<SRHIDrawCall>						&drawCalls,
+																	const TArray<u32>								*cameraVisibleDrawCalls,
+																	const TMemoryView<const TArray<u32>* const>	&shadowVisibleDrawCalls)
+{
+	PK_NAMEDSCOPEDPROFILE("Prepare particle render queues");
+	_ReleasePreparedRenderQueues();
+	if (!m_EnableParticleRender || drawCalls.Empty())
+		return;
+
+	// Same passes as the ones rendered by RenderScene(), the debug ones are always built on the render thread
+	for (u32 i = 0; i < shadowVisibleDrawCalls.Count(); ++i)
+		_AddPreparedRenderQueue(drawCalls, ParticlePass_OpaqueShadow, shadowVisibleDrawCalls[i]);
+	if ((m_InitializedRP & InitRP_GBuffer) != 0)
+	{
+		_AddPreparedRenderQueue(drawCalls, ParticlePass_Opaque, cameraVisibleDrawCalls);
+		_AddPreparedRenderQueue(drawCalls, ParticlePass_Decal, cameraVisibleDrawCalls);
+		_AddPreparedRenderQueue(drawCalls, ParticlePass_Lighting, null);
+	}
+	_AddPreparedRenderQueue(drawCalls, ParticlePass_Transparent, cameraVisibleDrawCalls);
+	if ((m_InitializedRP & InitRP_Distortion) != 0 && !m_EnableOverdrawRender)
+	{
+		ESampleLibGraphicResources_RenderPass	postDistortionPasses[] =
+		{
+			ParticlePass_Tint,
+			ParticlePass_TransparentPostDisto
+		};
+		if (PostFXEnabled_Distortion())
+			_AddPreparedRenderQueue(drawCalls, ParticlePass_Distortion, cameraVisibleDrawCalls);
+		_AddPreparedRenderQueue(drawCalls, postDistortionPasses, cameraVisibleDrawCalls);
+	}
+	if (m_PreparedRenderQueueCount <= 1)
+	{
+		// Not worth it, built when rendered
+		_ReleasePreparedRenderQueues();
+		return;
+	}
+
+	// Cache instances are resolved once on the render thread, the jobs only read them
+	if (!PK_VERIFY(m_DrawCallCacheInstances.Resize(drawCalls.Count())))
+	{
+		_ReleasePreparedRenderQueues();
+		return;
+	}
+	for (u32 i = 0; i < drawCalls.Count(); ++i)
+	{
+		CRendererCacheInstance_UpdateThread	*srcRendererCache = drawCalls[i].m_RendererCacheInstance.Get();
+		if (srcRendererCache != null)
+			m_DrawCallCacheInstances[i] = srcRendererCache->RenderThread_GetCacheInstance();
+		else
+		{
+			m_DrawCallCacheInstances[i] = null;
+			CLog::Log(PK_ERROR, "The renderer does not have a cache instance: some graphical resource creation must have failed");
+		}
+	}
 
-				if (neededConstants & MaterialToRHI::NeedDitheringPattern)
-					constantSets.PushBack(m_NoiseTexture.m_NoiseTextureConstantSet);
+	// Built by the worker pool and the render thread, that only waits for the queues being built by the helpers
+	RunParallelBatch(m_PreparedRenderQueueCount, FastDelegate<void(u32)>(this, &CRHIParticleSceneRenderHelper::_BuildPreparedRenderQueue));
 
-				constantSets.PushBack(sceneInfo == null ? m_SceneInfoConstantSet : sceneInfo);
+	// Missing render states are requested in the rendering order by the render thread:
+	// the queues are built again when rendered, as if they were not prepared.
+	for (u32 i = 0; i < m_PreparedRenderQueueCount; ++i)
+	{
+		if (m_PreparedRenderQueues[i].m_NeedsRenderStateRequests)
+		{
+			_ReleasePreparedRenderQueues();
+			return;
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+
+bool	CRHIParticleSceneRenderHelper::_AddPreparedRenderQueue(const TArray<SRHIDrawCall> &drawCalls, CRenderPassArray renderPasses, const TArray<u32> *visibleDrawCalls)
+{
+	// Shadow cascades are not culled when draw-call culling is disabled: they share the same queue
+	for (u32 i = 0; i < m_PreparedRenderQueueCount; ++i)
+	{
+		if (_SameRenderQueueInputs(m_PreparedRenderQueues[i], drawCalls, renderPasses, visibleDrawCalls))
+			return true;
+	}
+	if (m_PreparedRenderQueueCount == m_PreparedRenderQueues.Count() &&
+		!PK_VERIFY(m_PreparedRenderQueues.PushBack().Valid()))
+		return false;
+	SParticleRenderQueue	&queue = m_PreparedRenderQueues[m_PreparedRenderQueueCount++];
+	queue.m_DrawCalls = &drawCalls;
+	queue.m_VisibleDrawCalls = visibleDrawCalls;
+	queue.m_RenderPasses = renderPasses;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+void	CRHIParticleSceneRenderHelper::_BuildPreparedRenderQueue(u32 queueIdx)
+{
+	SParticleRenderQueue	&queue = m_PreparedRenderQueues[queueIdx];
+	if (!_BuildParticleRenderQueue(queue, false, true))
+		queue.m_DrawCalls = null; // Not reused, built again when rendered
+}
 
-				if (cacheInstance->m_ConstSet != null)
-					constantSets.PushBack(cacheInstance->m_ConstSet);
+//----------------------------------------------------------------------------
+
+void	CRHIParticleSceneRenderHelper::_ReleasePreparedRenderQueues()
+{
+	// Do not keep the render states and cache instances alive
+	for (u32 i = 0; i < m_PreparedRenderQueueCount; ++i)
+	{
+		m_PreparedRenderQueues[i].m_DrawCalls = null;
+		m_PreparedRenderQueues[i].m_Draws.Clear();
+	}
+	m_PreparedRenderQueueCount = 0;
+	m_DrawCallCacheInstances.Clear();
+}
+
+//----------------------------------------------------------------------------
+
+void	CRHIParticleSceneRenderHelper::_RenderParticles(bool											debugMode,
+														CRenderPassArray								renderPasses,
+														const TArray<SRHIDrawCall>						&drawCalls,
+														const RHI::PCommandBuffer						&cmdBuff,
+														const RHI::PConstantSet							&sceneInfo,
+														const TArray<u32>								*visibleDrawCalls,
+														SScreenRegion									*outScreenRegion)
+{
+	PK_SCOPEDPROFILE();
+
+	//------------------------------------------------------
+	// Find the prepared render queue, or build it:
+	//------------------------------------------------------
+	SParticleRenderQueue	*queue = null;
+	for (u32 i = 0; i < m_PreparedRenderQueueCount && !debugMode; ++i)
+	{
+		SParticleRenderQueue	&preparedQueue = m_PreparedRenderQueues[i];
+		if (_SameRenderQueueInputs(preparedQueue, drawCalls, renderPasses, visibleDrawCalls))
+		{
+			queue = &preparedQueue;
+			break;
+		}
+	}
+	if (queue == null)
+	{
+		queue = &m_RenderQueue;
+		queue->m_DrawCalls = &drawCalls;
+		queue->m_VisibleDrawCalls = visibleDrawCalls;
+		queue->m_RenderPasses = renderPasses;
+		if (!_BuildParticleRenderQueue(*queue, debugMode, false))
+		{
+			queue->m_Draws.Clear();
+			return;
+		}
+	}
+
+	//------------------------------------------------------
+	// Render the queue, skipping the redundant binds:
+	//------------------------------------------------------
+	RHI::PRenderState								renderState = null;
+	TStaticCountedArray<RHI::PConstantSet, 0x10>	boundConstantSets;
+	const SRHIDrawCall								*boundGeometry = null;
+
+	for (const CRenderQueue::SItem &item : queue->m_Queue.Items())
+	{
+		const SQueuedParticleDraw				&queuedDraw = queue->m_Draws[item.m_Index];
+		const SRHIDrawCall						&dc = drawCalls[queuedDraw.m_DrawCallIdx];
+		const ESampleLibGraphicResources_RenderPass	renderPass = queuedDraw.m_RenderPass;
+		const PCRendererCacheInstance			&cacheInstance = queuedDraw.m_CacheInstance;
+		const u32								neededConstants = queuedDraw.m_NeededConstants;
+		EShaderOptions							shaderOptions = static_cast<EShaderOptions>(dc.m_ShaderOptions);
+		const bool								isGeomShaderBB = !!(shaderOptions & Option_GeomBillboarding);
+		const bool								isVertexShaderBB =	(shaderOptions & Option_VertexBillboarding) ||
+																	(shaderOptions & Option_TriangleVertexBillboarding) ||
+																	(shaderOptions & Option_RibbonVertexBillboarding);
+		const bool								gpuStorage = (shaderOptions & PKSample::Option_GPUStorage) != 0;
+		const bool								GPUMesh = (shaderOptions & PKSample::Option_GPUMesh) != 0;
+
+		if (outScreenRegion != null)
+			outScreenRegion->Add(ProjectToScreenRegion(dc.m_BBox, m_SceneInfoData.m_ViewProj));
+
+		//------------------------------------------------------
+		// Bind render state and constants:
+		//------------------------------------------------------
+		if (renderState != queuedDraw.m_RenderState)
+		{
+			renderState = queuedDraw.m_RenderState;
+			cmdBuff->BindRenderState(renderState);
+			// Conservative: the bindings are not assumed to survive a render state change
+			boundConstantSets.Clear();
+			boundGeometry = null;
+		}
+
+		// First we add the scene info constant set and then the renderer cache constant sets:
+		TStaticCountedArray<RHI::PConstantSet, 0x10>	constantSets;
+		if (!debugMode)
+		{
+			PK_ASSERT(cacheInstance != null);
+			if ((m_InitializedRP & InitRP_GBuffer) != 0)
+			{
+				if (neededConstants & MaterialToRHI::NeedSampleDepth)
+					constantSets.PushBack(GBufferRT(SPassDescription::GBufferRT_Depth).m_SamplerConstantSet);
+				if (neededConstants & MaterialToRHI::NeedSampleNormalRoughMetal)
+					constantSets.PushBack(m_GBuffer.m_NormalRoughMetal.m_SamplerConstantSet);
+				if (neededConstants & MaterialToRHI::NeedSampleDiffuse)
+					constantSets.PushBack(GBufferRT(SPassDescription::GBufferRT_Diffuse).m_SamplerConstantSet);
 			}
 			else
 			{
-				constantSets.PushBack(sceneInfo == null ? m_SceneInfoConstantSet : sceneInfo);
+				if (neededConstants & MaterialToRHI::NeedSampleDepth)
+					constantSets.PushBack(m_DummyWhiteConstantSet);
+				if (neededConstants & MaterialToRHI::NeedSampleNormalRoughMetal)
+					constantSets.PushBack(m_DummyBlackConstantSet);
+				if (neededConstants & MaterialToRHI::NeedSampleDiffuse)
+					constantSets.PushBack(m_DummyBlackConstantSet);
 			}
-
-			if (isGeomShaderBB || isVertexShaderBB)
+			if (neededConstants & MaterialToRHI::NeedLightingInfo)
 			{
-				if (!gpuStorage)
-				{
-					PK_ASSERT(dc.m_UBSemanticsPtr[SRHIDrawCall::UBSemantic_GPUBillboard] != null);
+				constantSets.PushBack(m_Lights.m_LightsInfoConstantSet);
+				if (renderPass == ParticlePass_OpaqueShadow)
+					constantSets.PushBack(m_Lights.m_DummyShadowsInfoConstantSet);
+				else
+					constantSets.PushBack(m_Lights.m_ShadowsInfoConstantSet);
+				constantSets.PushBack(m_BRDFLUTConstantSet);
+				const bool	envMapAffectsAmbient = (!m_EnvironmentMap.IsValid() || m_BackdropsData.m_EnvironmentMapPath.Empty()) ? false : m_BackdropsData.m_EnvironmentMapAffectsAmbient;
+				constantSets.PushBack(envMapAffectsAmbient ? m_EnvironmentMap.GetIBLCubemapConstantSet() : m_EnvironmentMap.GetWhiteEnvMapConstantSet());
+			}
+			if (neededConstants & MaterialToRHI::NeedAtlasInfo)
+			{
+				// If the atlas dimension is 1 * 1, it's null in the cache (see LoadRendererAtlas() in
+				// RHIGraphicResources) but the atlas feature is not disabled in the shader, so we load
+				// a valid 1 * 1 atlas definition.
+				if (cacheInstance->m_Atlas != null)
+					constantSets.PushBack(cacheInstance->m_Atlas->m_AtlasConstSet);
+				else
+					constantSets.PushBack(m_DummyAtlas.m_AtlasConstSet);
+			}
 
-					// TODO: Fix this, we should avoid creating the constant set per draw call..
-					// But if disabled, artefacts on d3d12
-					PK_NAMEDSCOPEDPROFILE("Create constant set for draw requests");
-					RHI::PConstantSet	drawRequestsConstantSet = m_ApiManager->CreateConstantSet(RHI::SRHIResourceInfos("Draw Requests Constant Set"), SConstantDrawRequests::GetConstantSetLayout(dc.m_RendererType));
-					if (!PK_VERIFY(drawRequestsConstantSet != null))
-						return;
+			if (neededConstants & MaterialToRHI::NeedDitheringPattern)
+				constantSets.PushBack(m_NoiseTexture.m_NoiseTextureConstantSet);
 
-					drawRequestsConstantSet->SetConstants(dc.m_UBSemanticsPtr[SRHIDrawCall::UBSemantic_GPUBillboard], 0);
-					drawRequestsConstantSet->UpdateConstantValues();
-					constantSets.PushBack(drawRequestsConstantSet);
-				}
-				if (isVertexShaderBB)
-				{
-					if (debugMode)
-					{
-						if (!_BindDebugConstantSets(renderState, dc, constantSets))
-							return;
-					}
-					else
-					{
-						if (gpuStorage)
-						{
-							if (!PK_VERIFY(constantSets.PushBack(dc.m_GPUStorageOffsetsConstantSet).Valid()))
-								return;
-						}
-						// Full constant set (Positions, Sizes, .. All additional inputs)
-						if (!PK_VERIFY(constantSets.PushBack(dc.m_GPUStorageSimDataConstantSet).Valid()))
-							return;
-					}
-				}
+			constantSets.PushBack(sceneInfo == null ? m_SceneInfoConstantSet : sceneInfo);
+
+			if (cacheInstance->m_ConstSet != null)
+				constantSets.PushBack(cacheInstance->m_ConstSet);
+		}
+		else
+		{
+			constantSets.PushBack(sceneInfo == null ? m_SceneInfoConstantSet : sceneInfo);
+		}
+
+		if (isGeomShaderBB || isVertexShaderBB)
+		{
+			if (!gpuStorage)
+			{
+				PK_ASSERT(dc.m_UBSemanticsPtr[SRHIDrawCall::UBSemantic_GPUBillboard] != null);
+
+				// TODO: Fix this, we should avoid creating the constant set per draw call..
+				// But if disabled, artefacts on d3d12
+				PK_NAMEDSCOPEDPROFILE("Create constant set for draw requests");
+				RHI::PConstantSet	drawRequestsConstantSet = m_ApiManager->CreateConstantSet(RHI::SRHIResourceInfos("Draw Requests Constant Set"), SConstantDrawRequests::GetConstantSetLayout(dc.m_RendererType));
+				if (!PK_VERIFY(drawRequestsConstantSet != null))
+					return;
+
+				drawRequestsConstantSet->SetConstants(dc.m_UBSemanticsPtr[SRHIDrawCall::UBSemantic_GPUBillboard], 0);
+				drawRequestsConstantSet->UpdateConstantValues();
+				constantSets.PushBack(drawRequestsConstantSet);
 			}
-			else if (GPUMesh)
+			if (isVertexShaderBB)
 			{
 				if (debugMode)
 				{
@@ -1980,65 +2357,88 @@ void	CRHIParticleSceneRenderHelper::_RenderParticles(bool											debugMode,
 				}
 				else
 				{
-					if (!PK_VERIFY(constantSets.PushBack(dc.m_GPUStorageOffsetsConstantSet).Valid()))
-						return;
+					if (gpuStorage)
+					{
+						if (!PK_VERIFY(constantSets.PushBack(dc.m_GPUStorageOffsetsConstantSet).Valid()))
+							return;
+					}
 					// Full constant set (Positions, Sizes, .. All additional inputs)
 					if (!PK_VERIFY(constantSets.PushBack(dc.m_GPUStorageSimDataConstantSet).Valid()))
 						return;
 				}
 			}
+		}
+		else if (GPUMesh)
+		{
+			if (debugMode)
+			{
+				if (!_BindDebugConstantSets(renderState, dc, constantSets))
+					return;
+			}
+			else
+			{
+				if (!PK_VERIFY(constantSets.PushBack(dc.m_GPUStorageOffsetsConstantSet).Valid()))
+					return;
+				// Full constant set (Positions, Sizes, .. All additional inputs)
+				if (!PK_VERIFY(constantSets.PushBack(dc.m_GPUStorageSimDataConstantSet).Valid()))
+					return;
+			}
+		}
 
-			for (u32 i = 0; i < dc.m_PushConstants.Count(); ++i)
-				cmdBuff->PushConstant(&dc.m_PushConstants[i], i);
+		for (u32 i = 0; i < dc.m_PushConstants.Count(); ++i)
+			cmdBuff->PushConstant(&dc.m_PushConstants[i], i);
 
+		if (!_SameConstantSets(constantSets.View(), boundConstantSets.View()))
+		{
 			cmdBuff->BindConstantSets(constantSets.View());
+			boundConstantSets = constantSets;
+		}
 
-			//------------------------------------------------------
-			// Render
-			//------------------------------------------------------
-			if (dc.m_Batch != lastBatch || !dc.m_VertexOffsets.Empty())
-			{
-				if (dc.m_IndexBuffer != null)
-					cmdBuff->BindIndexBuffer(dc.m_IndexBuffer, 0, dc.m_IndexSize);
-
-				if (!debugMode)
-				{
-					// Takes all the generated vertex inputs:
-					cmdBuff->BindVertexBuffers(dc.m_VertexBuffers, dc.m_VertexOffsets);
-				}
-				else
-				{
-					_BindDebugVertexBuffer(dc, cmdBuff);
-				}
-				//lastBatch = dc->m_Batch; // Fixme
-			}
+		//------------------------------------------------------
+		// Render
+		//------------------------------------------------------
+		if (debugMode)
+		{
+			if (dc.m_IndexBuffer != null)
+				cmdBuff->BindIndexBuffer(dc.m_IndexBuffer, 0, dc.m_IndexSize);
+			_BindDebugVertexBuffer(dc, cmdBuff);
+		}
+		else if (boundGeometry == null || !_SameGeometryBindings(dc, *boundGeometry))
+		{
+			if (dc.m_IndexBuffer != null)
+				cmdBuff->BindIndexBuffer(dc.m_IndexBuffer, 0, dc.m_IndexSize);
+			// Takes all the generated vertex inputs:
+			cmdBuff->BindVertexBuffers(dc.m_VertexBuffers, dc.m_VertexOffsets);
+			boundGeometry = &dc;
+		}
 
-			// Draw:
-			if (dc.m_Type == SRHIDrawCall::DrawCall_Regular)
-			{
-				if (dc.m_IndexBuffer != null)
-					cmdBuff->DrawIndexed(dc.m_IndexOffset, dc.m_VertexOffset, dc.m_IndexCount);
-				else
-					cmdBuff->Draw(dc.m_VertexOffset, dc.m_VertexCount);
-			}
-			else if (dc.m_Type == SRHIDrawCall::DrawCall_IndexedInstanced)
-			{
-				cmdBuff->DrawIndexedInstanced(dc.m_IndexOffset, 0, dc.m_IndexCount, dc.m_InstanceCount);
-			}
-			else if (dc.m_Type == SRHIDrawCall::DrawCall_InstancedIndirect)
-			{
-				cmdBuff->DrawInstancedIndirect(dc.m_IndirectBuffer, dc.m_IndirectBufferOffset);
-			}
-			else if (dc.m_Type == SRHIDrawCall::DrawCall_IndexedInstancedIndirect)
-			{
-				cmdBuff->DrawIndexedInstancedIndirect(dc.m_IndirectBuffer, dc.m_IndirectBufferOffset);
-			}
+		// Draw:
+		if (dc.m_Type == SRHIDrawCall::DrawCall_Regular)
+		{
+			if (dc.m_IndexBuffer != null)
+				cmdBuff->DrawIndexed(dc.m_IndexOffset, dc.m_VertexOffset, dc.m_IndexCount);
 			else
-			{
-				PK_ASSERT_NOT_REACHED();
-			}
+				cmdBuff->Draw(dc.m_VertexOffset, dc.m_VertexCount);
+		}
+		else if (dc.m_Type == SRHIDrawCall::DrawCall_IndexedInstanced)
+		{
+			cmdBuff->DrawIndexedInstanced(dc.m_IndexOffset, 0, dc.m_IndexCount, dc.m_InstanceCount);
+		}
+		else if (dc.m_Type == SRHIDrawCall::DrawCall_InstancedIndirect)
+		{
+			cmdBuff->DrawInstancedIndirect(dc.m_IndirectBuffer, dc.m_IndirectBufferOffset);
+		}
+		else if (dc.m_Type == SRHIDrawCall::DrawCall_IndexedInstancedIndirect)
+		{
+			cmdBuff->DrawIndexedInstancedIndirect(dc.m_IndirectBuffer, dc.m_IndirectBufferOffset);
+		}
+		else
+		{
+			PK_ASSERT_NOT_REACHED();
 		}
 	}
+	// Do not keep the render states and cache instances alive (prepared queues are released by RenderScene())
+	m_RenderQueue.m_Draws.Clear();
 }
 
 //----------------------------------------------------------------------------
@@ -2338,12 +2738,18 @@ void	CRHIParticleSceneRenderHelper::_RenderBackground(const RHI::PCommandBuffer
 
 		infos->m_TopColor = clearOnly ? CFloat4(0.f, 0.f, 0.f, m_DeferredMergingMinAlpha) : CFloat4(ConvertSRGBToLinear(m_BackdropsData.m_BackgroundColorTop), m_DeferredMergingMinAlpha);
 		infos->m_BottomColor = clearOnly ? CFloat4(0.f, 0.f, 0.f, m_DeferredMergingMinAlpha) : CFloat4(ConvertSRGBToLinear(m_BackdropsData.m_BackgroundColorBottom), m_DeferredMergingMinAlpha);
+		if (m_BackgroundIsConstant && !clearOnly)
+		{
+			// Same output as copying a texture filled with that color
+			infos->m_TopColor = m_BackgroundConstantColor;
+			infos->m_BottomColor = m_BackgroundConstantColor;
+		}
 		infos->m_CameraPosition = m_SceneInfoData.m_InvView.WAxis();
 		CCoordinateFrame::BuildTransitionFrame(CCoordinateFrame::GlobalFrame(), Frame_RightHand_Y_Up, infos->m_UserToRHY);
 		infos->m_InvViewProj = m_SceneInfoData.m_InvViewProj;
 		infos->m_EnvironmentMapColor = CFloat4(ConvertSRGBToLinear(m_BackdropsData.m_EnvironmentMapColor) * m_BackdropsData.m_EnvironmentMapIntensity, 0);
 		infos->m_EnvironmentMapMipLvl = m_BackdropsData.m_EnvironmentMapBlur * m_EnvironmentMap.GetBackgroundMipmapCount();
-		const bool	envMapVisible = (!m_EnvironmentMap.IsValid() || m_BackdropsData.m_EnvironmentMapPath.Empty()) ? false : m_BackdropsData.m_BackgroundUsesEnvironmentMap;
+		const bool	envMapVisible = (!m_EnvironmentMap.IsValid() || m_BackdropsData.m_EnvironmentMapPath.Empty() || m_BackgroundIsConstant) ? false : m_BackdropsData.m_BackgroundUsesEnvironmentMap;
 		infos->m_EnvironmentMapVisible = clearOnly ? 0 : static_cast<u32>(envMapVisible);
 
 		m_ApiManager->UnmapCpuView(m_BrushInfoData);
@@ -2357,9 +2763,35 @@ void	CRHIParticleSceneRenderHelper::_RenderBackground(const RHI::PCommandBuffer
 
 //----------------------------------------------------------------------------
 
-void	CRHIParticleSceneRenderHelper::_UpdateShadowsBBox(CDirectionalShadows &shadow, const TArray<SRHIDrawCall> &drawCalls)
+SScreenRegion	CRHIParticleSceneRenderHelper::_BloomSourceRegion(const TArray<SRHIDrawCall> &drawCalls) const
+{
+	if (!m_EnablePostFXRegions)
+		return SScreenRegion::Full();
+
+	// Everything that is not a draw-call must stay black after the bright pass (see _RenderBackground()):
+	const bool	clearOnlyBackground = m_EnableOverdrawRender || !m_EnableBrushBackground;
+	if (!m_BackgroundIsConstant && !clearOnlyBackground)
+		return SScreenRegion::Full();
+	if (m_BackdropsData.m_ShowMesh || m_BackdropsData.m_ShowGrid ||
+		!m_MiscLinesOpaque_Position.Empty() || !m_MiscLinesAdditive_Position.Empty())
+		return SScreenRegion::Full();
+	const CFloat3	backgroundColor = clearOnlyBackground ? CFloat3(0.0f) : m_BackgroundConstantColor.xyz();
+	if (!m_Bloom.IsBelowBrightPass(backgroundColor))
+		return SScreenRegion::Full();
+
+	// All the draw-calls, not only the visible ones: lights and occluded draw-calls stay conservative
+	SScreenRegion	region;
+	for (u32 i = 0; i < drawCalls.Count() && !region.IsFull(); ++i)
+		region.Add(ProjectToScreenRegion(drawCalls[i].m_BBox, m_SceneInfoData.m_ViewProj));
+	return region;
+}
+
+//----------------------------------------------------------------------------
+
+void	CRHIParticleSceneRenderHelper::_UpdateShadowsBBox(CDirectionalShadows &shadow, const TArray<SRHIDrawCall> &drawCalls, const TArray<u32> *visibleDrawCalls)
 {
 	PK_SCOPEDPROFILE();
+	u32	visibleIdx = 0;
 	for (u32 dcIdx = 0; dcIdx < drawCalls.Count(); ++dcIdx)
 	{
 		u32										neededConstants = 0;
@@ -2367,6 +2799,7 @@ void	CRHIParticleSceneRenderHelper::_UpdateShadowsBBox(CDirectionalShadows &shad
 		RHI::PRenderState						newRenderState = null;
 		EShaderOptions							shaderOptions = static_cast<EShaderOptions>(drawCalls[dcIdx].m_ShaderOptions);
 		bool									castShadows = false;
+		bool									receiveShadows = false;
 
 		//------------------------------------------------------
 		// Retrieve renderer cache instance:
@@ -2381,14 +2814,29 @@ void	CRHIParticleSceneRenderHelper::_UpdateShadowsBBox(CDirectionalShadows &shad
 				{
 					const PRendererCache	layout = cacheInstance->m_Cache;
 					if (layout != null)
+					{
 						newRenderState = layout->GetRenderState(shaderOptions, ParticlePass_Opaque, &neededConstants);
+						// Only draw-calls actually rendered in the shadow maps are casters:
+						castShadows &= layout->GetRenderState(shaderOptions, ParticlePass_OpaqueShadow) != null;
+					}
 				}
 			}
 			else
 				CLog::Log(PK_ERROR, "The renderer does not have a cache instance: some graphical resource creation must have failed");
 		}
-		if (newRenderState != null)
-			shadow.AddBBox(drawCalls[dcIdx].m_BBox, CFloat4x4::IDENTITY, castShadows);
+		if (newRenderState == null)
+			continue;
+		// Only visible draw-calls are receivers (the visible list is sorted):
+		if (visibleDrawCalls != null)
+		{
+			while (visibleIdx < visibleDrawCalls->Count() && (*visibleDrawCalls)[visibleIdx] < dcIdx)
+				++visibleIdx;
+			receiveShadows = visibleIdx < visibleDrawCalls->Count() && (*visibleDrawCalls)[visibleIdx] == dcIdx;
+		}
+		else
+			receiveShadows = true;
+		if (castShadows || receiveShadows)
+			shadow.AddBBox(drawCalls[dcIdx].m_BBox, CFloat4x4::IDENTITY, castShadows, receiveShadows);
 	}
 }
 
@@ -3464,6 +3912,85 @@ void	CRHIParticleSceneRenderHelper::_FillFXAAInOut(CPostFxFXAA::SInOutRenderTarg
 
 //----------------------------------------------------------------------------
 
+bool	CRHIParticleSceneRenderHelper::PlanPostFxAliasing(u32 initRP, const CUint2 &frameBufferSize, CTransientRenderTargetAllocator &allocator, CGuid (&outAliasedStages)[__MaxPostFxStages])
+{
+	static const EInitRenderPasses	kStageRenderPasses[__MaxPostFxStages] = { InitRP_Distortion, InitRP_ToneMapping, InitRP_ColorRemap, InitRP_FXAA };
+	// All the post-FX stages output in full-screen RHI::FormatFloat16RGBA render targets, the distortion output is full-screen too
+	const u32						key = static_cast<u32>(RHI::FormatFloat16RGBA);
+	const u32						inputKey = static_cast<u32>(CPostFxDistortion::s_DistortionBufferFormat);
+	const u64						sizeInBytes = u64(frameBufferSize.x()) * frameBufferSize.y() * 4 * sizeof(u16);
+
+	CGuid	resources[__MaxPostFxStages];
+	allocator.Clear();
+	for (u32 stage = 0; stage < __MaxPostFxStages; ++stage)
+	{
+		outAliasedStages[stage].Clear();
+		// Not rendered, or directly rendered in the swap chain render targets
+		const u32	nextRenderPasses = (~0U) << (IntegerTools::Log2(static_cast<u32>(kStageRenderPasses[stage])) + 1);
+		if ((initRP & kStageRenderPasses[stage]) == 0 || (initRP & nextRenderPasses) == 0)
+			continue;
+		// With the bloom, the distortion output is in the before-bloom render pass: it cannot be written by the final render pass
+		if (stage == PostFxStage_Input && (initRP & InitRP_Bloom) != 0)
+			continue;
+		// Read by the next rendered stage, the output of the last one is read until the end of the frame by the debug passes
+		u32	lastPass = __MaxPostFxStages;
+		for (u32 nextStage = stage + 1; nextStage < __MaxPostFxStages && lastPass == __MaxPostFxStages; ++nextStage)
+		{
+			if ((initRP & kStageRenderPasses[nextStage]) != 0)
+				lastPass = nextStage;
+		}
+		resources[stage] = allocator.AddResource(stage == PostFxStage_Input ? inputKey : key, sizeInBytes, stage, lastPass);
+	}
+	if (!allocator.Allocate())
+		return false; // Nothing is aliased
+
+	for (u32 stage = 0; stage < __MaxPostFxStages; ++stage)
+	{
+		if (!resources[stage].Valid())
+			continue;
+		for (u32 prevStage = 0; prevStage < stage && !outAliasedStages[stage].Valid(); ++prevStage)
+		{
+			if (resources[prevStage].Valid() &&
+				allocator.PhysicalIndex(resources[prevStage]) == allocator.PhysicalIndex(resources[stage]))
+				outAliasedStages[stage] = prevStage;
+		}
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+void	CRHIParticleSceneRenderHelper::_AllocatePostFxRenderTargets(const CUint2 &frameBufferSize)
+{
+	PlanPostFxAliasing(m_InitializedRP, frameBufferSize, m_PostFxRenderTargets, m_PostFxAliasedStages);
+}
+
+//----------------------------------------------------------------------------
+
+SSamplableRenderTarget	*CRHIParticleSceneRenderHelper::_AliasedPostFxOutput(EPostFxStage stage, CGuid &outputIdx)
+{
+	if (!m_PostFxAliasedStages[stage].Valid())
+		return null;
+	const u32	aliasedStage = m_PostFxAliasedStages[stage];
+	switch (aliasedStage)
+	{
+	case PostFxStage_Input:
+		outputIdx = m_Distortion.m_OutputBufferIdx;
+		return &m_Distortion.m_OutputRenderTarget;
+	case PostFxStage_ToneMapping:
+		outputIdx = m_ToneMapping.m_OutputRenderTargetIdx;
+		return &m_ToneMapping.m_OutputRenderTarget;
+	case PostFxStage_ColorRemap:
+		outputIdx = m_ColorRemap.m_OutputRenderTargetIdx;
+		return &m_ColorRemap.m_OutputRenderTarget;
+	default:
+		PK_ASSERT_NOT_REACHED();
+		return null;
+	}
+}
+
+//----------------------------------------------------------------------------
+
 bool	CRHIParticleSceneRenderHelper::_IsLastRenderPass(EInitRenderPasses renderPass) const
 {
 	const u32	bitIdx = IntegerTools::Log2(static_cast<u32>(renderPass));
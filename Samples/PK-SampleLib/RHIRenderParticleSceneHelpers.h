@@ -4,6 +4,9 @@
 
 #include <pk_rhi/include/FwdInterfaces.h>
 #include <PK-SampleLib/RenderIntegrationRHI/RHITypePolicy.h>
+#include <PK-SampleLib/RenderIntegrationRHI/RHIDrawCallCulling.h>
+#include <PK-SampleLib/RenderIntegrationRHI/RHIRenderQueue.h>
+#include <PK-SampleLib/RenderIntegrationRHI/RHITransientRenderTargets.h>
 
 // Render passes:
 #include <PK-SampleLib/RenderPasses/GBuffer.h>
@@ -411,7 +414,27 @@ public:
 										CShaderLoader			*shaderLoader,
 										CResourceManager		*resourceManager,
 										u32						initRP = InitRP_All);
+	// Render passes of 'initRP' needed to render 'options': disabled post-FX are left out rather than drawn as plain copies.
+	// The distortion render pass is kept, it also renders the tint and post-distortion particles.
+	static u32					PlanRenderPasses(const SParticleSceneOptions &options, u32 initRP = InitRP_All);
+	u32							InitializedRenderPasses() const { return m_InitializedRP; }
 	bool						Resize(TMemoryView<const RHI::PRenderTarget> finalRts);
+	// Post-FX output render targets of the last Resize(): the ones with non-overlapping lifetimes share the same render target
+	const CTransientRenderTargetAllocator	&PostFxRenderTargets() const { return m_PostFxRenderTargets; }
+
+	// Post-FX stages of the final render pass, each one writes a render target only read by the next stage.
+	// PostFxStage_Input is the distortion output read by the first one, when they are in the same render pass (no bloom).
+	enum	EPostFxStage
+	{
+		PostFxStage_Input = 0,
+		PostFxStage_ToneMapping,
+		PostFxStage_ColorRemap,
+		PostFxStage_FXAA,
+		__MaxPostFxStages
+	};
+	// Records the lifetimes of the post-FX render targets of 'initRP' in 'allocator' and allocates them.
+	// 'outAliasedStages' receives the stage whose render target each stage writes into, invalid when the stage creates its own.
+	static bool					PlanPostFxAliasing(u32 initRP, const CUint2 &frameBufferSize, CTransientRenderTargetAllocator &allocator, CGuid (&outAliasedStages)[__MaxPostFxStages]);
 
 	bool						SetupPostFX_Distortion(const SParticleSceneOptions::SDistortion &config, bool firstInit);
 	bool						SetupPostFX_Bloom(const SParticleSceneOptions::SBloom &config, bool firstInit, bool swapChainChanged);
@@ -429,10 +452,26 @@ public:
 	bool						PostFXEnabled_ColorRemap() const { return m_EnablePostFX && m_EnableColorRemap; }
 	bool						PostFXEnabled_FXAA() const { return m_EnablePostFX && m_EnableFXAA; }
 
+	// Tone-mapping gamma: 1 when the final render target is sRGB (the GPU encodes when it stores), 2.2 otherwise.
+	// With 'fixedGamma', 2.2 whatever the final format: for hosts that pick the final format per frame and need the same tone on all of them.
+	// Takes effect on the next SetupPostFX_ToneMapping().
+	static float				ToneMappingGamma(RHI::EPixelFormat finalFormat, bool fixedGamma);
+	void						SetToneMappingFixedGamma(bool fixedGamma) { m_ToneMappingFixedGamma = fixedGamma; }
+
 	void						EnableBrushBackground(bool enabled) { m_EnableBrushBackground = enabled; }
 
 	void						SetDeferredMergingMinAlpha(float minAlpha) { m_DeferredMergingMinAlpha = minAlpha; }
 
+	// Draw-calls culling against the camera and the shadow cascades (enabled by default).
+	// Occlusion culling is optional: feed it a depth buffer (ie. the previous frame's) read back on the CPU.
+	void						EnableDrawCallCulling(bool enabled) { m_EnableDrawCallCulling = enabled; }
+	bool						SetOcclusionCullingDepth(const TMemoryView<const float> &depth, const CUint2 &size, const CFloat4x4 &viewProj) { return m_OcclusionCullingDepth.Build(depth, size, viewProj); }
+	void						ClearOcclusionCullingDepth() { m_OcclusionCullingDepth.Clear(); }
+
+	// Distortion blurs and bloom scissored around the projected bounds of the draw-calls (enabled by default).
+	// The bloom is only restricted when the rest of the frame is below its bright pass (constant background, no backdrop).
+	void						EnablePostFXRegions(bool enabled) { m_EnablePostFXRegions = enabled; }
+
 	bool						SetSceneInfo(const SSceneInfoData &sceneInfoData, ECoordinateFrame coordinateFrame);
 	bool						SetBackdropInfo(const SBackdropsData &backdropData, ECoordinateFrame coordinateFrame);
 	const SBackdropsData		&GetBackdropsInfo() const { return m_BackdropsData; }
@@ -442,6 +481,8 @@ public:
 
 	void						SetBackGroundColor(const CFloat3 &top, const CFloat3 &bottom);
 	void						SetBackGroundTexture(const RHI::PTexture &background);
+	// Uniform background (solid or empty compositing layer): drawn by the brush, no texture needed
+	void						SetBackGroundConstantColor(const CFloat4 &linearColor);
 	CGBuffer					&GetDeferredSetup();
 
 	RHI::PFrameBuffer			GetFinalFrameBuffers(u32 index) { return m_FinalFrameBuffers[index]; }
@@ -490,17 +531,22 @@ protected:
 										CRenderPassArray renderPass,
 										const TArray<SRHIDrawCall> &drawCalls,
 										const RHI::PCommandBuffer &cmdBuff,
-										const RHI::PConstantSet &sceneInfo = null);
+										const RHI::PConstantSet &sceneInfo = null,
+										const TArray<u32> *visibleDrawCalls = null,		// null: all the draw-calls
+										SScreenRegion *outScreenRegion = null);			// Adds the screen region of the rendered draw-calls
 	void			_RenderGridBackdrop(const RHI::PCommandBuffer &cmdBuff);
 	void			_RenderMeshBackdrop(const RHI::PCommandBuffer &cmdBuff);
 	void			_RenderEditorMisc(const RHI::PCommandBuffer &cmdBuff);
 	void			_RenderBackground(const RHI::PCommandBuffer &cmdBuff, bool clearOnly = false);
 
 	// Update Shadow BBox:
-	void			_UpdateShadowsBBox(CDirectionalShadows &shadow, const TArray<SRHIDrawCall> &drawCalls);
+	void			_UpdateShadowsBBox(CDirectionalShadows &shadow, const TArray<SRHIDrawCall> &drawCalls, const TArray<u32> *visibleDrawCalls);
 
 	RHI::PRenderTarget		_GetRenderTarget(ERenderTargetDebug target);
 
+	// Screen region of the bright pass inputs of the bloom
+	SScreenRegion			_BloomSourceRegion(const TArray<SRHIDrawCall> &drawCalls) const;
+
 	RHI::PApiManager				m_ApiManager;
 	CShaderLoader					*m_ShaderLoader;
 
@@ -522,6 +568,7 @@ protected:
 	bool							m_EnablePostFX;
 
 	float							m_DeferredMergingMinAlpha = 1.0f;
+	bool							m_ToneMappingFixedGamma = false;
 
 	// Default single sampler constant set layout to sample render targets:
 	RHI::SConstantSetLayout				m_DefaultSamplerConstLayout;
@@ -602,6 +649,9 @@ protected:
 	SSamplableRenderTarget			m_BeforeDebugOutputRt;
 	CGuid							m_BeforeDebugOutputRtIdx;
 
+	CTransientRenderTargetAllocator	m_PostFxRenderTargets;
+	CGuid							m_PostFxAliasedStages[__MaxPostFxStages];	// Stage whose output render target is reused, invalid when the stage creates its own
+
 	CGuid							m_ParticleDebugSubpassIdx;
 
 	CUint2							m_ViewportSize;
@@ -609,6 +659,53 @@ protected:
 	SSceneInfoData					m_SceneInfoData;			// Current scene info
 	ECoordinateFrame				m_CoordinateFrame;
 
+	// Draw-call culling:
+	bool							m_EnableDrawCallCulling;
+	bool							m_EnablePostFXRegions;
+	CDrawCallCuller					m_DrawCallCuller;
+	CHiZOcclusionBuffer				m_OcclusionCullingDepth;
+	TArray<u32>						m_CameraVisibleDrawCalls;
+	TStaticArray<TArray<u32>, 4>	m_ShadowVisibleDrawCalls;	// Per cascade
+
+	// Render queue, sorts the draw-calls in _RenderParticles():
+	struct	SQueuedParticleDraw
+	{
+		u32										m_DrawCallIdx;
+		ESampleLibGraphicResources_RenderPass	m_RenderPass;
+		RHI::PRenderState						m_RenderState;
+		PCRendererCacheInstance					m_CacheInstance;
+		u32										m_NeededConstants;
+	};
+	struct	SParticleRenderQueue
+	{
+		// Inputs: a queue is only reused by a _RenderParticles() call with the same ones
+		const TArray<SRHIDrawCall>		*m_DrawCalls;
+		const TArray<u32>				*m_VisibleDrawCalls;
+		CRenderPassArray				m_RenderPasses;
+		// Sorted draws:
+		CRenderQueue					m_Queue;
+		TArray<SQueuedParticleDraw>		m_Draws;
+		bool							m_NeedsRenderStateRequests;	// Prepared without some render states that must be requested on the render thread
+
+		SParticleRenderQueue() : m_DrawCalls(null), m_VisibleDrawCalls(null), m_NeedsRenderStateRequests(false) { }
+	};
+
+	// Builds the sorted queue of 'queue' inputs. When 'prepare' is true, can be called from a worker thread
+	// (the renderer cache instances must be resolved in m_DrawCallCacheInstances, and _CullParticleDraw() must be thread-safe).
+	bool			_BuildParticleRenderQueue(SParticleRenderQueue &queue, bool debugMode, bool prepare);
+	// Builds the render queues of the particle passes of the frame on the worker threads, before the command buffers are recorded
+	void			_PrepareParticleRenderQueues(	const TArray<SRHIDrawCall> &drawCalls,
+													const TArray<u32> *cameraVisibleDrawCalls,
+													const TMemoryView<const TArray<u32>* const> &shadowVisibleDrawCalls);
+	bool			_AddPreparedRenderQueue(const TArray<SRHIDrawCall> &drawCalls, CRenderPassArray renderPasses, const TArray<u32> *visibleDrawCalls);
+	void			_BuildPreparedRenderQueue(u32 queueIdx);
+	void			_ReleasePreparedRenderQueues();
+
+	SParticleRenderQueue			m_RenderQueue;					// Built by _RenderParticles() when not prepared
+	TArray<SParticleRenderQueue>	m_PreparedRenderQueues;			// Allocations kept from frame to frame
+	u32								m_PreparedRenderQueueCount;
+	TArray<PCRendererCacheInstance>	m_DrawCallCacheInstances;		// Resolved on the render thread before preparing the queues
+
 	// Backdrop data:
 	SBackdropsData					m_BackdropsData;
 
@@ -618,6 +715,8 @@ protected:
 
 	RHI::PTexture					m_BackgroundTexture;
 	RHI::PConstantSet				m_BackgroundTextureConstantSet;
+	bool							m_BackgroundIsConstant = false;
+	CFloat4							m_BackgroundConstantColor = CFloat4::ZERO;
 
 	PKSample::CEnvironmentMap		m_EnvironmentMap;
 
@@ -729,6 +828,10 @@ private:
 	void	_FillDebugInOut(SSamplableRenderTarget &prevPassOut, CGuid &prevPassOutIdx);
 	void	_FillFXAAInOut(CPostFxFXAA::SInOutRenderTargets &inOut);
 
+	void	_AllocatePostFxRenderTargets(const CUint2 &frameBufferSize);
+	// Output render target of an other stage reused by 'stage', null if it creates its own
+	SSamplableRenderTarget	*_AliasedPostFxOutput(EPostFxStage stage, CGuid &outputIdx);
+
 	bool	_IsLastRenderPass(EInitRenderPasses renderPass) const;
 	bool	_EndRenderPass(EInitRenderPasses renderPass, const RHI::PCommandBuffer &cmdBuff) const;
 
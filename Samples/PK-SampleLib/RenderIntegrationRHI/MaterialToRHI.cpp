@@ -1728,6 +1728,67 @@ namespace	MaterialToRHI
 		return true;
 	}
 
+	void	DigestShaderBindingsInputs(	const SPrepareArg	&args,
+										EShaderOptions		options,
+										CDigestMD5			&outDigest)
+	{
+		const SGenericArgs	genArgs(args);
+		CBufferDigesterMD5	digester;
+
+		const u32	header[] =
+		{
+			static_cast<u32>(options),
+			static_cast<u32>(genArgs.m_RendererType),
+			genArgs.m_FeaturesSettings.Count(),
+			genArgs.m_Properties.Count(),
+			genArgs.m_FieldDefinitions.Count(),
+		};
+		digester.Append(header, sizeof(header));
+
+		for (const SToggledRenderingFeature &feature : genArgs.m_FeaturesSettings)
+		{
+			const CRHIRenderingFeature	*settings = feature.m_Settings.Get();
+			const u32	featureData[] =
+			{
+				feature.m_FeatureName.Id(),
+				feature.m_Enabled ? 1U : 0U,
+				settings != null ? 1U : 0U,
+				settings != null ? (u32(settings->UseUV()) << 0) |
+								   (u32(settings->UseNormal()) << 1) |
+								   (u32(settings->UseTangent()) << 2) |
+								   (u32(settings->UseMeshUV1()) << 3) |
+								   (u32(settings->UseMeshVertexColor0()) << 4) |
+								   (u32(settings->UseMeshVertexColor1()) << 5) |
+								   (u32(settings->UseMeshVertexBonesIndicesAndWeights()) << 6) |
+								   (u32(settings->SampleDepth()) << 7) |
+								   (u32(settings->SampleNormalRoughMetal()) << 8) |
+								   (u32(settings->SampleDiffuse()) << 9) |
+								   (u32(settings->UseSceneLightingInfo()) << 10) : 0U,
+			};
+			digester.Append(featureData, sizeof(featureData));
+			if (settings != null)
+			{
+				for (const CString &propName : settings->PropertiesAsShaderConstants())
+				{
+					const u32	length = propName.Length();
+					digester.Append(&length, sizeof(length));
+					digester.Append(propName.Data(), length);
+				}
+			}
+		}
+		for (const SRendererFeaturePropertyValue &property : genArgs.m_Properties)
+		{
+			const u32	propertyData[] = { property.m_Name.Id(), static_cast<u32>(property.m_Type) };
+			digester.Append(propertyData, sizeof(propertyData));
+		}
+		for (const SRendererFeatureFieldDefinition &field : genArgs.m_FieldDefinitions)
+		{
+			const u32	fieldData[] = { field.m_Name.Id(), static_cast<u32>(field.m_Type) };
+			digester.Append(fieldData, sizeof(fieldData));
+		}
+		digester.Finalize(outDigest);
+	}
+
 	bool	MaterialFrontendToShaderBindings(	RHI::SShaderBindings				&outShaderBindings,
 												EComputeShaderType					computeShaderType)
 	{
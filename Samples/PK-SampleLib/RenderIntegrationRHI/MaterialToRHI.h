@@ -178,6 +178,12 @@ namespace	MaterialToRHI
 	bool			MaterialFrontendToShaderBindings(	RHI::SShaderBindings				&outShaderBindings,
 														EComputeShaderType					computeShaderType);
 
+	// Digest of everything MaterialFrontendToShaderBindings(args, ..., options) depends on.
+	// Property values are not part of the bindings: renderers sharing a material and its enabled features get the same digest.
+	void			DigestShaderBindingsInputs(			const SPrepareArg					&args,
+														EShaderOptions						options,
+														CDigestMD5							&outDigest);
+
 	CString			GetHashedShaderName(const char											*pathPrefix,
 										const char											*path,
 										const CString										&materialName,
@@ -21,6 +21,7 @@
 
 #include "PK-SampleLib/ShaderDefinitions/SampleLibShaderDefinitions.h"
 #include "PK-SampleLib/RenderIntegrationRHI/RendererCache.h"
+#include "PK-SampleLib/RenderIntegrationRHI/RHIGpuBufferPool.h"
 #include "RHIRenderIntegrationConfig.h"
 
 __PK_SAMPLE_API_BEGIN
@@ -155,18 +156,29 @@ static u32	_GetVertexRibbonShaderOptions(const Drawers::SRibbon_BillboardingRequ
 static bool	_CreateOrResizeGpuBufferIf(const RHI::SRHIResourceInfos &infos, bool condition, const RHI::PApiManager &manager, SGpuBuffer &buffer, RHI::EBufferType type, u32 sizeToAlloc, u32 requiredSize)
 {
 	PK_ASSERT(sizeToAlloc >= requiredSize);
-	if (!condition)
+	const u32					currentSize = buffer.m_Buffer != null ? buffer.m_Buffer->GetByteSize() : 0;
+	u32							allocSize = 0;
+	CRHIGpuBufferPool			&pool = CRHIGpuBufferPool::Instance();
+	switch (buffer.m_SizePolicy.Update(currentSize, condition, requiredSize, sizeToAlloc, allocSize))
+	{
+	case	SGpuBufferSizePolicy::Action_Keep:
+		if (condition)
+			buffer.Use();
 		return true;
-	if (buffer.m_Buffer == null || buffer.m_Buffer->GetByteSize() < requiredSize)
-	{
-		RHI::PGpuBuffer	gpuBuffer = manager->CreateGpuBuffer(infos, type, sizeToAlloc);
-		buffer.SetGpuBuffer(gpuBuffer);
-		if (!PK_VERIFY(gpuBuffer != null) ||
-			!PK_VERIFY(buffer.Used()))
-			return false;
+	case	SGpuBufferSizePolicy::Action_Release:
+		pool.Recycle(manager, type, buffer.m_Buffer);
+		buffer.m_Buffer = null;
+		buffer.Clear();
+		return true;
+	case	SGpuBufferSizePolicy::Action_Allocate:
+		break;
 	}
-	else
-		buffer.Use();
+	pool.Recycle(manager, type, buffer.m_Buffer);
+	RHI::PGpuBuffer	gpuBuffer = pool.Acquire(infos, manager, type, allocSize, requiredSize);
+	buffer.SetGpuBuffer(gpuBuffer);
+	if (!PK_VERIFY(gpuBuffer != null) ||
+		!PK_VERIFY(buffer.Used()))
+		return false;
 	return true;
 }
 
@@ -638,6 +650,7 @@ bool	CRHIRendererBatch_Billboard_CPUBB::EmitDrawCall(SRenderContext &ctx, const
 		outDrawCall.m_BBox = toEmit.m_BBox;
 		outDrawCall.m_TotalBBox = m_DrawPass->m_TotalBBox;
 		outDrawCall.m_SlicedDC = toEmit.m_TotalParticleCount != m_DrawPass->m_TotalParticleCount;
+		outDrawCall.m_EstimatedParticleCount = toEmit.m_TotalParticleCount;
 
 		outDrawCall.m_Valid =	rCacheInstance->m_Cache != null &&
 								rCacheInstance->m_Cache->GetRenderState(static_cast<PKSample::EShaderOptions>(outDrawCall.m_ShaderOptions)) != null;
@@ -1030,6 +1043,7 @@ bool	CRHIRendererBatch_Billboard_GeomBB::EmitDrawCall(SRenderContext &ctx, const
 		outDrawCall.m_BBox = toEmit.m_BBox;
 		outDrawCall.m_TotalBBox = m_DrawPass->m_TotalBBox;
 		outDrawCall.m_SlicedDC = toEmit.m_TotalParticleCount != m_DrawPass->m_TotalParticleCount;
+		outDrawCall.m_EstimatedParticleCount = toEmit.m_TotalParticleCount;
 
 		outDrawCall.m_Valid =	rCacheInstance->m_Cache != null &&
 								rCacheInstance->m_Cache->GetRenderState(static_cast<PKSample::EShaderOptions>(outDrawCall.m_ShaderOptions)) != null;
@@ -1416,6 +1430,7 @@ bool	CRHIRendererBatch_Billboard_VertexBB::EmitDrawCall(SRenderContext &ctx, con
 		outDrawCall.m_BBox = toEmit.m_BBox;
 		outDrawCall.m_TotalBBox = m_DrawPass->m_TotalBBox;
 		outDrawCall.m_SlicedDC = toEmit.m_TotalParticleCount != m_DrawPass->m_TotalParticleCount;
+		outDrawCall.m_EstimatedParticleCount = toEmit.m_TotalParticleCount;
 
 		outDrawCall.m_Valid =	rCacheInstance->m_Cache != null &&
 								rCacheInstance->m_Cache->GetRenderState(static_cast<PKSample::EShaderOptions>(outDrawCall.m_ShaderOptions)) != null;
@@ -1913,6 +1928,7 @@ bool	CRHIRendererBatch_Ribbon_CPU::EmitDrawCall(SRenderContext &ctx, const SDraw
 		outDrawCall.m_BBox = toEmit.m_BBox;
 		outDrawCall.m_TotalBBox = m_DrawPass->m_TotalBBox;
 		outDrawCall.m_SlicedDC = toEmit.m_TotalParticleCount != m_DrawPass->m_TotalParticleCount;
+		outDrawCall.m_EstimatedParticleCount = toEmit.m_TotalParticleCount;
 
 		outDrawCall.m_Valid =	rCacheInstance->m_Cache != null &&
 								rCacheInstance->m_Cache->GetRenderState(static_cast<PKSample::EShaderOptions>(outDrawCall.m_ShaderOptions)) != null;
@@ -2300,6 +2316,7 @@ bool	CRHIRendererBatch_Ribbon_VertexBB::EmitDrawCall(SRenderContext &ctx, const
 		outDrawCall.m_BBox = toEmit.m_BBox;
 		outDrawCall.m_TotalBBox = m_DrawPass->m_TotalBBox;
 		outDrawCall.m_SlicedDC = toEmit.m_TotalParticleCount != m_DrawPass->m_TotalParticleCount;
+		outDrawCall.m_EstimatedParticleCount = toEmit.m_TotalParticleCount;
 
 		outDrawCall.m_Valid =	rCacheInstance->m_Cache != null &&
 								rCacheInstance->m_Cache->GetRenderState(static_cast<PKSample::EShaderOptions>(outDrawCall.m_ShaderOptions)) != null;
@@ -2766,6 +2783,7 @@ bool	CRHIRendererBatch_Mesh_CPU::EmitDrawCall(SRenderContext &ctx, const SDrawCa
 			outDrawCall.m_BBox = toEmit.m_BBox;
 			outDrawCall.m_TotalBBox = m_DrawPass->m_TotalBBox;
 			outDrawCall.m_SlicedDC = toEmit.m_TotalParticleCount != m_DrawPass->m_TotalParticleCount;
+			outDrawCall.m_EstimatedParticleCount = perMeshParticleCount[iSubMesh];
 
 			outDrawCall.m_Valid =	rCacheInstance->m_Cache != null &&
 									rCacheInstance->m_Cache->GetRenderState(static_cast<PKSample::EShaderOptions>(outDrawCall.m_ShaderOptions)) != null;
@@ -3076,6 +3094,7 @@ bool	CRHIRendererBatch_Decal_CPU::EmitDrawCall(SRenderContext &ctx, const SDrawC
 	outDrawCall.m_Type = SRHIDrawCall::DrawCall_IndexedInstanced;
 	outDrawCall.m_ShaderOptions = PKSample::Option_VertexPassThrough;
 	outDrawCall.m_RendererType = Renderer_Decal;
+	outDrawCall.m_EstimatedParticleCount = toEmit.m_TotalParticleCount;
 
 	const Utils::GpuBufferViews		&bufferView = rCacheInstance->m_AdditionalGeometry->m_PerGeometryViews.First();
 
@@ -3404,6 +3423,7 @@ bool	CRHIRendererBatch_Triangle_CPUBB::EmitDrawCall(SRenderContext &ctx, const S
 		outDrawCall.m_BBox = toEmit.m_BBox;
 		outDrawCall.m_TotalBBox = m_DrawPass->m_TotalBBox;
 		outDrawCall.m_SlicedDC = toEmit.m_TotalParticleCount != m_DrawPass->m_TotalParticleCount;
+		outDrawCall.m_EstimatedParticleCount = toEmit.m_TotalParticleCount;
 
 		outDrawCall.m_Valid =	rCacheInstance->m_Cache != null &&
 								rCacheInstance->m_Cache->GetRenderState(static_cast<PKSample::EShaderOptions>(outDrawCall.m_ShaderOptions)) != null;
@@ -3697,6 +3717,7 @@ bool	CRHIRendererBatch_Triangle_VertexBB::EmitDrawCall(SRenderContext &ctx, cons
 		outDrawCall.m_BBox = toEmit.m_BBox;
 		outDrawCall.m_TotalBBox = m_DrawPass->m_TotalBBox;
 		outDrawCall.m_SlicedDC = toEmit.m_TotalParticleCount != m_DrawPass->m_TotalParticleCount;
+		outDrawCall.m_EstimatedParticleCount = toEmit.m_TotalParticleCount;
 
 		outDrawCall.m_Valid =	rCacheInstance->m_Cache != null &&
 								rCacheInstance->m_Cache->GetRenderState(static_cast<PKSample::EShaderOptions>(outDrawCall.m_ShaderOptions)) != null;
@@ -4017,6 +4038,7 @@ bool	CRHIRendererBatch_Light_CPU::EmitDrawCall(SRenderContext &ctx, const SDrawC
 		outDrawCall.m_BBox = toEmit.m_BBox;
 		outDrawCall.m_TotalBBox = m_DrawPass->m_TotalBBox;
 		outDrawCall.m_SlicedDC = toEmit.m_TotalParticleCount != m_DrawPass->m_TotalParticleCount;
+		outDrawCall.m_EstimatedParticleCount = toEmit.m_TotalParticleCount;
 	}
 
 	if (rCacheInstance->m_Cache == null)
@@ -36,6 +36,7 @@
 
 #include "PK-SampleLib/ShaderDefinitions/SampleLibShaderDefinitions.h"
 #include "PK-SampleLib/RenderIntegrationRHI/RendererCache.h"
+#include "PK-SampleLib/RenderIntegrationRHI/RHIGpuBufferPool.h"
 
 #include "RHIRenderIntegrationConfig.h"
 
@@ -200,18 +201,29 @@ static u32	_GetGeomBillboardShaderOptions(const Drawers::SBillboard_Billboarding
 static bool	_CreateOrResizeGpuBufferIf(const RHI::SRHIResourceInfos &infos, bool condition, const RHI::PApiManager &manager, SGpuBuffer &buffer, RHI::EBufferType type, u32 sizeToAlloc, u32 requiredSize)
 {
 	PK_ASSERT(sizeToAlloc >= requiredSize);
-	if (!condition)
+	const u32					currentSize = buffer.m_Buffer != null ? buffer.m_Buffer->GetByteSize() : 0;
+	u32							allocSize = 0;
+	CRHIGpuBufferPool			&pool = CRHIGpuBufferPool::Instance();
+	switch (buffer.m_SizePolicy.Update(currentSize, condition, requiredSize, sizeToAlloc, allocSize))
+	{
+	case	SGpuBufferSizePolicy::Action_Keep:
+		if (condition)
+			buffer.Use();
 		return true;
-	if (buffer.m_Buffer == null || buffer.m_Buffer->GetByteSize() < requiredSize)
-	{
-		RHI::PGpuBuffer	gpuBuffer = manager->CreateGpuBuffer(infos, type, sizeToAlloc);
-		buffer.SetGpuBuffer(gpuBuffer);
-		if (!PK_VERIFY(gpuBuffer != null) ||
-			!PK_VERIFY(buffer.Used()))
-			return false;
+	case	SGpuBufferSizePolicy::Action_Release:
+		pool.Recycle(manager, type, buffer.m_Buffer);
+		buffer.m_Buffer = null;
+		buffer.Clear();
+		return true;
+	case	SGpuBufferSizePolicy::Action_Allocate:
+		break;
 	}
-	else
-		buffer.Use();
+	pool.Recycle(manager, type, buffer.m_Buffer);
+	RHI::PGpuBuffer	gpuBuffer = pool.Acquire(infos, manager, type, allocSize, requiredSize);
+	buffer.SetGpuBuffer(gpuBuffer);
+	if (!PK_VERIFY(gpuBuffer != null) ||
+		!PK_VERIFY(buffer.Used()))
+		return false;
 	return true;
 }
 
@@ -24,42 +24,89 @@ const float	DebugColorGrey = 1.0f;
 const float	DebugColorWhite = 2.0f;
 const float	DebugColorRed = 3.0f;
 
-void	CBillboard_Exec_WireframeDiscard::operator()(const Drawers::SBillboard_ExecPage &batch)
-{
-	if (m_DstSelectedParticles.Empty())
-		return;
-
-	PK_NAMEDSCOPEDPROFILE("CustomTasks CBillboard_Exec_WireframeDiscard");
-
-	const u32	vertexPerParticle = batch.m_Billboarder->BillboardVertexCount();
-
-	const u32	outCount = batch.m_Page->RenderedParticleCount();
-
-	Mem::Clear(&m_DstSelectedParticles[batch.m_VertexOffset], sizeof(float) * outCount * vertexPerParticle);
+//----------------------------------------------------------------------------
 
-	TStridedMemoryView<const u8>	enableds = batch.m_Page->StreamForReading<bool>(batch.m_DrawRequest->BaseBillboardingRequest().m_EnabledStreamId);
-	const bool						hasEnabled = batch.m_DrawRequest->InputParticleCount() != batch.m_DrawRequest->RenderedParticleCount();
+namespace
+{
+	// Exclusive prefix-sum of the enabled flags of a page: the rendered index of the simulation particle 'i' is m_Offsets[i],
+	// so any selection range remaps in O(1) whatever the ranges order (disabled particles are not in the rendering buffers).
+	class	CEnabledPrefixSum
+	{
+	public:
+		bool	Build(const TStridedMemoryView<const u8> &enableds)
+		{
+			if (!m_Offsets.Empty())
+				return true; // Already built for this page
+			const u32	count = enableds.Count();
+			if (!m_Offsets.Resize(count + 1))
+				return false;
+			u32			*dst = m_Offsets.RawDataPointer();
+			u32			sum = 0;
+			if (enableds.Contiguous())
+			{
+				// Branchless, vectorized by the compiler
+				const u8	*src = enableds.Data();
+				for (u32 i = 0; i < count; ++i)
+				{
+					dst[i] = sum;
+					sum += (src[i] != 0) ? 1U : 0U;
+				}
+			}
+			else
+			{
+				for (u32 i = 0; i < count; ++i)
+				{
+					dst[i] = sum;
+					sum += (enableds[i] != 0) ? 1U : 0U;
+				}
+			}
+			dst[count] = sum;
+			return true;
+		}
 
-	if (batch.m_DrawRequest->RenderedParticleCount() == 0)
-		return;
+		void	Remap(u32 startId, u32 count, u32 &outStartId, u32 &outCount) const
+		{
+			const u32	maxId = m_Offsets.Count() - 1;
+			PK_ASSERT(startId + count <= maxId);
+			const u32	stopId = PKMin(startId + count, maxId);
+			startId = PKMin(startId, maxId);
+			outStartId = m_Offsets[startId];
+			outCount = m_Offsets[stopId] - outStartId;
+		}
 
-	CGuid	particleId_First;
+	private:
+		TArray<u32>		m_Offsets;
+	};
 
-	TMemoryView<const SMediumParticleSelection>	&srcSelection = m_SrcParticleSelected.m_AllParticleSelectionsView;
-	for (u32 i = 0; i < srcSelection.Count(); ++i)
+	//----------------------------------------------------------------------------
+
+	// Calls 'writeRange(rangeOut_startId, writeCount, isFocusedMedium)' for each selected range of the page, remapped
+	// from the particle ids in the simulation (in) to the particle ids in the rendering buffers (out).
+	// Returns the out id of the focused particle, if it is in this page.
+	template <typename _WriteRange>
+	CGuid	_ForEachSelectedRangeInPage(const SEffectParticleSelectionView	&selection,
+										const CParticleMedium				*medium,
+										u32									pageIdxInMedium,
+										const TStridedMemoryView<const u8>	&enableds,
+										bool								hasEnabled,
+										u32									outCount,
+										const _WriteRange					&writeRange)
 	{
-		if (batch.m_DrawRequest->BaseBillboardingRequest()._UnsafeMedium() == srcSelection[i].m_Medium)
+		CGuid				particleId_First;
+		CEnabledPrefixSum	enabledPrefixSum; // Built on the first range in this page, then shared by all the ranges
+
+		const TMemoryView<const SMediumParticleSelection>	&srcSelection = selection.m_AllParticleSelectionsView;
+		for (u32 i = 0; i < srcSelection.Count(); ++i)
 		{
+			if (medium != srcSelection[i].m_Medium)
+				continue;
 			PK_ASSERT(!srcSelection[i].m_Ranges.Empty());
-			// Remap the particle Id from the simulation (in) to the particle id in the rendering buffers (out)
-			u32		particleId_in = 0;
-			u32		particleId_out = 0;
 
 			u32		offset = 0;
 
 			for (u32 j = 0; j < srcSelection[i].m_Ranges.Count(); ++j)
 			{
-				if (batch.m_Page->PageIdxInMedium() == srcSelection[i].m_Ranges[j].m_PageId)
+				if (pageIdxInMedium == srcSelection[i].m_Ranges[j].m_PageId)
 				{
 					const u32	range_startId = srcSelection[i].m_Ranges[j].StartID();
 					const u32	range_count = srcSelection[i].m_Ranges[j].Count();
@@ -68,42 +115,55 @@ void	CBillboard_Exec_WireframeDiscard::operator()(const Drawers::SBillboard_Exec
 					u32		rangeOut_count = range_count;
 					if (hasEnabled)
 					{
-						if (particleId_in > range_startId) // restart over (when "m_Ranges" are not in ascending order)
-						{
-							particleId_in = 0;
-							particleId_out = 0;
-						}
-						while (particleId_in < range_startId)
-						{
-							if (enableds[particleId_in] != 0)
-								++particleId_out;
-							++particleId_in;
-						}
-						rangeOut_startId = particleId_out;
-						while (particleId_in < (range_startId + range_count))
-						{
-							if (enableds[particleId_in] != 0)
-								++particleId_out;
-							++particleId_in;
-						}
-						rangeOut_count = (particleId_out - rangeOut_startId);
+						if (!enabledPrefixSum.Build(enableds))
+							return particleId_First;
+						enabledPrefixSum.Remap(range_startId, range_count, rangeOut_startId, rangeOut_count);
 					}
 
 					if (rangeOut_count == 0)
 						continue; // TODO: if it goes here with j == 0, then the first particle won't be hightlighted ...
 
-					const bool	isFocusedMedium = (i == m_SrcParticleSelected.m_FocusedMedium);
+					const bool	isFocusedMedium = (i == selection.m_FocusedMedium);
 					if (isFocusedMedium && srcSelection[i].m_CurrentSelectedId - offset < rangeOut_count)
 						particleId_First = rangeOut_startId + srcSelection[i].m_CurrentSelectedId - offset;
 
 					PK_ASSERT(rangeOut_startId + rangeOut_count <= outCount); // issue with mismatching between the current frame processed from frame-collector and the editor's selection input.
 					const u32	writeCount = (rangeOut_startId < outCount) ? PKMin(rangeOut_count, outCount - rangeOut_startId) : 0;
-					Mem::Fill32(&m_DstSelectedParticles[batch.m_VertexOffset + rangeOut_startId * vertexPerParticle], bit_cast<u32>((!m_SrcParticleSelected.m_FocusedMedium.Valid() || isFocusedMedium) ? DebugColorWhite : DebugColorGrey), writeCount * vertexPerParticle);
+					writeRange(rangeOut_startId, writeCount, isFocusedMedium);
 				}
 				offset += srcSelection[i].m_Ranges[j].Count();
 			}
 		}
+		return particleId_First;
 	}
+}
+
+//----------------------------------------------------------------------------
+
+void	CBillboard_Exec_WireframeDiscard::operator()(const Drawers::SBillboard_ExecPage &batch)
+{
+	if (m_DstSelectedParticles.Empty())
+		return;
+
+	PK_NAMEDSCOPEDPROFILE("CustomTasks CBillboard_Exec_WireframeDiscard");
+
+	const u32	vertexPerParticle = batch.m_Billboarder->BillboardVertexCount();
+
+	const u32	outCount = batch.m_Page->RenderedParticleCount();
+
+	Mem::Clear(&m_DstSelectedParticles[batch.m_VertexOffset], sizeof(float) * outCount * vertexPerParticle);
+
+	TStridedMemoryView<const u8>	enableds = batch.m_Page->StreamForReading<bool>(batch.m_DrawRequest->BaseBillboardingRequest().m_EnabledStreamId);
+	const bool						hasEnabled = batch.m_DrawRequest->InputParticleCount() != batch.m_DrawRequest->RenderedParticleCount();
+
+	if (batch.m_DrawRequest->RenderedParticleCount() == 0)
+		return;
+
+	const CGuid	particleId_First = _ForEachSelectedRangeInPage(m_SrcParticleSelected, batch.m_DrawRequest->BaseBillboardingRequest()._UnsafeMedium(), batch.m_Page->PageIdxInMedium(), enableds, hasEnabled, outCount,
+		[&](u32 rangeOut_startId, u32 writeCount, bool isFocusedMedium)
+		{
+			Mem::Fill32(&m_DstSelectedParticles[batch.m_VertexOffset + rangeOut_startId * vertexPerParticle], bit_cast<u32>((!m_SrcParticleSelected.m_FocusedMedium.Valid() || isFocusedMedium) ? DebugColorWhite : DebugColorGrey), writeCount * vertexPerParticle);
+		});
 
 	if (particleId_First.Valid() && particleId_First < outCount)
 	{
@@ -130,68 +190,11 @@ void	CCopyStream_Exec_WireframeDiscard::operator()(const Drawers::SCopyStream_Ex
 	if (batch.m_DrawRequest->RenderedParticleCount() == 0)
 		return;
 
-	CGuid	particleId_First;
-
-	// Build the array of particle ranges for this page:
-	TMemoryView<const SMediumParticleSelection>	&srcSelection = m_SrcParticleSelected.m_AllParticleSelectionsView;
-	for (u32 i = 0; i < srcSelection.Count(); ++i)
-	{
-		if (batch.m_DrawRequest->BaseBillboardingRequest()._UnsafeMedium() == srcSelection[i].m_Medium)
+	const CGuid	particleId_First = _ForEachSelectedRangeInPage(m_SrcParticleSelected, batch.m_DrawRequest->BaseBillboardingRequest()._UnsafeMedium(), batch.m_Page->PageIdxInMedium(), enableds, hasEnabled, outCount,
+		[&](u32 rangeOut_startId, u32 writeCount, bool isFocusedMedium)
 		{
-			PK_ASSERT(!srcSelection[i].m_Ranges.Empty());
-			// Remap the particle Id from the simulation (in) to the particle id in the rendering buffers (out)
-			u32		particleId_in = 0;
-			u32		particleId_out = 0;
-
-			u32		offset = 0;
-
-			for (u32 j = 0; j < srcSelection[i].m_Ranges.Count(); ++j)
-			{
-				if (batch.m_Page->PageIdxInMedium() == srcSelection[i].m_Ranges[j].m_PageId)
-				{
-					const u32	range_startId = srcSelection[i].m_Ranges[j].StartID();
-					const u32	range_count = srcSelection[i].m_Ranges[j].Count();
-
-					u32		rangeOut_startId = range_startId;
-					u32		rangeOut_count = range_count;
-					if (hasEnabled)
-					{
-						if (particleId_in > range_startId) // restart over (when "m_Ranges" are not in ascending order)
-						{
-							particleId_in = 0;
-							particleId_out = 0;
-						}
-						while (particleId_in < range_startId)
-						{
-							if (enableds[particleId_in] != 0)
-								++particleId_out;
-							++particleId_in;
-						}
-						rangeOut_startId = particleId_out;
-						while (particleId_in < (range_startId + range_count))
-						{
-							if (enableds[particleId_in] != 0)
-								++particleId_out;
-							++particleId_in;
-						}
-						rangeOut_count = (particleId_out - rangeOut_startId);
-					}
-
-					if (rangeOut_count == 0)
-						continue; // TODO: if it goes here with j == 0, then the first particle won't be hightlighted ...
-
-					const bool	isFocusedMedium = (i == m_SrcParticleSelected.m_FocusedMedium);
-					if (isFocusedMedium && srcSelection[i].m_CurrentSelectedId - offset < rangeOut_count)
-						particleId_First = rangeOut_startId + srcSelection[i].m_CurrentSelectedId - offset;
-
-					PK_ASSERT(rangeOut_startId + rangeOut_count <= outCount); // issue with mismatching between the current frame processed from frame-collector and the editor's selection input.
-					const u32	writeCount = (rangeOut_startId < outCount) ? PKMin(rangeOut_count, outCount - rangeOut_startId) : 0;
-					Mem::Fill32(&m_DstSelectedParticles[batch.m_ParticleOffset + rangeOut_startId], bit_cast<u32>((!m_SrcParticleSelected.m_FocusedMedium.Valid() || isFocusedMedium) ? DebugColorWhite : DebugColorGrey), writeCount);
-				}
-				offset += srcSelection[i].m_Ranges[j].Count();
-			}
-		}
-	}
+			Mem::Fill32(&m_DstSelectedParticles[batch.m_ParticleOffset + rangeOut_startId], bit_cast<u32>((!m_SrcParticleSelected.m_FocusedMedium.Valid() || isFocusedMedium) ? DebugColorWhite : DebugColorGrey), writeCount);
+		});
 
 	if (particleId_First.Valid() && particleId_First < outCount)
 	{
@@ -400,67 +403,11 @@ void	CMesh_Exec_WireframeDiscard::operator()(const Drawers::SMesh_ExecPage &batc
 	{
 		Mem::Clear(&m_DstSelectedParticles[batch.m_ParticleOffset], sizeof(float) * outCount);
 
-		CGuid	particleId_First;
-
-		TMemoryView<const SMediumParticleSelection>	&srcSelection = m_SrcParticleSelected.m_AllParticleSelectionsView;
-		for (u32 i = 0; i < srcSelection.Count(); ++i)
-		{
-			if (batch.m_DrawRequest->BaseBillboardingRequest()._UnsafeMedium() == srcSelection[i].m_Medium)
+		const CGuid	particleId_First = _ForEachSelectedRangeInPage(m_SrcParticleSelected, batch.m_DrawRequest->BaseBillboardingRequest()._UnsafeMedium(), batch.m_Page->PageIdxInMedium(), enableds, hasEnabled, outCount,
+			[&](u32 rangeOut_startId, u32 writeCount, bool isFocusedMedium)
 			{
-				PK_ASSERT(!srcSelection[i].m_Ranges.Empty());
-				// Remap the particle Id from the simulation (in) to the particle id in the rendering buffers (out)
-				u32		particleId_in = 0;
-				u32		particleId_out = 0;
-
-				u32		offset = 0;
-
-				for (u32 j = 0; j < srcSelection[i].m_Ranges.Count(); ++j)
-				{
-					if (batch.m_Page->PageIdxInMedium() == srcSelection[i].m_Ranges[j].m_PageId)
-					{
-						const u32	range_startId = srcSelection[i].m_Ranges[j].StartID();
-						const u32	range_count = srcSelection[i].m_Ranges[j].Count();
-
-						u32		rangeOut_startId = range_startId;
-						u32		rangeOut_count = range_count;
-						if (hasEnabled)
-						{
-							if (particleId_in > range_startId) // restart over (when "m_Ranges" are not in ascending order)
-							{
-								particleId_in = 0;
-								particleId_out = 0;
-							}
-							while (particleId_in < range_startId)
-							{
-								if (enableds[particleId_in] != 0)
-									++particleId_out;
-								++particleId_in;
-							}
-							rangeOut_startId = particleId_out;
-							while (particleId_in < (range_startId + range_count))
-							{
-								if (enableds[particleId_in] != 0)
-									++particleId_out;
-								++particleId_in;
-							}
-							rangeOut_count = (particleId_out - rangeOut_startId);
-						}
-
-						if (rangeOut_count == 0)
-							continue; // TODO: if it goes here with j == 0, then the first particle won't be hightlighted ...
-
-						const bool	isFocusedMedium = (i == m_SrcParticleSelected.m_FocusedMedium);
-						if (isFocusedMedium && srcSelection[i].m_CurrentSelectedId - offset < rangeOut_count)
-							particleId_First = rangeOut_startId + srcSelection[i].m_CurrentSelectedId - offset;
-
-						PK_ASSERT(rangeOut_startId + rangeOut_count <= outCount); // issue with mismatching between the current frame processed from frame-collector and the editor's selection input.
-						const u32	writeCount = (rangeOut_startId < outCount) ? PKMin(rangeOut_count, outCount - rangeOut_startId) : 0;
-						Mem::Fill32(&m_DstSelectedParticles[batch.m_ParticleOffset + rangeOut_startId], bit_cast<u32>((!m_SrcParticleSelected.m_FocusedMedium.Valid() || isFocusedMedium) ? DebugColorWhite : DebugColorGrey), writeCount);
-					}
-					offset += srcSelection[i].m_Ranges[j].Count();
-				}
-			}
-		}
+				Mem::Fill32(&m_DstSelectedParticles[batch.m_ParticleOffset + rangeOut_startId], bit_cast<u32>((!m_SrcParticleSelected.m_FocusedMedium.Valid() || isFocusedMedium) ? DebugColorWhite : DebugColorGrey), writeCount);
+			});
 
 		if (particleId_First.Valid() && particleId_First < outCount)
 		{
@@ -479,67 +426,11 @@ void	CMesh_Exec_WireframeDiscard::operator()(const Drawers::SMesh_ExecPage &batc
 
 		TSemiDynamicArray<SRangeAndFocusedMedium, 0x100>	currentParticleRanges;  // 1kb of stack space ?!! I know we should hunt allocs down but isn't there a better way? that's pretty horrible
 
-		CGuid	particleId_First;
-
-		TMemoryView<const SMediumParticleSelection>	&srcSelection = m_SrcParticleSelected.m_AllParticleSelectionsView;
-		for (u32 i = 0; i < srcSelection.Count(); ++i)
-		{
-			if (batch.m_DrawRequest->BaseBillboardingRequest()._UnsafeMedium() == srcSelection[i].m_Medium)
+		const CGuid	particleId_First = _ForEachSelectedRangeInPage(m_SrcParticleSelected, batch.m_DrawRequest->BaseBillboardingRequest()._UnsafeMedium(), batch.m_Page->PageIdxInMedium(), enableds, hasEnabled, outCount,
+			[&](u32 rangeOut_startId, u32 writeCount, bool isFocusedMedium)
 			{
-				PK_ASSERT(!srcSelection[i].m_Ranges.Empty());
-				// Remap the particle Id from the simulation (in) to the particle id in the rendering buffers (out)
-				u32		particleId_in = 0;
-				u32		particleId_out = 0;
-
-				u32		offset = 0;
-
-				for (u32 j = 0; j < srcSelection[i].m_Ranges.Count(); ++j)
-				{
-					if (batch.m_Page->PageIdxInMedium() == srcSelection[i].m_Ranges[j].m_PageId)
-					{
-						const u32	range_startId = srcSelection[i].m_Ranges[j].StartID();
-						const u32	range_count = srcSelection[i].m_Ranges[j].Count();
-
-						u32		rangeOut_startId = range_startId;
-						u32		rangeOut_count = range_count;
-						if (hasEnabled)
-						{
-							if (particleId_in > range_startId) // restart over (when "m_Ranges" are not in ascending order)
-							{
-								particleId_in = 0;
-								particleId_out = 0;
-							}
-							while (particleId_in < range_startId)
-							{
-								if (enableds[particleId_in] != 0)
-									++particleId_out;
-								++particleId_in;
-							}
-							rangeOut_startId = particleId_out;
-							while (particleId_in < (range_startId + range_count))
-							{
-								if (enableds[particleId_in] != 0)
-									++particleId_out;
-								++particleId_in;
-							}
-							rangeOut_count = (particleId_out - rangeOut_startId);
-						}
-
-						if (rangeOut_count == 0)
-							continue; // TODO: if it goes here with j == 0, then the first particle won't be hightlighted ...
-
-						const bool	isFocusedMedium = (i == m_SrcParticleSelected.m_FocusedMedium);
-						if (isFocusedMedium && srcSelection[i].m_CurrentSelectedId - offset < rangeOut_count)
-							particleId_First = rangeOut_startId + srcSelection[i].m_CurrentSelectedId - offset;
-
-						PK_ASSERT(rangeOut_startId + rangeOut_count <= outCount); // issue with mismatching between the current frame processed from frame-collector and the editor's selection input.
-						const u32	writeCount = (rangeOut_startId < outCount) ? PKMin(rangeOut_count, outCount - rangeOut_startId) : 0;
-						currentParticleRanges.PushBack(SRangeAndFocusedMedium(SMediumParticleSelection::SRange(rangeOut_startId, writeCount), isFocusedMedium));
-					}
-					offset += srcSelection[i].m_Ranges[j].Count();
-				}
-			}
-		}
+				currentParticleRanges.PushBack(SRangeAndFocusedMedium(SMediumParticleSelection::SRange(rangeOut_startId, writeCount), isFocusedMedium));
+			});
 
 		// naive test
 		u32		currentParticleIdx = batch.m_ParticleOffset;
@@ -590,68 +481,11 @@ void CTriangle_Exec_WireframeDiscard::operator()(const Drawers::STriangle_ExecPa
 	if (batch.m_DrawRequest->RenderedParticleCount() == 0)
 		return;
 
-	CGuid	particleId_First;
-
-	// Build the array of particle ranges for this page:
-	TMemoryView<const SMediumParticleSelection>	&srcSelection = m_SrcParticleSelected.m_AllParticleSelectionsView;
-	for (u32 i = 0; i < srcSelection.Count(); ++i)
-	{
-		if (batch.m_DrawRequest->BaseBillboardingRequest()._UnsafeMedium() == srcSelection[i].m_Medium)
+	const CGuid	particleId_First = _ForEachSelectedRangeInPage(m_SrcParticleSelected, batch.m_DrawRequest->BaseBillboardingRequest()._UnsafeMedium(), batch.m_Page->PageIdxInMedium(), enableds, hasEnabled, outCount,
+		[&](u32 rangeOut_startId, u32 writeCount, bool isFocusedMedium)
 		{
-			PK_ASSERT(!srcSelection[i].m_Ranges.Empty());
-			// Remap the particle Id from the simulation (in) to the particle id in the rendering buffers (out)
-			u32		particleId_in = 0;
-			u32		particleId_out = 0;
-
-			u32		offset = 0;
-
-			for (u32 j = 0; j < srcSelection[i].m_Ranges.Count(); ++j)
-			{
-				if (batch.m_Page->PageIdxInMedium() == srcSelection[i].m_Ranges[j].m_PageId)
-				{
-					const u32	range_startId = srcSelection[i].m_Ranges[j].StartID();
-					const u32	range_count = srcSelection[i].m_Ranges[j].Count();
-
-					u32		rangeOut_startId = range_startId;
-					u32		rangeOut_count = range_count;
-					if (hasEnabled)
-					{
-						if (particleId_in > range_startId) // restart over (when "m_Ranges" are not in ascending order)
-						{
-							particleId_in = 0;
-							particleId_out = 0;
-						}
-						while (particleId_in < range_startId)
-						{
-							if (enableds[particleId_in] != 0)
-								++particleId_out;
-							++particleId_in;
-						}
-						rangeOut_startId = particleId_out;
-						while (particleId_in < (range_startId + range_count))
-						{
-							if (enableds[particleId_in] != 0)
-								++particleId_out;
-							++particleId_in;
-						}
-						rangeOut_count = (particleId_out - rangeOut_startId);
-					}
-
-					if (rangeOut_count == 0)
-						continue; // TODO: if it goes here with j == 0, then the first particle won't be hightlighted ...
-
-					const bool	isFocusedMedium = (i == m_SrcParticleSelected.m_FocusedMedium);
-					if (isFocusedMedium && srcSelection[i].m_CurrentSelectedId - offset < rangeOut_count)
-						particleId_First = rangeOut_startId + srcSelection[i].m_CurrentSelectedId - offset;
-
-					PK_ASSERT(rangeOut_startId + rangeOut_count <= outCount); // issue with mismatching between the current frame processed from frame-collector and the editor's selection input.
-					const u32	writeCount = (rangeOut_startId < outCount) ? PKMin(rangeOut_count, outCount - rangeOut_startId) : 0;
-					Mem::Fill32(&m_DstSelectedParticles[batch.m_VertexOffset + rangeOut_startId * 3], bit_cast<u32>((!m_SrcParticleSelected.m_FocusedMedium.Valid() || isFocusedMedium) ? DebugColorWhite : DebugColorGrey), writeCount * 3);
-				}
-				offset += srcSelection[i].m_Ranges[j].Count();
-			}
-		}
-	}
+			Mem::Fill32(&m_DstSelectedParticles[batch.m_VertexOffset + rangeOut_startId * 3], bit_cast<u32>((!m_SrcParticleSelected.m_FocusedMedium.Valid() || isFocusedMedium) ? DebugColorWhite : DebugColorGrey), writeCount * 3);
+		});
 
 	if (particleId_First.Valid() && particleId_First < outCount)
 	{
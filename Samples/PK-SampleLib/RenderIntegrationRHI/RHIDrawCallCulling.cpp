@@ -0,0 +1,307 @@
+//----------------------------------------------------------------------------
+// This program is the property of Persistant Studios SARL.
+//
+// You may not redistribute it and/or modify it under any conditions
+// without written permission from Persistant Studios SARL, unless
+// otherwise stated in the latest Persistant Studios Code License.
+//
+// See the Persistant Studios Code License for further details.
+//----------------------------------------------------------------------------
+
+#include "precompiled.h"
+
+#include "RHIDrawCallCulling.h"
+
+__PK_SAMPLE_API_BEGIN
+//----------------------------------------------------------------------------
+//
+//	SCullingFrustum
+//
+//----------------------------------------------------------------------------
+
+void	SCullingFrustum::SetupFromViewProj(const CFloat4x4 &viewProj, bool withNearPlane)
+{
+	// Row vectors: clip.c = dot(pos, column c)
+	const CFloat4x4	columns = viewProj.Transposed();
+	const CFloat4	&x = columns.XAxis();
+	const CFloat4	&y = columns.YAxis();
+	const CFloat4	&z = columns.ZAxis();
+	const CFloat4	&w = columns.WAxis();
+
+	m_PlaneCount = 0;
+	m_Planes[m_PlaneCount++] = w + x;	// Left
+	m_Planes[m_PlaneCount++] = w - x;	// Right
+	m_Planes[m_PlaneCount++] = w + y;	// Bottom
+	m_Planes[m_PlaneCount++] = w - y;	// Top
+	m_Planes[m_PlaneCount++] = w - z;	// Far
+	if (withNearPlane)
+		m_Planes[m_PlaneCount++] = w + z;
+}
+
+//----------------------------------------------------------------------------
+
+bool	SCullingFrustum::Touches(const CAABB &bbox) const
+{
+	if (!bbox.IsFinite() || !bbox.Valid())
+		return true;
+	const CFloat3	center = (bbox.Min() + bbox.Max()) * 0.5f;
+	const CFloat3	halfExtent = (bbox.Max() - bbox.Min()) * 0.5f;
+	for (u32 i = 0; i < m_PlaneCount; ++i)
+	{
+		const CFloat3	normal = m_Planes[i].xyz();
+		if (normal.Dot(center) + m_Planes[i].w() + PKAbs(normal).Dot(halfExtent) < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+//
+//	CHiZOcclusionBuffer
+//
+//----------------------------------------------------------------------------
+
+CHiZOcclusionBuffer::CHiZOcclusionBuffer()
+:	m_ViewProj(CFloat4x4::IDENTITY)
+{
+}
+
+//----------------------------------------------------------------------------
+
+CHiZOcclusionBuffer::~CHiZOcclusionBuffer()
+{
+}
+
+//----------------------------------------------------------------------------
+
+bool	CHiZOcclusionBuffer::Build(const TMemoryView<const float> &depth, const CUint2 &size, const CFloat4x4 &viewProj)
+{
+	Clear();
+	if (size.x() == 0 || size.y() == 0 || !PK_VERIFY(depth.Count() >= size.x() * size.y()))
+		return false;
+
+	// Compute the levels layout, down to 1x1:
+	u32		texelCount = 0;
+	CUint2	levelSize = size;
+	while (true)
+	{
+		if (!PK_VERIFY(m_Levels.PushBack().Valid()))
+		{
+			Clear();
+			return false;
+		}
+		SLevel	&level = m_Levels.Last();
+		level.m_Offset = texelCount;
+		level.m_Width = levelSize.x();
+		level.m_Height = levelSize.y();
+		texelCount += levelSize.x() * levelSize.y();
+		if (levelSize.x() == 1 && levelSize.y() == 1)
+			break;
+		levelSize = CUint2((levelSize.x() + 1) / 2, (levelSize.y() + 1) / 2);
+	}
+	if (!PK_VERIFY(m_Texels.Resize(texelCount)))
+	{
+		Clear();
+		return false;
+	}
+
+	Mem::Copy(m_Texels.RawDataPointer(), depth.Data(), size.x() * size.y() * sizeof(float));
+
+	// Each texel is the farthest depth of the (up to) 2x2 texels it covers in the previous level:
+	for (u32 iLevel = 1; iLevel < m_Levels.Count(); ++iLevel)
+	{
+		const SLevel	&src = m_Levels[iLevel - 1];
+		const SLevel	&dst = m_Levels[iLevel];
+		const float		*srcTexels = m_Texels.RawDataPointer() + src.m_Offset;
+		float			*dstTexels = m_Texels.RawDataPointer() + dst.m_Offset;
+		for (u32 y = 0; y < dst.m_Height; ++y)
+		{
+			const u32	y0 = y * 2;
+			const u32	y1 = PKMin(y0 + 1, src.m_Height - 1);
+			for (u32 x = 0; x < dst.m_Width; ++x)
+			{
+				const u32	x0 = x * 2;
+				const u32	x1 = PKMin(x0 + 1, src.m_Width - 1);
+				dstTexels[y * dst.m_Width + x] = PKMax(	PKMax(srcTexels[y0 * src.m_Width + x0], srcTexels[y0 * src.m_Width + x1]),
+														PKMax(srcTexels[y1 * src.m_Width + x0], srcTexels[y1 * src.m_Width + x1]));
+			}
+		}
+	}
+	m_ViewProj = viewProj;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+void	CHiZOcclusionBuffer::Clear()
+{
+	m_Texels.Clear();
+	m_Levels.Clear();
+}
+
+//----------------------------------------------------------------------------
+
+bool	CHiZOcclusionBuffer::Occludes(const CAABB &bbox) const
+{
+	if (!Valid() || !bbox.IsFinite() || !bbox.Valid())
+		return false;
+
+	// Screen rect and nearest depth of the bbox:
+	CFloat3	clipMin = CFloat3(TNumericTraits<float>::kMax);
+	CFloat3	clipMax = CFloat3(-TNumericTraits<float>::kMax);
+	for (u32 i = 0; i < 8; ++i)
+	{
+		const CFloat4	corner(	(i & 1) ? bbox.Max().x() : bbox.Min().x(),
+								(i & 2) ? bbox.Max().y() : bbox.Min().y(),
+								(i & 4) ? bbox.Max().z() : bbox.Min().z(),
+								1.0f);
+		const CFloat4	clipPos = m_ViewProj.TransformVector(corner);
+		if (clipPos.w() <= 1.0e-5f)
+			return false;
+		const CFloat3	ndc = clipPos.xyz() / clipPos.w();
+		clipMin = PKMin(clipMin, ndc);
+		clipMax = PKMax(clipMax, ndc);
+	}
+	if (clipMax.x() < -1.0f || clipMin.x() > 1.0f ||
+		clipMax.y() < -1.0f || clipMin.y() > 1.0f)
+		return false; // Not on screen, left to the frustum test
+
+	const SLevel	&level0 = m_Levels[0];
+	const float		width = static_cast<float>(level0.m_Width);
+	const float		height = static_cast<float>(level0.m_Height);
+	const u32		x0 = static_cast<u32>(PKMax(0.0f, PKMin(width - 1.0f, (clipMin.x() * 0.5f + 0.5f) * width)));
+	const u32		x1 = static_cast<u32>(PKMax(0.0f, PKMin(width - 1.0f, (clipMax.x() * 0.5f + 0.5f) * width)));
+	const u32		y0 = static_cast<u32>(PKMax(0.0f, PKMin(height - 1.0f, (0.5f - clipMax.y() * 0.5f) * height)));
+	const u32		y1 = static_cast<u32>(PKMax(0.0f, PKMin(height - 1.0f, (0.5f - clipMin.y() * 0.5f) * height)));
+
+	// Pick the level where the rect covers at most 3x3 texels:
+	u32	iLevel = 0;
+	while (iLevel + 1 < m_Levels.Count() &&
+		   ((x1 >> iLevel) - (x0 >> iLevel) > 2 || (y1 >> iLevel) - (y0 >> iLevel) > 2))
+		++iLevel;
+
+	const SLevel	&level = m_Levels[iLevel];
+	const float		*texels = m_Texels.RawDataPointer() + level.m_Offset;
+	float			farthestDepth = -TNumericTraits<float>::kMax;
+	for (u32 y = y0 >> iLevel; y <= (y1 >> iLevel); ++y)
+	{
+		for (u32 x = x0 >> iLevel; x <= (x1 >> iLevel); ++x)
+			farthestDepth = PKMax(farthestDepth, texels[y * level.m_Width + x]);
+	}
+	return clipMin.z() > farthestDepth;
+}
+
+//----------------------------------------------------------------------------
+//
+//	CDrawCallCuller
+//
+//----------------------------------------------------------------------------
+
+CDrawCallCuller::CDrawCallCuller()
+{
+}
+
+//----------------------------------------------------------------------------
+
+CDrawCallCuller::~CDrawCallCuller()
+{
+}
+
+//----------------------------------------------------------------------------
+
+bool	CDrawCallCuller::SetBBoxes(const TStridedMemoryView<const CAABB> &bboxes)
+{
+	const u32	count = bboxes.Count();
+	if (!PK_VERIFY(m_CenterX.Resize(count)) ||
+		!PK_VERIFY(m_CenterY.Resize(count)) ||
+		!PK_VERIFY(m_CenterZ.Resize(count)) ||
+		!PK_VERIFY(m_HalfExtentX.Resize(count)) ||
+		!PK_VERIFY(m_HalfExtentY.Resize(count)) ||
+		!PK_VERIFY(m_HalfExtentZ.Resize(count)) ||
+		!PK_VERIFY(m_Unbounded.Resize(count)) ||
+		!PK_VERIFY(m_Outside.Resize(count)) ||
+		!PK_VERIFY(m_BBoxes.Resize(count)))
+	{
+		m_CenterX.Clear();
+		return false;
+	}
+	for (u32 i = 0; i < count; ++i)
+	{
+		const CAABB	&bbox = bboxes[i];
+		const bool	unbounded = !bbox.IsFinite() || !bbox.Valid();
+		m_Unbounded[i] = unbounded ? 1 : 0;
+		m_BBoxes[i] = bbox;
+		if (unbounded)
+		{
+			m_CenterX[i] = m_CenterY[i] = m_CenterZ[i] = 0.0f;
+			m_HalfExtentX[i] = m_HalfExtentY[i] = m_HalfExtentZ[i] = 0.0f;
+			continue;
+		}
+		const CFloat3	center = (bbox.Min() + bbox.Max()) * 0.5f;
+		const CFloat3	halfExtent = (bbox.Max() - bbox.Min()) * 0.5f;
+		m_CenterX[i] = center.x();
+		m_CenterY[i] = center.y();
+		m_CenterZ[i] = center.z();
+		m_HalfExtentX[i] = halfExtent.x();
+		m_HalfExtentY[i] = halfExtent.y();
+		m_HalfExtentZ[i] = halfExtent.z();
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+bool	CDrawCallCuller::Cull(const SCullingFrustum &frustum, const CHiZOcclusionBuffer *occlusion, TArray<u32> &outVisible)
+{
+	outVisible.Clear();
+	const u32	count = BBoxCount();
+	if (count == 0)
+		return true;
+
+	const float	*centerX = m_CenterX.RawDataPointer();
+	const float	*centerY = m_CenterY.RawDataPointer();
+	const float	*centerZ = m_CenterZ.RawDataPointer();
+	const float	*halfExtentX = m_HalfExtentX.RawDataPointer();
+	const float	*halfExtentY = m_HalfExtentY.RawDataPointer();
+	const float	*halfExtentZ = m_HalfExtentZ.RawDataPointer();
+	u8			*outside = m_Outside.RawDataPointer();
+
+	Mem::Clear(outside, count);
+	for (u32 iPlane = 0; iPlane < frustum.m_PlaneCount; ++iPlane)
+	{
+		const CFloat4	&plane = frustum.m_Planes[iPlane];
+		const float		nx = plane.x();
+		const float		ny = plane.y();
+		const float		nz = plane.z();
+		const float		d = plane.w();
+		const float		ax = PKAbs(nx);
+		const float		ay = PKAbs(ny);
+		const float		az = PKAbs(nz);
+		// Branchless, one plane against all the bboxes:
+		for (u32 i = 0; i < count; ++i)
+		{
+			const float	dist = nx * centerX[i] + ny * centerY[i] + nz * centerZ[i] + d;
+			const float	radius = ax * halfExtentX[i] + ay * halfExtentY[i] + az * halfExtentZ[i];
+			outside[i] |= (dist + radius < 0.0f) ? 1 : 0;
+		}
+	}
+
+	if (!outVisible.Reserve(count))
+		return false;
+	const bool	testOcclusion = occlusion != null && occlusion->Valid();
+	for (u32 i = 0; i < count; ++i)
+	{
+		if (m_Unbounded[i] == 0)
+		{
+			if (outside[i] != 0)
+				continue;
+			if (testOcclusion && occlusion->Occludes(m_BBoxes[i]))
+				continue;
+		}
+		outVisible.PushBack(i);
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+__PK_SAMPLE_API_END
@@ -0,0 +1,100 @@
+#pragma once
+
+//----------------------------------------------------------------------------
+// This program is the property of Persistant Studios SARL.
+//
+// You may not redistribute it and/or modify it under any conditions
+// without written permission from Persistant Studios SARL, unless
+// otherwise stated in the latest Persistant Studios Code License.
+//
+// See the Persistant Studios Code License for further details.
+//----------------------------------------------------------------------------
+
+#include "PK-SampleLib/PKSample.h"
+
+__PK_SAMPLE_API_BEGIN
+//----------------------------------------------------------------------------
+//
+//	Draw-call culling: CPU only, no RHI dependency.
+//
+//----------------------------------------------------------------------------
+
+// Frustum planes extracted from a view-projection matrix (row vectors, clip = pos * viewProj).
+// A point is inside a plane when dot(plane.xyz, pos) + plane.w >= 0.
+struct	SCullingFrustum
+{
+	enum { kMaxPlanes = 6 };
+
+	CFloat4		m_Planes[kMaxPlanes];
+	u32			m_PlaneCount;
+
+	SCullingFrustum() : m_PlaneCount(0) { }
+
+	// 'withNearPlane' false for shadow cascades: casters between the light and the cascade still cast shadows.
+	// The near plane is z >= -w, which is conservative for both the [0, 1] and the [-1, 1] clip depth ranges.
+	void		SetupFromViewProj(const CFloat4x4 &viewProj, bool withNearPlane);
+	bool		Touches(const CAABB &bbox) const;
+};
+
+//----------------------------------------------------------------------------
+
+// Max-depth mip chain built from a depth buffer (usually the previous frame's), for conservative occlusion tests.
+// Depth values are the clip z / w of 'viewProj' (greater is farther), rows are top (clip y = +1) to bottom.
+class	CHiZOcclusionBuffer
+{
+public:
+	CHiZOcclusionBuffer();
+	~CHiZOcclusionBuffer();
+
+	bool		Build(const TMemoryView<const float> &depth, const CUint2 &size, const CFloat4x4 &viewProj);
+	void		Clear();
+	bool		Valid() const { return !m_Levels.Empty(); }
+
+	// True if the whole bbox is behind the depth buffer. Conservative: straddling the near plane is never occluded.
+	bool		Occludes(const CAABB &bbox) const;
+
+private:
+	struct	SLevel
+	{
+		u32		m_Offset;
+		u32		m_Width;
+		u32		m_Height;
+	};
+
+	TArray<float>						m_Texels;
+	TStaticCountedArray<SLevel, 16>		m_Levels;
+	CFloat4x4							m_ViewProj;
+};
+
+//----------------------------------------------------------------------------
+
+// Batched frustum (and optional occlusion) culling of the draw-call bboxes.
+// The bboxes are stored as structure of arrays once per frame, so that each plane test
+// runs as a branchless loop over all the draw-calls (vectorized by the compiler).
+// Invalid or infinite bboxes (bounds disabled) are never culled.
+class	CDrawCallCuller
+{
+public:
+	CDrawCallCuller();
+	~CDrawCallCuller();
+
+	bool		SetBBoxes(const TStridedMemoryView<const CAABB> &bboxes);
+	u32			BBoxCount() const { return m_CenterX.Count(); }
+
+	// Outputs the indices of the visible bboxes, in order
+	bool		Cull(const SCullingFrustum &frustum, const CHiZOcclusionBuffer *occlusion, TArray<u32> &outVisible);
+
+private:
+	TArray<float>		m_CenterX;
+	TArray<float>		m_CenterY;
+	TArray<float>		m_CenterZ;
+	TArray<float>		m_HalfExtentX;
+	TArray<float>		m_HalfExtentY;
+	TArray<float>		m_HalfExtentZ;
+	TArray<u8>			m_Unbounded;
+	TArray<u8>			m_Outside;		// Scratch, per bbox
+	TArray<CAABB>		m_BBoxes;		// For occlusion tests
+};
+
+//----------------------------------------------------------------------------
+__PK_SAMPLE_API_END
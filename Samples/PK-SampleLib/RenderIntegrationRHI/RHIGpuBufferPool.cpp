@@ -0,0 +1,132 @@
+//----------------------------------------------------------------------------
+// This program is the property of Persistant Studios SARL.
+//
+// You may not redistribute it and/or modify it under any conditions
+// without written permission from Persistant Studios SARL, unless
+// otherwise stated in the latest Persistant Studios Code License.
+//
+// See the Persistant Studios Code License for further details.
+//----------------------------------------------------------------------------
+
+#include "precompiled.h"
+
+#include "RHIGpuBufferPool.h"
+
+__PK_SAMPLE_API_BEGIN
+//----------------------------------------------------------------------------
+
+CRHIGpuBufferPool::CRHIGpuBufferPool()
+:	m_Frame(0)
+,	m_PooledBytes(0)
+,	m_ReuseCount(0)
+{
+}
+
+//----------------------------------------------------------------------------
+
+CRHIGpuBufferPool::~CRHIGpuBufferPool()
+{
+	// Clear() is called by CRendererCacheInstance_UpdateThread::RenderThread_DestroyAllResources(),
+	// the api managers might already be destroyed here.
+	PK_ASSERT(m_Buffers.Empty());
+}
+
+//----------------------------------------------------------------------------
+
+CRHIGpuBufferPool	&CRHIGpuBufferPool::Instance()
+{
+	static CRHIGpuBufferPool	pool;
+	return pool;
+}
+
+//----------------------------------------------------------------------------
+
+RHI::PGpuBuffer	CRHIGpuBufferPool::Acquire(const RHI::SRHIResourceInfos &infos, const RHI::PApiManager &manager, RHI::EBufferType type, u32 sizeToAlloc, u32 requiredSize)
+{
+	PK_ASSERT(sizeToAlloc >= requiredSize);
+	{
+		PK_SCOPEDLOCK(m_Lock);
+		// Best fit, do not hand out buffers much bigger than needed (that is what we are trying to avoid)
+		const u32	maxSize = sizeToAlloc * 2;
+		CGuid		bestIdx;
+		for (u32 i = 0; i < m_Buffers.Count(); ++i)
+		{
+			const SPooledBuffer	&pooled = m_Buffers[i];
+			if (pooled.m_Manager != manager ||
+				pooled.m_Type != type ||
+				pooled.m_ByteSize < requiredSize ||
+				pooled.m_ByteSize > maxSize ||
+				m_Frame - pooled.m_RecycledFrame < kReuseLatency)
+				continue;
+			if (!bestIdx.Valid() || pooled.m_ByteSize < m_Buffers[bestIdx].m_ByteSize)
+				bestIdx = i;
+		}
+		if (bestIdx.Valid())
+		{
+			RHI::PGpuBuffer	buffer = m_Buffers[bestIdx].m_Buffer;
+			_RemoveAt(bestIdx);
+			++m_ReuseCount;
+			return buffer;
+		}
+	}
+	return manager->CreateGpuBuffer(infos, type, sizeToAlloc);
+}
+
+//----------------------------------------------------------------------------
+
+void	CRHIGpuBufferPool::Recycle(const RHI::PApiManager &manager, RHI::EBufferType type, const RHI::PGpuBuffer &buffer)
+{
+	if (buffer == null || manager == null)
+		return;
+	PK_ASSERT(!buffer->IsMapped());
+	const u32	byteSize = buffer->GetByteSize();
+	if (byteSize > kMaxPooledBytes)
+		return; // Destroyed right away
+
+	PK_SCOPEDLOCK(m_Lock);
+	// Make room: drop the oldest buffers first
+	while (!m_Buffers.Empty() && m_PooledBytes + byteSize > kMaxPooledBytes)
+		_RemoveAt(0);
+
+	if (!m_Buffers.PushBack().Valid())
+		return;
+	SPooledBuffer	&pooled = m_Buffers.Last();
+	pooled.m_Buffer = buffer;
+	pooled.m_Manager = manager;
+	pooled.m_Type = type;
+	pooled.m_ByteSize = byteSize;
+	pooled.m_RecycledFrame = m_Frame;
+	m_PooledBytes += byteSize;
+}
+
+//----------------------------------------------------------------------------
+
+void	CRHIGpuBufferPool::RenderThread_NextFrame()
+{
+	PK_SCOPEDLOCK(m_Lock);
+	++m_Frame;
+	// Buffers are recycled in order: expired ones are at the front
+	while (!m_Buffers.Empty() && m_Frame - m_Buffers[0].m_RecycledFrame > kExpireFrames)
+		_RemoveAt(0);
+}
+
+//----------------------------------------------------------------------------
+
+void	CRHIGpuBufferPool::Clear()
+{
+	PK_SCOPEDLOCK(m_Lock);
+	m_Buffers.Clear();
+	m_PooledBytes = 0;
+}
+
+//----------------------------------------------------------------------------
+
+void	CRHIGpuBufferPool::_RemoveAt(u32 index)
+{
+	PK_ASSERT(m_PooledBytes >= m_Buffers[index].m_ByteSize);
+	m_PooledBytes -= m_Buffers[index].m_ByteSize;
+	m_Buffers.Remove_AndKeepOrder(index);
+}
+
+//----------------------------------------------------------------------------
+__PK_SAMPLE_API_END
@@ -0,0 +1,136 @@
+#pragma once
+
+//----------------------------------------------------------------------------
+// This program is the property of Persistant Studios SARL.
+//
+// You may not redistribute it and/or modify it under any conditions
+// without written permission from Persistant Studios SARL, unless
+// otherwise stated in the latest Persistant Studios Code License.
+//
+// See the Persistant Studios Code License for further details.
+//----------------------------------------------------------------------------
+
+#include "PK-SampleLib/PKSample.h"
+
+#include <pk_rhi/include/FwdInterfaces.h>
+#include <pk_rhi/include/interfaces/IApiManager.h>
+#include <pk_rhi/include/interfaces/IGpuBuffer.h>
+
+__PK_SAMPLE_API_BEGIN
+//----------------------------------------------------------------------------
+
+// Sizing policy of the billboarding batches gpu buffers, no RHI dependency.
+// - Buffers grow to the requested size.
+// - A buffer shrinks to the high-water mark of the last 'kShrinkWindow' frames it was used, if it stayed
+//   more than 'kShrinkRatio' times too big during the whole window (hysteresis, no grow/shrink ping-pong).
+// - A buffer not used for 'kReleaseAfterIdleFrames' frames is released.
+struct	SGpuBufferSizePolicy
+{
+	enum
+	{
+		kShrinkWindow = 240,
+		kShrinkRatio = 4,
+		kMinShrinkSize = 0x10000,	// Below this, keep the buffer as is
+		kReleaseAfterIdleFrames = 600,
+	};
+
+	enum	EAction
+	{
+		Action_Keep,
+		Action_Allocate,	// (re)allocate with the returned size
+		Action_Release,
+	};
+
+	u32		m_HighWaterMark;
+	u32		m_WindowFrames;
+	u32		m_IdleFrames;
+
+	SGpuBufferSizePolicy() : m_HighWaterMark(0), m_WindowFrames(0), m_IdleFrames(0) { }
+
+	// Called once per frame for each buffer. 'currentSize' is 0 if the buffer is not allocated.
+	EAction	Update(u32 currentSize, bool neededThisFrame, u32 requiredSize, u32 sizeToAlloc, u32 &outAllocSize)
+	{
+		PK_ASSERT(sizeToAlloc >= requiredSize);
+		if (!neededThisFrame)
+		{
+			if (currentSize == 0 || ++m_IdleFrames < kReleaseAfterIdleFrames)
+				return Action_Keep;
+			*this = SGpuBufferSizePolicy();
+			return Action_Release;
+		}
+		m_IdleFrames = 0;
+		if (currentSize < requiredSize)
+		{
+			m_HighWaterMark = sizeToAlloc;
+			m_WindowFrames = 0;
+			outAllocSize = sizeToAlloc;
+			return Action_Allocate;
+		}
+		m_HighWaterMark = PKMax(m_HighWaterMark, sizeToAlloc);
+		if (++m_WindowFrames < kShrinkWindow)
+			return Action_Keep;
+
+		const u32	highWaterMark = m_HighWaterMark;
+		m_HighWaterMark = 0;
+		m_WindowFrames = 0;
+		if (currentSize > kMinShrinkSize && currentSize / kShrinkRatio >= highWaterMark)
+		{
+			outAllocSize = highWaterMark;
+			return Action_Allocate;
+		}
+		return Action_Keep;
+	}
+};
+
+//----------------------------------------------------------------------------
+
+// Buffers dropped by a billboarding batch (grown, shrunk or released) are recycled here so that other batches
+// can reuse them instead of allocating new ones: a one-off burst in one batch does not pin its peak memory.
+// A recycled buffer is only handed out 'kReuseLatency' frames after being dropped (it can still be in flight),
+// and destroyed after 'kExpireFrames' frames or when the pool exceeds 'kMaxPooledBytes'.
+class	CRHIGpuBufferPool : public CNonCopyable
+{
+public:
+	enum
+	{
+		kReuseLatency = 3,
+		kExpireFrames = 120,
+		kMaxPooledBytes = 64 * 1024 * 1024,
+	};
+
+	CRHIGpuBufferPool();
+	~CRHIGpuBufferPool();
+
+	// Returns a recycled buffer of at least 'requiredSize' bytes (and at most twice 'sizeToAlloc'), or allocates 'sizeToAlloc' bytes
+	RHI::PGpuBuffer		Acquire(const RHI::SRHIResourceInfos &infos, const RHI::PApiManager &manager, RHI::EBufferType type, u32 sizeToAlloc, u32 requiredSize);
+	void				Recycle(const RHI::PApiManager &manager, RHI::EBufferType type, const RHI::PGpuBuffer &buffer);
+
+	void				RenderThread_NextFrame();
+	void				Clear();
+
+	u32					PooledBytes() const { return m_PooledBytes; }
+	u32					ReuseCount() const { return m_ReuseCount; }
+
+	static CRHIGpuBufferPool	&Instance();
+
+private:
+	struct	SPooledBuffer
+	{
+		RHI::PGpuBuffer			m_Buffer;
+		RHI::PApiManager		m_Manager;
+		RHI::EBufferType		m_Type;
+		u32						m_ByteSize;
+		u32						m_RecycledFrame;
+	};
+
+	void						_RemoveAt(u32 index);
+
+	Threads::CCriticalSection	m_Lock;	// Batches are allocated from worker threads
+	TArray<SPooledBuffer>		m_Buffers;
+	u32							m_Frame;
+	u32							m_PooledBytes;
+	u32							m_ReuseCount;
+};
+
+//----------------------------------------------------------------------------
+__PK_SAMPLE_API_END
@@ -30,6 +30,8 @@
 
 #include <pk_maths/include/pk_maths_simd.h>
 
+#include <pk_render_helpers/include/draw_requests/rh_job_pools.h>
+
 __PK_SAMPLE_API_BEGIN
 //----------------------------------------------------------------------------
 //
@@ -283,24 +285,113 @@ const TMemoryView<const RHI::EPixelFormat>	SPassDescription::s_GBufferDefaultFor
 
 //----------------------------------------------------------------------------
 //
-//	SRenderStateKey
+//	CShaderBindingsCache
 //
 //----------------------------------------------------------------------------
 
-PK_NOINLINE bool	SRenderStateKey::UpdateThread_Prepare(const SPrepareArg &args)
+bool	CShaderBindingsCache::FindOrBuild(const SPrepareArg &args, EShaderOptions options, SEntry *outEntry)
+{
+	CDigestMD5	key;
+	MaterialToRHI::DigestShaderBindingsInputs(args, options, key);
+	if (_Find(key, outEntry))
+		return true;
+
+	// Built outside of the lock: renderers are prepared concurrently (see SRendererCacheKey::UpdateThread_Prepare())
+	SEntry	entry;
+	if (!_Build(args, options, entry))
+		return false;
+	entry.m_Key = key;
+
+	PK_SCOPEDLOCK(m_Lock);
+	++m_MissCount;
+	bool	alreadyInserted = false;
+	for (const SEntry &other : m_Entries)
+	{
+		if (other.m_Key == key) // Built concurrently by another thread
+		{
+			alreadyInserted = true;
+			break;
+		}
+	}
+	if (!alreadyInserted)
+		PK_VERIFY(m_Entries.PushBack(entry).Valid());
+	if (outEntry != null)
+		*outEntry = entry;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+void	CShaderBindingsCache::Clear()
+{
+	PK_SCOPEDLOCK(m_Lock);
+	m_Entries.Clear();
+	m_HitCount = 0;
+	m_MissCount = 0;
+}
+
+//----------------------------------------------------------------------------
+
+bool	CShaderBindingsCache::_Find(const CDigestMD5 &key, SEntry *outEntry)
 {
+	PK_SCOPEDLOCK(m_Lock);
+	for (const SEntry &entry : m_Entries)
+	{
+		if (entry.m_Key == key)
+		{
+			++m_HitCount;
+			if (outEntry != null)
+				*outEntry = entry;
+			return true;
+		}
+	}
+	return false;
+}
+
+//----------------------------------------------------------------------------
+
+bool	CShaderBindingsCache::_Build(const SPrepareArg &args, EShaderOptions options, SEntry &outEntry)
+{
+	PK_NAMEDSCOPEDPROFILE("Build shader bindings");
 	// Create the shader bindings:
-	if (!MaterialToRHI::MaterialFrontendToShaderBindings(args, m_ShaderBindings, m_InputVertexBuffers, m_NeededConstants, m_RenderStateHash, m_Options))
+	if (!MaterialToRHI::MaterialFrontendToShaderBindings(args, outEntry.m_ShaderBindings, outEntry.m_InputVertexBuffers, outEntry.m_NeededConstants, outEntry.m_RenderStateHash, options))
 	{
 		CLog::Log(PK_ERROR, "MaterialToRHI::MaterialFrontendToShaderBindings failed");
 		return false;
 	}
 	// We generate dummy bindings for the shaders:
-	RHI::ShaderConstantBindingGenerator::GenerateBindingsForApi(RHI::GApi_OpenGL, m_ShaderBindings);
+	RHI::ShaderConstantBindingGenerator::GenerateBindingsForApi(RHI::GApi_OpenGL, outEntry.m_ShaderBindings);
 	for (u32 i = 0; i < RHI::ShaderStage_Count; ++i)
-		m_ShaderBindings.Hash(static_cast<RHI::EShaderStage>(i));
+		outEntry.m_ShaderBindings.Hash(static_cast<RHI::EShaderStage>(i));
 	// Reset the bindings after the hash:
-	RHI::ShaderConstantBindingGenerator::ResetBindings(m_ShaderBindings);
+	RHI::ShaderConstantBindingGenerator::ResetBindings(outEntry.m_ShaderBindings);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+//
+//	SRenderStateKey
+//
+//----------------------------------------------------------------------------
+
+CShaderBindingsCache	&SRenderStateKey::ShaderBindingsCache()
+{
+	static CShaderBindingsCache	cache;
+	return cache;
+}
+
+//----------------------------------------------------------------------------
+
+PK_NOINLINE bool	SRenderStateKey::UpdateThread_Prepare(const SPrepareArg &args)
+{
+	// Get the shader bindings (shared by all the renderers with the same material property set):
+	CShaderBindingsCache::SEntry	bindings;
+	if (!ShaderBindingsCache().FindOrBuild(args, m_Options, &bindings))
+		return false;
+	m_ShaderBindings = bindings.m_ShaderBindings;
+	m_InputVertexBuffers = bindings.m_InputVertexBuffers;
+	m_NeededConstants = bindings.m_NeededConstants;
+	m_RenderStateHash = bindings.m_RenderStateHash;
 
 	// Create the pipeline state:
 	m_PipelineState.m_DynamicScissor = true;
@@ -680,62 +771,35 @@ bool	SComputeStateKey::operator == (const SComputeStateKey &oth) const
 
 //----------------------------------------------------------------------------
 //
-//	SShaderModuleKey
+//	Shader byte code loading
 //
 //----------------------------------------------------------------------------
 
-bool	SShaderModuleKey::UpdateThread_Prepare(const SPrepareArg &args)
-{
-	(void)args;
-	return true;
-}
-
-//----------------------------------------------------------------------------
-
-RHI::PShaderModule	SShaderModuleKey::RenderThread_CreateResource(const SCreateArg &args)
+namespace
 {
-	if (m_Path.Empty())
-		return null;
-
-	TArray<IFileSystem*> controllers;
-	if (args.m_ResourceManagers.Empty())
-	{
-		controllers.PushBack(File::DefaultFileSystem());
-	}
-	else
+	bool	_ReadShaderByteCode(const TMemoryView<IFileSystem * const>	&controllers,
+								const CString							&path,
+								RHI::EGraphicalApi						graphicalApi,
+								PRefCountedMemoryBuffer					&outByteCode,
+								bool									&outPrecompiledExists)
 	{
-		for (u32 i = 0; i < args.m_ResourceManagers.Count(); i++)
-		{
-			controllers.PushBack (args.m_ResourceManagers[i]->FileController());
-		}
-	}
+		const CString	apiShaderPath = path + GetShaderExtensionStringFromApi(graphicalApi);
 
-	PRefCountedMemoryBuffer	byteCode;
-	RHI::EGraphicalApi		graphicalApi = args.m_ApiManager->ApiName();
-	const CString			ext = GetShaderExtensionStringFromApi(graphicalApi);
-#ifndef PK_RETAIL
-	const CString			shaderDebugName = CFilePath::ExtractFilename(m_Path);
-#else
-	const CString			shaderDebugName;
-#endif // ifndef PK_RETAIL
-	const CString			apiShaderPath = m_Path + ext;
-	bool					precompiledExists = true;
-
-	{
 		CLog::Log(PK_INFO, "Loading shader %s", apiShaderPath.Data());
 		PFileStream		fileView;
+		outPrecompiledExists = true;
 		for (auto controller : controllers)
 		{
-			precompiledExists = true;
+			outPrecompiledExists = true;
 			fileView = controller->OpenStream(apiShaderPath, IFileSystem::Access_Read);
 			if (fileView == null)
 			{
-				precompiledExists = false;
+				outPrecompiledExists = false;
 
 				// Metal: we want to keep the precompiled shader path for static editor shaders and samples but compile from source at runtime in editor.
 				if (graphicalApi == RHI::GApi_Metal)
 				{
-					const CString	apiShaderSourcePath = m_Path + GetShaderExtensionStringFromApi(graphicalApi, true);
+					const CString	apiShaderSourcePath = path + GetShaderExtensionStringFromApi(graphicalApi, true);
 
 					CLog::Log(PK_INFO, "Could not find precompiled shader '%s', will try to fallback on source '%s'", apiShaderPath.Data(), apiShaderSourcePath.Data());
 
@@ -747,7 +811,7 @@ RHI::PShaderModule	SShaderModuleKey::RenderThread_CreateResource(const SCreateAr
 					else
 					{
 						CLog::Log(PK_ERROR, "Could not load source shader file \"%s\"", apiShaderSourcePath.Data());
-						return null;
+						return false;
 					}
 				}
 			}
@@ -758,11 +822,224 @@ RHI::PShaderModule	SShaderModuleKey::RenderThread_CreateResource(const SCreateAr
 		if (fileView == null)
 		{
 			CLog::Log(PK_ERROR, "Could not load shader file \"%s\"", apiShaderPath.Data());
-			return null;
+			return false;
 		}
 
-		byteCode = fileView->BufferizeToRefCountedMemoryBuffer();
+		outByteCode = fileView->BufferizeToRefCountedMemoryBuffer();
 		fileView->Close();
+		return outByteCode != null;
+	}
+}
+
+//----------------------------------------------------------------------------
+//
+//	CShaderByteCodePrefetcher
+//
+//----------------------------------------------------------------------------
+
+class	CShaderByteCodeReadJob : public CAsynchronousJob
+{
+public:
+	CString					m_Path;
+	RHI::EGraphicalApi		m_Api;
+	IFileSystem				*m_Controller;
+
+	// Written by the worker thread, valid once m_Finished is triggered
+	PRefCountedMemoryBuffer	m_ByteCode;
+	bool					m_PrecompiledExists;
+	Threads::CEvent			m_Finished;
+
+	CShaderByteCodeReadJob() : m_Api(RHI::GApi_Null), m_Controller(null), m_PrecompiledExists(false) { }
+	~CShaderByteCodeReadJob() { }
+
+protected:
+	virtual void		_VirtualLaunch(Threads::SThreadContext &) override
+	{
+		PK_NAMEDSCOPEDPROFILE("Prefetch shader byte code");
+		IFileSystem	*controllers[] = { m_Controller };
+		if (!_ReadShaderByteCode(TMemoryView<IFileSystem * const>(controllers), m_Path, m_Api, m_ByteCode, m_PrecompiledExists))
+			m_ByteCode = null;
+		m_Finished.Trigger();
+	}
+};
+PK_DECLARE_REFPTRCLASS(ShaderByteCodeReadJob);
+
+//----------------------------------------------------------------------------
+
+CShaderByteCodePrefetcher::CShaderByteCodePrefetcher()
+{
+}
+
+//----------------------------------------------------------------------------
+
+CShaderByteCodePrefetcher::~CShaderByteCodePrefetcher()
+{
+	// Static destruction: the thread pool might already be destroyed, do not wait for pending jobs here.
+	// Clear() is called by CRendererCacheInstance_UpdateThread::RenderThread_DestroyAllResources()
+}
+
+//----------------------------------------------------------------------------
+
+void	CShaderByteCodePrefetcher::UpdateThread_Prefetch(const CString &path, RHI::EShaderStage stage, RHI::EGraphicalApi api, IFileSystem *controller)
+{
+	if (path.Empty() || controller == null)
+		return;
+
+	PShaderByteCodeReadJob	job;
+	{
+		PK_SCOPEDLOCK(m_Lock);
+		const SShaderModuleFileKey	key(path, stage, api);
+		u32							jobIdx = 0;
+		if (m_Index.Find(key, jobIdx))
+		{
+			if (m_Jobs[jobIdx] != null)
+				return; // Already in flight or waiting to be acquired
+		}
+		else
+		{
+			jobIdx = m_Jobs.Count();
+			if (!m_Jobs.PushBack().Valid() ||
+				!m_Index.Insert(key, jobIdx))
+				return;
+		}
+		job = PK_NEW(CShaderByteCodeReadJob);
+		if (!PK_VERIFY(job != null))
+			return;
+		job->m_Path = path;
+		job->m_Api = api;
+		job->m_Controller = controller;
+		m_Jobs[jobIdx] = job;
+	}
+	job->AddToPool(Scheduler::ThreadPool());
+	Scheduler::ThreadPool()->KickTasks(true);
+}
+
+//----------------------------------------------------------------------------
+
+bool	CShaderByteCodePrefetcher::RenderThread_Acquire(const CString			&path,
+														RHI::EShaderStage		stage,
+														RHI::EGraphicalApi		api,
+														PRefCountedMemoryBuffer	&outByteCode,
+														bool					&outPrecompiled)
+{
+	PShaderByteCodeReadJob	job;
+	{
+		PK_SCOPEDLOCK(m_Lock);
+		u32	jobIdx = 0;
+		if (!m_Index.Find(SShaderModuleFileKey(path, stage, api), jobIdx) || m_Jobs[jobIdx] == null)
+			return false;
+		job = m_Jobs[jobIdx];
+		if (job->m_Path != path) // Path hash collision
+			return false;
+		m_Jobs[jobIdx] = null;
+	}
+	{
+		PK_NAMEDSCOPEDPROFILE("Wait prefetched shader byte code");
+		job->m_Finished.Wait();
+	}
+	outByteCode = job->m_ByteCode;
+	outPrecompiled = job->m_PrecompiledExists;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+void	CShaderByteCodePrefetcher::Discard(const CString &path, RHI::EShaderStage stage, RHI::EGraphicalApi api)
+{
+	PShaderByteCodeReadJob	job;
+	{
+		PK_SCOPEDLOCK(m_Lock);
+		u32	jobIdx = 0;
+		if (!m_Index.Find(SShaderModuleFileKey(path, stage, api), jobIdx) || m_Jobs[jobIdx] == null)
+			return;
+		job = m_Jobs[jobIdx];
+		m_Jobs[jobIdx] = null;
+	}
+	job->m_Finished.Wait(); // Do not leave a job reading a file that is about to change
+}
+
+//----------------------------------------------------------------------------
+
+void	CShaderByteCodePrefetcher::Clear()
+{
+	TArray<PShaderByteCodeReadJob>	jobs;
+	{
+		PK_SCOPEDLOCK(m_Lock);
+		jobs = m_Jobs;
+		m_Jobs.Clear();
+		m_Index.Clear();
+	}
+	// Jobs reference file controllers which can be destroyed after this call
+	for (const PShaderByteCodeReadJob &job : jobs)
+	{
+		if (job != null)
+			job->m_Finished.Wait();
+	}
+}
+
+//----------------------------------------------------------------------------
+//
+//	SShaderModuleKey
+//
+//----------------------------------------------------------------------------
+
+CShaderByteCodePrefetcher	&SShaderModuleKey::ByteCodePrefetcher()
+{
+	static CShaderByteCodePrefetcher	prefetcher;
+	return prefetcher;
+}
+
+//----------------------------------------------------------------------------
+
+bool	SShaderModuleKey::UpdateThread_Prepare(const SPrepareArg &args)
+{
+	// Effect is loading: start reading the byte code now, the render thread will create the module later
+	IFileSystem	*controller = args.m_ResourceManager != null ? args.m_ResourceManager->FileController() : File::DefaultFileSystem();
+	if (args.m_ApiName != RHI::GApi_Null)
+		ByteCodePrefetcher().UpdateThread_Prefetch(m_Path, m_Stage, args.m_ApiName, controller);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+RHI::PShaderModule	SShaderModuleKey::RenderThread_CreateResource(const SCreateArg &args)
+{
+	return _RenderThread_CreateResource(args, true);
+}
+
+//----------------------------------------------------------------------------
+
+RHI::PShaderModule	SShaderModuleKey::_RenderThread_CreateResource(const SCreateArg &args, bool usePrefetched)
+{
+	if (m_Path.Empty())
+		return null;
+
+	PRefCountedMemoryBuffer	byteCode;
+	RHI::EGraphicalApi		graphicalApi = args.m_ApiManager->ApiName();
+#ifndef PK_RETAIL
+	const CString			shaderDebugName = CFilePath::ExtractFilename(m_Path);
+#else
+	const CString			shaderDebugName;
+#endif // ifndef PK_RETAIL
+	bool					precompiledExists = true;
+
+	if (!usePrefetched ||
+		!ByteCodePrefetcher().RenderThread_Acquire(m_Path, m_Stage, graphicalApi, byteCode, precompiledExists))
+	{
+		TArray<IFileSystem*> controllers;
+		if (args.m_ResourceManagers.Empty())
+		{
+			controllers.PushBack(File::DefaultFileSystem());
+		}
+		else
+		{
+			for (u32 i = 0; i < args.m_ResourceManagers.Count(); i++)
+			{
+				controllers.PushBack (args.m_ResourceManagers[i]->FileController());
+			}
+		}
+		if (!_ReadShaderByteCode(controllers.View(), m_Path, graphicalApi, byteCode, precompiledExists))
+			return null;
 	}
 	if (byteCode == null)
 		return null;
@@ -803,7 +1080,9 @@ RHI::PShaderModule	SShaderModuleKey::RenderThread_CreateResource(const SCreateAr
 
 RHI::PShaderModule	SShaderModuleKey::RenderThread_ReloadResource(const SCreateArg &args)
 {
-	return RenderThread_CreateResource(args);
+	// The file changed on disk: any prefetched byte code is stale
+	ByteCodePrefetcher().Discard(m_Path, m_Stage, args.m_ApiManager->ApiName());
+	return _RenderThread_CreateResource(args, false);
 }
 
 //----------------------------------------------------------------------------
@@ -1490,6 +1769,27 @@ RHI::PRenderState	CRendererCache::GetRenderState(EShaderOptions option, ESampleL
 
 //----------------------------------------------------------------------------
 
+RHI::PRenderState	CRendererCache::FindRenderState(EShaderOptions option, ESampleLibGraphicResources_RenderPass renderPass, u32 *neededConstants, bool *outNeedsRequest) const
+{
+	*outNeedsRequest = false;
+	for (u32 i = 0; i < m_RenderStates.Count(); ++i)
+	{
+		if (m_RenderStates[i].m_Options == option)
+		{
+			if (renderPass == __MaxParticlePass || m_RenderStates[i].m_RenderPassIdx == renderPass)
+			{
+				if (neededConstants != null)
+					*neededConstants = m_RenderStates[i].m_NeededConstants;
+				*outNeedsRequest = m_RenderStates[i].m_RenderState == null && !m_RenderStates[i].m_Expected;
+				return m_RenderStates[i].m_RenderState;
+			}
+		}
+	}
+	return null;
+}
+
+//----------------------------------------------------------------------------
+
 RHI::PComputeState	CRendererCache::GetComputeState(EComputeShaderType type)
 {
 	for (u32 i = 0; i < m_ComputeStates.Count(); ++i)
@@ -1523,6 +1823,39 @@ bool	CRendererCache::GetGPUStorageConstantSets(EShaderOptions option, const RHI:
 	return false;
 }
 
+//----------------------------------------------------------------------------
+//
+//	Shader bindings batch: builds the shader bindings of all the render states of a renderer cache on the worker pool
+//
+//----------------------------------------------------------------------------
+
+// Items are processed by RunParallelBatch() on the worker pool and on the thread preparing the renderer cache,
+// the prepare args and the options are only read while _WarmShaderBindingsCache() waits for them.
+struct	SShaderBindingsBatch
+{
+	const SPrepareArg					*m_Args;
+	TMemoryView<const EShaderOptions>	m_Options;
+
+	void		BuildItem(u32 itemIdx)
+	{
+		// Failures are not reported here: UpdateThread_Prepare() will try again and log the error
+		SRenderStateKey::ShaderBindingsCache().FindOrBuild(*m_Args, m_Options[itemIdx], null);
+	}
+};
+
+//----------------------------------------------------------------------------
+
+static void	_WarmShaderBindingsCache(const SPrepareArg &args, const TMemoryView<const EShaderOptions> &options)
+{
+	if (options.Count() <= 1)
+		return;
+	PK_NAMEDSCOPEDPROFILE("Warm shader bindings cache");
+	SShaderBindingsBatch	batch;
+	batch.m_Args = &args;
+	batch.m_Options = options;
+	RunParallelBatch(options.Count(), FastDelegate<void(u32)>(&batch, &SShaderBindingsBatch::BuildItem));
+}
+
 //----------------------------------------------------------------------------
 
 PK_NOINLINE bool	SRendererCacheKey::UpdateThread_Prepare(const SPrepareArg &args)
@@ -1645,6 +1978,10 @@ PK_NOINLINE bool	SRendererCacheKey::UpdateThread_Prepare(const SPrepareArg &args
 
 	m_RenderPasses = args.m_RenderPasses;
 
+	// Build the shader bindings of all the options in parallel, the render states below will then only hit the cache:
+	if (m_RenderPasses.Count() != 0)
+		_WarmShaderBindingsCache(args, TMemoryView<const EShaderOptions>(&options[0], options.Count()));
+
 	for (const auto &option : options)
 		result &= PushRenderState(args, option);
 
@@ -12,6 +12,7 @@
 
 #include "PK-SampleLib/PKSample.h"
 #include "PK-SampleLib/SampleUtils.h"
+#include "PK-SampleLib/ShaderLoader.h"
 #include "PK-SampleLib/ShaderGenerator/ParticleShaderGenerator.h"
 
 #include <pk_render_helpers/include/resource_manager/rh_resource_manager.h>
@@ -298,6 +299,45 @@ struct	SConstantSamplerKey
 // Render state
 //----------------------------------------------------------------------------
 
+// Memoizes the material dependent part of SRenderStateKey::UpdateThread_Prepare():
+// shader bindings only depend on the material property set and the shader options (not on the render pass),
+// renderers sharing the same property set resolve them once. Thread safe.
+class	CShaderBindingsCache
+{
+public:
+	struct	SEntry
+	{
+		CDigestMD5							m_Key;				// MaterialToRHI::DigestShaderBindingsInputs()
+		RHI::SShaderBindings				m_ShaderBindings;	// Hashed, with reset bindings
+		TArray<RHI::SVertexInputBufferDesc>	m_InputVertexBuffers;
+		u32									m_NeededConstants;
+		CDigestMD5							m_RenderStateHash;
+
+		SEntry() : m_NeededConstants(0) { }
+	};
+
+	CShaderBindingsCache() : m_HitCount(0), m_MissCount(0) { }
+	~CShaderBindingsCache() { }
+
+	// Builds and inserts the entry if missing. 'outEntry' can be null to only warm the cache.
+	bool		FindOrBuild(const SPrepareArg &args, EShaderOptions options, SEntry *outEntry);
+	void		Clear();
+
+	u32			HitCount() const { return m_HitCount; }
+	u32			MissCount() const { return m_MissCount; }
+
+private:
+	static bool	_Build(const SPrepareArg &args, EShaderOptions options, SEntry &outEntry);
+	bool		_Find(const CDigestMD5 &key, SEntry *outEntry);
+
+	Threads::CCriticalSection	m_Lock;
+	TArray<SEntry>				m_Entries;
+	u32							m_HitCount;
+	u32							m_MissCount;
+};
+
+//----------------------------------------------------------------------------
+
 struct	SRenderStateKey
 {
 	EShaderOptions							m_Options;
@@ -316,6 +356,8 @@ struct	SRenderStateKey
 	const RHI::SShaderBindings	&GetGeneratedShaderBindings() const { return m_ShaderBindings; }
 	u32						GetNeededConstants() const { return m_NeededConstants; }
 
+	static CShaderBindingsCache	&ShaderBindingsCache();
+
 private:
 	RHI::SShaderBindings					m_ShaderBindings;
 	RHI::SPipelineState						m_PipelineState;
@@ -355,6 +397,36 @@ private:
 // Shader module
 //----------------------------------------------------------------------------
 
+PK_FORWARD_DECLARE(ShaderByteCodeReadJob);
+
+// Reads shader modules byte code on the worker pool while effects are loading (update thread),
+// so that SShaderModuleKey::RenderThread_CreateResource() does not block the render thread on disk IO.
+class	CShaderByteCodePrefetcher
+{
+public:
+	CShaderByteCodePrefetcher();
+	~CShaderByteCodePrefetcher();
+
+	void		UpdateThread_Prefetch(const CString &path, RHI::EShaderStage stage, RHI::EGraphicalApi api, IFileSystem *controller);
+
+	// Returns false if the module was not prefetched. Otherwise waits for the read to finish and
+	// returns its result in 'outByteCode' (null if the read failed).
+	bool		RenderThread_Acquire(	const CString &path,
+										RHI::EShaderStage stage,
+										RHI::EGraphicalApi api,
+										PRefCountedMemoryBuffer &outByteCode,
+										bool &outPrecompiled);
+	void		Discard(const CString &path, RHI::EShaderStage stage, RHI::EGraphicalApi api);
+	void		Clear();
+
+private:
+	Threads::CCriticalSection		m_Lock;
+	CShaderModuleIndex				m_Index;	// -> index in m_Jobs, slots are reused for the same key
+	TArray<PShaderByteCodeReadJob>	m_Jobs;		// null when acquired or discarded
+};
+
+//----------------------------------------------------------------------------
+
 struct	SShaderModuleKey
 {
 	CString					m_Path;
@@ -369,6 +441,11 @@ struct	SShaderModuleKey
 	void					UpdateThread_ReleaseDependencies() {}
 	bool					operator == (const SShaderModuleKey &other) const;
 	static const char		*GetResourceName() { return "ShaderModule"; }
+
+	static CShaderByteCodePrefetcher	&ByteCodePrefetcher();
+
+private:
+	RHI::PShaderModule		_RenderThread_CreateResource(const SCreateArg &args, bool usePrefetched);
 };
 
 //----------------------------------------------------------------------------
@@ -608,6 +685,9 @@ public:
 	SCreateArg						m_LastCreateArgs;
 
 	RHI::PRenderState				GetRenderState(EShaderOptions option, ESampleLibGraphicResources_RenderPass renderPass = __MaxParticlePass, u32 *neededConstants = null);
+	// Read-only, can be called from several threads: does not request the creation of the missing render states.
+	// 'outNeedsRequest' is set when the render state is missing and GetRenderState() must be called on the render thread to request it.
+	RHI::PRenderState				FindRenderState(EShaderOptions option, ESampleLibGraphicResources_RenderPass renderPass, u32 *neededConstants, bool *outNeedsRequest) const;
 	RHI::PComputeState				GetComputeState(EComputeShaderType type);
 	bool							GetGPUStorageConstantSets(EShaderOptions option, const RHI::SConstantSetLayout *&outSimDataConstantSet, const RHI::SConstantSetLayout *&outOffsetsConstantSet) const;
 };
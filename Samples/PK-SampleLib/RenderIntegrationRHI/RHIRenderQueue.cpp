@@ -0,0 +1,178 @@
+//----------------------------------------------------------------------------
+// This program is the property of Persistant Studios SARL.
+//
+// You may not redistribute it and/or modify it under any conditions
+// without written permission from Persistant Studios SARL, unless
+// otherwise stated in the latest Persistant Studios Code License.
+//
+// See the Persistant Studios Code License for further details.
+//----------------------------------------------------------------------------
+
+#include "precompiled.h"
+
+#include "RHIRenderQueue.h"
+
+__PK_SAMPLE_API_BEGIN
+//----------------------------------------------------------------------------
+//
+//	CRenderQueue::CIdTable
+//
+//----------------------------------------------------------------------------
+
+void	CRenderQueue::CIdTable::Clear()
+{
+	for (u32 i = 0; i < m_Slots.Count(); ++i)
+		m_Slots[i].m_Ptr = null;
+	m_Ptrs.Clear();
+	m_Count = 0;
+}
+
+//----------------------------------------------------------------------------
+
+u32	CRenderQueue::CIdTable::GetOrAdd(const void *ptr, u32 maxId)
+{
+	if (ptr == null)
+		return 0;
+	// Keep the load factor under 1/2
+	if ((m_Count + 1) * 2 > m_Slots.Count())
+	{
+		const u32	newSize = PKMax(m_Slots.Count() * 2, 64U);
+		if (!m_Slots.Resize(newSize))
+			return maxId;
+		for (u32 i = 0; i < newSize; ++i)
+			m_Slots[i].m_Ptr = null;
+		for (u32 i = 0; i < m_Count; ++i)
+			m_Slots[_FindSlot(m_Ptrs[i])] = SSlot{ m_Ptrs[i], PKMin(i + 1, maxId) };
+	}
+
+	const u32	slot = _FindSlot(ptr);
+	if (m_Slots[slot].m_Ptr != null)
+		return m_Slots[slot].m_Id;
+	if (!m_Ptrs.PushBack(ptr).Valid())
+		return maxId;
+	// Id 0 is the null pointer
+	m_Slots[slot].m_Ptr = ptr;
+	m_Slots[slot].m_Id = PKMin(++m_Count, maxId);
+	return m_Slots[slot].m_Id;
+}
+
+//----------------------------------------------------------------------------
+
+u32	CRenderQueue::CIdTable::_FindSlot(const void *ptr) const
+{
+	const u32	mask = m_Slots.Count() - 1;
+	u32			slot = static_cast<u32>((reinterpret_cast<ureg>(ptr) >> 4) * 0x9E3779B1U) & mask;
+	while (m_Slots[slot].m_Ptr != null && m_Slots[slot].m_Ptr != ptr)
+		slot = (slot + 1) & mask;
+	return slot;
+}
+
+//----------------------------------------------------------------------------
+//
+//	CRenderQueue
+//
+//----------------------------------------------------------------------------
+
+CRenderQueue::CRenderQueue()
+:	m_Segment(0)
+,	m_SegmentBlendClass(BlendClass_Ordered)
+{
+}
+
+//----------------------------------------------------------------------------
+
+CRenderQueue::~CRenderQueue()
+{
+}
+
+//----------------------------------------------------------------------------
+
+void	CRenderQueue::Clear()
+{
+	m_Items.Clear();
+	m_RenderStateIds.Clear();
+	m_MaterialIds.Clear();
+	m_Segment = 0;
+	m_SegmentBlendClass = BlendClass_Ordered;
+}
+
+//----------------------------------------------------------------------------
+
+u32	CRenderQueue::QuantizeDepth(float depth)
+{
+	// The bits of positive floats sort like the floats: drop the sign bit, keep the exponent and the first mantissa bits
+	const u32	bits = bit_cast<u32>(PKMax(depth, 0.0f));
+	return PKMin((bits << 1) >> (32 - kDepthBits), (1U << kDepthBits) - 1);
+}
+
+//----------------------------------------------------------------------------
+
+bool	CRenderQueue::Push(u32 index, u32 passIdx, const void *renderState, const void *material, EBlendClass blendClass, float depth)
+{
+	// New segment when the draw cannot be reordered with the previous ones
+	if (!m_Items.Empty() &&
+		(blendClass == BlendClass_Ordered || blendClass != m_SegmentBlendClass))
+		m_Segment = PKMin(m_Segment + 1, (1U << kSegmentBits) - 1);
+	m_SegmentBlendClass = blendClass;
+
+	const u64	renderStateId = m_RenderStateIds.GetOrAdd(renderState, (1U << kRenderStateBits) - 1);
+	const u64	materialId = m_MaterialIds.GetOrAdd(material, (1U << kMaterialBits) - 1);
+	const u64	depthBits = (blendClass == BlendClass_Opaque) ? QuantizeDepth(depth) : 0;
+
+	PK_ASSERT(passIdx < (1U << kPassBits));
+	if (!m_Items.PushBack().Valid())
+		return false;
+	SItem	&item = m_Items.Last();
+	item.m_Index = index;
+	item.m_Key =	(u64(m_Segment) << kSegmentShift) |
+					(u64(passIdx & ((1U << kPassBits) - 1)) << kPassShift) |
+					(renderStateId << kRenderStateShift) |
+					(materialId << kMaterialShift) |
+					depthBits;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+bool	CRenderQueue::Sort()
+{
+	const u32	count = m_Items.Count();
+	if (count < 2)
+		return true;
+	if (!m_SortScratch.Resize(count))
+		return false;
+
+	// LSD radix sort, 8 bits per pass. Passes where all the keys share the same digit are skipped
+	// (the segment bits are mostly zeros for opaque passes, the depth bits for transparent ones).
+	SItem	*src = m_Items.RawDataPointer();
+	SItem	*dst = m_SortScratch.RawDataPointer();
+	for (u32 shift = 0; shift < 64; shift += 8)
+	{
+		u32	offsets[256];
+		Mem::Clear(offsets, sizeof(offsets));
+		for (u32 i = 0; i < count; ++i)
+			++offsets[(src[i].m_Key >> shift) & 0xFF];
+		if (offsets[(src[0].m_Key >> shift) & 0xFF] == count)
+			continue;
+
+		u32	sum = 0;
+		for (u32 digit = 0; digit < 256; ++digit)
+		{
+			const u32	digitCount = offsets[digit];
+			offsets[digit] = sum;
+			sum += digitCount;
+		}
+		for (u32 i = 0; i < count; ++i)
+			dst[offsets[(src[i].m_Key >> shift) & 0xFF]++] = src[i];
+
+		SItem	*tmp = src;
+		src = dst;
+		dst = tmp;
+	}
+	if (src != m_Items.RawDataPointer())
+		Mem::Copy(m_Items.RawDataPointer(), src, count * sizeof(SItem));
+	return true;
+}
+
+//----------------------------------------------------------------------------
+__PK_SAMPLE_API_END
@@ -0,0 +1,103 @@
+#pragma once
+
+//----------------------------------------------------------------------------
+// This program is the property of Persistant Studios SARL.
+//
+// You may not redistribute it and/or modify it under any conditions
+// without written permission from Persistant Studios SARL, unless
+// otherwise stated in the latest Persistant Studios Code License.
+//
+// See the Persistant Studios Code License for further details.
+//----------------------------------------------------------------------------
+
+#include "PK-SampleLib/PKSample.h"
+
+__PK_SAMPLE_API_BEGIN
+//----------------------------------------------------------------------------
+//
+//	Render queue: sorts the draws of a render pass to minimize the state changes.
+//	CPU only, no RHI dependency: render states and materials are opaque pointers.
+//
+//----------------------------------------------------------------------------
+
+class	CRenderQueue
+{
+public:
+	// Whether draws can be reordered relative to each other, depending on their blending
+	enum	EBlendClass
+	{
+		BlendClass_Opaque = 0,		// No blending: any order, front to back
+		BlendClass_Additive,		// Commutative with the other additive draws
+		BlendClass_Multiply,		// Commutative with the other multiply draws
+		BlendClass_Ordered,			// Drawn in the submitted order (alpha blending, ...)
+	};
+
+	// 64 bits sort key, from the most to the least significant bits:
+	// | Segment (20) | Pass (2) | Render state (14) | Material (14) | Depth (14) |
+	// A segment is a run of submitted draws of the same reorderable blend class: segments keep the submitted order,
+	// each ordered draw has its own segment. Inside a segment draws are grouped by pass, render state and material.
+	enum
+	{
+		kDepthBits = 14,
+		kMaterialBits = 14,
+		kRenderStateBits = 14,
+		kPassBits = 2,
+		kSegmentBits = 20,
+
+		kMaterialShift = kDepthBits,
+		kRenderStateShift = kMaterialShift + kMaterialBits,
+		kPassShift = kRenderStateShift + kRenderStateBits,
+		kSegmentShift = kPassShift + kPassBits,
+	};
+
+	struct	SItem
+	{
+		u64		m_Key;
+		u32		m_Index;	// Submitted draw index
+	};
+
+	CRenderQueue();
+	~CRenderQueue();
+
+	void						Clear();
+	// 'depth' is the distance to the camera, only used to sort the opaque draws front to back
+	bool						Push(u32 index, u32 passIdx, const void *renderState, const void *material, EBlendClass blendClass, float depth);
+	// Stable radix sort of the keys: draws with the same key keep the submitted order
+	bool						Sort();
+
+	u32							Count() const { return m_Items.Count(); }
+	TMemoryView<const SItem>	Items() const { return m_Items; }
+
+	static u32					QuantizeDepth(float depth);
+
+private:
+	// Compact id of a pointer (first-seen order), saturated to 'maxId'
+	class	CIdTable
+	{
+	public:
+		void	Clear();
+		u32		GetOrAdd(const void *ptr, u32 maxId);
+
+	private:
+		u32		_FindSlot(const void *ptr) const;
+
+		struct	SSlot
+		{
+			const void	*m_Ptr;
+			u32			m_Id;
+		};
+		TArray<SSlot>		m_Slots;	// Open addressing, power of two size
+		TArray<const void*>	m_Ptrs;		// In id order, to rehash
+		u32					m_Count = 0;
+	};
+
+	TArray<SItem>		m_Items;
+	TArray<SItem>		m_SortScratch;
+	CIdTable			m_RenderStateIds;
+	CIdTable			m_MaterialIds;
+	u32					m_Segment;
+	EBlendClass			m_SegmentBlendClass;
+};
+
+//----------------------------------------------------------------------------
+__PK_SAMPLE_API_END
@@ -0,0 +1,142 @@
+//----------------------------------------------------------------------------
+// This program is the property of Persistant Studios SARL.
+//
+// You may not redistribute it and/or modify it under any conditions
+// without written permission from Persistant Studios SARL, unless
+// otherwise stated in the latest Persistant Studios Code License.
+//
+// See the Persistant Studios Code License for further details.
+//----------------------------------------------------------------------------
+
+#include "precompiled.h"
+
+#include "RHITransientRenderTargets.h"
+
+__PK_SAMPLE_API_BEGIN
+//----------------------------------------------------------------------------
+
+CTransientRenderTargetAllocator::CTransientRenderTargetAllocator()
+{
+}
+
+//----------------------------------------------------------------------------
+
+CTransientRenderTargetAllocator::~CTransientRenderTargetAllocator()
+{
+}
+
+//----------------------------------------------------------------------------
+
+void	CTransientRenderTargetAllocator::Clear()
+{
+	m_Resources.Clear();
+	m_PhysicalSizes.Clear();
+	m_PhysicalKeys.Clear();
+	m_PhysicalLastPasses.Clear();
+}
+
+//----------------------------------------------------------------------------
+
+CGuid	CTransientRenderTargetAllocator::AddResource(u32 key, u64 sizeInBytes, u32 firstPass, u32 lastPass)
+{
+	PK_ASSERT(firstPass <= lastPass);
+	SResource	resource;
+	resource.m_Key = key;
+	resource.m_SizeInBytes = sizeInBytes;
+	resource.m_FirstPass = firstPass;
+	resource.m_LastPass = lastPass;
+	resource.m_PhysicalIdx = 0;
+	return m_Resources.PushBack(resource);
+}
+
+//----------------------------------------------------------------------------
+
+bool	CTransientRenderTargetAllocator::Allocate()
+{
+	m_PhysicalSizes.Clear();
+	m_PhysicalKeys.Clear();
+	m_PhysicalLastPasses.Clear();
+
+	const u32	resourceCount = m_Resources.Count();
+	if (!m_SortedResources.Resize(resourceCount))
+		return false;
+	// Insertion sort on the first pass, stable: there are only a few resources per frame
+	for (u32 i = 0; i < resourceCount; ++i)
+	{
+		u32	j = i;
+		for (; j > 0 && m_Resources[m_SortedResources[j - 1]].m_FirstPass > m_Resources[i].m_FirstPass; --j)
+			m_SortedResources[j] = m_SortedResources[j - 1];
+		m_SortedResources[j] = i;
+	}
+
+	for (u32 i = 0; i < resourceCount; ++i)
+	{
+		SResource	&resource = m_Resources[m_SortedResources[i]];
+
+		// Compatible physical render target free the longest time ago
+		CGuid	physicalIdx;
+		for (u32 p = 0; p < m_PhysicalKeys.Count(); ++p)
+		{
+			if (m_PhysicalKeys[p] != resource.m_Key ||
+				m_PhysicalSizes[p] != resource.m_SizeInBytes ||
+				m_PhysicalLastPasses[p] >= resource.m_FirstPass)
+				continue;
+			if (!physicalIdx.Valid() || m_PhysicalLastPasses[p] < m_PhysicalLastPasses[physicalIdx])
+				physicalIdx = p;
+		}
+		if (!physicalIdx.Valid())
+		{
+			physicalIdx = m_PhysicalKeys.PushBack(resource.m_Key);
+			if (!physicalIdx.Valid() ||
+				!m_PhysicalSizes.PushBack(resource.m_SizeInBytes).Valid() ||
+				!m_PhysicalLastPasses.PushBack(resource.m_LastPass).Valid())
+				return false;
+		}
+		m_PhysicalLastPasses[physicalIdx] = resource.m_LastPass;
+		resource.m_PhysicalIdx = physicalIdx;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+u64	CTransientRenderTargetAllocator::AllocatedBytes() const
+{
+	u64	bytes = 0;
+	for (u32 i = 0; i < m_PhysicalSizes.Count(); ++i)
+		bytes += m_PhysicalSizes[i];
+	return bytes;
+}
+
+//----------------------------------------------------------------------------
+
+u64	CTransientRenderTargetAllocator::UnaliasedBytes() const
+{
+	u64	bytes = 0;
+	for (u32 i = 0; i < m_Resources.Count(); ++i)
+		bytes += m_Resources[i].m_SizeInBytes;
+	return bytes;
+}
+
+//----------------------------------------------------------------------------
+
+u64	CTransientRenderTargetAllocator::PeakLiveBytes() const
+{
+	// The live memory only grows at a resource first pass
+	u64	peakBytes = 0;
+	for (u32 i = 0; i < m_Resources.Count(); ++i)
+	{
+		const u32	pass = m_Resources[i].m_FirstPass;
+		u64			liveBytes = 0;
+		for (u32 j = 0; j < m_Resources.Count(); ++j)
+		{
+			if (m_Resources[j].m_FirstPass <= pass && m_Resources[j].m_LastPass >= pass)
+				liveBytes += m_Resources[j].m_SizeInBytes;
+		}
+		peakBytes = PKMax(peakBytes, liveBytes);
+	}
+	return peakBytes;
+}
+
+//----------------------------------------------------------------------------
+__PK_SAMPLE_API_END
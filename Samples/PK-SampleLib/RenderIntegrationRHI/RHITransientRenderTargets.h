@@ -0,0 +1,65 @@
+#pragma once
+
+//----------------------------------------------------------------------------
+// This program is the property of Persistant Studios SARL.
+//
+// You may not redistribute it and/or modify it under any conditions
+// without written permission from Persistant Studios SARL, unless
+// otherwise stated in the latest Persistant Studios Code License.
+//
+// See the Persistant Studios Code License for further details.
+//----------------------------------------------------------------------------
+
+#include "PK-SampleLib/PKSample.h"
+
+__PK_SAMPLE_API_BEGIN
+//----------------------------------------------------------------------------
+//
+//	Transient render targets aliasing: render targets only used by a range of passes
+//	share the same physical render target when their ranges do not overlap.
+//	CPU only, no RHI dependency: render targets are described by a compatibility key and a size.
+//
+//----------------------------------------------------------------------------
+
+class	CTransientRenderTargetAllocator
+{
+public:
+	struct	SResource
+	{
+		u32		m_Key;			// Only render targets with the same key (format, dimensions, ...) can be aliased
+		u64		m_SizeInBytes;
+		u32		m_FirstPass;	// First pass writing it
+		u32		m_LastPass;		// Last pass reading it
+		u32		m_PhysicalIdx;	// Filled by Allocate()
+	};
+
+	CTransientRenderTargetAllocator();
+	~CTransientRenderTargetAllocator();
+
+	void						Clear();
+	// Returns the resource index, invalid if out of memory
+	CGuid						AddResource(u32 key, u64 sizeInBytes, u32 firstPass, u32 lastPass);
+	// Interval coloring: resources are assigned to physical render targets in first pass order,
+	// a physical render target is reused when its last reader pass is before the resource first pass.
+	bool						Allocate();
+
+	u32							PhysicalIndex(u32 resourceIdx) const { return m_Resources[resourceIdx].m_PhysicalIdx; }
+	u32							PhysicalCount() const { return m_PhysicalSizes.Count(); }
+	TMemoryView<const SResource>	Resources() const { return m_Resources; }
+
+	// Memory of the physical render targets, and what it would be without aliasing
+	u64							AllocatedBytes() const;
+	u64							UnaliasedBytes() const;
+	// Highest memory of the resources alive during the same pass: the lower bound of AllocatedBytes()
+	u64							PeakLiveBytes() const;
+
+private:
+	TArray<SResource>	m_Resources;
+	TArray<u32>			m_SortedResources;	// Scratch, in first pass order
+	TArray<u64>			m_PhysicalSizes;
+	TArray<u32>			m_PhysicalKeys;
+	TArray<u32>			m_PhysicalLastPasses;
+};
+
+//----------------------------------------------------------------------------
+__PK_SAMPLE_API_END
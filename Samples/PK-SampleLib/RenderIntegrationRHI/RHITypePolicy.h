@@ -16,6 +16,7 @@
 #include "PK-SampleLib/PKSample.h"
 #include "PK-SampleLib/RenderIntegrationRHI/RendererCache.h"
 #include "PK-SampleLib/RenderIntegrationRHI/RHICustomTasks.h"
+#include "PK-SampleLib/RenderIntegrationRHI/RHIGpuBufferPool.h"
 
 __PK_SAMPLE_API_BEGIN
 //----------------------------------------------------------------------------
@@ -167,7 +168,8 @@ struct	SRHIDrawCall
 
 struct	SGpuBuffer
 {
-	RHI::PGpuBuffer		m_Buffer;
+	RHI::PGpuBuffer			m_Buffer;
+	SGpuBufferSizePolicy	m_SizePolicy;
 
 	SGpuBuffer() : m_Buffer(null), m_UsedThisFrame(false) { }
 
@@ -176,7 +178,7 @@ struct	SGpuBuffer
 	void	SetGpuBuffer(RHI::PGpuBuffer buffer) { m_Buffer = buffer; m_UsedThisFrame = PK_VERIFY(m_Buffer != null); }
 	void	Use() { m_UsedThisFrame = PK_VERIFY(m_Buffer != null); }
 	bool	Used() const { PK_ASSERT(m_Buffer != null || !m_UsedThisFrame); return m_UsedThisFrame; }
-	void	Clear() { m_UsedThisFrame = false; /* More than some amount of frames unused, we could destroy the vertex buffer */ }
+	void	Clear() { m_UsedThisFrame = false; /* Unused buffers are released by m_SizePolicy */ }
 
 private:
 	bool	m_UsedThisFrame;
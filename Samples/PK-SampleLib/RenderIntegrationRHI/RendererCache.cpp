@@ -13,6 +13,7 @@
 #include "RendererCache.h"
 
 #include "PK-SampleLib/ShaderGenerator/ShaderGenerator.h"
+#include "PK-SampleLib/RenderIntegrationRHI/RHIGpuBufferPool.h"
 
 #include <pk_render_helpers/include/render_features/rh_features_basic.h>
 
@@ -223,6 +224,10 @@ void	CRendererCacheInstance_UpdateThread::RenderThread_ClearAllGpuResources()
 #define	X_GRAPHIC_RESOURCE(__name)	C ## __name ## Manager::RenderThread_ClearGpuResources()
 	EXEC_X_GRAPHIC_RESOURCE(;)
 #undef X_GRAPHIC_RESOURCE
+	// Prefetched shader byte code that was never used:
+	SShaderModuleKey::ByteCodePrefetcher().Clear();
+	// Billboarding batches buffers waiting to be reused:
+	CRHIGpuBufferPool::Instance().Clear();
 }
 
 //----------------------------------------------------------------------------
@@ -233,6 +238,10 @@ void	CRendererCacheInstance_UpdateThread::RenderThread_DestroyAllResources()
 #define	X_GRAPHIC_RESOURCE(__name)	C ## __name ## Manager::RenderThread_Destroy()
 	EXEC_X_GRAPHIC_RESOURCE(;)
 #undef X_GRAPHIC_RESOURCE
+	// Prefetched shader byte code that was never used:
+	SShaderModuleKey::ByteCodePrefetcher().Clear();
+	SRenderStateKey::ShaderBindingsCache().Clear();
+	CRHIGpuBufferPool::Instance().Clear();
 }
 
 //----------------------------------------------------------------------------
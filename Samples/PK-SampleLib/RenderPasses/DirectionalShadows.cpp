@@ -11,6 +11,7 @@
 #include "precompiled.h"
 
 #include "DirectionalShadows.h"
+#include "ShadowCascadeFitting.h"
 
 #include <PK-SampleLib/ShaderDefinitions/UnitTestsShaderDefinitions.h>
 #include <PK-SampleLib/ShaderDefinitions/BasicSceneShaderDefinitions.h>
@@ -70,6 +71,7 @@ CDirectionalShadows::CDirectionalShadows()
 ,	m_ReceiverWorldAlignedBBox(CAABB::DEGENERATED)
 ,	m_CasterViewAlignedBBox(CAABB::DEGENERATED)
 ,	m_CasterWorldAlignedBBox(CAABB::DEGENERATED)
+,	m_ReceiverLightAlignedBBox(CAABB::DEGENERATED)
 ,	m_ShadowBias(0)
 ,	m_ShadowVariancePower(1.2)
 ,	m_EnableShadows(true)
@@ -392,6 +394,8 @@ bool	CDirectionalShadows::InitFrameUpdateSceneInfo(const CFloat3 &lightDir, ECoo
 	m_ReceiverViewAlignedBBox = CAABB::DEGENERATED;
 	m_CasterWorldAlignedBBox = CAABB::DEGENERATED;
 	m_ReceiverWorldAlignedBBox = CAABB::DEGENERATED;
+	m_ReceiverLightAlignedBBox = CAABB::DEGENERATED;
+	m_CasterLightSpaceBBoxes.Clear();
 
 	for (u32 i = 0; i < m_CascadedShadows.Count(); ++i)
 	{
@@ -428,7 +432,7 @@ bool	CDirectionalShadows::InitFrameUpdateSceneInfo(const CFloat3 &lightDir, ECoo
 
 //----------------------------------------------------------------------------
 
-void	CDirectionalShadows::AddBBox(const CAABB &bbox, const CFloat4x4 &transform, bool castShadows)
+void	CDirectionalShadows::AddBBox(const CAABB &bbox, const CFloat4x4 &transform, bool castShadows, bool receiveShadows)
 {
 	const float epsilon = 0.001f;
 	const CAABB	scaledBBox = bbox.ScaledFromCenter(1.0f + epsilon);
@@ -440,8 +444,17 @@ void	CDirectionalShadows::AddBBox(const CAABB &bbox, const CFloat4x4 &transform,
 	CAABB		viewBBox;
 	viewBBox.SetupFromOBB(scaledBBox, transform * m_SceneInfoData.m_View);
 
-	m_ReceiverViewAlignedBBox.Add(viewBBox);
-	m_ReceiverWorldAlignedBBox.Add(worldBBox);
+	// We compute a world BBox and a light-space BBox and constraint both depending on the light direction
+	// Computing both those BBox helps getting the smallest as possible BBox:
+	CAABB		viewSpaceBBox;
+	viewSpaceBBox.SetupFromOBB(scaledBBox, transform * m_LightTransform);
+
+	if (receiveShadows)
+	{
+		m_ReceiverViewAlignedBBox.Add(viewBBox);
+		m_ReceiverWorldAlignedBBox.Add(worldBBox);
+		m_ReceiverLightAlignedBBox.Add(viewSpaceBBox);
+	}
 
 	if (!castShadows)
 		return;
@@ -449,11 +462,6 @@ void	CDirectionalShadows::AddBBox(const CAABB &bbox, const CFloat4x4 &transform,
 	m_CasterViewAlignedBBox.Add(viewBBox);
 	m_CasterWorldAlignedBBox.Add(worldBBox);
 
-	// We compute a world BBox and a light-space BBox and constraint both depending on the light direction
-	// Computing both those BBox helps getting the smallest as possible BBox:
-	CAABB		viewSpaceBBox;
-	viewSpaceBBox.SetupFromOBB(scaledBBox, transform * m_LightTransform);
-
 	// World space culling with the light direction:
 	CAABB					frsutumFittedBBoxWorld = worldBBox;
 	for (u32 j = 0; j < 3; ++j)
@@ -472,6 +480,8 @@ void	CDirectionalShadows::AddBBox(const CAABB &bbox, const CFloat4x4 &transform,
 		fittedViewSpaceBBox.Min() = PKMax(fittedViewSpaceBBox.Min(), viewSpaceBBox.Min());
 		fittedViewSpaceBBox.Max() = PKMin(fittedViewSpaceBBox.Max(), viewSpaceBBox.Max());
 		m_CasterLightAlignedBBox.Add(fittedViewSpaceBBox);
+		if (fittedViewSpaceBBox.Valid())
+			m_CasterLightSpaceBBoxes.PushBack(fittedViewSpaceBBox);
 	}
 }
 
@@ -549,13 +559,26 @@ bool	CDirectionalShadows::FinalizeFrameUpdateSceneInfo()
 		const CSphere	&frustumSliceBSphere		= _GetFrustumBSphere(m_SceneInfoData.m_InvViewProj, slice.m_DepthRangeMax, m_LightTransform);
 		const float		frustumSliceBSphereRadius	= PKCeil(frustumSliceBSphere.Radius());
 
-		// Compute the ratio of world units to texels for the current slice:
-		const float	worldUnitsPerTexel = (frustumSliceBSphereRadius * 2) / m_ShadowMapResolution.HighestComponent();
-
-		// Round the center of the bounding sphere to texel sized increments and create a bounding box that encloses it:
-		const CFloat3	centerFloor	= PKFloor(frustumSliceBSphere.Center() / worldUnitsPerTexel) * worldUnitsPerTexel;
-		slice.m_ShadowSliceViewAABB.Min() = centerFloor - frustumSliceBSphereRadius;
-		slice.m_ShadowSliceViewAABB.Max() = centerFloor + frustumSliceBSphereRadius;
+		// Fit the cascade to the part of the slice where the receivers are, and where the casters can shadow them.
+		// The bounding sphere diameter is the max cascade size, the slice is skipped if nothing casts on it:
+		{
+			const float	receiverDepthMin = (i == 0) ? 0.0f : slice.m_DepthRangeMin;
+			CAABB		receiverSlice = _GetFrustumBBox(m_SceneInfoData.m_InvViewProj, receiverDepthMin, slice.m_DepthRangeMax, m_LightTransform);
+			if (m_ReceiverLightAlignedBBox.Valid())
+			{
+				receiverSlice.Min() = PKMax(receiverSlice.Min(), m_ReceiverLightAlignedBBox.Min());
+				receiverSlice.Max() = PKMin(receiverSlice.Max(), m_ReceiverLightAlignedBBox.Max());
+			}
+			CAABB	cascade;
+			if (!ShadowCascadeFitting::FitCascade(m_CasterLightSpaceBBoxes, receiverSlice, cascade))
+			{
+				slice.m_IsValid = false;
+				slice.m_DepthRangeMin = -1.0f;
+				slice.m_DepthRangeMax = -1.0f;
+				continue;
+			}
+			slice.m_ShadowSliceViewAABB = ShadowCascadeFitting::SnapToTexels(cascade, frustumSliceBSphereRadius * 2, PKMax(m_ShadowMapResolution.HighestComponent(), 2U));
+		}
 
 		// Compute the light camera position as the center of the BBox in X/Y and the min value of Z:
 		CFloat3	lightCamPos = slice.m_ShadowSliceViewAABB.Center();
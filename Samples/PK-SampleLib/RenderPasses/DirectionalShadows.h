@@ -39,7 +39,7 @@ public:
 											CShaderLoader &loader,
 											const PKSample::SMesh &backdrop,
 											bool castShadows);
-	void		AddBBox(const CAABB &bbox, const CFloat4x4 &transform, bool castShadows);
+	void		AddBBox(const CAABB &bbox, const CFloat4x4 &transform, bool castShadows, bool receiveShadows = true);
 	bool		FinalizeFrameUpdateSceneInfo();
 
 	bool		IsSliceValidForDraw(u32 sliceIdx) const { return m_CascadedShadows[sliceIdx].m_IsValid; }
@@ -163,6 +163,10 @@ private:
 	CAABB								m_CasterViewAlignedBBox;
 	CAABB								m_CasterWorldAlignedBBox;
 
+	// Cascades fitting (light space):
+	TArray<CAABB>						m_CasterLightSpaceBBoxes;
+	CAABB								m_ReceiverLightAlignedBBox;
+
 	float								m_ShadowBias;
 	float								m_ShadowVariancePower;
 	bool								m_EnableShadows;
@@ -152,16 +152,29 @@ bool	CDownSampleTexture::CreateFrameBuffers()
 bool	CDownSampleTexture::Draw(	const RHI::PCommandBuffer &cmdBuff,
 									const RHI::PConstantSet &hdrFrameSampler,
 									const SMulAddInfo &firstPass,
-									const SMulAddInfo &otherPasses)
+									const SMulAddInfo &otherPasses,
+									const TMemoryView<const SScreenRegion> &regions)
 {
 	PK_NAMEDSCOPEDPROFILE("Down sample pass");
+	PK_ASSERT(regions.Empty() || regions.Count() == m_DownscaledTextures.Count());
 	for (u32 i = 0; i < m_DownscaledTextures.Count(); ++i)
 	{
 		cmdBuff->BeginRenderPass(m_RenderPassDownScale, m_FrameBuffers[i], TMemoryView<RHI::SFrameBufferClearValue>());
 
+		// The viewport stays full screen to keep the quad UVs, only the scissor is restricted
+		CInt2	scissorOffset(0);
+		CUint2	scissorSize = m_DownscaledTextures[i].m_Size;
+		if (!regions.Empty() && !regions[i].ToScissor(m_DownscaledTextures[i].m_Size, scissorOffset, scissorSize))
+		{
+			// Nothing read in this down sample
+			cmdBuff->EndRenderPass();
+			cmdBuff->SyncPreviousRenderPass(RHI::OutputColorPipelineStage, RHI::FragmentPipelineStage);
+			continue;
+		}
+
 		// -------------- Blit render sub pass --------------
 		cmdBuff->SetViewport(CInt2(0, 0), m_DownscaledTextures[i].m_Size, CFloat2(0, 1));
-		cmdBuff->SetScissor(CInt2(0), m_DownscaledTextures[i].m_Size);
+		cmdBuff->SetScissor(scissorOffset, scissorSize);
 
 		// -------------- Copy --------------
 		if (i == 0)
@@ -12,6 +12,7 @@
 #include <PK-SampleLib/PKSample.h>
 #include <PK-SampleLib/SampleUtils.h>
 #include <PK-SampleLib/ShaderLoader.h>
+#include <PK-SampleLib/RenderPasses/PostFxRegion.h>
 
 #include <PK-SampleLib/ShaderDefinitions/UnitTestsShaderDefinitions.h>
 
@@ -53,7 +54,8 @@ public:
 	bool		Draw(	const RHI::PCommandBuffer &commandBuffer,
 						const RHI::PConstantSet &hdrFrameSampler,
 						const SMulAddInfo &firstPass = SMulAddInfo(),
-						const SMulAddInfo &otherPasses = SMulAddInfo());
+						const SMulAddInfo &otherPasses = SMulAddInfo(),
+						const TMemoryView<const SScreenRegion> &regions = TMemoryView<const SScreenRegion>());	// Per down sample, empty: full screen
 
 	TMemoryView<const SSamplableRenderTarget>	GetSamplableRenderTargets() const;
 	TMemoryView<const CInt2>					GetDownscaledSizes() const;
@@ -30,6 +30,8 @@ CPostFxBloom::CPostFxBloom()
 ,	m_SubtractValue(-1)
 ,	m_Intensity(1)
 ,	m_Attenuation(0.5)
+,	m_BlurRadius(13)
+,	m_SourceRegion(SScreenRegion::Full())
 {
 }
 
@@ -213,26 +215,60 @@ void	CPostFxBloom::SetAttenuation(float attenuation)
 
 //----------------------------------------------------------------------------
 
+bool	CPostFxBloom::IsBelowBrightPass(const CFloat3 &linearColor) const
+{
+	// Same as the first down sample: color * intensity - bright pass value
+	const CFloat3	brightPass = linearColor * m_Intensity.xyz() + m_SubtractValue.xyz();
+	return brightPass.x() <= 0.0f && brightPass.y() <= 0.0f && brightPass.z() <= 0.0f;
+}
+
+//----------------------------------------------------------------------------
+
 bool	CPostFxBloom::Draw(const RHI::PCommandBuffer &cmdBuff, u32 swapChainIdx)
 {
 	PK_NAMEDSCOPEDPROFILE("Bloom pass");
 	SMulAddInfo		firstPass(m_Intensity, m_SubtractValue);
 	SMulAddInfo		otherPass(m_Attenuation, CFloat4::ZERO);
 
-	if (!m_DownSampler.Draw(cmdBuff, m_InputRenderTarget.m_SamplerConstantSet, firstPass, otherPass))
+	// Regions written by each pass, the viewports stay full screen to keep the quad UVs:
+	const bool	useRegions = !m_SourceRegion.IsFull();
+	if (useRegions)
+	{
+		PK_NAMEDSCOPEDPROFILE("Bloom regions");
+		PK_STACKMEMORYVIEW(CUint2, mipSizes, m_DownSampledBrightPassRTs.Count());
+		for (u32 i = 0; i < m_DownSampledBrightPassRTs.Count(); ++i)
+			mipSizes[i] = m_DownSampledBrightPassRTs[i].m_Size;
+		if (!ComputeBloomRegions(m_SourceRegion, mipSizes, m_DownSampler.GetDownscaledSizes(), m_BlurRadius, m_Regions))
+			return false;
+	}
+
+	if (!m_DownSampler.Draw(cmdBuff, m_InputRenderTarget.m_SamplerConstantSet, firstPass, otherPass,
+							useRegions ? TMemoryView<const SScreenRegion>(m_Regions.m_DownSample) : TMemoryView<const SScreenRegion>()))
 		return false;
 	for (u32 i = 0; i < m_FrameBuffersBloom.Count(); ++i)
 	{
 		const u32		currentRT = m_FrameBuffersBloom.Count() - i - 1;
-		const CFloat2	currentRTSize = m_DownSampledBrightPassRTs[currentRT].m_Size;
+		const CUint2	currentRTSizeTexels = m_DownSampledBrightPassRTs[currentRT].m_Size;
+		const CFloat2	currentRTSize = currentRTSizeTexels;
 		const CInt2		currentRTSize_ScreenRatio = m_DownSampler.GetDownscaledSizes()[currentRT];
 
+		// Scissors of the 3 sub passes
+		CInt2	scissorOffsets[3] = { CInt2(0), CInt2(0), CInt2(0) };
+		CUint2	scissorSizes[3] = { currentRTSizeTexels, currentRTSizeTexels, currentRTSizeTexels };
+		bool	drawSubPass[3] = { true, true, true };
+		if (useRegions)
+		{
+			drawSubPass[0] = m_Regions.m_AddPrevious[currentRT].ToScissor(currentRTSizeTexels, scissorOffsets[0], scissorSizes[0]);
+			drawSubPass[1] = m_Regions.m_HorizontalBlur[currentRT].ToScissor(currentRTSizeTexels, scissorOffsets[1], scissorSizes[1]);
+			drawSubPass[2] = m_Regions.m_VerticalBlur[currentRT].ToScissor(currentRTSizeTexels, scissorOffsets[2], scissorSizes[2]);
+		}
+
 		cmdBuff->BeginRenderPass(m_RenderPassBloom, m_FrameBuffersBloom[currentRT], TMemoryView<RHI::SFrameBufferClearValue>());
 
 		cmdBuff->SetViewport(CInt2(0, 0), currentRTSize, CFloat2(0, 1));
-		cmdBuff->SetScissor(CInt2(0), currentRTSize);
+		cmdBuff->SetScissor(scissorOffsets[0], scissorSizes[0]);
 
-		if (i != 0)
+		if (i != 0 && drawSubPass[0])
 		{
 			// -------------- Additive copy of the prev pass --------------
 			PK_NAMEDSCOPEDPROFILE("Additive copy of the prev pass");
@@ -248,9 +284,11 @@ bool	CPostFxBloom::Draw(const RHI::PCommandBuffer &cmdBuff, u32 swapChainIdx)
 
 		SBlurInfo		blurInfo(currentRTSize_ScreenRatio, CFloat2(1.0f, 0.0f));
 
+		if (drawSubPass[1])
 		{
 			// -------------- Horizontal blur sub pass --------------
 			PK_NAMEDSCOPEDPROFILE("Horizontal blur sub pass");
+			cmdBuff->SetScissor(scissorOffsets[1], scissorSizes[1]);
 			cmdBuff->BindRenderState(m_HorizontalBlurRS);
 			cmdBuff->BindVertexBuffers(TMemoryView<const RHI::PGpuBuffer>(m_FullScreenQuadVbo));
 			cmdBuff->BindConstantSets(TMemoryView<const RHI::PConstantSet>(m_DownSampledBrightPassRTs[currentRT].m_SamplerConstantSet));
@@ -258,20 +296,24 @@ bool	CPostFxBloom::Draw(const RHI::PCommandBuffer &cmdBuff, u32 swapChainIdx)
 			cmdBuff->PushConstant(&blurInfo, 0);
 
 			cmdBuff->Draw(0, 6);
-
-			cmdBuff->NextRenderSubPass();
 		}
+		cmdBuff->NextRenderSubPass();
 
 		{
 			// -------------- Vertical blur sub pass --------------
 			PK_NAMEDSCOPEDPROFILE("Vertical blur sub pass");
-			cmdBuff->BindRenderState(m_VerticalBlurRS);
-			cmdBuff->BindConstantSets(TMemoryView<const RHI::PConstantSet>(m_TmpBlurRTs[currentRT].m_SamplerConstantSet));
+			if (drawSubPass[2])
+			{
+				cmdBuff->SetScissor(scissorOffsets[2], scissorSizes[2]);
+				cmdBuff->BindRenderState(m_VerticalBlurRS);
+				cmdBuff->BindVertexBuffers(TMemoryView<const RHI::PGpuBuffer>(m_FullScreenQuadVbo));
+				cmdBuff->BindConstantSets(TMemoryView<const RHI::PConstantSet>(m_TmpBlurRTs[currentRT].m_SamplerConstantSet));
 
-			blurInfo.m_Direction = CFloat2(0.0f, 1.0f);
-			cmdBuff->PushConstant(&blurInfo, 0);
+				blurInfo.m_Direction = CFloat2(0.0f, 1.0f);
+				cmdBuff->PushConstant(&blurInfo, 0);
 
-			cmdBuff->Draw(0, 6);
+				cmdBuff->Draw(0, 6);
+			}
 
 			cmdBuff->EndRenderPass();
 			cmdBuff->SyncPreviousRenderPass(RHI::OutputColorPipelineStage, RHI::FragmentPipelineStage);
@@ -302,12 +344,17 @@ bool	CPostFxBloom::Draw(const RHI::PCommandBuffer &cmdBuff, u32 swapChainIdx)
 			cmdBuff->Draw(0, 6);
 		}
 
-		cmdBuff->BindRenderState(m_FinalAdditiveBlitRS);
-		cmdBuff->BindVertexBuffers(TMemoryView<const RHI::PGpuBuffer>(m_FullScreenQuadVbo));
-		cmdBuff->SetViewport(CInt2(0, 0), contextSize, CFloat2(0, 1));
-		cmdBuff->SetScissor(CInt2(0), contextSize);
-		cmdBuff->BindConstantSets(TMemoryView<const RHI::PConstantSet>(m_DownSampledBrightPassRTs[0].m_SamplerConstantSet));
-		cmdBuff->Draw(0, 6);
+		CInt2	scissorOffset(0);
+		CUint2	scissorSize = contextSize;
+		if (!useRegions || m_Regions.m_Merge.ToScissor(contextSize, scissorOffset, scissorSize))
+		{
+			cmdBuff->BindRenderState(m_FinalAdditiveBlitRS);
+			cmdBuff->BindVertexBuffers(TMemoryView<const RHI::PGpuBuffer>(m_FullScreenQuadVbo));
+			cmdBuff->SetViewport(CInt2(0, 0), contextSize, CFloat2(0, 1));
+			cmdBuff->SetScissor(scissorOffset, scissorSize);
+			cmdBuff->BindConstantSets(TMemoryView<const RHI::PConstantSet>(m_DownSampledBrightPassRTs[0].m_SamplerConstantSet));
+			cmdBuff->Draw(0, 6);
+		}
 
 		cmdBuff->EndRenderPass();
 	}
@@ -340,6 +387,9 @@ bool	CPostFxBloom::CreateRenderStates(CShaderLoader &loader, EGaussianBlurCombin
 	shadersPathsBloom.m_Vertex = QUAD_VERTEX_SHADER;
 	shadersPathsBloom.m_Fragment = BLUR_FRAGMENT_SHADER;
 
+	// Conservative: the tap count, the taps span about half of it on each side
+	m_BlurRadius = (blurTap == GaussianBlurCombination_5_Tap) ? 5 : (blurTap == GaussianBlurCombination_9_Tap) ? 9 : 13;
+
 	// Horizontal & VerticalBlur (two passes)
 	FillGaussianBlurShaderBindings(	blurTap,
 									opaqueRenderState.m_ShaderBindings,
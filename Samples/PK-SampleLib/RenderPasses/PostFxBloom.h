@@ -13,6 +13,7 @@
 #include <PK-SampleLib/SampleUtils.h>
 #include <PK-SampleLib/ShaderLoader.h>
 #include <PK-SampleLib/RenderPasses/DownSampleTexture.h>
+#include <PK-SampleLib/RenderPasses/PostFxRegion.h>
 
 #include <pk_rhi/include/FwdInterfaces.h>
 #include <pk_rhi/include/interfaces/IFrameBuffer.h>
@@ -47,6 +48,11 @@ public:
 	void		SetIntensity(float intensity);
 	void		SetAttenuation(float attenuation);
 
+	// Only what is around 'region' goes through the bright pass, the bloom passes are scissored around it. Full screen by default.
+	void		SetSourceRegion(const SScreenRegion &region) { m_SourceRegion = region; }
+	// True when a 'linearColor' pixel does not contribute to the bloom
+	bool		IsBelowBrightPass(const CFloat3 &linearColor) const;
+
 	u32			DownsampleCount() const { return m_DownSampledBrightPassRTs.Count(); }
 
 	bool		Draw(const RHI::PCommandBuffer &commandBuffer, u32 swapChainIdx);
@@ -96,6 +102,10 @@ private:
 	CFloat4								m_SubtractValue;
 	CFloat4								m_Intensity;
 	CFloat4								m_Attenuation;
+
+	u32									m_BlurRadius;
+	SScreenRegion						m_SourceRegion;
+	SBloomRegions						m_Regions;
 };
 
 //----------------------------------------------------------------------------
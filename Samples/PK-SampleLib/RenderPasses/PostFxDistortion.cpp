@@ -41,6 +41,7 @@ CPostFxDistortion::CPostFxDistortion()
 , m_DistortionIntensity(1.f)
 , m_ChromaticAberrationMultipliers(CFloat4(0.01f, 0.0125f, 0.015f, 0.0175f))
 , m_PushMultipliers(m_DistortionIntensity * m_ChromaticAberrationMultipliers)
+, m_BlurRegion(SScreenRegion::Full())
 {
 }
 
@@ -267,10 +268,26 @@ bool	CPostFxDistortion::Draw(const RHI::PCommandBuffer &cmdBuff)
 {
 	bool result = true;
 	result &= _Draw_UVoffset(cmdBuff, m_ConstSetProcessToDistord);
+
+	// The blurs are weighted by the distortion map: outside of the distortion particles, they are copies
+	// of texels that are already the same in both render targets.
+	const CUint2	contextSize = m_OutputRenderTarget.m_RenderTarget->GetSize();
+	CInt2			scissorOffset(0);
+	CUint2			scissorSize = contextSize;
+	const bool		drawBlur = m_BlurRegion.Dilated(CFloat2(2.0f), contextSize).ToScissor(contextSize, scissorOffset, scissorSize);
+
 	cmdBuff->NextRenderSubPass();
-	result &= _Draw_Blur(cmdBuff, m_ConstSetProcessOutput, true);
+	if (drawBlur)
+	{
+		cmdBuff->SetScissor(scissorOffset, scissorSize);
+		result &= _Draw_Blur(cmdBuff, m_ConstSetProcessOutput, true);
+	}
 	cmdBuff->NextRenderSubPass();
-	result &= _Draw_Blur(cmdBuff, m_ConstSetProcessToDistord, false);
+	if (drawBlur)
+	{
+		result &= _Draw_Blur(cmdBuff, m_ConstSetProcessToDistord, false);
+		cmdBuff->SetScissor(CInt2(0), contextSize);
+	}
 	return result;
 }
 
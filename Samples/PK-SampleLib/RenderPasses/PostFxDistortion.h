@@ -12,6 +12,7 @@
 #include <PK-SampleLib/PKSample.h>
 #include <PK-SampleLib/SampleUtils.h>
 #include <PK-SampleLib/ShaderLoader.h>
+#include <PK-SampleLib/RenderPasses/PostFxRegion.h>
 
 #include <pk_rhi/include/FwdInterfaces.h>
 #include <pk_rhi/include/interfaces/IFrameBuffer.h>
@@ -68,6 +69,8 @@ public:
 
 	void		SetChromaticAberrationIntensity(float intensity);
 	void		SetAberrationMultipliers(CFloat4 multipliers);
+	// Region of the distortion particles: the blurs are scissored around it, the UV offset pass still copies the full screen
+	void		SetBlurRegion(const SScreenRegion &region) { m_BlurRegion = region; }
 
 	CGuid							m_DistoBufferIdx;
 	SSamplableRenderTarget			m_DistoRenderTarget;
@@ -100,6 +103,7 @@ private:
 	float							m_DistortionIntensity;
 	CFloat4							m_ChromaticAberrationMultipliers;
 	CFloat4							m_PushMultipliers;
+	SScreenRegion					m_BlurRegion;
 
 	// This class does not own that
 	RHI::PApiManager				m_ApiManager;
@@ -0,0 +1,150 @@
+//----------------------------------------------------------------------------
+// This program is the property of Persistant Studios SARL.
+//
+// You may not redistribute it and/or modify it under any conditions
+// without written permission from Persistant Studios SARL, unless
+// otherwise stated in the latest Persistant Studios Code License.
+//
+// See the Persistant Studios Code License for further details.
+//----------------------------------------------------------------------------
+
+#include "precompiled.h"
+
+#include "PostFxRegion.h"
+
+__PK_SAMPLE_API_BEGIN
+//----------------------------------------------------------------------------
+
+void	SScreenRegion::Add(const SScreenRegion &other)
+{
+	if (other.Empty())
+		return;
+	if (Empty())
+	{
+		*this = other;
+		return;
+	}
+	m_Min = PKMin(m_Min, other.m_Min);
+	m_Max = PKMax(m_Max, other.m_Max);
+}
+
+//----------------------------------------------------------------------------
+
+SScreenRegion	SScreenRegion::Dilated(const CFloat2 &texels, const CUint2 &size) const
+{
+	if (Empty())
+		return *this;
+	const CFloat2	margin(texels.x() / PKMax(1.0f, static_cast<float>(size.x())), texels.y() / PKMax(1.0f, static_cast<float>(size.y())));
+	return SScreenRegion(PKMax(CFloat2(0.0f), m_Min - margin), PKMin(CFloat2(1.0f), m_Max + margin));
+}
+
+//----------------------------------------------------------------------------
+
+bool	SScreenRegion::ToScissor(const CUint2 &size, CInt2 &outOffset, CUint2 &outSize) const
+{
+	if (Empty())
+		return false;
+	const CFloat2	sizeF(static_cast<float>(size.x()), static_cast<float>(size.y()));
+	const CFloat2	texelMin = PKMax(CFloat2(0.0f), PKFloor(m_Min * sizeF));
+	const CFloat2	texelMax = PKMin(sizeF, PKCeil(m_Max * sizeF));
+	if (texelMin.x() >= texelMax.x() || texelMin.y() >= texelMax.y())
+		return false;
+	outOffset = CInt2(static_cast<s32>(texelMin.x()), static_cast<s32>(texelMin.y()));
+	outSize = CUint2(static_cast<u32>(texelMax.x() - texelMin.x()), static_cast<u32>(texelMax.y() - texelMin.y()));
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+SScreenRegion	ProjectToScreenRegion(const CAABB &bbox, const CFloat4x4 &viewProj)
+{
+	if (!bbox.IsFinite() || !bbox.Valid())
+		return SScreenRegion::Full();
+
+	// Same conventions as CHiZOcclusionBuffer::Occludes()
+	CFloat2	clipMin = CFloat2(TNumericTraits<float>::kMax);
+	CFloat2	clipMax = CFloat2(-TNumericTraits<float>::kMax);
+	for (u32 i = 0; i < 8; ++i)
+	{
+		const CFloat4	corner(	(i & 1) ? bbox.Max().x() : bbox.Min().x(),
+								(i & 2) ? bbox.Max().y() : bbox.Min().y(),
+								(i & 4) ? bbox.Max().z() : bbox.Min().z(),
+								1.0f);
+		const CFloat4	clipPos = viewProj.TransformVector(corner);
+		if (clipPos.w() <= 1.0e-5f)
+			return SScreenRegion::Full();	// Crosses the camera plane: the projected corners do not bound it anymore
+		const CFloat2	ndc = clipPos.xy() / clipPos.w();
+		clipMin = PKMin(clipMin, ndc);
+		clipMax = PKMax(clipMax, ndc);
+	}
+	const CFloat2	screenMin(clipMin.x() * 0.5f + 0.5f, 0.5f - clipMax.y() * 0.5f);
+	const CFloat2	screenMax(clipMax.x() * 0.5f + 0.5f, 0.5f - clipMin.y() * 0.5f);
+	// Off screen bboxes end up empty
+	return SScreenRegion(PKMax(CFloat2(0.0f), screenMin), PKMin(CFloat2(1.0f), screenMax));
+}
+
+//----------------------------------------------------------------------------
+
+static CFloat2	_BlurTexels(u32 blurRadius, const CUint2 &mipSize, const CInt2 &blurSize)
+{
+	// The blur offsets are in texels of 'blurSize' (the screen ratio of the mip), +1 texel for the bilinear taps
+	return CFloat2(	blurRadius * static_cast<float>(mipSize.x()) / PKMax(1.0f, static_cast<float>(blurSize.x())) + 1.0f,
+					blurRadius * static_cast<float>(mipSize.y()) / PKMax(1.0f, static_cast<float>(blurSize.y())) + 1.0f);
+}
+
+//----------------------------------------------------------------------------
+
+bool	ComputeBloomRegions(const SScreenRegion &sources,
+							const TMemoryView<const CUint2> &mipSizes,
+							const TMemoryView<const CInt2> &blurSizes,
+							u32 blurRadius,
+							SBloomRegions &outRegions)
+{
+	const u32	mipCount = mipSizes.Count();
+	if (!PK_VERIFY(blurSizes.Count() == mipCount) ||
+		!outRegions.m_DownSample.Resize(mipCount) ||
+		!outRegions.m_AddPrevious.Resize(mipCount) ||
+		!outRegions.m_HorizontalBlur.Resize(mipCount) ||
+		!outRegions.m_VerticalBlur.Resize(mipCount))
+		return false;
+	outRegions.m_Merge = SScreenRegion();
+	if (mipCount == 0)
+		return true;
+
+	// Where the bloom is not black, from the smallest mip to the output:
+	SScreenRegion	support;
+	for (u32 i = mipCount; i-- > 0; )
+	{
+		// Bilinear down samples: less than 1 texel of each mip, less than 2 texels of the current one in total
+		SScreenRegion	mipSupport = sources.Dilated(CFloat2(2.0f), mipSizes[i]);
+		if (i + 1 < mipCount)
+			mipSupport.Add(support.Dilated(CFloat2(1.0f), mipSizes[i + 1]));
+		support = mipSupport.Dilated(_BlurTexels(blurRadius, mipSizes[i], blurSizes[i]), mipSizes[i]);
+	}
+	outRegions.m_Merge = support.Dilated(CFloat2(1.0f), mipSizes[0]);
+
+	// Regions each pass must write, from the output to the smallest mip:
+	SScreenRegion	needed = outRegions.m_Merge.Dilated(CFloat2(1.0f), mipSizes[0]);
+	for (u32 i = 0; i < mipCount; ++i)
+	{
+		const CFloat2	blurTexels = _BlurTexels(blurRadius, mipSizes[i], blurSizes[i]);
+
+		outRegions.m_VerticalBlur[i] = needed;
+		outRegions.m_HorizontalBlur[i] = needed.Dilated(CFloat2(0.0f, blurTexels.y()), mipSizes[i]);
+		outRegions.m_AddPrevious[i] = outRegions.m_HorizontalBlur[i].Dilated(CFloat2(blurTexels.x(), 0.0f), mipSizes[i]);
+		if (i + 1 < mipCount)
+			needed = outRegions.m_AddPrevious[i].Dilated(CFloat2(1.0f), mipSizes[i + 1]);
+	}
+
+	// The down samples also read the larger mip under the next down sample:
+	outRegions.m_DownSample[mipCount - 1] = outRegions.m_AddPrevious[mipCount - 1];
+	for (u32 i = mipCount - 1; i-- > 0; )
+	{
+		outRegions.m_DownSample[i] = outRegions.m_AddPrevious[i];
+		outRegions.m_DownSample[i].Add(outRegions.m_DownSample[i + 1].Dilated(CFloat2(1.0f), mipSizes[i]));
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+__PK_SAMPLE_API_END
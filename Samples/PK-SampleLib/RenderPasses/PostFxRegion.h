@@ -0,0 +1,70 @@
+#pragma once
+//----------------------------------------------------------------------------
+// This program is the property of Persistant Studios SARL.
+//
+// You may not redistribute it and/or modify it under any conditions
+// without written permission from Persistant Studios SARL, unless
+// otherwise stated in the latest Persistant Studios Code License.
+//
+// See the Persistant Studios Code License for further details.
+//----------------------------------------------------------------------------
+
+#include <PK-SampleLib/PKSample.h>
+
+__PK_SAMPLE_API_BEGIN
+//----------------------------------------------------------------------------
+//
+//	Screen regions of the post-FX: the full screen passes are scissored around what they actually modify.
+//	CPU only, no RHI dependency.
+//
+//----------------------------------------------------------------------------
+
+// Normalized screen rect, top-left origin (same as the render targets texels)
+struct	SScreenRegion
+{
+	CFloat2		m_Min;
+	CFloat2		m_Max;
+
+	SScreenRegion() : m_Min(1.0f), m_Max(0.0f) { }	// Empty
+	SScreenRegion(const CFloat2 &min, const CFloat2 &max) : m_Min(min), m_Max(max) { }
+
+	static SScreenRegion	Full() { return SScreenRegion(CFloat2(0.0f), CFloat2(1.0f)); }
+
+	bool			Empty() const { return m_Min.x() >= m_Max.x() || m_Min.y() >= m_Max.y(); }
+	bool			IsFull() const { return m_Min.x() <= 0.0f && m_Min.y() <= 0.0f && m_Max.x() >= 1.0f && m_Max.y() >= 1.0f; }
+
+	void			Add(const SScreenRegion &other);
+	// Grows the region by 'texels' texels of a 'size' render target, clamped to the screen
+	SScreenRegion	Dilated(const CFloat2 &texels, const CUint2 &size) const;
+	// Texels of a 'size' render target touched by the region, for SetScissor(). Returns false when no texel is touched.
+	bool			ToScissor(const CUint2 &size, CInt2 &outOffset, CUint2 &outSize) const;
+};
+
+//----------------------------------------------------------------------------
+
+// Screen region covered by 'bbox'. Full screen when the bbox is not finite or crosses the camera plane.
+SScreenRegion	ProjectToScreenRegion(const CAABB &bbox, const CFloat4x4 &viewProj);
+
+//----------------------------------------------------------------------------
+
+// Regions written by each pass of CPostFxBloom, per mip (largest mip first)
+struct	SBloomRegions
+{
+	TArray<SScreenRegion>	m_DownSample;		// Down sample (bright pass for the first mip)
+	TArray<SScreenRegion>	m_AddPrevious;		// Additive copy of the next mip
+	TArray<SScreenRegion>	m_HorizontalBlur;	// Into the tmp blur render target
+	TArray<SScreenRegion>	m_VerticalBlur;		// Back into the mip
+	SScreenRegion			m_Merge;			// Additive blit in the output
+};
+
+// 'sources': region of the bright pass inputs, the rest of the frame is assumed to be black after the bright pass.
+// 'mipSizes': render targets sizes, 'blurSizes': sizes the blur offsets are computed in (see SBlurInfo), 'blurRadius': in texels of 'blurSizes'.
+// Every region covers the texels read by the passes after it: the result matches the full screen bloom.
+bool			ComputeBloomRegions(const SScreenRegion &sources,
+									const TMemoryView<const CUint2> &mipSizes,
+									const TMemoryView<const CInt2> &blurSizes,
+									u32 blurRadius,
+									SBloomRegions &outRegions);
+
+//----------------------------------------------------------------------------
+__PK_SAMPLE_API_END
@@ -0,0 +1,71 @@
+//----------------------------------------------------------------------------
+// This program is the property of Persistant Studios SARL.
+//
+// You may not redistribute it and/or modify it under any conditions
+// without written permission from Persistant Studios SARL, unless
+// otherwise stated in the latest Persistant Studios Code License.
+//
+// See the Persistant Studios Code License for further details.
+//----------------------------------------------------------------------------
+
+#include "precompiled.h"
+
+#include "ShadowCascadeFitting.h"
+
+__PK_SAMPLE_API_BEGIN
+//----------------------------------------------------------------------------
+
+namespace	ShadowCascadeFitting
+{
+	bool	FitCasterToReceivers(const CAABB &caster, const CAABB &receivers, CAABB &outFitted)
+	{
+		if (!caster.Valid() || !receivers.Valid())
+			return false;
+		// Shadows are cast along z: the caster can be anywhere before the receivers, but must overlap them in x/y
+		outFitted.Min() = CFloat3(PKMax(caster.Min().xy(), receivers.Min().xy()), caster.Min().z());
+		outFitted.Max() = CFloat3(PKMin(caster.Max().xy(), receivers.Max().xy()), PKMin(caster.Max().z(), receivers.Max().z()));
+		return outFitted.Valid();
+	}
+
+	//----------------------------------------------------------------------------
+
+	bool	FitCascade(const TMemoryView<const CAABB> &casters, const CAABB &receivers, CAABB &outCascade)
+	{
+		outCascade = CAABB::DEGENERATED;
+		for (u32 i = 0; i < casters.Count(); ++i)
+		{
+			CAABB	fitted;
+			if (FitCasterToReceivers(casters[i], receivers, fitted))
+				outCascade.Add(fitted);
+		}
+		if (!outCascade.Valid())
+			return false;
+		// The receivers must be inside the depth range
+		outCascade.Min().z() = PKMin(outCascade.Min().z(), receivers.Min().z());
+		outCascade.Max().z() = receivers.Max().z();
+		return true;
+	}
+
+	//----------------------------------------------------------------------------
+
+	CAABB	SnapToTexels(const CAABB &cascade, float maxExtent, u32 resolution)
+	{
+		PK_ASSERT(cascade.Valid() && maxExtent > 0.0f && resolution > 1);
+		const float	step = maxExtent / kExtentSteps;
+		const float	extent = PKMax(cascade.Extent().x(), cascade.Extent().y());
+		const float	snappedExtent = PKMin(PKCeil(extent / step) * step, maxExtent);
+
+		// The min corner is snapped down to the texel grid: one more texel keeps the max corner covered
+		const float		texelSize = snappedExtent / (resolution - 1);
+		const CFloat2	center = cascade.Center().xy();
+		const CFloat2	snappedMin = PKFloor((center - snappedExtent * 0.5f) / texelSize) * texelSize;
+
+		CAABB	snapped = cascade;
+		snapped.Min() = CFloat3(snappedMin, cascade.Min().z());
+		snapped.Max() = CFloat3(snappedMin + texelSize * resolution, cascade.Max().z());
+		return snapped;
+	}
+}
+
+//----------------------------------------------------------------------------
+__PK_SAMPLE_API_END
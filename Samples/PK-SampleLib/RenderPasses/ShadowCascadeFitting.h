@@ -0,0 +1,41 @@
+#pragma once
+//----------------------------------------------------------------------------
+// This program is the property of Persistant Studios SARL.
+//
+// You may not redistribute it and/or modify it under any conditions
+// without written permission from Persistant Studios SARL, unless
+// otherwise stated in the latest Persistant Studios Code License.
+//
+// See the Persistant Studios Code License for further details.
+//----------------------------------------------------------------------------
+
+#include <PK-SampleLib/PKSample.h>
+
+__PK_SAMPLE_API_BEGIN
+//----------------------------------------------------------------------------
+
+// Directional shadow cascades fitting, no GPU dependency.
+// All the bboxes are in light space: x/y is the shadow map plane, z increases along the light direction.
+namespace	ShadowCascadeFitting
+{
+	enum
+	{
+		// The cascade size is rounded up to a multiple of 1/kExtentSteps of its max size,
+		// the texel size only changes when crossing a step (no shimmering while the casters move a bit).
+		kExtentSteps = 16,
+	};
+
+	// Part of a caster that can cast shadows on the receivers: inside their x/y footprint, and not behind them.
+	// Returns false if the caster cannot shadow the receivers.
+	bool	FitCasterToReceivers(const CAABB &caster, const CAABB &receivers, CAABB &outFitted);
+
+	// Cascade bbox: the fitted casters in x/y, from the first caster to the last receiver in z.
+	// Returns false if no caster can shadow the receivers: the cascade does not need to be rendered.
+	bool	FitCascade(const TMemoryView<const CAABB> &casters, const CAABB &receivers, CAABB &outCascade);
+
+	// Squares and snaps the cascade x/y to the texel grid, for a shadow map of 'resolution' texels covering at most 'maxExtent'.
+	CAABB	SnapToTexels(const CAABB &cascade, float maxExtent, u32 resolution);
+}
+
+//----------------------------------------------------------------------------
+__PK_SAMPLE_API_END
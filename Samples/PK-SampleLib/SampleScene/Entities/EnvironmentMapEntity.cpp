@@ -42,9 +42,6 @@
 #define MAXFACESIZEIBL 512
 #define MIPMAPCOUNTIBL 7
 #define IBLSAMPLECOUNT 1024 // For montecarlo sampling of radiance
-#define PI 3.14159f
-
-PK_PLUGIN_DECLARE(CImagePKIMCodec);
 
 __PK_SAMPLE_API_BEGIN
 
@@ -55,6 +52,8 @@ CEnvironmentMap::CEnvironmentMap()
 :	m_ProgressiveProcessing(false)
 ,	m_InputPath(null)
 ,	m_CachePath(null)
+,	m_CacheKey(0)
+,	m_HasCacheKey(false)
 ,	m_InputTexture(null)
 ,	m_InputSampler(null)
 ,	m_InputIsLatLong(false)
@@ -165,32 +164,50 @@ u32	_TexelRangeFromAngle(float angle, u32 faceSize)
 // kernel blur angle (radians).
 float	CEnvironmentMap::MipLevelToBlurAngle(u32 srcMipLevel)
 {
-	// Cursor t in 0 - 1 range. Is = 1 at the before last mipmap, meaning it's processed with the max blur
-	// into the last mipmap.
-	const float	t = PKMin(1.0f, static_cast<float>(srcMipLevel) / static_cast<float>(m_MipmapCount - 2));
+	// Shared with the CPU prefilter, so that baked caches match
+	return CEnvironmentMapPrefilter::BackgroundBlurAngle(srcMipLevel, m_MipmapCount);
+}
+
+//----------------------------------------------------------------------------
 
-	// Heuristic: make small cones for first blurs since very visible.
-	// Do not start with blur of 0., which would mean no blur.
-	return	(PI / 2.0f) * PKLerp(0.01f, 1.0f, pow(t, 1.8f));
+SEnvironmentMapPrefilterParams	CEnvironmentMap::PrefilterParams()
+{
+	SEnvironmentMapPrefilterParams	params;
+	params.m_FaceSize = MAXFACESIZE;
+	params.m_MipmapCount = IntegerTools::Log2(MAXFACESIZE) + 1;	// Same as m_MipmapCount
+	params.m_FaceSizeIBL = MAXFACESIZEIBL;
+	params.m_MipmapCountIBL = MIPMAPCOUNTIBL;
+	params.m_SampleCount = IBLSAMPLECOUNT;
+	return params;
 }
 
 //----------------------------------------------------------------------------
 
-bool CEnvironmentMap::TryLoadFromCache(const CString &resourcePath, CResourceManager *resourceManager)
+bool CEnvironmentMap::TryLoadFromCache(const CString &resourcePath, CResourceManager *resourceManager, u64 cacheKey)
 {
-	const CString			cachePath = m_CachePath / m_InputPath + ".cube.pkim";
-	const CString			cachePathIBL = m_CachePath / m_InputPath + ".ibl.pkim";
-	TResourcePtr<CImage>	cachedImage = resourceManager->Load<CImage>(cachePath);
-	TResourcePtr<CImage>	cachedImageIBL = resourceManager->Load<CImage>(cachePathIBL);
+	// Content addressed: an edited input, or different prefilter params, never hit a stale cache
+	const SEnvironmentMapPrefilterParams	params = PrefilterParams();
+	const CString				basePath = CEnvironmentMapPrefilter::CacheBasePath(m_CachePath, cacheKey);
+	SEnvironmentMapCacheHeader	header;
+	if (!CEnvironmentMapPrefilter::ReadCacheHeader(resourceManager->FileController(), basePath, cacheKey, params, header))
+		return false;
+
+	TResourcePtr<CImage>	cachedImage = resourceManager->Load<CImage>(basePath + ".cube.pkim");
+	TResourcePtr<CImage>	cachedImageIBL = resourceManager->Load<CImage>(basePath + ".ibl.pkim");
 
 	if (cachedImage != null && cachedImageIBL != null)
 	{
 		// Check for invalid/corrupted cache file
-		if (cachedImage->m_Frames.Count() != 1 &&
-			cachedImage->m_Frames.First().m_Mipmaps.Count() != FACECOUNT * m_MipmapCount &&
-			cachedImageIBL->m_Frames.Count() != 1 &&
-			cachedImageIBL->m_Frames.First().m_Mipmaps.Count() != FACECOUNT * m_MipmapCountIBL)
+		if (cachedImage->m_Frames.Count() != 1 ||
+			cachedImage->m_Frames.First().m_Mipmaps.Count() != FACECOUNT * m_MipmapCount ||
+			cachedImage->m_Frames.First().m_Mipmaps.First().m_Dimensions.xy() != CUint2(MAXFACESIZE) ||
+			cachedImageIBL->m_Frames.Count() != 1 ||
+			cachedImageIBL->m_Frames.First().m_Mipmaps.Count() != FACECOUNT * m_MipmapCountIBL ||
+			cachedImageIBL->m_Frames.First().m_Mipmaps.First().m_Dimensions.xy() != CUint2(MAXFACESIZEIBL))
+		{
+			CLog::Log(PK_WARN, "Environment map cache \"%s\" rejected: unexpected cubemap layout", basePath.Data());
 			return false;
+		}
 
 		RHI::PTexture		initialCubemap = m_BackgroundCubemapTexture;
 		RHI::PTexture		initialCubemapIBL = m_IBLCubemapTexture;
@@ -575,8 +592,16 @@ bool	CEnvironmentMap::Load(const CString &resourcePath, CResourceManager *resour
 	m_IsUsable = false;
 	m_ProgressiveCounter = 0u;
 	m_InputPath = resourcePath;
+	m_HasCacheKey = CEnvironmentMapPrefilter::ComputeCacheKey(resourceManager->FileController(), resourcePath, PrefilterParams(), EnvironmentMapBaker_GPU, m_CacheKey);
 
-	if (TryLoadFromCache(resourcePath, resourceManager))
+	// Our own exports first, then the offline CPU bakes
+	bool	loadedFromCache = m_HasCacheKey && TryLoadFromCache(resourcePath, resourceManager, m_CacheKey);
+	u64		cpuCacheKey = 0;
+	if (!loadedFromCache && m_HasCacheKey &&
+		CEnvironmentMapPrefilter::ComputeCacheKey(resourceManager->FileController(), resourcePath, PrefilterParams(), EnvironmentMapBaker_CPU, cpuCacheKey))
+		loadedFromCache = TryLoadFromCache(resourcePath, resourceManager, cpuCacheKey);
+
+	if (loadedFromCache)
 	{
 		m_MustRegisterCompute = false;
 		m_LoadIsValid = true;
@@ -615,16 +640,6 @@ bool	CEnvironmentMap::Load(const CString &resourcePath, CResourceManager *resour
 
 #if	(PK_IMAGING_ENABLE_WRITE_CODECS != 0)
 
-// These would be defined in the dds_codec.h header, which might not be redistributed
-// in the SDKs. Ideally we would #include "../Plugins/CodecImage_DDS/include/dds_codec.h",
-// but it wouldn't compile in some SDK configs. So here, just repro it here and keep it synced
-enum	EExportCodecFlags
-{
-	ExportFlag_ExplicitWriteFlags	= 0x1,
-	ExportFlag_WriteTexels			= 0x2,
-	ExportFlag_WriteDensity			= 0x4,
-};
-
 bool CEnvironmentMap::ExportCubemap(CResourceManager *resourceManager)
 {
 	TArray<PImage>	images;
@@ -670,31 +685,18 @@ bool CEnvironmentMap::ExportCubemap(CResourceManager *resourceManager)
 		}
 	}
 
-	IFileSystem				*fileController = resourceManager->FileController();
-
-	const CString			cachePath = m_CachePath / m_InputPath + ".cube.pkim";
-	const CString			cachePathIBL = m_CachePath / m_InputPath + ".ibl.pkim";
-	IImageCodec				*imageCodec = checked_cast<IImageCodec*>(GetPlugin_CImagePKIMCodec());
-	if (imageCodec == null)
-		return false;
-
-	CMessageStream			exportReport;
-	SImageCodecWriteConfig	writeCfg;
+	m_ReadBackTextures.Clear();
 
-	writeCfg.m_CodecData[0] = EExportCodecFlags::ExportFlag_WriteTexels;
+	if (!m_HasCacheKey)
+		return true;	// Input file could not be hashed: nothing to cache
 
-	if (!imageCodec->FileSave(fileController, *imageCube, cachePath, false, writeCfg, exportReport))
-	{
-		fileController->FileDelete(cachePath, true);
-	}
-
-	if (!imageCodec->FileSave(fileController, *imageIBL, cachePathIBL, false, writeCfg, exportReport))
-	{
-		fileController->FileDelete(cachePathIBL, true);
-	}
-	m_ReadBackTextures.Clear();
+	// Irradiance from the unfiltered radiance (IBL mip 0), stored in the cache header
+	SIrradianceSH	irradianceSH;
+	if (!CEnvironmentMapPrefilter::ComputeIrradianceSH(*imageIBL, 0, irradianceSH))
+		return false;
 
-	return !exportReport.HasErrors();
+	const CString	basePath = CEnvironmentMapPrefilter::CacheBasePath(m_CachePath, m_CacheKey);
+	return CEnvironmentMapPrefilter::WriteCache(resourceManager->FileController(), basePath, m_CacheKey, PrefilterParams(), *imageCube, *imageIBL, irradianceSH);
 }
 #endif
 
@@ -1045,6 +1047,7 @@ void	CEnvironmentMap::Reset()
 	m_MustRegisterCompute = false;
 	m_LoadIsValid = false;
 	m_IsUsable = false;
+	m_HasCacheKey = false;
 }
 
 //----------------------------------------------------------------------------
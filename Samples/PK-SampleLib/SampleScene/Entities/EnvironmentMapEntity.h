@@ -14,6 +14,7 @@
 #include <pk_rhi/include/FwdInterfaces.h>
 
 #include <PK-SampleLib/ShaderLoader.h>
+#include <PK-SampleLib/SampleScene/Entities/EnvironmentMapPrefilter.h>
 
 __PK_SAMPLE_API_BEGIN
 //----------------------------------------------------------------------------
@@ -39,9 +40,12 @@ public:
 	void							SetProgressiveProcessing(bool progressiveProcessing);
 	void							SetCachePath(const CString &path);
 
+	// Params of the cached cubemaps: CEnvironmentMapPrefilter::BakeCache() must use the same to be picked up by Load()
+	static SEnvironmentMapPrefilterParams	PrefilterParams();
+
 private:
 	float							MipLevelToBlurAngle(u32 srcMip);
-	bool							TryLoadFromCache(const CString &resourcePath, CResourceManager *resourceManager);
+	bool							TryLoadFromCache(const CString &resourcePath, CResourceManager *resourceManager, u64 cacheKey);
 	bool							GenerateCubemap(const RHI::PCommandBuffer &cmdBuff);
 #if	(PK_IMAGING_ENABLE_WRITE_CODECS != 0)
 	bool							ExportCubemap(CResourceManager *resourceManager);
@@ -51,6 +55,8 @@ private:
 	bool							m_ProgressiveProcessing;
 	CString							m_InputPath;
 	CString							m_CachePath;
+	u64								m_CacheKey;		// Hash of the input file content and of the prefilter params, EnvironmentMapBaker_GPU
+	bool							m_HasCacheKey;
 	RHI::PTexture					m_InputTexture;
 	RHI::PConstantSampler			m_InputSampler;
 	bool							m_InputIsLatLong;
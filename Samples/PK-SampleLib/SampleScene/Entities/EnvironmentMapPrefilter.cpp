@@ -0,0 +1,906 @@
+//----------------------------------------------------------------------------
+// This program is the property of Persistant Studios SARL.
+//
+// You may not redistribute it and/or modify it under any conditions
+// without written permission from Persistant Studios SARL, unless
+// otherwise stated in the latest Persistant Studios Code License.
+//
+// See the Persistant Studios Code License for further details.
+//----------------------------------------------------------------------------
+
+#include "precompiled.h"
+
+#include "EnvironmentMapPrefilter.h"
+
+#include <pk_kernel/include/kr_resources.h>
+#include <pk_imaging/include/im_codecs.h>
+
+#include <PK-SampleLib/SampleUtils.h>
+
+#define	FACECOUNT	6
+
+#if	(PK_IMAGING_ENABLE_WRITE_CODECS != 0)
+PK_PLUGIN_DECLARE(CImagePKIMCodec);
+#endif
+
+__PK_SAMPLE_API_BEGIN
+//----------------------------------------------------------------------------
+
+static const u32	kBackgroundSampleCount = 128;
+static const u32	kIrradianceMaxFaceSize = 64;	// Irradiance is low frequency: projected from a small mip
+static const u32	kCacheKeyVersion = 3;			// Bump when the prefiltering or the cached layout changes
+
+//----------------------------------------------------------------------------
+//
+//	Helpers
+//
+//----------------------------------------------------------------------------
+
+static u32	_Log2(u32 value)
+{
+	u32	log = 0;
+	while (value > 1)
+	{
+		value >>= 1;
+		++log;
+	}
+	return log;
+}
+
+//----------------------------------------------------------------------------
+
+static bool	_IsPow2(u32 value)
+{
+	return value != 0 && (value & (value - 1)) == 0;
+}
+
+//----------------------------------------------------------------------------
+
+static u64	_HashFNV1a(const void *data, u32 sizeInBytes, u64 hash = 0xCBF29CE484222325ULL)
+{
+	// Same hash as SShaderModuleFileKey::HashPath(), stable across runs
+	const u8	*bytes = static_cast<const u8*>(data);
+	for (u32 i = 0; i < sizeInBytes; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+//----------------------------------------------------------------------------
+
+// Face texel coordinates in [-1, 1] to direction, D3D/GL cubemap faces order and orientation (+X, -X, +Y, -Y, +Z, -Z),
+// same as the ComputeCubemap/FilterCubemap compute shaders.
+static CFloat3	_FaceToDirection(u32 face, float u, float v)
+{
+	switch (face)
+	{
+	case 0:
+		return CFloat3(1.0f, -v, -u).Normalized();
+	case 1:
+		return CFloat3(-1.0f, -v, u).Normalized();
+	case 2:
+		return CFloat3(u, 1.0f, v).Normalized();
+	case 3:
+		return CFloat3(u, -1.0f, -v).Normalized();
+	case 4:
+		return CFloat3(u, -v, 1.0f).Normalized();
+	default:
+		return CFloat3(-u, -v, -1.0f).Normalized();
+	}
+}
+
+//----------------------------------------------------------------------------
+
+static u32	_DirectionToFace(const CFloat3 &dir, float &outU, float &outV)
+{
+	const CFloat3	absDir(fabsf(dir.x()), fabsf(dir.y()), fabsf(dir.z()));
+	if (absDir.x() >= absDir.y() && absDir.x() >= absDir.z())
+	{
+		const float	invMa = 1.0f / absDir.x();
+		outV = -dir.y() * invMa;
+		outU = (dir.x() > 0.0f ? -dir.z() : dir.z()) * invMa;
+		return dir.x() > 0.0f ? 0 : 1;
+	}
+	if (absDir.y() >= absDir.z())
+	{
+		const float	invMa = 1.0f / absDir.y();
+		outU = dir.x() * invMa;
+		outV = (dir.y() > 0.0f ? dir.z() : -dir.z()) * invMa;
+		return dir.y() > 0.0f ? 2 : 3;
+	}
+	const float	invMa = 1.0f / absDir.z();
+	outU = (dir.z() > 0.0f ? dir.x() : -dir.x()) * invMa;
+	outV = -dir.y() * invMa;
+	return dir.z() > 0.0f ? 4 : 5;
+}
+
+//----------------------------------------------------------------------------
+
+static CFloat3	_TexelDirection(u32 face, u32 x, u32 y, u32 size)
+{
+	const float	invSize = 1.0f / static_cast<float>(size);
+	return _FaceToDirection(face, (x + 0.5f) * invSize * 2.0f - 1.0f, (y + 0.5f) * invSize * 2.0f - 1.0f);
+}
+
+//----------------------------------------------------------------------------
+
+static float	_AreaElement(float x, float y)
+{
+	return atan2f(x * y, sqrtf(x * x + y * y + 1.0f));
+}
+
+//----------------------------------------------------------------------------
+
+static float	_TexelSolidAngle(u32 x, u32 y, u32 size)
+{
+	const float	invSize = 1.0f / static_cast<float>(size);
+	const float	x0 = x * invSize * 2.0f - 1.0f;
+	const float	y0 = y * invSize * 2.0f - 1.0f;
+	const float	x1 = x0 + invSize * 2.0f;
+	const float	y1 = y0 + invSize * 2.0f;
+	return _AreaElement(x0, y0) - _AreaElement(x0, y1) - _AreaElement(x1, y0) + _AreaElement(x1, y1);
+}
+
+//----------------------------------------------------------------------------
+
+static CFloat2	_Hammersley(u32 i, u32 count)
+{
+	u32	bits = i;
+	bits = (bits << 16u) | (bits >> 16u);
+	bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+	bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+	bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+	bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+	return CFloat2(static_cast<float>(i) / static_cast<float>(count), static_cast<float>(bits) * 2.3283064365386963e-10f);
+}
+
+//----------------------------------------------------------------------------
+
+static void	_TangentFrame(const CFloat3 &n, CFloat3 &outT, CFloat3 &outB)
+{
+	const CFloat3	up = fabsf(n.z()) < 0.999f ? CFloat3(0.0f, 0.0f, 1.0f) : CFloat3(1.0f, 0.0f, 0.0f);
+	outT = up.Cross(n).Normalized();
+	outB = n.Cross(outT);
+}
+
+//----------------------------------------------------------------------------
+
+// Bilinear, clamped to the edges (or wrapped horizontally for lat-long images)
+static CFloat3	_SampleBilinear(const CFloat3 *texels, u32 width, u32 height, float x, float y, bool wrapX)
+{
+	x -= 0.5f;
+	y = PKClamp(y - 0.5f, 0.0f, static_cast<float>(height - 1));
+	if (!wrapX)
+		x = PKClamp(x, 0.0f, static_cast<float>(width - 1));
+	const float	fx = floorf(x);
+	const float	fy = floorf(y);
+	const float	tx = x - fx;
+	const float	ty = y - fy;
+	s32			x0 = static_cast<s32>(fx);
+	s32			x1 = x0 + 1;
+	const u32	y0 = static_cast<u32>(fy);
+	const u32	y1 = PKMin(y0 + 1, height - 1);
+	if (wrapX)
+	{
+		const s32	w = static_cast<s32>(width);
+		x0 = (x0 % w + w) % w;
+		x1 = (x1 % w + w) % w;
+	}
+	else
+		x1 = PKMin(x1, static_cast<s32>(width - 1));
+	const CFloat3	top = PKLerp(texels[y0 * width + x0], texels[y0 * width + x1], tx);
+	const CFloat3	bottom = PKLerp(texels[y1 * width + x0], texels[y1 * width + x1], tx);
+	return PKLerp(top, bottom, ty);
+}
+
+//----------------------------------------------------------------------------
+
+struct	SSRGBToLinearTable
+{
+	float		m_Table[256];
+
+	SSRGBToLinearTable()
+	{
+		for (u32 i = 0; i < 256; ++i)
+		{
+			const float	c = i / 255.0f;
+			m_Table[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+		}
+	}
+};
+
+//----------------------------------------------------------------------------
+
+// Linear RGB texels of an image map, any pixel format. Non floating point images are sRGB,
+// like the input texture of CEnvironmentMap::Load().
+static bool	_ReadTexels(const CImageMap &map, CImage::EFormat format, bool isFloat, TArray<CFloat3> &outTexels)
+{
+	const CImage::EFormat	dstFormat = isFloat ? CImage::Format_Fp32RGBA : (format == CImage::Format_BGRA8_sRGB ? CImage::Format_BGRA8_sRGB : CImage::Format_BGRA8);
+	const u32				texelCount = map.m_Dimensions.x() * map.m_Dimensions.y();
+
+	// Convert() works in place: on a copy of the texels
+	CImageMap	dstMap = map;
+	dstMap.m_RawBuffer = CRefCountedMemoryBuffer::Alloc(map.PixelBufferSize(format));
+	if (dstMap.m_RawBuffer == null || map.m_RawBuffer == null)
+		return false;
+	Mem::Copy(dstMap.m_RawBuffer->Data<u8>(), map.m_RawBuffer->Data<u8>(), map.PixelBufferSize(format));
+	CImageSurface	surface(dstMap, format);
+	if (!surface.Convert(dstFormat) ||
+		!outTexels.Resize(texelCount))
+		return false;
+
+	if (isFloat)
+	{
+		const float	*src = surface.m_RawBuffer->Data<float>();
+		for (u32 i = 0; i < texelCount; ++i)
+			outTexels[i] = CFloat3(src[i * 4 + 0], src[i * 4 + 1], src[i * 4 + 2]);
+	}
+	else
+	{
+		static const SSRGBToLinearTable	kSRGBToLinear;
+		const u8	*src = surface.m_RawBuffer->Data<u8>();
+		for (u32 i = 0; i < texelCount; ++i)
+			outTexels[i] = CFloat3(kSRGBToLinear.m_Table[src[i * 4 + 2]], kSRGBToLinear.m_Table[src[i * 4 + 1]], kSRGBToLinear.m_Table[src[i * 4 + 0]]);
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+static void	_ProjectIrradianceSH(const CFloat3 *texels, u32 faceSize, SIrradianceSH &outSH)
+{
+	for (u32 i = 0; i < 9; ++i)
+		outSH.m_Coeffs[i] = CFloat3(0.0f);
+
+	float	totalSolidAngle = 0.0f;
+	for (u32 face = 0; face < FACECOUNT; ++face)
+	{
+		for (u32 y = 0; y < faceSize; ++y)
+		{
+			for (u32 x = 0; x < faceSize; ++x)
+			{
+				const CFloat3	d = _TexelDirection(face, x, y, faceSize);
+				const float		solidAngle = _TexelSolidAngle(x, y, faceSize);
+				const CFloat3	radiance = texels[(face * faceSize + y) * faceSize + x] * solidAngle;
+				totalSolidAngle += solidAngle;
+
+				outSH.m_Coeffs[0] += radiance * 0.282095f;
+				outSH.m_Coeffs[1] += radiance * (0.488603f * d.y());
+				outSH.m_Coeffs[2] += radiance * (0.488603f * d.z());
+				outSH.m_Coeffs[3] += radiance * (0.488603f * d.x());
+				outSH.m_Coeffs[4] += radiance * (1.092548f * d.x() * d.y());
+				outSH.m_Coeffs[5] += radiance * (1.092548f * d.y() * d.z());
+				outSH.m_Coeffs[6] += radiance * (0.315392f * (3.0f * d.z() * d.z() - 1.0f));
+				outSH.m_Coeffs[7] += radiance * (1.092548f * d.x() * d.z());
+				outSH.m_Coeffs[8] += radiance * (0.546274f * (d.x() * d.x() - d.y() * d.y()));
+			}
+		}
+	}
+
+	// Clamped cosine convolution, and the solid angle discretization error
+	const float	normalization = totalSolidAngle > 0.0f ? (4.0f * TNumericConstants<float>::Pi() / totalSolidAngle) : 0.0f;
+	const float	bands[3] = { TNumericConstants<float>::Pi(), 2.0f * TNumericConstants<float>::Pi() / 3.0f, TNumericConstants<float>::Pi() / 4.0f };
+	for (u32 i = 0; i < 9; ++i)
+		outSH.m_Coeffs[i] *= normalization * bands[i == 0 ? 0 : (i < 4 ? 1 : 2)];
+}
+
+//----------------------------------------------------------------------------
+
+#if	(PK_IMAGING_ENABLE_WRITE_CODECS != 0)
+
+// These would be defined in the dds_codec.h header, which might not be redistributed
+// in the SDKs. Ideally we would #include "../Plugins/CodecImage_DDS/include/dds_codec.h",
+// but it wouldn't compile in some SDK configs. So here, just repro it here and keep it synced
+enum	EExportCodecFlags
+{
+	ExportFlag_ExplicitWriteFlags	= 0x1,
+	ExportFlag_WriteTexels			= 0x2,
+	ExportFlag_WriteDensity			= 0x4,
+};
+
+#endif
+
+//----------------------------------------------------------------------------
+
+static bool	_FileSizeAndCRC32(IFileSystem *fileSystem, const CString &path, u32 &outSize, u32 &outCRC32)
+{
+	PFileStream	fileView = fileSystem->OpenStream(path, IFileSystem::Access_Read, false);
+	if (fileView == null)
+		return false;
+	u32		fileSize = 0;
+	void	*fileData = fileView->Bufferize(fileSize);
+	fileView->Close();
+	if (fileData == null)
+		return false;
+	outSize = fileSize;
+	outCRC32 = ComputeCRC32(fileData, fileSize);
+	PK_FREE(fileData);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+static u32	_HeaderCRC32(const SEnvironmentMapCacheHeader &header)
+{
+	return ComputeCRC32(&header, PK_MEMBER_OFFSET(SEnvironmentMapCacheHeader, m_HeaderCRC32));
+}
+
+//----------------------------------------------------------------------------
+
+static bool	_SameParams(const SEnvironmentMapPrefilterParams &a, const SEnvironmentMapPrefilterParams &b)
+{
+	return	a.m_FaceSize == b.m_FaceSize &&
+			a.m_MipmapCount == b.m_MipmapCount &&
+			a.m_FaceSizeIBL == b.m_FaceSizeIBL &&
+			a.m_MipmapCountIBL == b.m_MipmapCountIBL &&
+			a.m_SampleCount == b.m_SampleCount;
+}
+
+//----------------------------------------------------------------------------
+//
+//	CEnvironmentMapPrefilter
+//
+//----------------------------------------------------------------------------
+
+CEnvironmentMapPrefilter::CEnvironmentMapPrefilter()
+{
+	Mem::Clear(&m_IrradianceSH, sizeof(m_IrradianceSH));
+}
+
+//----------------------------------------------------------------------------
+
+CEnvironmentMapPrefilter::~CEnvironmentMapPrefilter()
+{
+}
+
+//----------------------------------------------------------------------------
+
+float	CEnvironmentMapPrefilter::BackgroundBlurAngle(u32 srcMip, u32 mipCount)
+{
+	// Cursor t in 0 - 1 range. Is = 1 at the before last mipmap, meaning it's processed with the max blur
+	// into the last mipmap.
+	const float	t = PKMin(1.0f, static_cast<float>(srcMip) / static_cast<float>(PKMax(mipCount, 3u) - 2));
+
+	// Heuristic: make small cones for first blurs since very visible.
+	// Do not start with blur of 0., which would mean no blur.
+	return	(TNumericConstants<float>::Pi() / 2.0f) * PKLerp(0.01f, 1.0f, powf(t, 1.8f));
+}
+
+//----------------------------------------------------------------------------
+
+bool	CEnvironmentMapPrefilter::Prefilter(const CImage &source, const SEnvironmentMapPrefilterParams &params, bool useWorkerPool)
+{
+	PK_NAMEDSCOPEDPROFILE("CEnvironmentMapPrefilter::Prefilter");
+
+	if (!_IsPow2(params.m_FaceSize) || !_IsPow2(params.m_FaceSizeIBL) ||
+		params.m_FaceSizeIBL > params.m_FaceSize ||
+		params.m_MipmapCount == 0 || params.m_MipmapCount > _Log2(params.m_FaceSize) + 1 ||
+		params.m_MipmapCountIBL == 0 || params.m_MipmapCountIBL > _Log2(params.m_FaceSizeIBL) + 1 ||
+		params.m_SampleCount == 0)
+	{
+		CLog::Log(PK_ERROR, "Environment map prefilter: invalid parameters");
+		return false;
+	}
+	if (source.m_Frames.Empty() || source.m_Frames[0].m_Mipmaps.Empty())
+		return false;
+	m_Params = params;
+
+	// Input texels, mip 0 only: the source chain is resampled to m_FaceSize and box filtered below.
+	// Cubemap mipmaps are face major, like RHI::TextureCubemap: all the mips of a face are contiguous.
+	const bool					isCubemap = (source.m_Flags & CImage::Flag_Cubemap) != 0;
+	const TArray<CImageMap>		&srcMipmaps = source.m_Frames[0].m_Mipmaps;
+	if (isCubemap && (srcMipmaps.Count() < FACECOUNT || srcMipmaps.Count() % FACECOUNT != 0))
+		return false;
+	const u32					inputCount = isCubemap ? FACECOUNT : 1;
+	const u32					srcMipsPerFace = isCubemap ? srcMipmaps.Count() / FACECOUNT : 1;
+	const CUint2				inputSize = srcMipmaps[0].m_Dimensions.xy();
+	TArray<CFloat3>				inputTexels[FACECOUNT];
+	for (u32 i = 0; i < inputCount; ++i)
+	{
+		const CImageMap	&srcMap = srcMipmaps[i * srcMipsPerFace];
+		if (srcMap.m_Dimensions.xy() != inputSize ||
+			!_ReadTexels(srcMap, source.m_Format, source.FloatingPoint(), inputTexels[i]))
+		{
+			CLog::Log(PK_ERROR, "Environment map prefilter: could not read the source texels");
+			return false;
+		}
+	}
+
+	// Source chain
+	const u32	chainCount = _Log2(m_Params.m_FaceSize) + 1;
+	if (!m_Source.Resize(chainCount))
+		return false;
+	for (u32 level = 0; level < chainCount; ++level)
+	{
+		SCubeMip	&mip = m_Source[level];
+		mip.m_Size = m_Params.m_FaceSize >> level;
+		if (!mip.m_Texels.Resize(FACECOUNT * mip.m_Size * mip.m_Size))
+			return false;
+	}
+	{
+		SCubeMip	&mip0 = m_Source[0];
+		for (u32 face = 0; face < FACECOUNT; ++face)
+		{
+			for (u32 y = 0; y < mip0.m_Size; ++y)
+			{
+				for (u32 x = 0; x < mip0.m_Size; ++x)
+				{
+					const CFloat3	d = _TexelDirection(face, x, y, mip0.m_Size);
+					CFloat3			&dst = mip0.m_Texels[(face * mip0.m_Size + y) * mip0.m_Size + x];
+					if (isCubemap)
+					{
+						float		u, v;
+						const u32	srcFace = _DirectionToFace(d, u, v);
+						dst = _SampleBilinear(inputTexels[srcFace].RawDataPointer(), inputSize.x(), inputSize.y(),
+											  (u * 0.5f + 0.5f) * inputSize.x(), (v * 0.5f + 0.5f) * inputSize.y(), false);
+					}
+					else
+					{
+						// Lat-long: same mapping as the ComputeCubemap lat-long compute shader
+						const float	u = 0.5f + atan2f(d.x(), -d.z()) / (2.0f * TNumericConstants<float>::Pi());
+						const float	v = acosf(PKClamp(d.y(), -1.0f, 1.0f)) / TNumericConstants<float>::Pi();
+						dst = _SampleBilinear(inputTexels[0].RawDataPointer(), inputSize.x(), inputSize.y(), u * inputSize.x(), v * inputSize.y(), true);
+					}
+				}
+			}
+		}
+	}
+	for (u32 i = 0; i < inputCount; ++i)
+		inputTexels[i].Clean();
+	for (u32 level = 1; level < chainCount; ++level)
+	{
+		const SCubeMip	&src = m_Source[level - 1];
+		SCubeMip		&dst = m_Source[level];
+		for (u32 face = 0; face < FACECOUNT; ++face)
+		{
+			for (u32 y = 0; y < dst.m_Size; ++y)
+			{
+				for (u32 x = 0; x < dst.m_Size; ++x)
+				{
+					const CFloat3	*srcRow0 = &src.m_Texels[(face * src.m_Size + y * 2) * src.m_Size + x * 2];
+					const CFloat3	*srcRow1 = srcRow0 + src.m_Size;
+					dst.m_Texels[(face * dst.m_Size + y) * dst.m_Size + x] = (srcRow0[0] + srcRow0[1] + srcRow1[0] + srcRow1[1]) * 0.25f;
+				}
+			}
+		}
+	}
+
+	// Background cone angles: successive blurs of the GPU path, composed like gaussians
+	if (!m_BackgroundAngles.Resize(m_Params.m_MipmapCount) ||
+		!m_Background.Resize(m_Params.m_MipmapCount) ||
+		!m_IBL.Resize(m_Params.m_MipmapCountIBL))
+		return false;
+	float	angleSq = 0.0f;
+	m_BackgroundAngles[0] = 0.0f;
+	for (u32 level = 1; level < m_Params.m_MipmapCount; ++level)
+	{
+		const float	angle = BackgroundBlurAngle(level - 1, m_Params.m_MipmapCount);
+		angleSq += angle * angle;
+		m_BackgroundAngles[level] = PKMin(sqrtf(angleSq), TNumericConstants<float>::Pi());
+	}
+	for (u32 level = 1; level < m_Params.m_MipmapCount; ++level)
+	{
+		m_Background[level].m_Size = m_Params.m_FaceSize >> level;
+		if (!m_Background[level].m_Texels.Resize(FACECOUNT * m_Background[level].m_Size * m_Background[level].m_Size))
+			return false;
+	}
+	for (u32 level = 1; level < m_Params.m_MipmapCountIBL; ++level)
+	{
+		m_IBL[level].m_Size = m_Params.m_FaceSizeIBL >> level;
+		if (!m_IBL[level].m_Texels.Resize(FACECOUNT * m_IBL[level].m_Size * m_IBL[level].m_Size))
+			return false;
+	}
+
+	// Filtered faces, largest mips first
+	const u32	faceCount = (m_Params.m_MipmapCount - 1 + m_Params.m_MipmapCountIBL - 1) * FACECOUNT;
+	if (useWorkerPool)
+		RunParallelBatch(faceCount, FastDelegate<void(u32)>(this, &CEnvironmentMapPrefilter::_FilterFace));
+	else
+	{
+		for (u32 i = 0; i < faceCount; ++i)
+			_FilterFace(i);
+	}
+
+	// Irradiance
+	const u32	irradianceLevel = _Log2(m_Params.m_FaceSize) - _Log2(PKMin(m_Params.m_FaceSize, kIrradianceMaxFaceSize));
+	_ProjectIrradianceSH(m_Source[irradianceLevel].m_Texels.RawDataPointer(), m_Source[irradianceLevel].m_Size, m_IrradianceSH);
+
+	// Outputs: mip 0 of both cubemaps is the source chain
+	TArray<const SCubeMip*>	backgroundMips;
+	TArray<const SCubeMip*>	iblMips;
+	if (!backgroundMips.Resize(m_Params.m_MipmapCount) ||
+		!iblMips.Resize(m_Params.m_MipmapCountIBL))
+		return false;
+	backgroundMips[0] = &m_Source[0];
+	for (u32 level = 1; level < m_Params.m_MipmapCount; ++level)
+		backgroundMips[level] = &m_Background[level];
+	iblMips[0] = &m_Source[_Log2(m_Params.m_FaceSize) - _Log2(m_Params.m_FaceSizeIBL)];
+	for (u32 level = 1; level < m_Params.m_MipmapCountIBL; ++level)
+		iblMips[level] = &m_IBL[level];
+
+	const bool	success = _BuildOutputImage(backgroundMips, m_BackgroundCubemap) &&
+						  _BuildOutputImage(iblMips, m_IBLCubemap);
+
+	// The float chains are only needed while filtering
+	m_Source.Clean();
+	m_Background.Clean();
+	m_IBL.Clean();
+	return success;
+}
+
+//----------------------------------------------------------------------------
+
+void	CEnvironmentMapPrefilter::_FilterFace(u32 taskIdx)
+{
+	const u32	backgroundFaceCount = (m_Params.m_MipmapCount - 1) * FACECOUNT;
+	if (taskIdx < backgroundFaceCount)
+		_FilterBackgroundFace(1 + taskIdx / FACECOUNT, taskIdx % FACECOUNT);
+	else
+		_FilterIBLFace(1 + (taskIdx - backgroundFaceCount) / FACECOUNT, (taskIdx - backgroundFaceCount) % FACECOUNT);
+}
+
+//----------------------------------------------------------------------------
+
+void	CEnvironmentMapPrefilter::_FilterBackgroundFace(u32 mip, u32 face)
+{
+	PK_NAMEDSCOPEDPROFILE("CEnvironmentMapPrefilter::_FilterBackgroundFace");
+
+	SCubeMip		&dst = m_Background[mip];
+	const float		angle = m_BackgroundAngles[mip];
+	const float		cosAngle = cosf(angle);
+
+	// Filtered importance sampling: each sample reads the source mip covering its share of the cone
+	const float		texelSolidAngle = 4.0f * TNumericConstants<float>::Pi() / (FACECOUNT * static_cast<float>(m_Params.m_FaceSize) * m_Params.m_FaceSize);
+	const float		sampleSolidAngle = 2.0f * TNumericConstants<float>::Pi() * (1.0f - cosAngle) / kBackgroundSampleCount;
+	const float		lod = PKMax(static_cast<float>(mip), 0.5f * log2f(sampleSolidAngle / texelSolidAngle) + 1.0f);
+
+	for (u32 y = 0; y < dst.m_Size; ++y)
+	{
+		for (u32 x = 0; x < dst.m_Size; ++x)
+		{
+			const CFloat3	n = _TexelDirection(face, x, y, dst.m_Size);
+			CFloat3			t, b;
+			_TangentFrame(n, t, b);
+
+			// Uniform in the cone
+			CFloat3	sum(0.0f);
+			for (u32 i = 0; i < kBackgroundSampleCount; ++i)
+			{
+				const CFloat2	xi = _Hammersley(i, kBackgroundSampleCount);
+				const float		cosTheta = 1.0f - xi.x() * (1.0f - cosAngle);
+				const float		sinTheta = sqrtf(PKMax(0.0f, 1.0f - cosTheta * cosTheta));
+				const float		phi = 2.0f * TNumericConstants<float>::Pi() * xi.y();
+				const CFloat3	l = t * (sinTheta * cosf(phi)) + b * (sinTheta * sinf(phi)) + n * cosTheta;
+				sum += _SampleSource(l, lod);
+			}
+			dst.m_Texels[(face * dst.m_Size + y) * dst.m_Size + x] = sum / static_cast<float>(kBackgroundSampleCount);
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+
+void	CEnvironmentMapPrefilter::_FilterIBLFace(u32 mip, u32 face)
+{
+	PK_NAMEDSCOPEDPROFILE("CEnvironmentMapPrefilter::_FilterIBLFace");
+
+	SCubeMip		&dst = m_IBL[mip];
+	const float		roughness = static_cast<float>(mip) / static_cast<float>(m_Params.m_MipmapCountIBL - 1);
+	const float		alpha = roughness * roughness;
+	const float		alphaSq = alpha * alpha;
+	const u32		sampleCount = m_Params.m_SampleCount;
+
+	// Never sample finer than the IBL mip 0
+	const float		minLod = static_cast<float>(_Log2(m_Params.m_FaceSize) - _Log2(m_Params.m_FaceSizeIBL));
+	const float		texelSolidAngle = 4.0f * TNumericConstants<float>::Pi() / (FACECOUNT * static_cast<float>(m_Params.m_FaceSize) * m_Params.m_FaceSize);
+
+	for (u32 y = 0; y < dst.m_Size; ++y)
+	{
+		for (u32 x = 0; x < dst.m_Size; ++x)
+		{
+			// GGX importance sampling with N = V = R
+			const CFloat3	n = _TexelDirection(face, x, y, dst.m_Size);
+			CFloat3			t, b;
+			_TangentFrame(n, t, b);
+
+			CFloat3	sum(0.0f);
+			float	weight = 0.0f;
+			for (u32 i = 0; i < sampleCount; ++i)
+			{
+				const CFloat2	xi = _Hammersley(i, sampleCount);
+				const float		cosThetaH = sqrtf((1.0f - xi.x()) / (1.0f + (alphaSq - 1.0f) * xi.x()));
+				const float		sinThetaH = sqrtf(PKMax(0.0f, 1.0f - cosThetaH * cosThetaH));
+				const float		phi = 2.0f * TNumericConstants<float>::Pi() * xi.y();
+				const CFloat3	h = t * (sinThetaH * cosf(phi)) + b * (sinThetaH * sinf(phi)) + n * cosThetaH;
+				const float		nDotL = 2.0f * cosThetaH * cosThetaH - 1.0f;
+				if (nDotL <= 0.0f)
+					continue;
+				const CFloat3	l = h * (2.0f * cosThetaH) - n;
+
+				// pdf(l) = D(h) * NdotH / (4 * VdotH) = D(h) / 4
+				const float		denom = cosThetaH * cosThetaH * (alphaSq - 1.0f) + 1.0f;
+				const float		pdf = alphaSq / (TNumericConstants<float>::Pi() * denom * denom) * 0.25f;
+				const float		sampleSolidAngle = 1.0f / (sampleCount * pdf + 1.0e-6f);
+				const float		lod = PKMax(minLod, 0.5f * log2f(sampleSolidAngle / texelSolidAngle) + 1.0f);
+
+				sum += _SampleSource(l, lod) * nDotL;
+				weight += nDotL;
+			}
+			dst.m_Texels[(face * dst.m_Size + y) * dst.m_Size + x] = weight > 0.0f ? sum / weight : CFloat3(0.0f);
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+
+CFloat3	CEnvironmentMapPrefilter::_SampleSource(const CFloat3 &direction, float lod) const
+{
+	float		u, v;
+	const u32	face = _DirectionToFace(direction, u, v);
+	const u32	maxLevel = m_Source.Count() - 1;
+	lod = PKClamp(lod, 0.0f, static_cast<float>(maxLevel));
+	const u32	level0 = static_cast<u32>(lod);
+	const u32	level1 = PKMin(level0 + 1, maxLevel);
+
+	const SCubeMip	&mip0 = m_Source[level0];
+	const SCubeMip	&mip1 = m_Source[level1];
+	const CFloat3	c0 = _SampleBilinear(&mip0.m_Texels[face * mip0.m_Size * mip0.m_Size], mip0.m_Size, mip0.m_Size,
+										 (u * 0.5f + 0.5f) * mip0.m_Size, (v * 0.5f + 0.5f) * mip0.m_Size, false);
+	if (level0 == level1)
+		return c0;
+	const CFloat3	c1 = _SampleBilinear(&mip1.m_Texels[face * mip1.m_Size * mip1.m_Size], mip1.m_Size, mip1.m_Size,
+										 (u * 0.5f + 0.5f) * mip1.m_Size, (v * 0.5f + 0.5f) * mip1.m_Size, false);
+	return PKLerp(c0, c1, lod - static_cast<float>(level0));
+}
+
+//----------------------------------------------------------------------------
+
+bool	CEnvironmentMapPrefilter::_BuildOutputImage(const TMemoryView<const SCubeMip * const> &mips, PImage &outImage) const
+{
+	// Same layout and format as the images of CEnvironmentMap::ExportCubemap(): face major, all the mips of a face are contiguous
+	outImage = PK_NEW(CImage);
+	if (outImage == null || !outImage->m_Frames.Resize(1))
+		return false;
+	outImage->m_Flags |= CImage::Flag_Cubemap;
+	outImage->m_Format = CImage::Format_Fp16RGBA;
+
+	for (u32 face = 0; face < FACECOUNT; ++face)
+	{
+		for (u32 level = 0; level < mips.Count(); ++level)
+		{
+			const SCubeMip	&mip = *mips[level];
+			CImageMap	map;
+			map.m_Dimensions = CUint3(mip.m_Size, mip.m_Size, 1);
+			map.m_RawBuffer = CRefCountedMemoryBuffer::Alloc(map.PixelBufferSize(CImage::Format_Fp32RGBA));
+			if (map.m_RawBuffer == null)
+				return false;
+			CFloat4			*dst = map.m_RawBuffer->Data<CFloat4>();
+			const CFloat3	*src = &mip.m_Texels[face * mip.m_Size * mip.m_Size];
+			for (u32 i = 0; i < mip.m_Size * mip.m_Size; ++i)
+				dst[i] = CFloat4(src[i], 1.0f);
+
+			CImageSurface	surface(map, CImage::Format_Fp32RGBA);
+			if (!surface.Convert(CImage::Format_Fp16RGBA))
+				return false;
+			map.m_RawBuffer = surface.m_RawBuffer;
+			if (!outImage->m_Frames[0].m_Mipmaps.PushBack(map).Valid())
+				return false;
+		}
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+bool	CEnvironmentMapPrefilter::ComputeIrradianceSH(const CImage &cubemap, u32 mip, SIrradianceSH &outSH)
+{
+	if ((cubemap.m_Flags & CImage::Flag_Cubemap) == 0 ||
+		cubemap.m_Frames.Empty() ||
+		cubemap.m_Frames[0].m_Mipmaps.Count() % FACECOUNT != 0 ||
+		cubemap.m_Frames[0].m_Mipmaps.Count() < (mip + 1) * FACECOUNT)
+		return false;
+
+	// Face major
+	const TArray<CImageMap>	&mipmaps = cubemap.m_Frames[0].m_Mipmaps;
+	const u32				mipsPerFace = mipmaps.Count() / FACECOUNT;
+	const u32				faceSize = mipmaps[mip].m_Dimensions.x();
+	TArray<CFloat3>			texels;
+	TArray<CFloat3>			faceTexels;
+	if (!texels.Resize(FACECOUNT * faceSize * faceSize))
+		return false;
+	for (u32 face = 0; face < FACECOUNT; ++face)
+	{
+		const CImageMap	&map = mipmaps[mip + face * mipsPerFace];
+		if (map.m_Dimensions.x() != faceSize || map.m_Dimensions.y() != faceSize ||
+			!_ReadTexels(map, cubemap.m_Format, cubemap.FloatingPoint(), faceTexels))
+			return false;
+		Mem::Copy(&texels[face * faceSize * faceSize], faceTexels.RawDataPointer(), faceTexels.CoveredBytes());
+	}
+	_ProjectIrradianceSH(texels.RawDataPointer(), faceSize, outSH);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+u64	CEnvironmentMapPrefilter::CacheKey(const TMemoryView<const u8> &sourceFileData, const SEnvironmentMapPrefilterParams &params, EEnvironmentMapBaker baker)
+{
+	u64			hash = _HashFNV1a(sourceFileData.Data(), sourceFileData.CoveredBytes());
+	const u32	keyParams[] = { kCacheKeyVersion, static_cast<u32>(baker), params.m_FaceSize, params.m_MipmapCount, params.m_FaceSizeIBL, params.m_MipmapCountIBL, params.m_SampleCount };
+	hash = _HashFNV1a(keyParams, sizeof(keyParams), hash);
+	return hash;
+}
+
+//----------------------------------------------------------------------------
+
+bool	CEnvironmentMapPrefilter::ComputeCacheKey(IFileSystem *fileSystem, const CString &sourcePath, const SEnvironmentMapPrefilterParams &params, EEnvironmentMapBaker baker, u64 &outKey)
+{
+	PK_NAMEDSCOPEDPROFILE("CEnvironmentMapPrefilter::ComputeCacheKey");
+	PFileStream	fileView = fileSystem->OpenStream(sourcePath, IFileSystem::Access_Read, false);
+	if (fileView == null)
+		return false;
+	u32		fileSize = 0;
+	void	*fileData = fileView->Bufferize(fileSize);
+	fileView->Close();
+	if (fileData == null)
+		return false;
+	outKey = CacheKey(TMemoryView<const u8>(static_cast<const u8*>(fileData), fileSize), params, baker);
+	PK_FREE(fileData);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+CString	CEnvironmentMapPrefilter::CacheBasePath(const CString &cacheDir, u64 key)
+{
+	return cacheDir / "EnvironmentMaps" / CString::Format("%016llx", static_cast<unsigned long long>(key));
+}
+
+//----------------------------------------------------------------------------
+
+bool	CEnvironmentMapPrefilter::ReadCacheHeader(IFileSystem *fileSystem, const CString &basePath, u64 key, const SEnvironmentMapPrefilterParams &params, SEnvironmentMapCacheHeader &outHeader)
+{
+	PFileStream	fileView = fileSystem->OpenStream(basePath + ".envmap", IFileSystem::Access_Read, false);
+	if (fileView == null)
+		return false;	// Not cached yet
+	u32		fileSize = 0;
+	void	*fileData = fileView->Bufferize(fileSize);
+	fileView->Close();
+	if (fileData == null || fileSize != sizeof(SEnvironmentMapCacheHeader))
+	{
+		CLog::Log(PK_WARN, "Environment map cache \"%s\" rejected: invalid header size (%d bytes)", basePath.Data(), fileSize);
+		PK_FREE(fileData);
+		return false;
+	}
+	Mem::Copy(&outHeader, fileData, sizeof(SEnvironmentMapCacheHeader));
+	PK_FREE(fileData);
+
+	if (outHeader.m_Magic != SEnvironmentMapCacheHeader::kMagic)
+	{
+		CLog::Log(PK_WARN, "Environment map cache \"%s\" rejected: unknown file format", basePath.Data());
+		return false;
+	}
+	if (outHeader.m_HeaderCRC32 != _HeaderCRC32(outHeader))
+	{
+		CLog::Log(PK_WARN, "Environment map cache \"%s\" rejected: corrupted header", basePath.Data());
+		return false;
+	}
+	if (outHeader.m_Version != SEnvironmentMapCacheHeader::kVersion ||
+		outHeader.m_Key != key ||
+		!_SameParams(outHeader.m_Params, params))
+	{
+		CLog::Log(PK_INFO, "Environment map cache \"%s\" rejected: out of date", basePath.Data());
+		return false;
+	}
+
+	u32	cubeSize = 0, cubeCRC32 = 0;
+	u32	iblSize = 0, iblCRC32 = 0;
+	if (!_FileSizeAndCRC32(fileSystem, basePath + ".cube.pkim", cubeSize, cubeCRC32) ||
+		!_FileSizeAndCRC32(fileSystem, basePath + ".ibl.pkim", iblSize, iblCRC32))
+	{
+		CLog::Log(PK_WARN, "Environment map cache \"%s\" rejected: missing cubemap", basePath.Data());
+		return false;
+	}
+	if (cubeSize != outHeader.m_CubeFileSize || cubeCRC32 != outHeader.m_CubeFileCRC32 ||
+		iblSize != outHeader.m_IBLFileSize || iblCRC32 != outHeader.m_IBLFileCRC32)
+	{
+		CLog::Log(PK_WARN, "Environment map cache \"%s\" rejected: checksum mismatch", basePath.Data());
+		return false;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+#if	(PK_IMAGING_ENABLE_WRITE_CODECS != 0)
+
+bool	CEnvironmentMapPrefilter::WriteCache(	IFileSystem *fileSystem, const CString &basePath, u64 key, const SEnvironmentMapPrefilterParams &params,
+												const CImage &backgroundCubemap, const CImage &iblCubemap, const SIrradianceSH &irradianceSH)
+{
+	PK_NAMEDSCOPEDPROFILE("CEnvironmentMapPrefilter::WriteCache");
+	IImageCodec		*imageCodec = checked_cast<IImageCodec*>(GetPlugin_CImagePKIMCodec());
+	if (imageCodec == null)
+		return false;
+
+	const CString	headerPath = basePath + ".envmap";
+	const CString	cubePath = basePath + ".cube.pkim";
+	const CString	iblPath = basePath + ".ibl.pkim";
+
+	// The header goes last: a previous header must not validate partially written cubemaps
+	fileSystem->FileDelete(headerPath, false);
+
+	CMessageStream			exportReport;
+	SImageCodecWriteConfig	writeCfg;
+	writeCfg.m_CodecData[0] = EExportCodecFlags::ExportFlag_WriteTexels;
+
+	SEnvironmentMapCacheHeader	header;
+	Mem::Clear(&header, sizeof(header));
+	header.m_Magic = SEnvironmentMapCacheHeader::kMagic;
+	header.m_Version = SEnvironmentMapCacheHeader::kVersion;
+	header.m_Key = key;
+	header.m_Params = params;
+	header.m_IrradianceSH = irradianceSH;
+
+	if (!imageCodec->FileSave(fileSystem, backgroundCubemap, cubePath, false, writeCfg, exportReport) ||
+		!imageCodec->FileSave(fileSystem, iblCubemap, iblPath, false, writeCfg, exportReport) ||
+		exportReport.HasErrors() ||
+		!_FileSizeAndCRC32(fileSystem, cubePath, header.m_CubeFileSize, header.m_CubeFileCRC32) ||
+		!_FileSizeAndCRC32(fileSystem, iblPath, header.m_IBLFileSize, header.m_IBLFileCRC32))
+	{
+		CLog::Log(PK_ERROR, "Could not write the environment map cache \"%s\"", basePath.Data());
+		fileSystem->FileDelete(cubePath, false);
+		fileSystem->FileDelete(iblPath, false);
+		return false;
+	}
+	header.m_HeaderCRC32 = _HeaderCRC32(header);
+
+	PFileStream	fileView = fileSystem->OpenStream(headerPath, IFileSystem::Access_WriteCreate, false);
+	const bool	written = fileView != null && fileView->Write(&header, sizeof(header)) != 0;
+	if (fileView != null)
+		fileView->Close();
+	if (!written)
+	{
+		CLog::Log(PK_ERROR, "Could not write the environment map cache header \"%s\"", headerPath.Data());
+		fileSystem->FileDelete(headerPath, false);
+		return false;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+bool	CEnvironmentMapPrefilter::BakeCache(	CResourceManager *resourceManager, const CString &sourcePath, const CString &cacheDir,
+											const SEnvironmentMapPrefilterParams &params, bool useWorkerPool)
+{
+	PK_NAMEDSCOPEDPROFILE("CEnvironmentMapPrefilter::BakeCache");
+	IFileSystem	*fileSystem = resourceManager->FileController();
+
+	u64	key = 0;
+	if (!ComputeCacheKey(fileSystem, sourcePath, params, EnvironmentMapBaker_CPU, key))
+	{
+		CLog::Log(PK_ERROR, "Environment map bake: could not read \"%s\"", sourcePath.Data());
+		return false;
+	}
+	const CString				basePath = CacheBasePath(cacheDir, key);
+	SEnvironmentMapCacheHeader	header;
+	if (ReadCacheHeader(fileSystem, basePath, key, params, header))
+		return true;	// Already baked
+
+	TResourcePtr<CImage>	sourceImage = resourceManager->Load<CImage>(sourcePath, false, SResourceLoadCtl(false, true));
+	if (sourceImage == null || sourceImage->Empty())
+	{
+		CLog::Log(PK_ERROR, "Environment map bake: could not load \"%s\"", sourcePath.Data());
+		return false;
+	}
+
+	CEnvironmentMapPrefilter	prefilter;
+	if (!prefilter.Prefilter(*sourceImage, params, useWorkerPool))
+		return false;
+	return WriteCache(fileSystem, basePath, key, params, *prefilter.BackgroundCubemap(), *prefilter.IBLCubemap(), prefilter.IrradianceSH());
+}
+
+#endif	// (PK_IMAGING_ENABLE_WRITE_CODECS != 0)
+
+//----------------------------------------------------------------------------
+__PK_SAMPLE_API_END
@@ -0,0 +1,134 @@
+#pragma once
+//----------------------------------------------------------------------------
+// This program is the property of Persistant Studios SARL.
+//
+// You may not redistribute it and/or modify it under any conditions
+// without written permission from Persistant Studios SARL, unless
+// otherwise stated in the latest Persistant Studios Code License.
+//
+// See the Persistant Studios Code License for further details.
+//----------------------------------------------------------------------------
+
+#include <PK-SampleLib/PKSample.h>
+
+#include <pk_imaging/include/im_image.h>
+
+__PK_SAMPLE_API_BEGIN
+//----------------------------------------------------------------------------
+//
+//	Environment map prefiltering on the CPU, same outputs as the CEnvironmentMap compute shaders:
+//	- Background cubemap: mip 0 is the source, the other mips are more and more blurred
+//	- IBL cubemap: mip 0 is the source, the other mips are GGX prefiltered (roughness = mip / (mipCount - 1))
+//	and the diffuse irradiance as spherical harmonics. No RHI dependency: caches can be baked headless.
+//
+//----------------------------------------------------------------------------
+
+// Prefiltering settings: part of the cache key
+struct	SEnvironmentMapPrefilterParams
+{
+	u32		m_FaceSize;			// Background cubemap mip 0
+	u32		m_MipmapCount;
+	u32		m_FaceSizeIBL;		// IBL cubemap mip 0
+	u32		m_MipmapCountIBL;
+	u32		m_SampleCount;		// Per texel of the GGX prefiltered mips
+
+	SEnvironmentMapPrefilterParams() : m_FaceSize(1024), m_MipmapCount(11), m_FaceSizeIBL(512), m_MipmapCountIBL(7), m_SampleCount(1024) { }
+};
+
+// Which implementation prefiltered the cached cubemaps: part of the cache key, the outputs are close but not bit exact
+enum	EEnvironmentMapBaker
+{
+	EnvironmentMapBaker_GPU = 0,	// CEnvironmentMap compute shaders, exported at runtime
+	EnvironmentMapBaker_CPU,		// CEnvironmentMapPrefilter::BakeCache()
+};
+
+// L2 spherical harmonics of the irradiance, already convolved with the clamped cosine: E(n) = sum(m_Coeffs[i] * Y[i](n))
+struct	SIrradianceSH
+{
+	CFloat3		m_Coeffs[9];
+};
+
+//----------------------------------------------------------------------------
+
+// Header of the cache files, written last: its presence means the cubemaps were fully written.
+struct	SEnvironmentMapCacheHeader
+{
+	enum
+	{
+		kMagic = 0x4D454B50,	// 'PKEM'
+		kVersion = 1,
+	};
+
+	u32				m_Magic;
+	u32				m_Version;
+	u64				m_Key;
+	SEnvironmentMapPrefilterParams	m_Params;
+	u32				m_CubeFileSize;
+	u32				m_CubeFileCRC32;
+	u32				m_IBLFileSize;
+	u32				m_IBLFileCRC32;
+	SIrradianceSH	m_IrradianceSH;
+	u32				m_HeaderCRC32;		// CRC of all the previous fields
+};
+
+//----------------------------------------------------------------------------
+
+class	CEnvironmentMapPrefilter
+{
+public:
+	CEnvironmentMapPrefilter();
+	~CEnvironmentMapPrefilter();
+
+	// 'source': lat-long image, or cubemap (face major: the mips of each face are contiguous)
+	bool				Prefilter(const CImage &source, const SEnvironmentMapPrefilterParams &params, bool useWorkerPool = true);
+
+	const PImage		&BackgroundCubemap() const { return m_BackgroundCubemap; }
+	const PImage		&IBLCubemap() const { return m_IBLCubemap; }
+	const SIrradianceSH	&IrradianceSH() const { return m_IrradianceSH; }
+
+	// Blur cone angle (radians) applied to 'srcMip' to build the next background mip
+	static float		BackgroundBlurAngle(u32 srcMip, u32 mipCount);
+	// Irradiance of a mip of a cubemap image, any pixel format
+	static bool			ComputeIrradianceSH(const CImage &cubemap, u32 mip, SIrradianceSH &outSH);
+
+	// Cache: '<cacheDir>/<key>.cube.pkim', '<cacheDir>/<key>.ibl.pkim' and the '<cacheDir>/<key>.envmap' header.
+	// The key hashes the source file content, the prefilter params and the baker.
+	static u64			CacheKey(const TMemoryView<const u8> &sourceFileData, const SEnvironmentMapPrefilterParams &params, EEnvironmentMapBaker baker);
+	static bool			ComputeCacheKey(IFileSystem *fileSystem, const CString &sourcePath, const SEnvironmentMapPrefilterParams &params, EEnvironmentMapBaker baker, u64 &outKey);
+	static CString		CacheBasePath(const CString &cacheDir, u64 key);
+	// Validates the header and the checksums of the cubemap files
+	static bool			ReadCacheHeader(IFileSystem *fileSystem, const CString &basePath, u64 key, const SEnvironmentMapPrefilterParams &params, SEnvironmentMapCacheHeader &outHeader);
+#if	(PK_IMAGING_ENABLE_WRITE_CODECS != 0)
+	static bool			WriteCache(	IFileSystem *fileSystem, const CString &basePath, u64 key, const SEnvironmentMapPrefilterParams &params,
+									const CImage &backgroundCubemap, const CImage &iblCubemap, const SIrradianceSH &irradianceSH);
+	// Headless: loads 'sourcePath', prefilters it on the CPU and writes its cache files, under the EnvironmentMapBaker_CPU key
+	static bool			BakeCache(	CResourceManager *resourceManager, const CString &sourcePath, const CString &cacheDir,
+									const SEnvironmentMapPrefilterParams &params, bool useWorkerPool = true);
+#endif
+
+private:
+	struct	SCubeMip
+	{
+		u32					m_Size;
+		TArray<CFloat3>		m_Texels;	// 6 faces of m_Size * m_Size texels
+	};
+
+	void				_FilterFace(u32 taskIdx);
+	void				_FilterBackgroundFace(u32 mip, u32 face);
+	void				_FilterIBLFace(u32 mip, u32 face);
+	CFloat3				_SampleSource(const CFloat3 &direction, float lod) const;
+	bool				_BuildOutputImage(const TMemoryView<const SCubeMip * const> &mips, PImage &outImage) const;
+
+	SEnvironmentMapPrefilterParams	m_Params;
+	TArray<SCubeMip>				m_Source;			// Source resampled to m_FaceSize, with box filtered mips
+	TArray<SCubeMip>				m_Background;
+	TArray<SCubeMip>				m_IBL;
+	TArray<float>					m_BackgroundAngles;	// Cumulated blur angle of each background mip
+
+	PImage							m_BackgroundCubemap;
+	PImage							m_IBLCubemap;
+	SIrradianceSH					m_IrradianceSH;
+};
+
+//----------------------------------------------------------------------------
+__PK_SAMPLE_API_END
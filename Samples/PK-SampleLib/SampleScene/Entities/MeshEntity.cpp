@@ -11,6 +11,7 @@
 #include "precompiled.h"
 
 #include "MeshEntity.h"
+#include "MeshOptimizer.h"
 
 #include <pk_rhi/include/AllInterfaces.h>
 #include <pk_rhi/include/interfaces/SApiContext.h>
@@ -35,6 +36,8 @@ SMesh::SMesh()
 ,	m_MeshLOD(0)
 ,	m_Roughness(0.5)
 ,	m_Metalness(0)
+,	m_HasVertexColors(false)
+,	m_OptimizeVertexCache(false)
 ,	m_ResourceDirtyKey(0)
 ,	m_ResourceCleanKey(0)
 {
@@ -56,7 +59,37 @@ SMesh::~SMesh()
 
 //----------------------------------------------------------------------------
 
-bool	SMesh::_AddMeshBatch(const RHI::PApiManager &apiManager, CMeshNew *mesh, u32 colorSet, EVertexColorMode vertexColorMode)
+bool	SMesh::_OptimizeIndices(const CMeshIStream &iStream, u32 vertexCount, bool reorderVertices, TArray<u32> &outIndices, TArray<u32> &outVertexOrder, SVertexCacheStats &stats)
+{
+	const u32	indexCount = iStream.IndexCount();
+	if (!outIndices.Resize(indexCount))
+		return false;
+	if (iStream.IndexByteWidth() == CMeshIStream::U16Indices)
+	{
+		const u16	*src = iStream.Stream<u16>();
+		for (u32 i = 0; i < indexCount; ++i)
+			outIndices[i] = src[i];
+	}
+	else
+		Mem::Copy(outIndices.RawDataPointer(), iStream.Stream<u32>(), indexCount * sizeof(u32));
+
+	const u32	missesBefore = CMeshOptimizer::CountCacheMisses(outIndices, vertexCount);
+	if (!CMeshOptimizer::OptimizeVertexCache(outIndices, vertexCount) ||
+		(reorderVertices && !CMeshOptimizer::OptimizeVertexFetch(outIndices, vertexCount, outVertexOrder)))
+	{
+		outIndices.Clear();
+		outVertexOrder.Clear();
+		return false;
+	}
+	stats.m_TriangleCount += indexCount / 3;
+	stats.m_MissesBefore += missesBefore;
+	stats.m_MissesAfter += CMeshOptimizer::CountCacheMisses(outIndices, vertexCount);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+bool	SMesh::_AddMeshBatch(const RHI::PApiManager &apiManager, CMeshNew *mesh, bool isSkinned, u32 colorSet, EVertexColorMode vertexColorMode, SVertexCacheStats &stats)
 {
 	if (!m_MeshBatches.PushBack().Valid())
 		return false;
@@ -75,6 +108,25 @@ bool	SMesh::_AddMeshBatch(const RHI::PApiManager &apiManager, CMeshNew *mesh, u3
 
 	u32				offset = 0;
 	const u32		vertexCount = positions.Count();
+
+	// Triangles in vertex cache order, vertices in first use order: same streams, shuffled.
+	// Partial streams are filled with defaults below, they can't be shuffled.
+	// Skinned meshes keep their vertex order: the instances' skinned vertex buffers, drawn with this index buffer,
+	// are written by the CPU skinner in the source order.
+	TArray<u32>		optimizedIndices;
+	TArray<u32>		vertexOrderArray;	// New to old vertex index
+	const bool		canReorder =	(normals.Empty() || normals.Count() == vertexCount) &&
+									(tangents.Empty() || tangents.Count() == vertexCount) &&
+									(texCoords.Empty() || texCoords.Count() == vertexCount) &&
+									(colors.Empty() || colors.Count() == vertexCount);
+	if (m_OptimizeVertexCache && canReorder && vertexCount > 0 &&
+		triangleBatch.m_IStream.PrimitiveType() == CMeshIStream::Triangles &&
+		triangleBatch.m_IStream.RawStream() != null)
+	{
+		if (!_OptimizeIndices(triangleBatch.m_IStream, vertexCount, !isSkinned, optimizedIndices, vertexOrderArray, stats))
+			CLog::Log(PK_WARN, "Mesh \"%s\": could not optimize the vertex cache order, using the source order", m_MeshPath.Data());
+	}
+	const u32		*vertexOrder = vertexOrderArray.Empty() ? null : vertexOrderArray.RawDataPointer();
 	const u32		totalVboSize =	vertexCount * (positions.ElementSizeInBytes() + normals.ElementSizeInBytes() + texCoords.ElementSizeInBytes() + (m_HasVertexColors ? colors.ElementSizeInBytes() : 0) + tangents.ElementSizeInBytes());
 	RHI::PGpuBuffer	vertexBuffer = apiManager->CreateGpuBuffer(RHI::SRHIResourceInfos("Mesh Vertex Buffer"), RHI::VertexBuffer, totalVboSize);
 	if (vertexBuffer == null)
@@ -89,7 +141,7 @@ bool	SMesh::_AddMeshBatch(const RHI::PApiManager &apiManager, CMeshNew *mesh, u3
 	{
 		CFloat3		*buffData = static_cast<CFloat3*>(Mem::AdvanceRawPointer(mappedVertexBuffer, offset));
 		for (u32 i = 0; i < vertexCount; ++i)
-			buffData[i] = positions[i];
+			buffData[i] = positions[vertexOrder != null ? vertexOrder[i] : i];
 	}
 	offset += positions.ElementSizeInBytes() * vertexCount;
 
@@ -100,7 +152,7 @@ bool	SMesh::_AddMeshBatch(const RHI::PApiManager &apiManager, CMeshNew *mesh, u3
 	{
 		CFloat3		*buffData = static_cast<CFloat3*>(Mem::AdvanceRawPointer(mappedVertexBuffer, offset));
 		for (u32 i = 0; i < vertexCount; ++i)
-			buffData[i] = normals[i];
+			buffData[i] = normals[vertexOrder != null ? vertexOrder[i] : i];
 	}
 	else // don't fail - fill with default
 	{
@@ -120,9 +172,17 @@ bool	SMesh::_AddMeshBatch(const RHI::PApiManager &apiManager, CMeshNew *mesh, u3
 	if (positions.Count() == tangents.Count())
 	{
 		CFloat4		*buffData = static_cast<CFloat4*>(Mem::AdvanceRawPointer(mappedVertexBuffer, offset));
-		PK_ASSERT(!tangents.Virtual() && tangents.Contiguous());
-		PK_ASSERT(tangents.CoveredBytes() == vertexCount * sizeof(*buffData));
-		Mem::Copy_Uncached(buffData, tangents.Data(), vertexCount * sizeof(*buffData));
+		if (vertexOrder != null)
+		{
+			for (u32 i = 0; i < vertexCount; ++i)
+				buffData[i] = tangents[vertexOrder[i]];
+		}
+		else
+		{
+			PK_ASSERT(!tangents.Virtual() && tangents.Contiguous());
+			PK_ASSERT(tangents.CoveredBytes() == vertexCount * sizeof(*buffData));
+			Mem::Copy_Uncached(buffData, tangents.Data(), vertexCount * sizeof(*buffData));
+		}
 	}
 	else // don't fail - fill with default
 	{
@@ -144,7 +204,7 @@ bool	SMesh::_AddMeshBatch(const RHI::PApiManager &apiManager, CMeshNew *mesh, u3
 	{
 		CFloat2		*buffData = static_cast<CFloat2*>(Mem::AdvanceRawPointer(mappedVertexBuffer, offset));
 		for (u32 i = 0; i < vertexCount; ++i)
-			buffData[i] = texCoords[i];
+			buffData[i] = texCoords[vertexOrder != null ? vertexOrder[i] : i];
 	}
 	else // don't fail - fill with default
 	{
@@ -167,14 +227,14 @@ bool	SMesh::_AddMeshBatch(const RHI::PApiManager &apiManager, CMeshNew *mesh, u3
 		if (vertexColorMode == VCMode_Alpha)
 		{
 			for (u32 i = 0; i < vertexCount; ++i)
-				buffData[i] = colors[i].www1();
+				buffData[i] = colors[vertexOrder != null ? vertexOrder[i] : i].www1();
 		}
 		else if (vertexColorMode == VCMode_UV)
 		{
 			if (!texCoords.Empty())
 			{
 				for (u32 i = 0; i < vertexCount; ++i)
-					buffData[i] = CFloat4(texCoords[i], 0, 1);
+					buffData[i] = CFloat4(texCoords[vertexOrder != null ? vertexOrder[i] : i], 0, 1);
 			}
 			else
 			{
@@ -185,7 +245,7 @@ bool	SMesh::_AddMeshBatch(const RHI::PApiManager &apiManager, CMeshNew *mesh, u3
 		else
 		{
 			for (u32 i = 0; i < vertexCount; ++i)
-				buffData[i] = colors[i];
+				buffData[i] = colors[vertexOrder != null ? vertexOrder[i] : i];
 		}
 		offset += colors.ElementSizeInBytes() * vertexCount;
 	}
@@ -208,7 +268,20 @@ bool	SMesh::_AddMeshBatch(const RHI::PApiManager &apiManager, CMeshNew *mesh, u3
 	if (!PK_VERIFY(buffIndexData != null))
 		return false;
 
-	Mem::Copy(buffIndexData, indexData, triangleBatch.m_IStream.StreamSize());
+	if (!optimizedIndices.Empty())
+	{
+		// Same index width as the source
+		if (triangleBatch.m_IStream.IndexByteWidth() == CMeshIStream::U16Indices)
+		{
+			u16	*dstIndices = static_cast<u16*>(buffIndexData);
+			for (u32 i = 0; i < optimizedIndices.Count(); ++i)
+				dstIndices[i] = static_cast<u16>(optimizedIndices[i]);
+		}
+		else
+			Mem::Copy(buffIndexData, optimizedIndices.RawDataPointer(), optimizedIndices.CoveredBytes());
+	}
+	else
+		Mem::Copy(buffIndexData, indexData, triangleBatch.m_IStream.StreamSize());
 
 	meshBuffers.m_BindPoseVertexBuffers = vertexBuffer;
 	apiManager->UnmapCpuView(meshBuffers.m_IndexBuffer);
@@ -353,16 +426,24 @@ bool	SMesh::Load(	const RHI::PApiManager &apiManager,
 	m_ConstantSet->UpdateConstantValues();
 
 	TMemoryView<const PResourceMeshBatch>	batchList = m_MeshResource->BatchList(m_MeshLOD);
+	SVertexCacheStats						vertexCacheStats;
 
 	for (const auto &batch : batchList)
 	{
 		if (PK_VERIFY(batch != null) &&
-			!_AddMeshBatch(apiManager, batch->RawMesh(), colorSet, vertexColorMode))
+			!_AddMeshBatch(apiManager, batch->RawMesh(), batch->IsSkinned(), colorSet, vertexColorMode, vertexCacheStats))
 		{
 			return false;
 		}
 	}
 
+	if (vertexCacheStats.m_TriangleCount > 0)
+	{
+		const float	triangleCount = static_cast<float>(vertexCacheStats.m_TriangleCount);
+		CLog::Log(PK_INFO, "Mesh \"%s\": vertex cache ACMR %.3f -> %.3f (%u triangles)",
+				  m_MeshPath.Data(), vertexCacheStats.m_MissesBefore / triangleCount, vertexCacheStats.m_MissesAfter / triangleCount, vertexCacheStats.m_TriangleCount);
+	}
+
 	m_ResourceCleanKey = prevDirtyKey;
 	return true;
 }
@@ -120,6 +120,7 @@ struct	SMesh
 	float							m_Roughness;
 	float							m_Metalness;
 	bool							m_HasVertexColors;
+	bool							m_OptimizeVertexCache;	// Reorders triangle lists for the vertex cache and the vertex fetch at load time
 
 	PImage							m_DummyWhiteImage;
 	PImage							m_DummyNormalImage;
@@ -131,8 +132,18 @@ struct	SMesh
 	bool							IsDirty() const { return m_ResourceDirtyKey.Load() != m_ResourceCleanKey; }
 
 private:
+	struct	SVertexCacheStats
+	{
+		u32		m_TriangleCount;
+		u32		m_MissesBefore;
+		u32		m_MissesAfter;
+
+		SVertexCacheStats() : m_TriangleCount(0), m_MissesBefore(0), m_MissesAfter(0) { }
+	};
+
 	static bool				_LoadMap(const RHI::PApiManager &apiManager, STextureMap &map, CResourceManager *resourceManager, bool interpretAsSrgb = true);
-	bool					_AddMeshBatch(const RHI::PApiManager &apiManager, CMeshNew *mesh, u32 colorSet, EVertexColorMode vertexColorMode);
+	bool					_AddMeshBatch(const RHI::PApiManager &apiManager, CMeshNew *mesh, bool isSkinned, u32 colorSet, EVertexColorMode vertexColorMode, SVertexCacheStats &stats);
+	static bool				_OptimizeIndices(const CMeshIStream &iStream, u32 vertexCount, bool reorderVertices, TArray<u32> &outIndices, TArray<u32> &outVertexOrder, SVertexCacheStats &stats);
 	void					_OnResourceReloaded(CResourceMesh *resource);
 };
 
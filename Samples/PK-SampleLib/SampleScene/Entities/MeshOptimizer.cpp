@@ -0,0 +1,212 @@
+//----------------------------------------------------------------------------
+// This program is the property of Persistant Studios SARL.
+//
+// You may not redistribute it and/or modify it under any conditions
+// without written permission from Persistant Studios SARL, unless
+// otherwise stated in the latest Persistant Studios Code License.
+//
+// See the Persistant Studios Code License for further details.
+//----------------------------------------------------------------------------
+
+#include "precompiled.h"
+
+#include "MeshOptimizer.h"
+
+__PK_SAMPLE_API_BEGIN
+//----------------------------------------------------------------------------
+
+static const u32	kInvalidVertex = 0xFFFFFFFF;
+
+//----------------------------------------------------------------------------
+
+// Next vertex with triangles left: from the dead-end stack (recently emitted), then in input order
+static u32	_SkipDeadEnd(TArray<u32> &deadEndStack, const TArray<u32> &liveTriangles, u32 &cursor, u32 vertexCount)
+{
+	while (!deadEndStack.Empty())
+	{
+		const u32	vertex = deadEndStack.Last();
+		deadEndStack.PopBackAndDiscard();
+		if (liveTriangles[vertex] > 0)
+			return vertex;
+	}
+	while (cursor < vertexCount)
+	{
+		if (liveTriangles[cursor] > 0)
+			return cursor;
+		++cursor;
+	}
+	return kInvalidVertex;
+}
+
+//----------------------------------------------------------------------------
+
+bool	CMeshOptimizer::OptimizeVertexCache(const TMemoryView<u32> &indices, u32 vertexCount, u32 cacheSize)
+{
+	PK_NAMEDSCOPEDPROFILE("CMeshOptimizer::OptimizeVertexCache");
+	const u32	triangleCount = indices.Count() / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+		return true;
+
+	// Vertex -> triangles adjacency, compact
+	TArray<u32>		liveTriangles;
+	TArray<u32>		adjacencyOffsets;
+	TArray<u32>		adjacency;
+	if (!liveTriangles.Resize(vertexCount) ||
+		!adjacencyOffsets.Resize(vertexCount + 1) ||
+		!adjacency.Resize(triangleCount * 3))
+		return false;
+	Mem::Clear(liveTriangles.RawDataPointer(), liveTriangles.CoveredBytes());
+	for (u32 i = 0; i < triangleCount * 3; ++i)
+	{
+		if (!PK_VERIFY(indices[i] < vertexCount))
+			return false;
+		++liveTriangles[indices[i]];
+	}
+	adjacencyOffsets[0] = 0;
+	for (u32 v = 0; v < vertexCount; ++v)
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+	{
+		TArray<u32>	fill;
+		if (!fill.Resize(vertexCount))
+			return false;
+		Mem::Copy(fill.RawDataPointer(), adjacencyOffsets.RawDataPointer(), fill.CoveredBytes());
+		for (u32 i = 0; i < triangleCount * 3; ++i)
+			adjacency[fill[indices[i]]++] = i / 3;
+	}
+
+	TArray<u32>		cacheTimeStamps;
+	TArray<bool>	emitted;
+	TArray<u32>		deadEndStack;
+	TArray<u32>		candidates;
+	TArray<u32>		output;
+	if (!cacheTimeStamps.Resize(vertexCount) ||
+		!emitted.Resize(triangleCount) ||
+		!deadEndStack.Reserve(triangleCount * 3) ||
+		!output.Resize(triangleCount * 3))
+		return false;
+	Mem::Clear(cacheTimeStamps.RawDataPointer(), cacheTimeStamps.CoveredBytes());
+	Mem::Clear(emitted.RawDataPointer(), emitted.CoveredBytes());
+
+	u32	timeStamp = cacheSize + 1;
+	u32	cursor = 0;
+	u32	outputCount = 0;
+	u32	fanningVertex = _SkipDeadEnd(deadEndStack, liveTriangles, cursor, vertexCount);
+	while (fanningVertex != kInvalidVertex)
+	{
+		candidates.Clear();
+
+		// Emits all the remaining triangles around the fanning vertex
+		for (u32 a = adjacencyOffsets[fanningVertex]; a < adjacencyOffsets[fanningVertex + 1]; ++a)
+		{
+			const u32	triangle = adjacency[a];
+			if (emitted[triangle])
+				continue;
+			emitted[triangle] = true;
+			for (u32 k = 0; k < 3; ++k)
+			{
+				const u32	vertex = indices[triangle * 3 + k];
+				output[outputCount++] = vertex;
+				if (!deadEndStack.PushBack(vertex).Valid() ||
+					!candidates.PushBack(vertex).Valid())
+					return false;
+				--liveTriangles[vertex];
+				if (timeStamp - cacheTimeStamps[vertex] > cacheSize)
+					cacheTimeStamps[vertex] = timeStamp++;
+			}
+		}
+
+		// Next fanning vertex: the oldest candidate still in the cache once its triangles are emitted
+		u32	nextVertex = kInvalidVertex;
+		s32	bestPriority = -1;
+		for (u32 c = 0; c < candidates.Count(); ++c)
+		{
+			const u32	vertex = candidates[c];
+			if (liveTriangles[vertex] == 0)
+				continue;
+			s32			priority = 0;
+			const u32	age = timeStamp - cacheTimeStamps[vertex];
+			if (age + 2 * liveTriangles[vertex] <= cacheSize)
+				priority = static_cast<s32>(age);
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				nextVertex = vertex;
+			}
+		}
+		if (nextVertex == kInvalidVertex)
+			nextVertex = _SkipDeadEnd(deadEndStack, liveTriangles, cursor, vertexCount);
+		fanningVertex = nextVertex;
+	}
+	PK_ASSERT(outputCount == triangleCount * 3);
+
+	Mem::Copy(indices.Data(), output.RawDataPointer(), output.CoveredBytes());
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+bool	CMeshOptimizer::OptimizeVertexFetch(const TMemoryView<u32> &indices, u32 vertexCount, TArray<u32> &outNewToOld)
+{
+	PK_NAMEDSCOPEDPROFILE("CMeshOptimizer::OptimizeVertexFetch");
+	TArray<u32>	oldToNew;
+	if (!oldToNew.Resize(vertexCount) ||
+		!outNewToOld.Resize(vertexCount))
+		return false;
+	Mem::Fill32(oldToNew.RawDataPointer(), kInvalidVertex, oldToNew.Count());
+
+	u32	newCount = 0;
+	for (u32 i = 0; i < indices.Count(); ++i)
+	{
+		const u32	vertex = indices[i];
+		if (!PK_VERIFY(vertex < vertexCount))
+			return false;
+		if (oldToNew[vertex] == kInvalidVertex)
+		{
+			oldToNew[vertex] = newCount;
+			outNewToOld[newCount++] = vertex;
+		}
+		indices[i] = oldToNew[vertex];
+	}
+	for (u32 v = 0; v < vertexCount; ++v)
+	{
+		if (oldToNew[v] == kInvalidVertex)
+			outNewToOld[newCount++] = v;
+	}
+	PK_ASSERT(newCount == vertexCount);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+u32	CMeshOptimizer::CountCacheMisses(const TMemoryView<const u32> &indices, u32 vertexCount, u32 cacheSize)
+{
+	// FIFO: a vertex is in the cache if it missed less than 'cacheSize' misses ago
+	TArray<u32>	missStamps;
+	if (cacheSize == 0 || !missStamps.Resize(vertexCount))
+		return indices.Count();
+	Mem::Fill32(missStamps.RawDataPointer(), kInvalidVertex, missStamps.Count());
+
+	u32	misses = 0;
+	for (u32 i = 0; i < indices.Count(); ++i)
+	{
+		const u32	vertex = indices[i];
+		if (vertex >= vertexCount)
+			continue;
+		if (missStamps[vertex] == kInvalidVertex || misses - missStamps[vertex] >= cacheSize)
+			missStamps[vertex] = misses++;
+	}
+	return misses;
+}
+
+//----------------------------------------------------------------------------
+
+float	CMeshOptimizer::ComputeACMR(const TMemoryView<const u32> &indices, u32 vertexCount, u32 cacheSize)
+{
+	const u32	triangleCount = indices.Count() / 3;
+	if (triangleCount == 0)
+		return 0.0f;
+	return static_cast<float>(CountCacheMisses(indices, vertexCount, cacheSize)) / static_cast<float>(triangleCount);
+}
+
+//----------------------------------------------------------------------------
+__PK_SAMPLE_API_END
@@ -0,0 +1,41 @@
+#pragma once
+//----------------------------------------------------------------------------
+// This program is the property of Persistant Studios SARL.
+//
+// You may not redistribute it and/or modify it under any conditions
+// without written permission from Persistant Studios SARL, unless
+// otherwise stated in the latest Persistant Studios Code License.
+//
+// See the Persistant Studios Code License for further details.
+//----------------------------------------------------------------------------
+
+#include <PK-SampleLib/PKSample.h>
+
+__PK_SAMPLE_API_BEGIN
+//----------------------------------------------------------------------------
+//
+//	Load time reordering of indexed triangle lists, for the post-transform vertex cache
+//	and the vertex fetch. CPU only, no RHI dependency.
+//
+//----------------------------------------------------------------------------
+
+class	CMeshOptimizer
+{
+public:
+	enum	{ kDefaultCacheSize = 16 };
+
+	// Tipsify (Sander et al. 2007): reorders the triangles in place, the vertices are unchanged.
+	// Linear in the triangle count: cheap enough to run at each mesh load.
+	static bool		OptimizeVertexCache(const TMemoryView<u32> &indices, u32 vertexCount, u32 cacheSize = kDefaultCacheSize);
+
+	// Renumbers the vertices in first use order, indices are remapped in place.
+	// 'outNewToOld[newIdx]' is the source vertex of each output vertex, unreferenced vertices go last.
+	static bool		OptimizeVertexFetch(const TMemoryView<u32> &indices, u32 vertexCount, TArray<u32> &outNewToOld);
+
+	// Vertex shader invocations per triangle with a FIFO cache of 'cacheSize' entries: 3 at worst, ~0.5 at best
+	static u32		CountCacheMisses(const TMemoryView<const u32> &indices, u32 vertexCount, u32 cacheSize = kDefaultCacheSize);
+	static float	ComputeACMR(const TMemoryView<const u32> &indices, u32 vertexCount, u32 cacheSize = kDefaultCacheSize);
+};
+
+//----------------------------------------------------------------------------
+__PK_SAMPLE_API_END
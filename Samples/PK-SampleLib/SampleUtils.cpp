@@ -24,6 +24,7 @@
 #include <pk_geometrics/include/ge_mesh_deformers_skin.h>
 #include <pk_kernel/include/kr_memoryviews_utils.h>
 #include <pk_maths/include/pk_maths_type_converters.h>
+#include <pk_render_helpers/include/draw_requests/rh_job_pools.h>
 
 #include <math.h>
 
@@ -105,6 +106,129 @@ const char	*GetShaderExtensionStringFromStage(RHI::EShaderStage stage)
 
 //----------------------------------------------------------------------------
 
+namespace
+{
+	struct	SCRC32Table
+	{
+		u32		m_Table[256];
+
+		SCRC32Table()
+		{
+			for (u32 i = 0; i < 256; ++i)
+			{
+				u32	c = i;
+				for (u32 k = 0; k < 8; ++k)
+					c = (c & 1) ? (0xEDB88320U ^ (c >> 1)) : (c >> 1);
+				m_Table[i] = c;
+			}
+		}
+	};
+}
+
+//----------------------------------------------------------------------------
+
+u32		ComputeCRC32(const void *data, u32 sizeInBytes, u32 crc)
+{
+	static const SCRC32Table	kTable;
+
+	const u8	*bytes = static_cast<const u8*>(data);
+	crc = ~crc;
+	for (u32 i = 0; i < sizeInBytes; ++i)
+		crc = kTable.m_Table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+//----------------------------------------------------------------------------
+//
+//	Parallel batch: items claimed by the helper jobs and by the calling thread
+//
+//----------------------------------------------------------------------------
+
+namespace
+{
+	// Ref-counted: a helper job that starts after the caller returned only sees the exhausted counter, never the delegate's data
+	class	CParallelBatch : public CRefCountedObject
+	{
+	public:
+		FastDelegate<void(u32)>		m_ProcessItem;
+		u32							m_ItemCount;
+		TAtomic<u32>				m_NextItem;
+		TAtomic<u32>				m_DoneItems;
+		Threads::CEvent				m_Finished;
+
+		CParallelBatch() : m_ItemCount(0), m_NextItem(0), m_DoneItems(0) { }
+		~CParallelBatch() { }
+
+		void		Run()
+		{
+			for (;;)
+			{
+				const u32	itemIdx = m_NextItem.Inc() - 1;
+				if (itemIdx >= m_ItemCount)
+					return;
+				m_ProcessItem(itemIdx);
+				if (m_DoneItems.Inc() == m_ItemCount)
+					m_Finished.Trigger();
+			}
+		}
+	};
+	PK_DECLARE_REFPTRCLASS(ParallelBatch);
+
+	//----------------------------------------------------------------------------
+
+	class	CParallelBatchJob : public CAsynchronousJob
+	{
+	public:
+		PParallelBatch	m_Batch;
+
+		CParallelBatchJob() { }
+		~CParallelBatchJob() { }
+
+	protected:
+		virtual void		_VirtualLaunch(Threads::SThreadContext &) override
+		{
+			PK_NAMEDSCOPEDPROFILE("Parallel batch job");
+			m_Batch->Run();
+			m_Batch = null;
+		}
+	};
+	PK_DECLARE_REFPTRCLASS(ParallelBatchJob);
+}
+
+//----------------------------------------------------------------------------
+
+void	RunParallelBatch(u32 itemCount, const FastDelegate<void(u32)> &processItem, u32 maxHelperJobs /*= 7*/)
+{
+	PParallelBatch	batch = itemCount > 1 ? PK_NEW(CParallelBatch) : null;
+	if (batch == null)
+	{
+		// Single item (or out of memory): processed here, no job to wait for
+		for (u32 i = 0; i < itemCount; ++i)
+			processItem(i);
+		return;
+	}
+	batch->m_ProcessItem = processItem;
+	batch->m_ItemCount = itemCount;
+
+	const u32	helperCount = PKMin(itemCount - 1, maxHelperJobs);
+	for (u32 i = 0; i < helperCount; ++i)
+	{
+		PParallelBatchJob	job = PK_NEW(CParallelBatchJob);
+		if (job == null)
+			break;
+		job->m_Batch = batch;
+		job->AddToPool(Scheduler::ThreadPool());
+	}
+	Scheduler::ThreadPool()->KickTasks(true);
+
+	batch->Run();
+	// All items are claimed: only wait for the ones being processed by the helpers
+	if (batch->m_DoneItems.Load() != itemCount)
+		batch->m_Finished.Wait();
+}
+
+//----------------------------------------------------------------------------
+
 bool	SSamplableRenderTarget::CreateRenderTarget(	const RHI::SRHIResourceInfos	&infos,
 													const RHI::PApiManager			&apiManager,
 													const RHI::PConstantSampler		&sampler,
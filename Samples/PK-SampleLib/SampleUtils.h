@@ -43,6 +43,15 @@ const char				*GetShaderExtensionStringFromApi(RHI::EGraphicalApi api, bool tmpF
 const char				*GetShaderLogExtensionStringFromAPI(RHI::EGraphicalApi API);
 const char				*GetShaderExtensionStringFromStage(RHI::EShaderStage stage);
 
+// Standard CRC-32 (IEEE 802.3 polynomial), used to validate the cache files written by the samples.
+// Pass the previous result as 'crc' to checksum data in several chunks.
+u32						ComputeCRC32(const void *data, u32 sizeInBytes, u32 crc = 0);
+
+// Calls 'processItem' for every item in [0, itemCount) on the worker pool *and* on the calling thread, returns once they are all processed.
+// Items are claimed atomically: the calling thread never waits for a helper job that did not start (no dead-lock when the pool is busy),
+// and 'processItem' is never called after the function returned (it can point to data on the caller's stack).
+void					RunParallelBatch(u32 itemCount, const FastDelegate<void(u32)> &processItem, u32 maxHelperJobs = 7);
+
 //----------------------------------------------------------------------------
 
 template<u32 _D>
@@ -47,6 +47,17 @@ bool	CMetalShaderGenerator::GatherShaderInfo(const CString &shaderContent, const
 
 //----------------------------------------------------------------------------
 
+void	CMetalShaderGenerator::AppendStateToCacheKey(CBufferDigesterMD5 &digester) const
+{
+	// Generated samplers declarations depend on the texture parameters gathered so far
+	const u32	paramCount = m_TextureParameters.Count();
+	digester.Append(&paramCount, sizeof(paramCount));
+	for (const CString &param : m_TextureParameters)
+		digester.Append(param.Data(), param.Length() + 1); // include the null terminator as separator
+}
+
+//----------------------------------------------------------------------------
+
 CString CMetalShaderGenerator::GenDefines(const RHI::SShaderDescription &description) const
 {
 	(void)description;
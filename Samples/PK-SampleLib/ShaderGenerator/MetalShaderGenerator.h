@@ -58,6 +58,9 @@ private:
 	virtual CString		GenComputeMain(	const CUint3						dispatchSize,
 										const TMemoryView<const CString>	&funcToCall) override final;
 
+protected:
+	virtual void		AppendStateToCacheKey(CBufferDigesterMD5 &digester) const override;
+
 private:
 	bool				_FindAllTextureFunctionParameters(const CString &shaderCode);
 	bool				_FindMacroParametersInShader(const CString &shaderCode, const CStringView &macro);
@@ -332,32 +332,37 @@ namespace
 
 		return shaderCode;
 	}
+
+	//----------------------------------------------------------------------------
+
+	// Identical for all permutations. A literal: no PopcornFX allocation outliving the allocators
+	const char	kGetMeshTransformHelper[] =
+		"mat4		GetMeshMatrix(IN(SVertexInput) vInput VS_ARGS)\n"
+		"{\n"
+		"#if		defined(VRESOURCE_MeshTransforms)\n"
+		"	const uint	storageID = GET_CONSTANT(GPUMeshPushConstants, DrawRequest);\n"
+		"	const uint	indirectionOffsetsID = GET_CONSTANT(GPUMeshPushConstants, IndirectionOffsetsIndex);\n"
+		"	const uint	indirectionOffset = LOADU(GET_RAW_BUFFER(IndirectionOffsets), RAW_BUFFER_INDEX(indirectionOffsetsID));\n"
+		"	const uint	transformsOffset = LOADU(GET_RAW_BUFFER(MeshTransformsOffsets), RAW_BUFFER_INDEX(storageID));\n"
+		"	const uint	particleID = LOADU(GET_RAW_BUFFER(Indirection), indirectionOffset + RAW_BUFFER_INDEX(vInput.InstanceId));\n"
+		"	const vec4	m0 = LOADF4(GET_RAW_BUFFER(MeshTransforms), transformsOffset + RAW_BUFFER_INDEX(particleID * 16 + 0 * 4));\n"
+		"	const vec4	m1 = LOADF4(GET_RAW_BUFFER(MeshTransforms), transformsOffset + RAW_BUFFER_INDEX(particleID * 16 + 1 * 4));\n"
+		"	const vec4	m2 = LOADF4(GET_RAW_BUFFER(MeshTransforms), transformsOffset + RAW_BUFFER_INDEX(particleID * 16 + 2 * 4));\n"
+		"	const vec4	m3 = LOADF4(GET_RAW_BUFFER(MeshTransforms), transformsOffset + RAW_BUFFER_INDEX(particleID * 16 + 3 * 4));\n"
+		"	return BUILD_MAT4(m0, m1, m2, m3);\n"
+		"#elif		defined(VINPUT_MeshTransform)\n"
+		"	return vInput.MeshTransform;\n"
+		"#else\n"
+		"	return BUILD_MAT4(vec4(1, 0, 0, 0), vec4(0, 1, 0, 0), vec4(0, 0, 1, 0), vec4(0, 0, 0, 1));\n"
+		"#endif\n"
+		"}\n\n";
 }
 
 //----------------------------------------------------------------------------
 
 CString		ParticleShaderGenerator::GenGetMeshTransformHelper()
 {
-	CString		getMeshMatrixHelper = "mat4		GetMeshMatrix(IN(SVertexInput) vInput VS_ARGS)\n";
-	getMeshMatrixHelper += "{\n";
-	getMeshMatrixHelper += "#if		defined(VRESOURCE_MeshTransforms)\n";
-	getMeshMatrixHelper += "	const uint	storageID = GET_CONSTANT(GPUMeshPushConstants, DrawRequest);\n";
-	getMeshMatrixHelper += "	const uint	indirectionOffsetsID = GET_CONSTANT(GPUMeshPushConstants, IndirectionOffsetsIndex);\n";
-	getMeshMatrixHelper += "	const uint	indirectionOffset = LOADU(GET_RAW_BUFFER(IndirectionOffsets), RAW_BUFFER_INDEX(indirectionOffsetsID));\n";
-	getMeshMatrixHelper += "	const uint	transformsOffset = LOADU(GET_RAW_BUFFER(MeshTransformsOffsets), RAW_BUFFER_INDEX(storageID));\n";
-	getMeshMatrixHelper += "	const uint	particleID = LOADU(GET_RAW_BUFFER(Indirection), indirectionOffset + RAW_BUFFER_INDEX(vInput.InstanceId));\n";
-	getMeshMatrixHelper += "	const vec4	m0 = LOADF4(GET_RAW_BUFFER(MeshTransforms), transformsOffset + RAW_BUFFER_INDEX(particleID * 16 + 0 * 4));\n";
-	getMeshMatrixHelper += "	const vec4	m1 = LOADF4(GET_RAW_BUFFER(MeshTransforms), transformsOffset + RAW_BUFFER_INDEX(particleID * 16 + 1 * 4));\n";
-	getMeshMatrixHelper += "	const vec4	m2 = LOADF4(GET_RAW_BUFFER(MeshTransforms), transformsOffset + RAW_BUFFER_INDEX(particleID * 16 + 2 * 4));\n";
-	getMeshMatrixHelper += "	const vec4	m3 = LOADF4(GET_RAW_BUFFER(MeshTransforms), transformsOffset + RAW_BUFFER_INDEX(particleID * 16 + 3 * 4));\n";
-	getMeshMatrixHelper += "	return BUILD_MAT4(m0, m1, m2, m3);\n";
-	getMeshMatrixHelper += "#elif		defined(VINPUT_MeshTransform)\n";
-	getMeshMatrixHelper += "	return vInput.MeshTransform;\n";
-	getMeshMatrixHelper += "#else\n";
-	getMeshMatrixHelper += "	return BUILD_MAT4(vec4(1, 0, 0, 0), vec4(0, 1, 0, 0), vec4(0, 0, 1, 0), vec4(0, 0, 0, 1));\n";
-	getMeshMatrixHelper += "#endif\n";
-	getMeshMatrixHelper += "}\n\n";
-	return getMeshMatrixHelper;
+	return kGetMeshTransformHelper;
 }
 
 //----------------------------------------------------------------------------
@@ -38,13 +38,207 @@
 __PK_SAMPLE_API_BEGIN
 //----------------------------------------------------------------------------
 
+namespace
+{
+	void	_DigestU32(CBufferDigesterMD5 &digester, u32 value)
+	{
+		digester.Append(&value, sizeof(value));
+	}
+
+	//----------------------------------------------------------------------------
+
+	void	_DigestString(CBufferDigesterMD5 &digester, const CString &str)
+	{
+		// Length first so that concatenated strings cannot produce the same key
+		_DigestU32(digester, str.Length());
+		digester.Append(str.Data(), str.Length());
+	}
+
+	//----------------------------------------------------------------------------
+
+	void	_DigestVertexOutputs(CBufferDigesterMD5 &digester, const TMemoryView<const RHI::SVertexOutput> &outputs)
+	{
+		_DigestU32(digester, outputs.Count());
+		for (const RHI::SVertexOutput &output : outputs)
+		{
+			_DigestString(digester, output.m_Name);
+			_DigestU32(digester, static_cast<u32>(output.m_Type));
+			_DigestU32(digester, static_cast<u32>(output.m_Interpolation));
+			_DigestU32(digester, output.m_InputRelated.Valid() ? static_cast<u32>(output.m_InputRelated) : ~0U);
+		}
+	}
+
+	//----------------------------------------------------------------------------
+
+	void	_DigestVertexInputs(CBufferDigesterMD5 &digester, const TMemoryView<const RHI::SVertexAttributeDesc> &inputs)
+	{
+		_DigestU32(digester, inputs.Count());
+		for (const RHI::SVertexAttributeDesc &input : inputs)
+		{
+			_DigestString(digester, input.m_Name);
+			_DigestU32(digester, static_cast<u32>(input.m_Type));
+			_DigestU32(digester, static_cast<u32>(input.m_ShaderLocationBinding));
+		}
+	}
+
+	//----------------------------------------------------------------------------
+
+	void	_DigestFragmentOutputs(CBufferDigesterMD5 &digester, const TMemoryView<const RHI::SFragmentOutput> &outputs)
+	{
+		_DigestU32(digester, outputs.Count());
+		for (const RHI::SFragmentOutput &output : outputs)
+		{
+			_DigestString(digester, output.m_Name);
+			_DigestU32(digester, static_cast<u32>(output.m_Type));
+		}
+	}
+
+	//----------------------------------------------------------------------------
+
+	// Everything from the shader description read by the generators, and by ParticleShaderGenerator
+	void	_DigestDescription(CBufferDigesterMD5 &digester, RHI::EShaderStage stage, const RHI::SShaderDescription &description)
+	{
+		_DigestU32(digester, static_cast<u32>(description.m_Pipeline));
+		_DigestU32(digester, static_cast<u32>(description.m_DrawMode));
+		// Bindings must have been generated for the target API (see CShaderCompilation::Partial)
+		const CDigestMD5	&bindingsHash = description.m_Bindings.Hash(stage);
+		digester.Append(&bindingsHash, sizeof(bindingsHash));
+		_DigestVertexInputs(digester, description.m_Bindings.m_InputAttributes);
+		_DigestVertexOutputs(digester, description.m_VertexOutput);
+		_DigestU32(digester, static_cast<u32>(description.m_GeometryOutput.m_PrimitiveType));
+		_DigestU32(digester, description.m_GeometryOutput.m_MaxVertices);
+		_DigestVertexOutputs(digester, description.m_GeometryOutput.m_GeometryOutput);
+		_DigestFragmentOutputs(digester, description.m_FragmentOutput);
+		digester.Append(&description.m_DispatchThreadSize, sizeof(description.m_DispatchThreadSize));
+	}
+
+	//----------------------------------------------------------------------------
+
+	u32		_BucketIndex(const CDigestMD5 &key, u32 bucketCount)
+	{
+		// MD5 bits are evenly distributed, the first word is enough
+		u32	word = 0;
+		Mem::Copy(&word, &key, sizeof(word));
+		return word % bucketCount;
+	}
+}
+
+//----------------------------------------------------------------------------
+//
+//	CShaderCodeBuilder
+//
+//----------------------------------------------------------------------------
+
+void	CShaderCodeBuilder::Append(const CString &fragment)
+{
+	if (fragment.Empty())
+		return;
+	if (!PK_VERIFY(m_Fragments.PushBack().Valid()))
+		return;
+	m_Fragments.Last().m_Owned = fragment; // Shares the string storage, no copy
+	m_Fragments.Last().m_Length = fragment.Length();
+	m_Length += fragment.Length();
+}
+
+//----------------------------------------------------------------------------
+
+void	CShaderCodeBuilder::AppendLiteral(const char *literal, u32 length)
+{
+	if (length == 0)
+		return;
+	if (!PK_VERIFY(m_Fragments.PushBack().Valid()))
+		return;
+	m_Fragments.Last().m_Literal = literal;
+	m_Fragments.Last().m_Length = length;
+	m_Length += length;
+}
+
+//----------------------------------------------------------------------------
+
+CString	CShaderCodeBuilder::ToString() const
+{
+	TArray<char>	buffer;
+	if (m_Length == 0 || !PK_VERIFY(buffer.Resize(m_Length)))
+		return CString();
+	char	*dst = buffer.RawDataPointer();
+	for (const SFragment &fragment : m_Fragments)
+	{
+		const char	*src = fragment.m_Literal != null ? fragment.m_Literal : fragment.m_Owned.Data();
+		Mem::Copy(dst, src, fragment.m_Length);
+		dst += fragment.m_Length;
+	}
+	return CString(buffer.RawDataPointer(), m_Length);
+}
+
+//----------------------------------------------------------------------------
+//
+//	CAbstractShaderGenerator
+//
+//----------------------------------------------------------------------------
+
+bool	CAbstractShaderGenerator::SCachedCodeTable::Find(const CDigestMD5 &key, CString &outCode) const
+{
+	for (const SCachedCode &entry : m_Buckets[_BucketIndex(key, kBucketCount)])
+	{
+		if (entry.m_Key == key)
+		{
+			outCode = entry.m_Code;
+			return true;
+		}
+	}
+	return false;
+}
+
+//----------------------------------------------------------------------------
+
+void	CAbstractShaderGenerator::SCachedCodeTable::Add(const CDigestMD5 &key, const CString &code)
+{
+	CString	existingCode;
+	if (Find(key, existingCode)) // Generated concurrently by another thread
+		return;
+	TArray<SCachedCode>	&bucket = m_Buckets[_BucketIndex(key, kBucketCount)];
+	if (bucket.Count() >= kMaxBucketEntries)
+		bucket.Remove(0);
+	if (!PK_VERIFY(bucket.PushBack().Valid()))
+		return;
+	bucket.Last().m_Key = key;
+	bucket.Last().m_Code = code;
+}
+
+//----------------------------------------------------------------------------
+
+void	CAbstractShaderGenerator::SCachedCodeTable::Clear()
+{
+	for (u32 i = 0; i < kBucketCount; ++i)
+		m_Buckets[i].Clear();
+}
+
+//----------------------------------------------------------------------------
+
+void	CAbstractShaderGenerator::ClearGenerationCache()
+{
+	PK_SCOPEDLOCK(m_CacheLock);
+	m_ShaderCache.Clear();
+	for (u32 i = 0; i < __MaxFragments; ++i)
+		m_FragmentCache[i].Clear();
+	m_CacheStats = SGenerationCacheStats();
+}
+
+//----------------------------------------------------------------------------
+
+CAbstractShaderGenerator::SGenerationCacheStats	CAbstractShaderGenerator::GenerationCacheStats() const
+{
+	PK_SCOPEDLOCK(m_CacheLock);
+	return m_CacheStats;
+}
+
+//----------------------------------------------------------------------------
+
 CString		CAbstractShaderGenerator::GenerateShader(const CString &fileContent, RHI::EShaderStage stage, const RHI::SShaderDescription &description, EShaderOptions options)
 {
+	PK_SCOPEDPROFILE();
 	PK_ASSERT_MESSAGE(description.m_Pipeline != RHI::InvalidShaderStagePipeline, "Shader pipeline is not set");
 
-	CString		shaderCode = GenDefines(description);
-	shaderCode += GenHeader(stage);
-
 	TMemoryView<const RHI::SVertexOutput>	fragmentInput;
 	if (stage == RHI::FragmentShaderStage)
 	{
@@ -62,12 +256,143 @@ CString		CAbstractShaderGenerator::GenerateShader(const CString &fileContent, RH
 		}
 	}
 
+	CDigestMD5	key;
+	{
+		CBufferDigesterMD5	digester;
+		_DigestU32(digester, static_cast<u32>(stage));
+		_DigestU32(digester, static_cast<u32>(options));
+		_DigestString(digester, fileContent);
+		_DigestDescription(digester, stage, description);
+		AppendStateToCacheKey(digester);
+		digester.Finalize(key);
+	}
+
+	{
+		PK_SCOPEDLOCK(m_CacheLock);
+		CString	cachedShader;
+		if (m_ShaderCache.Find(key, cachedShader))
+		{
+			++m_CacheStats.m_ShaderHits;
+			return cachedShader;
+		}
+		++m_CacheStats.m_ShaderMisses;
+	}
+
+	// Generate outside of the lock, only the cache accesses are serialized
+	CTimer	timer;
+	timer.Start();
+	const CString	shaderCode = _GenerateShader(fileContent, stage, description, options, fragmentInput);
+	const double	generationTime = timer.Stop();
+
+	PK_SCOPEDLOCK(m_CacheLock);
+	m_CacheStats.m_GenerationTime += generationTime;
+	m_ShaderCache.Add(key, shaderCode);
+	return shaderCode;
+}
+
+//----------------------------------------------------------------------------
+
+CString		CAbstractShaderGenerator::_GenFragment(	EFragment fragment,
+													RHI::EShaderStage stage,
+													const RHI::SShaderDescription &description,
+													const TMemoryView<const RHI::SVertexOutput> &fragmentInput)
+{
+	// Declarations only depend on a small part of the description, most permutations share them
+	CDigestMD5	key;
+	{
+		CBufferDigesterMD5	digester;
+		switch (fragment)
+		{
+		case Fragment_VertexInputs:
+			_DigestVertexInputs(digester, description.m_Bindings.m_InputAttributes);
+			break;
+		case Fragment_VertexOutputs:
+			_DigestU32(digester, description.m_Pipeline == RHI::VsPs ? 1U : 0U);
+			_DigestVertexOutputs(digester, description.m_VertexOutput);
+			break;
+		case Fragment_FragmentInputs:
+			_DigestVertexOutputs(digester, fragmentInput);
+			break;
+		case Fragment_FragmentOutputs:
+			_DigestFragmentOutputs(digester, description.m_FragmentOutput);
+			break;
+		case Fragment_ConstantSets:
+		case Fragment_PushConstants:
+		{
+			_DigestU32(digester, static_cast<u32>(stage));
+			const CDigestMD5	&bindingsHash = description.m_Bindings.Hash(stage);
+			digester.Append(&bindingsHash, sizeof(bindingsHash));
+			break;
+		}
+		default:
+			PK_ASSERT_NOT_REACHED();
+			break;
+		}
+		AppendStateToCacheKey(digester);
+		digester.Finalize(key);
+	}
+
+	{
+		PK_SCOPEDLOCK(m_CacheLock);
+		CString	cachedFragment;
+		if (m_FragmentCache[fragment].Find(key, cachedFragment))
+		{
+			++m_CacheStats.m_FragmentHits;
+			return cachedFragment;
+		}
+		++m_CacheStats.m_FragmentMisses;
+	}
+
+	CString	code;
+	switch (fragment)
+	{
+	case Fragment_VertexInputs:
+		code = GenVertexInputs(description.m_Bindings.m_InputAttributes);
+		break;
+	case Fragment_VertexOutputs:
+		code = GenVertexOutputs(description.m_VertexOutput, description.m_Pipeline == RHI::VsPs);
+		break;
+	case Fragment_FragmentInputs:
+		code = GenFragmentInputs(fragmentInput);
+		break;
+	case Fragment_FragmentOutputs:
+		code = GenFragmentOutputs(description.m_FragmentOutput);
+		break;
+	case Fragment_ConstantSets:
+		code = GenConstantSets(description.m_Bindings.m_ConstantSets, stage);
+		break;
+	case Fragment_PushConstants:
+		code = GenPushConstants(description.m_Bindings.m_PushConstants, stage);
+		break;
+	default:
+		PK_ASSERT_NOT_REACHED();
+		break;
+	}
+
+	PK_SCOPEDLOCK(m_CacheLock);
+	m_FragmentCache[fragment].Add(key, code);
+	return code;
+}
+
+//----------------------------------------------------------------------------
+
+CString		CAbstractShaderGenerator::_GenerateShader(	const CString &fileContent,
+														RHI::EShaderStage stage,
+														const RHI::SShaderDescription &description,
+														EShaderOptions options,
+														const TMemoryView<const RHI::SVertexOutput> &fragmentInput)
+{
+	CShaderCodeBuilder	shaderCode;
+
+	shaderCode += GenDefines(description);
+	shaderCode += GenHeader(stage);
+
 	shaderCode += "\n";
 	if (stage == RHI::VertexShaderStage)
 	{
-		shaderCode += GenVertexInputs(description.m_Bindings.m_InputAttributes);
+		shaderCode += _GenFragment(Fragment_VertexInputs, stage, description, fragmentInput);
 		shaderCode += "\n";
-		shaderCode += GenVertexOutputs(description.m_VertexOutput, description.m_Pipeline == RHI::VsPs);
+		shaderCode += _GenFragment(Fragment_VertexOutputs, stage, description, fragmentInput);
 		shaderCode += "\n";
 	}
 	else if (stage == RHI::GeometryShaderStage)
@@ -86,9 +411,9 @@ CString		CAbstractShaderGenerator::GenerateShader(const CString &fileContent, RH
 	}
 	else if (stage == RHI::FragmentShaderStage)
 	{
-		shaderCode += GenFragmentInputs(fragmentInput);
+		shaderCode += _GenFragment(Fragment_FragmentInputs, stage, description, fragmentInput);
 		shaderCode += "\n";
-		shaderCode += GenFragmentOutputs(description.m_FragmentOutput);
+		shaderCode += _GenFragment(Fragment_FragmentOutputs, stage, description, fragmentInput);
 		shaderCode += "\n";
 	}
 	else if (stage == RHI::ComputeShaderStage)
@@ -99,9 +424,9 @@ CString		CAbstractShaderGenerator::GenerateShader(const CString &fileContent, RH
 		shaderCode += GenComputeInputs();
 		shaderCode += "\n";
 	}
-	shaderCode += GenConstantSets(description.m_Bindings.m_ConstantSets, stage);
+	shaderCode += _GenFragment(Fragment_ConstantSets, stage, description, fragmentInput);
 	shaderCode += "\n";
-	shaderCode += GenPushConstants(description.m_Bindings.m_PushConstants, stage);
+	shaderCode += _GenFragment(Fragment_PushConstants, stage, description, fragmentInput);
 	shaderCode += "\n";
 	if (stage == RHI::ComputeShaderStage)
 	{
@@ -156,7 +481,7 @@ CString		CAbstractShaderGenerator::GenerateShader(const CString &fileContent, RH
 		PK_ASSERT_NOT_REACHED_MESSAGE("This function is either not implemented or you shouldn't be there");
 	}
 
-	return shaderCode;
+	return shaderCode.ToString();
 }
 
 //----------------------------------------------------------------------------
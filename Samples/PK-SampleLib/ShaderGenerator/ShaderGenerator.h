@@ -22,21 +22,113 @@ __PK_SAMPLE_API_BEGIN
 
 struct	SShaderCompilationSettings;
 
+//----------------------------------------------------------------------------
+//	Accumulates shader code fragments and concatenates them with a single allocation,
+//	instead of reallocating the destination string on each append.
+
+class	CShaderCodeBuilder
+{
+public:
+	CShaderCodeBuilder() : m_Length(0) {}
+
+	void		Append(const CString &fragment);
+	void		AppendLiteral(const char *literal, u32 length);	// 'literal' must outlive the builder (string literals)
+	CString		ToString() const;
+
+	CShaderCodeBuilder	&operator += (const CString &fragment) { Append(fragment); return *this; }
+	template<u32 _Size>
+	CShaderCodeBuilder	&operator += (const char (&literal)[_Size]) { AppendLiteral(literal, _Size - 1); return *this; }
+
+private:
+	struct	SFragment
+	{
+		CString		m_Owned;
+		const char	*m_Literal = null;
+		u32			m_Length = 0;
+	};
+
+	TArray<SFragment>	m_Fragments;
+	u32					m_Length;
+};
+
 //----------------------------------------------------------------------------
 
 class	CAbstractShaderGenerator
 {
 public:
+	struct	SGenerationCacheStats
+	{
+		u32		m_ShaderHits = 0;
+		u32		m_ShaderMisses = 0;
+		u32		m_FragmentHits = 0;
+		u32		m_FragmentMisses = 0;
+		double	m_GenerationTime = 0.0;	// Seconds spent generating code on shader cache misses
+	};
+
 	CAbstractShaderGenerator() {}
 	virtual ~CAbstractShaderGenerator() {}
 
 	virtual bool	GatherShaderInfo(const CString &shaderContent, const CString &shaderDir, IFileSystem *fs) { (void)shaderContent; (void)shaderDir; (void)fs; return true; }
+
+	// Memoized: permutations sharing the same (content, stage, description, options) are only generated once per generator (= per API)
 	CString			GenerateShader(	const CString &fileContent,
 									RHI::EShaderStage stage,
 									const RHI::SShaderDescription &description,
 									EShaderOptions options);
 
+	void					ClearGenerationCache();
+	SGenerationCacheStats	GenerationCacheStats() const;
+
+protected:
+	// Override if the generated code depends on state gathered in GatherShaderInfo()
+	virtual void				AppendStateToCacheKey(CBufferDigesterMD5 &digester) const { (void)digester; }
+
 private:
+	enum	EFragment
+	{
+		Fragment_VertexInputs,
+		Fragment_VertexOutputs,
+		Fragment_FragmentInputs,
+		Fragment_FragmentOutputs,
+		Fragment_ConstantSets,
+		Fragment_PushConstants,
+		__MaxFragments
+	};
+
+	struct	SCachedCode
+	{
+		CDigestMD5		m_Key;
+		CString			m_Code;
+	};
+
+	// Buckets picked from the key bits, each one bounded: the oldest entry of a full bucket is evicted
+	struct	SCachedCodeTable
+	{
+		static const u32	kBucketCount = 64;
+		static const u32	kMaxBucketEntries = 32;
+
+		TArray<SCachedCode>	m_Buckets[kBucketCount];
+
+		bool	Find(const CDigestMD5 &key, CString &outCode) const;
+		void	Add(const CDigestMD5 &key, const CString &code);
+		void	Clear();
+	};
+
+	CString						_GenerateShader(const CString &fileContent,
+												RHI::EShaderStage stage,
+												const RHI::SShaderDescription &description,
+												EShaderOptions options,
+												const TMemoryView<const RHI::SVertexOutput> &fragmentInput);
+	CString						_GenFragment(	EFragment fragment,
+												RHI::EShaderStage stage,
+												const RHI::SShaderDescription &description,
+												const TMemoryView<const RHI::SVertexOutput> &fragmentInput);
+
+	mutable Threads::CCriticalSection	m_CacheLock;
+	SCachedCodeTable					m_ShaderCache;
+	SCachedCodeTable					m_FragmentCache[__MaxFragments];
+	SGenerationCacheStats				m_CacheStats;
+
 	virtual CString				GenDefines(const RHI::SShaderDescription &description) const = 0;
 	virtual CString				GenHeader(RHI::EShaderStage stage) const = 0;
 	virtual CString				GenVertexInputs(const TMemoryView<const RHI::SVertexAttributeDesc> &vertexInputs) = 0;
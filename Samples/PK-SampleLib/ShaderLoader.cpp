@@ -32,8 +32,111 @@
 __PK_SAMPLE_API_BEGIN
 //----------------------------------------------------------------------------
 
+u64	SShaderModuleFileKey::HashPath(const CString &path)
+{
+	u64			hash = 0xCBF29CE484222325ULL;
+	const char	*data = path.Data();
+	for (u32 i = 0; i < path.Length(); ++i)
+	{
+		hash ^= static_cast<u8>(data[i]);
+		hash *= 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+//----------------------------------------------------------------------------
+
+u32	SShaderModuleFileKey::Hash() const
+{
+	u64	hash = m_PathHash;
+	hash ^= (u64(m_Stage) << 8) | u64(m_Api);
+	hash *= 0x9E3779B97F4A7C15ULL;
+	return static_cast<u32>(hash >> 32);
+}
+
+//----------------------------------------------------------------------------
+//
+//	CShaderModuleIndex
+//
+//----------------------------------------------------------------------------
+
+u32	CShaderModuleIndex::_FindSlot(const SShaderModuleFileKey &key) const
+{
+	PK_ASSERT(!m_Slots.Empty() && (m_Slots.Count() & (m_Slots.Count() - 1)) == 0);
+	const u32	mask = m_Slots.Count() - 1;
+	u32			slotIdx = key.Hash() & mask;
+	while (m_Slots[slotIdx].m_Used && !(m_Slots[slotIdx].m_Key == key))
+		slotIdx = (slotIdx + 1) & mask;
+	return slotIdx;
+}
+
+//----------------------------------------------------------------------------
+
+bool	CShaderModuleIndex::_Grow()
+{
+	const TArray<SSlot>	oldSlots = m_Slots;
+	if (oldSlots.Count() != m_Slots.Count())
+		return false;
+	m_Slots.Clear();
+	if (!m_Slots.Resize(oldSlots.Empty() ? 64 : oldSlots.Count() * 2))
+	{
+		m_Slots = oldSlots;
+		return false;
+	}
+	for (const SSlot &slot : oldSlots)
+	{
+		if (slot.m_Used)
+			m_Slots[_FindSlot(slot.m_Key)] = slot;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+bool	CShaderModuleIndex::Insert(const SShaderModuleFileKey &key, u32 value)
+{
+	// Keep the load factor under 3/4 so that probe sequences stay short
+	if ((m_Count + 1) * 4 > m_Slots.Count() * 3 && !_Grow())
+		return false;
+	SSlot	&slot = m_Slots[_FindSlot(key)];
+	if (!slot.m_Used)
+		++m_Count;
+	slot.m_Key = key;
+	slot.m_Value = value;
+	slot.m_Used = true;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+bool	CShaderModuleIndex::Find(const SShaderModuleFileKey &key, u32 &outValue) const
+{
+	if (m_Count == 0)
+		return false;
+	const SSlot	&slot = m_Slots[_FindSlot(key)];
+	if (!slot.m_Used)
+		return false;
+	outValue = slot.m_Value;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+void	CShaderModuleIndex::Clear()
+{
+	m_Slots.Clear();
+	m_Count = 0;
+}
+
+//----------------------------------------------------------------------------
+//
+//	CShaderLoader
+//
+//----------------------------------------------------------------------------
+
 bool	CShaderLoader::Release()
 {
+	m_ModuleIndex.Clear();
 	m_VertexModules.Clear();
 	m_GeometryModules.Clear();
 	m_FragmentModules.Clear();
@@ -222,42 +325,43 @@ RHI::PShaderModule	CShaderLoader::FindOrLoadShaderModule(	TArray<SLoadedModule>
 															IFileSystem					*controller)
 {
 	(void)bindings;
-	for (u32 i = 0; i < moduleLibrary.Count(); ++i)
+	const SShaderModuleFileKey	fileKey(shaderPath, stage, apiManager->ApiName());
+	u32							libraryIdx = 0;
+	if (m_ModuleIndex.Find(fileKey, libraryIdx) &&
+		PK_VERIFY(libraryIdx < moduleLibrary.Count()) &&
+		moduleLibrary[libraryIdx].m_Path == shaderPath) // Guards against path hash collisions
 	{
-		SLoadedModule	&loadedModule = moduleLibrary[i];
-		if (loadedModule.m_Path == shaderPath)
+		SLoadedModule	&loadedModule = moduleLibrary[libraryIdx];
+		for (u32 j = 0; j < loadedModule.m_Modules.Count(); ++j)
 		{
-			for (u32 j = 0; j < loadedModule.m_Modules.Count(); ++j)
+			SLoadedModule::SModule	&currentModule = loadedModule.m_Modules[j];
+			if (hash == currentModule.m_Hash)
 			{
-				SLoadedModule::SModule	&currentModule = loadedModule.m_Modules[j];
-				if (hash == currentModule.m_Hash)
-				{
-					PK_ONLY_IF_ASSERTS(
-						// Check hash collisions
-						if (!currentModule.m_ShaderBindingsForDebug.AreBindingsEqual(bindings, stage))
-						{
-							CLog::Log(PK_ERROR, "Hash collision detected for the shader \"%s\"", shaderPath.Data());
-							PK_ASSERT_NOT_REACHED_MESSAGE("Hash collision detected");
-							return null;
-						}
-					);
-					return currentModule.m_Module;
-				}
+				PK_ONLY_IF_ASSERTS(
+					// Check hash collisions
+					if (!currentModule.m_ShaderBindingsForDebug.AreBindingsEqual(bindings, stage))
+					{
+						CLog::Log(PK_ERROR, "Hash collision detected for the shader \"%s\"", shaderPath.Data());
+						PK_ASSERT_NOT_REACHED_MESSAGE("Hash collision detected");
+						return null;
+					}
+				);
+				return currentModule.m_Module;
 			}
-
-			RHI::PShaderModule	module = LoadShaderModule(shaderPath, hash, apiManager, stage, controller);
-			if (module == null)
-				return null;
-
-			if (!loadedModule.m_Modules.PushBack().Valid())
-				return null;
-			loadedModule.m_Modules.Last().m_Module = module;
-			loadedModule.m_Modules.Last().m_Hash = hash;
-			PK_ONLY_IF_ASSERTS(
-				loadedModule.m_Modules.Last().m_ShaderBindingsForDebug = bindings;
-			);
-			return module;
 		}
+
+		RHI::PShaderModule	module = LoadShaderModule(shaderPath, hash, apiManager, stage, controller);
+		if (module == null)
+			return null;
+
+		if (!loadedModule.m_Modules.PushBack().Valid())
+			return null;
+		loadedModule.m_Modules.Last().m_Module = module;
+		loadedModule.m_Modules.Last().m_Hash = hash;
+		PK_ONLY_IF_ASSERTS(
+			loadedModule.m_Modules.Last().m_ShaderBindingsForDebug = bindings;
+		);
+		return module;
 	}
 
 	RHI::PShaderModule	module = LoadShaderModule(shaderPath, hash, apiManager, stage, controller);
@@ -271,6 +375,12 @@ RHI::PShaderModule	CShaderLoader::FindOrLoadShaderModule(	TArray<SLoadedModule>
 		return null;
 	}
 
+	if (!m_ModuleIndex.Insert(fileKey, moduleLibrary.Count() - 1))
+	{
+		moduleLibrary.PopBackAndDiscard();
+		return null;
+	}
+
 	moduleLibrary.Last().m_Path = shaderPath;
 	moduleLibrary.Last().m_Modules.Last().m_Hash = hash;
 	PK_ONLY_IF_ASSERTS(
@@ -19,6 +19,59 @@
 __PK_SAMPLE_API_BEGIN
 //----------------------------------------------------------------------------
 
+// Identifies a shader module file for a given stage and graphics API
+struct	SShaderModuleFileKey
+{
+	u64						m_PathHash;
+	RHI::EShaderStage		m_Stage;
+	RHI::EGraphicalApi		m_Api;
+
+	SShaderModuleFileKey() : m_PathHash(0), m_Stage(RHI::VertexShaderStage), m_Api(RHI::GApi_Null) {}
+	SShaderModuleFileKey(const CString &path, RHI::EShaderStage stage, RHI::EGraphicalApi api)
+	:	m_PathHash(HashPath(path))
+	,	m_Stage(stage)
+	,	m_Api(api)
+	{
+	}
+
+	static u64		HashPath(const CString &path);	// FNV-1a, stable across runs
+	u32				Hash() const;
+	bool			operator == (const SShaderModuleFileKey &other) const { return m_PathHash == other.m_PathHash && m_Stage == other.m_Stage && m_Api == other.m_Api; }
+};
+
+//----------------------------------------------------------------------------
+
+// Open-addressed (linear probing) index: SShaderModuleFileKey -> u32 value
+// Used to replace linear scans over loaded shader modules
+class	CShaderModuleIndex
+{
+public:
+	CShaderModuleIndex() : m_Count(0) {}
+
+	bool		Insert(const SShaderModuleFileKey &key, u32 value);
+	bool		Find(const SShaderModuleFileKey &key, u32 &outValue) const;
+	void		Clear();
+	u32			Count() const { return m_Count; }
+
+private:
+	struct	SSlot
+	{
+		SShaderModuleFileKey	m_Key;
+		u32						m_Value;
+		bool					m_Used;
+
+		SSlot() : m_Value(0), m_Used(false) {}
+	};
+
+	bool		_Grow();
+	u32			_FindSlot(const SShaderModuleFileKey &key) const;	// Returns the slot containing 'key', or the first free slot
+
+	TArray<SSlot>	m_Slots;	// Power of two count
+	u32				m_Count;
+};
+
+//----------------------------------------------------------------------------
+
 class	CShaderLoader
 {
 public:
@@ -104,6 +157,9 @@ private:
 											RHI::EShaderStage stage,
 											IFileSystem *controller);
 
+	// Indexes in the per-stage module libraries, keyed by (path, stage, api)
+	CShaderModuleIndex			m_ModuleIndex;
+
 	TArray<SLoadedModule>		m_VertexModules;
 	TArray<SLoadedModule>		m_GeometryModules;
 	TArray<SLoadedModule>		m_FragmentModules;